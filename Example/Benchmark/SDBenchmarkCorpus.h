@@ -0,0 +1,34 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+
+/// One encoded image of the benchmark corpus
+@interface SDBenchmarkCorpusItem : NSObject
+
+@property (nonatomic, copy, readonly, nonnull) NSData *data;
+@property (nonatomic, copy, readonly, nonnull) NSString *MIMEType;
+@property (nonatomic, assign, readonly) NSUInteger pixelWidth;
+@property (nonatomic, assign, readonly) NSUInteger pixelHeight;
+
+@end
+
+/**
+ A deterministic image corpus generated in memory, so the benchmark does not need any network or resource file.
+ The items cycle the pixel size (320x240 to 2048x1536) and the format (baseline JPEG, progressive JPEG and PNG), the same seed always produce the same bytes.
+ */
+@interface SDBenchmarkCorpus : NSObject
+
+- (nonnull instancetype)initWithCount:(NSUInteger)count seed:(unsigned short)seed NS_DESIGNATED_INITIALIZER;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly, nonnull) NSArray<SDBenchmarkCorpusItem *> *items;
+/// The total encoded bytes
+@property (nonatomic, assign, readonly) unsigned long long totalBytes;
+
+@end
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDBenchmarkCorpus.h"
+#import <CoreGraphics/CoreGraphics.h>
+#import <ImageIO/ImageIO.h>
+
+@implementation SDBenchmarkCorpusItem
+
+- (instancetype)initWithData:(NSData *)data MIMEType:(NSString *)MIMEType pixelWidth:(NSUInteger)pixelWidth pixelHeight:(NSUInteger)pixelHeight {
+    self = [super init];
+    if (self) {
+        _data = [data copy];
+        _MIMEType = [MIMEType copy];
+        _pixelWidth = pixelWidth;
+        _pixelHeight = pixelHeight;
+    }
+    return self;
+}
+
+@end
+
+@implementation SDBenchmarkCorpus
+
+- (instancetype)initWithCount:(NSUInteger)count seed:(unsigned short)seed {
+    self = [super init];
+    if (self) {
+        static const CGSize sizes[] = {{320, 240}, {640, 480}, {1280, 960}, {2048, 1536}};
+        static const NSUInteger sizeCount = sizeof(sizes) / sizeof(sizes[0]);
+        unsigned short randomState[3] = {seed, (unsigned short)(seed >> 3), 0x330E};
+        NSMutableArray<SDBenchmarkCorpusItem *> *items = [NSMutableArray arrayWithCapacity:count];
+        unsigned long long totalBytes = 0;
+        for (NSUInteger i = 0; i < count; i++) {
+            CGSize size = sizes[i % sizeCount];
+            // Cycle the format with a different period, so each size has each format
+            NSUInteger format = (i / sizeCount) % 3;
+            CGImageRef imageRef = [self.class newImageWithSize:size randomState:randomState];
+            if (!imageRef) {
+                continue;
+            }
+            NSData *data;
+            NSString *MIMEType;
+            if (format == 2) {
+                data = [self.class encodedDataWithImage:imageRef type:@"public.png" properties:nil];
+                MIMEType = @"image/png";
+            } else {
+                NSDictionary *properties = @{(__bridge NSString *)kCGImageDestinationLossyCompressionQuality : @(0.8),
+                                             (__bridge NSString *)kCGImagePropertyJFIFDictionary : @{(__bridge NSString *)kCGImagePropertyJFIFIsProgressive : @(format == 1)}};
+                data = [self.class encodedDataWithImage:imageRef type:@"public.jpeg" properties:properties];
+                MIMEType = @"image/jpeg";
+            }
+            CGImageRelease(imageRef);
+            if (!data) {
+                continue;
+            }
+            [items addObject:[[SDBenchmarkCorpusItem alloc] initWithData:data MIMEType:MIMEType pixelWidth:size.width pixelHeight:size.height]];
+            totalBytes += data.length;
+        }
+        _items = [items copy];
+        _totalBytes = totalBytes;
+    }
+    return self;
+}
+
+// A gradient with random rectangles, which does not compress too well like the real photos
++ (CGImageRef)newImageWithSize:(CGSize)size randomState:(unsigned short *)randomState CF_RETURNS_RETAINED {
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, size.width, size.height, 8, 0, colorSpace, kCGImageAlphaNoneSkipLast | kCGBitmapByteOrder32Big);
+    if (!context) {
+        CGColorSpaceRelease(colorSpace);
+        return NULL;
+    }
+    CGFloat components[8] = {erand48(randomState), erand48(randomState), erand48(randomState), 1,
+                             erand48(randomState), erand48(randomState), erand48(randomState), 1};
+    CGGradientRef gradient = CGGradientCreateWithColorComponents(colorSpace, components, NULL, 2);
+    CGContextDrawLinearGradient(context, gradient, CGPointZero, CGPointMake(size.width, size.height), 0);
+    CGGradientRelease(gradient);
+    CGColorSpaceRelease(colorSpace);
+    NSUInteger rectCount = (NSUInteger)(size.width * size.height / 2048);
+    for (NSUInteger i = 0; i < rectCount; i++) {
+        CGContextSetRGBFillColor(context, erand48(randomState), erand48(randomState), erand48(randomState), erand48(randomState));
+        CGRect rect = CGRectMake(erand48(randomState) * size.width, erand48(randomState) * size.height, erand48(randomState) * 64 + 1, erand48(randomState) * 64 + 1);
+        CGContextFillRect(context, rect);
+    }
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    return imageRef;
+}
+
++ (NSData *)encodedDataWithImage:(CGImageRef)imageRef type:(NSString *)type properties:(NSDictionary *)properties {
+    NSMutableData *data = [NSMutableData data];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data, (__bridge CFStringRef)type, 1, NULL);
+    if (!destination) {
+        return nil;
+    }
+    CGImageDestinationAddImage(destination, imageRef, (__bridge CFDictionaryRef)properties);
+    BOOL success = CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    return success ? [data copy] : nil;
+}
+
+@end
@@ -0,0 +1,100 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class ImageLoaderDownloader;
+@class ImageLoaderManager;
+
+/**
+ A synthetic scroll trace over a list of images. The list is scrolled by flings which decelerate by the friction, with a dwell between them, and some flings go backward.
+ The visible items and the prefetch items ahead are requested, the requests of items scrolled far away are cancelled, like a collection view with prefetching.
+ The same seed always produce the same trace.
+ */
+@interface SDBenchmarkScrollTrace : NSObject
+
+/// The item count of the list. Defaults to 500
+@property (nonatomic, assign) NSUInteger itemCount;
+/// The visible item count. Defaults to 12
+@property (nonatomic, assign) NSUInteger visibleCount;
+/// The prefetched item count ahead of the scroll direction. Defaults to 6
+@property (nonatomic, assign) NSUInteger prefetchCount;
+/// The item count out of the visible and prefetch range before the request is cancelled. Defaults to 12
+@property (nonatomic, assign) NSUInteger cancelDistance;
+/// The frame interval, in seconds. Defaults to 1/60
+@property (nonatomic, assign) NSTimeInterval frameInterval;
+/// The max fling velocity, in items per second. Defaults to 40
+@property (nonatomic, assign) double maxVelocity;
+/// The velocity decay per second. Defaults to 0.15, which means 15% of the velocity is kept after 1 second
+@property (nonatomic, assign) double friction;
+/// The max dwell between flings, in seconds. Defaults to 0.5
+@property (nonatomic, assign) NSTimeInterval maxDwell;
+/// The probability of backward fling. Defaults to 0.15
+@property (nonatomic, assign) double backwardProbability;
+/// The seed of the trace. Defaults to 1
+@property (nonatomic, assign) unsigned short seed;
+
+@end
+
+/// The result of one trace run
+@interface SDBenchmarkResult : NSObject
+
+/// The started request count
+@property (nonatomic, assign, readonly) NSUInteger requestCount;
+/// The request count which delivered the image
+@property (nonatomic, assign, readonly) NSUInteger imageCount;
+/// The request count which delivered the image from cache (manager only)
+@property (nonatomic, assign, readonly) NSUInteger cacheHitCount;
+/// The request count which failed, not including the cancelled ones
+@property (nonatomic, assign, readonly) NSUInteger failedCount;
+/// The request count cancelled by the trace
+@property (nonatomic, assign, readonly) NSUInteger cancelledCount;
+/// The sorted time-to-image of each delivered image, from the request start to the completion on the main queue, in seconds
+@property (nonatomic, copy, readonly, nonnull) NSArray<NSNumber *> *timesToImage;
+/// The wall time of the run, until the last request completed
+@property (nonatomic, assign, readonly) NSTimeInterval wallTime;
+/// The user and system CPU time of the process during the run
+@property (nonatomic, assign, readonly) NSTimeInterval CPUTime;
+/// The body bytes sent by the stand-in server during the run
+@property (nonatomic, assign, readonly) unsigned long long receivedBytes;
+
+/// The time-to-image at the percentile (nearest rank), such as 0.95 for p95. 0 if no image
+- (NSTimeInterval)timeToImageAtPercentile:(double)percentile;
+/// The delivered images per second of wall time
+@property (nonatomic, assign, readonly) double imageThroughput;
+/// The received bytes per second of wall time
+@property (nonatomic, assign, readonly) double byteThroughput;
+
+/// The JSON compatible dictionary
+- (nonnull NSDictionary<NSString *, id> *)dictionaryRepresentation;
+
+@end
+
+/**
+ The load generator, which drives the downloader or the manager with the scroll trace and measures it. All the requests and callbacks are on the main queue, like the UI code.
+ */
+@interface SDBenchmarkLoadGenerator : NSObject
+
+/// Drive the downloader directly, `options` is `ImageLoaderDownloaderOptions`
+- (nonnull instancetype)initWithDownloader:(nonnull ImageLoaderDownloader *)downloader options:(NSUInteger)options;
+/// Drive the manager (cache and loader), `options` is `ImageLoaderOptions`
+- (nonnull instancetype)initWithManager:(nonnull ImageLoaderManager *)manager options:(NSUInteger)options;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+/// The base URL of the images, the request URL is `<baseURL>/image/<item>`
+@property (nonatomic, copy, nonnull) NSURL *baseURL;
+
+/**
+ Run the trace and wait until all the requests completed. Must be called on the main thread, which spins the main run loop.
+
+ @param trace The scroll trace
+ @return The result
+ */
+- (nonnull SDBenchmarkResult *)runTrace:(nonnull SDBenchmarkScrollTrace *)trace;
+
+@end
@@ -0,0 +1,301 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDBenchmarkLoadGenerator.h"
+#import "SDBenchmarkURLProtocol.h"
+#import <ImageLoader/ImageLoader.h>
+#import <sys/resource.h>
+
+static NSTimeInterval SDBenchmarkCurrentCPUTime(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+@implementation SDBenchmarkScrollTrace
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _itemCount = 500;
+        _visibleCount = 12;
+        _prefetchCount = 6;
+        _cancelDistance = 12;
+        _frameInterval = 1.0 / 60;
+        _maxVelocity = 40;
+        _friction = 0.15;
+        _maxDwell = 0.5;
+        _backwardProbability = 0.15;
+        _seed = 1;
+    }
+    return self;
+}
+
+@end
+
+@interface SDBenchmarkResult ()
+
+@property (nonatomic, assign, readwrite) NSUInteger requestCount;
+@property (nonatomic, assign, readwrite) NSUInteger imageCount;
+@property (nonatomic, assign, readwrite) NSUInteger cacheHitCount;
+@property (nonatomic, assign, readwrite) NSUInteger failedCount;
+@property (nonatomic, assign, readwrite) NSUInteger cancelledCount;
+@property (nonatomic, copy, readwrite) NSArray<NSNumber *> *timesToImage;
+@property (nonatomic, assign, readwrite) NSTimeInterval wallTime;
+@property (nonatomic, assign, readwrite) NSTimeInterval CPUTime;
+@property (nonatomic, assign, readwrite) unsigned long long receivedBytes;
+
+@end
+
+@implementation SDBenchmarkResult
+
+- (NSTimeInterval)timeToImageAtPercentile:(double)percentile {
+    NSArray<NSNumber *> *timesToImage = self.timesToImage;
+    if (timesToImage.count == 0) {
+        return 0;
+    }
+    NSInteger rank = (NSInteger)ceil(MIN(MAX(percentile, 0), 1) * timesToImage.count) - 1;
+    return timesToImage[MAX(rank, 0)].doubleValue;
+}
+
+- (double)imageThroughput {
+    return self.wallTime > 0 ? self.imageCount / self.wallTime : 0;
+}
+
+- (double)byteThroughput {
+    return self.wallTime > 0 ? self.receivedBytes / self.wallTime : 0;
+}
+
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation {
+    return @{@"requests" : @(self.requestCount),
+             @"images" : @(self.imageCount),
+             @"cacheHits" : @(self.cacheHitCount),
+             @"failed" : @(self.failedCount),
+             @"cancelled" : @(self.cancelledCount),
+             @"p50" : @([self timeToImageAtPercentile:0.5]),
+             @"p95" : @([self timeToImageAtPercentile:0.95]),
+             @"p99" : @([self timeToImageAtPercentile:0.99]),
+             @"wallTime" : @(self.wallTime),
+             @"cpuTime" : @(self.CPUTime),
+             @"receivedBytes" : @(self.receivedBytes),
+             @"imageThroughput" : @(self.imageThroughput),
+             @"byteThroughput" : @(self.byteThroughput)};
+}
+
+@end
+
+/// One request of an item, only accessed on main queue
+@interface SDBenchmarkRequest : NSObject
+
+@property (nonatomic, assign) CFAbsoluteTime startTime;
+@property (nonatomic, strong) id<ImageLoaderOperation> operation;
+@property (nonatomic, assign) BOOL cancelled;
+@property (nonatomic, assign) BOOL completed;
+
+@end
+
+@implementation SDBenchmarkRequest
+@end
+
+@interface SDBenchmarkLoadGenerator ()
+
+@property (nonatomic, strong) ImageLoaderDownloader *downloader;
+@property (nonatomic, strong) ImageLoaderManager *manager;
+@property (nonatomic, assign) NSUInteger options;
+
+// The state of current run, only accessed on main queue
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, SDBenchmarkRequest *> *activeRequests;
+@property (nonatomic, strong) NSMutableIndexSet *boundItems; // requested and not scrolled far away, like the cell showing the item
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *timesToImage;
+@property (nonatomic, strong) SDBenchmarkResult *result;
+
+@end
+
+@implementation SDBenchmarkLoadGenerator
+
+- (instancetype)initWithDownloader:(ImageLoaderDownloader *)downloader options:(NSUInteger)options {
+    self = [super init];
+    if (self) {
+        _downloader = downloader;
+        _options = options;
+        _baseURL = [NSURL URLWithString:[NSString stringWithFormat:@"http://%@", SDBenchmarkURLProtocol.serverConfig.host]];
+    }
+    return self;
+}
+
+- (instancetype)initWithManager:(ImageLoaderManager *)manager options:(NSUInteger)options {
+    self = [super init];
+    if (self) {
+        _manager = manager;
+        _options = options;
+        _baseURL = [NSURL URLWithString:[NSString stringWithFormat:@"http://%@", SDBenchmarkURLProtocol.serverConfig.host]];
+    }
+    return self;
+}
+
+- (SDBenchmarkResult *)runTrace:(SDBenchmarkScrollTrace *)trace {
+    NSParameterAssert([NSThread isMainThread]);
+    self.activeRequests = [NSMutableDictionary dictionary];
+    self.boundItems = [NSMutableIndexSet indexSet];
+    self.timesToImage = [NSMutableArray array];
+    self.result = [SDBenchmarkResult new];
+    unsigned long long startBytes = SDBenchmarkURLProtocol.sentBytes;
+    NSTimeInterval startCPUTime = SDBenchmarkCurrentCPUTime();
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
+    // The trace is simulated with fixed time step, so the same seed produce the same requests
+    unsigned short randomState[3] = {trace.seed, (unsigned short)(trace.seed >> 7), 0x330E};
+    NSTimeInterval frameInterval = MAX(trace.frameInterval, 0.001);
+    double maxPosition = trace.itemCount > trace.visibleCount ? trace.itemCount - trace.visibleCount : 0;
+    double position = 0;
+    double velocity = 0;
+    NSInteger direction = 1;
+    // Look at the first screen before the first fling
+    NSTimeInterval dwell = erand48(randomState) * trace.maxDwell;
+    CFAbsoluteTime nextFrameTime = startTime;
+    [self updateWindowWithPosition:position direction:direction trace:trace];
+    while (position < maxPosition) {
+        nextFrameTime += frameInterval;
+        [self spinRunLoopUntilDate:[NSDate dateWithTimeIntervalSinceReferenceDate:nextFrameTime]];
+        if (dwell > 0) {
+            dwell -= frameInterval;
+            if (dwell <= 0) {
+                direction = (position > 0 && erand48(randomState) < trace.backwardProbability) ? -1 : 1;
+                velocity = direction * trace.maxVelocity * (0.3 + 0.7 * erand48(randomState));
+            }
+            continue;
+        }
+        position = MIN(MAX(position + velocity * frameInterval, 0), maxPosition);
+        velocity *= pow(trace.friction, frameInterval);
+        if (fabs(velocity) < 0.5 || position <= 0) {
+            velocity = 0;
+            dwell = MAX(erand48(randomState) * trace.maxDwell, frameInterval);
+        }
+        [self updateWindowWithPosition:position direction:direction trace:trace];
+    }
+    // Wait for the requests of the last screen
+    while (self.activeRequests.count > 0) {
+        [self spinRunLoopUntilDate:[NSDate dateWithTimeIntervalSinceNow:frameInterval]];
+    }
+    
+    SDBenchmarkResult *result = self.result;
+    result.wallTime = CFAbsoluteTimeGetCurrent() - startTime;
+    result.CPUTime = SDBenchmarkCurrentCPUTime() - startCPUTime;
+    result.receivedBytes = SDBenchmarkURLProtocol.sentBytes - startBytes;
+    result.timesToImage = [self.timesToImage sortedArrayUsingSelector:@selector(compare:)];
+    self.activeRequests = nil;
+    self.boundItems = nil;
+    self.timesToImage = nil;
+    self.result = nil;
+    return result;
+}
+
+- (void)spinRunLoopUntilDate:(NSDate *)date {
+    while (date.timeIntervalSinceNow > 0) {
+        [[NSRunLoop mainRunLoop] runMode:NSDefaultRunLoopMode beforeDate:date];
+    }
+}
+
+#pragma mark - Window
+
+- (void)updateWindowWithPosition:(double)position direction:(NSInteger)direction trace:(SDBenchmarkScrollTrace *)trace {
+    NSInteger itemCount = trace.itemCount;
+    NSInteger first = (NSInteger)floor(position);
+    NSInteger last = first + (NSInteger)trace.visibleCount; // exclusive
+    NSInteger wantedFirst = direction < 0 ? first - (NSInteger)trace.prefetchCount : first;
+    NSInteger wantedLast = direction < 0 ? last : last + (NSInteger)trace.prefetchCount;
+    wantedFirst = MAX(wantedFirst, 0);
+    wantedLast = MIN(wantedLast, itemCount);
+    NSInteger keptFirst = wantedFirst - (NSInteger)trace.cancelDistance;
+    NSInteger keptLast = wantedLast + (NSInteger)trace.cancelDistance;
+    
+    // Items scrolled far away, cancel the request and unbind, the item will be requested again when it comes back
+    NSMutableIndexSet *unboundItems = [NSMutableIndexSet indexSet];
+    [self.boundItems enumerateIndexesUsingBlock:^(NSUInteger item, BOOL * _Nonnull stop) {
+        if ((NSInteger)item < keptFirst || (NSInteger)item >= keptLast) {
+            [unboundItems addIndex:item];
+        }
+    }];
+    [unboundItems enumerateIndexesUsingBlock:^(NSUInteger item, BOOL * _Nonnull stop) {
+        [self.boundItems removeIndex:item];
+        [self cancelItem:item];
+    }];
+    
+    for (NSInteger item = wantedFirst; item < wantedLast; item++) {
+        if (![self.boundItems containsIndex:item]) {
+            [self.boundItems addIndex:item];
+            [self requestItem:item];
+        }
+    }
+}
+
+#pragma mark - Request
+
+- (void)requestItem:(NSUInteger)item {
+    NSURL *url = [self.baseURL URLByAppendingPathComponent:[NSString stringWithFormat:@"image/%lu", (unsigned long)item]];
+    SDBenchmarkRequest *request = [SDBenchmarkRequest new];
+    request.startTime = CFAbsoluteTimeGetCurrent();
+    self.activeRequests[@(item)] = request;
+    self.result.requestCount++;
+    
+    id<ImageLoaderOperation> operation;
+    if (self.manager) {
+        operation = [self.manager loadImageWithURL:url options:self.options progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, LoadImageCacheType cacheType, BOOL finished, NSURL * _Nullable imageURL) {
+            if (!finished) {
+                return;
+            }
+            [self completeRequest:request item:item image:image cached:cacheType != LoadImageCacheTypeNone];
+        }];
+    } else {
+        operation = [self.downloader downloadImageWithURL:url options:self.options progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            if (!finished) {
+                return;
+            }
+            [self completeRequest:request item:item image:image cached:NO];
+        }];
+    }
+    if (!request.completed) {
+        request.operation = operation;
+    }
+}
+
+- (void)cancelItem:(NSUInteger)item {
+    SDBenchmarkRequest *request = self.activeRequests[@(item)];
+    if (!request) {
+        return;
+    }
+    [self.activeRequests removeObjectForKey:@(item)];
+    request.cancelled = YES;
+    self.result.cancelledCount++;
+    [request.operation cancel];
+    request.operation = nil;
+}
+
+- (void)completeRequest:(SDBenchmarkRequest *)request item:(NSUInteger)item image:(UIImage *)image cached:(BOOL)cached {
+    if (request.cancelled || request.completed) {
+        return;
+    }
+    request.completed = YES;
+    request.operation = nil;
+    if (self.activeRequests[@(item)] == request) {
+        [self.activeRequests removeObjectForKey:@(item)];
+    }
+    if (image) {
+        [self.timesToImage addObject:@(CFAbsoluteTimeGetCurrent() - request.startTime)];
+        self.result.imageCount++;
+        if (cached) {
+            self.result.cacheHitCount++;
+        }
+    } else {
+        self.result.failedCount++;
+    }
+}
+
+@end
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class SDBenchmarkCorpus;
+
+/**
+ The behavior of the stand-in HTTP server. The instance is copied when set to `SDBenchmarkURLProtocol.serverConfig`, change it before the benchmark run.
+ */
+@interface SDBenchmarkServerConfig : NSObject <NSCopying>
+
+/// The host to serve, the request URL is `http://<host>/image/<index>`, the index is wrapped by the corpus count. Defaults to `benchmark.imageloader.invalid`
+@property (nonatomic, copy, nonnull) NSString *host;
+/// The image corpus to serve
+@property (nonatomic, strong, nullable) SDBenchmarkCorpus *corpus;
+/// The delay before the response header, in seconds. Defaults to 0
+@property (nonatomic, assign) NSTimeInterval latency;
+/// The latency of other hosts to serve as well, the key is the lowercase host name. So a fast host and a slow host can be served at the same time. Defaults to nil
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *latenciesForHosts;
+/// The bandwidth of each connection, in bytes per second. Defaults to 0, which means no limit
+@property (nonatomic, assign) NSUInteger bandwidth;
+/// The ratio of request (0.0-1.0) responded with 503 Service Unavailable. Defaults to 0
+@property (nonatomic, assign) double errorRate;
+/// The body chunk size, in bytes. Defaults to 16KB
+@property (nonatomic, assign) NSUInteger chunkSize;
+/// Whether to respond the `Range` request with 206 Partial Content (or 416), else the full body. Defaults to YES
+@property (nonatomic, assign) BOOL supportsRange;
+/// The `Cache-Control` header, the `ETag` header is always sent and `If-None-Match` is responded with 304 Not Modified. Defaults to `max-age=3600`, nil means no header
+@property (nonatomic, copy, nullable) NSString *cacheControl;
+/// The seed of the error injection. Defaults to 0
+@property (nonatomic, assign) unsigned short seed;
+
+@end
+
+/**
+ A local HTTP/1.1 stand-in server, implemented as URL protocol so it runs offline and in process. Register it to the session configuration with `protocolClasses`.
+ The response is paced on a background queue, and delivered on the loading thread of the URL loading system.
+ */
+@interface SDBenchmarkURLProtocol : NSURLProtocol
+
+/// The server config, thread-safe
+@property (nonatomic, class, copy, nonnull) SDBenchmarkServerConfig *serverConfig;
+
+/// The started request count, thread-safe
+@property (nonatomic, class, readonly) NSUInteger requestCount;
+/// The request count responded with injected error, thread-safe
+@property (nonatomic, class, readonly) NSUInteger errorCount;
+/// The sent body bytes, thread-safe
+@property (nonatomic, class, readonly) unsigned long long sentBytes;
+/// The started requests in order, thread-safe. Only recorded when `recordsRequests` is YES
+@property (nonatomic, class, readonly, nonnull) NSArray<NSURLRequest *> *startedRequests;
+/// Whether to record the started requests, used by tests to check the request headers. Defaults to NO
+@property (nonatomic, class, assign) BOOL recordsRequests;
+
+/// Reset the counters and the started requests
++ (void)resetStatistics;
+
+@end
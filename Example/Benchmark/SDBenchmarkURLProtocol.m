@@ -0,0 +1,306 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDBenchmarkURLProtocol.h"
+#import "SDBenchmarkCorpus.h"
+#import <stdatomic.h>
+
+@implementation SDBenchmarkServerConfig
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _host = @"benchmark.imageloader.invalid";
+        _chunkSize = 16 * 1024;
+        _supportsRange = YES;
+        _cacheControl = @"max-age=3600";
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    SDBenchmarkServerConfig *config = [[[self class] allocWithZone:zone] init];
+    config.host = self.host;
+    config.corpus = self.corpus;
+    config.latency = self.latency;
+    config.latenciesForHosts = self.latenciesForHosts;
+    config.bandwidth = self.bandwidth;
+    config.errorRate = self.errorRate;
+    config.chunkSize = self.chunkSize;
+    config.supportsRange = self.supportsRange;
+    config.cacheControl = self.cacheControl;
+    config.seed = self.seed;
+    return config;
+}
+
+@end
+
+static SDBenchmarkServerConfig *SDBenchmarkCurrentServerConfig;
+static unsigned short SDBenchmarkErrorRandomState[3];
+static atomic_ulong SDBenchmarkRequestCount;
+static atomic_ulong SDBenchmarkErrorCount;
+static atomic_ullong SDBenchmarkSentBytes;
+static NSMutableArray<NSURLRequest *> *SDBenchmarkStartedRequests;
+static BOOL SDBenchmarkRecordsRequests;
+
+@interface SDBenchmarkURLProtocol ()
+
+@property (nonatomic, strong) SDBenchmarkServerConfig *config;
+@property (nonatomic, strong) NSThread *clientThread;
+@property (nonatomic, copy) NSArray<NSString *> *clientModes;
+@property (nonatomic, assign) BOOL stopped; // only accessed on client thread
+@property (nonatomic, copy) NSData *body;
+@property (nonatomic, assign) NSUInteger offset;
+
+@end
+
+@implementation SDBenchmarkURLProtocol
+
++ (void)initialize {
+    if (self == [SDBenchmarkURLProtocol class]) {
+        SDBenchmarkCurrentServerConfig = [SDBenchmarkServerConfig new];
+        SDBenchmarkStartedRequests = [NSMutableArray array];
+    }
+}
+
++ (SDBenchmarkServerConfig *)serverConfig {
+    @synchronized (self) {
+        return SDBenchmarkCurrentServerConfig;
+    }
+}
+
++ (void)setServerConfig:(SDBenchmarkServerConfig *)serverConfig {
+    @synchronized (self) {
+        SDBenchmarkCurrentServerConfig = [serverConfig copy];
+        unsigned short seed = SDBenchmarkCurrentServerConfig.seed;
+        SDBenchmarkErrorRandomState[0] = seed;
+        SDBenchmarkErrorRandomState[1] = (unsigned short)(seed >> 5);
+        SDBenchmarkErrorRandomState[2] = 0x330E;
+    }
+}
+
++ (BOOL)shouldInjectErrorWithRate:(double)errorRate {
+    if (errorRate <= 0) {
+        return NO;
+    }
+    @synchronized (self) {
+        return erand48(SDBenchmarkErrorRandomState) < errorRate;
+    }
+}
+
++ (NSUInteger)requestCount {
+    return atomic_load_explicit(&SDBenchmarkRequestCount, memory_order_relaxed);
+}
+
++ (NSUInteger)errorCount {
+    return atomic_load_explicit(&SDBenchmarkErrorCount, memory_order_relaxed);
+}
+
++ (unsigned long long)sentBytes {
+    return atomic_load_explicit(&SDBenchmarkSentBytes, memory_order_relaxed);
+}
+
++ (NSArray<NSURLRequest *> *)startedRequests {
+    @synchronized (self) {
+        return [SDBenchmarkStartedRequests copy];
+    }
+}
+
++ (BOOL)recordsRequests {
+    @synchronized (self) {
+        return SDBenchmarkRecordsRequests;
+    }
+}
+
++ (void)setRecordsRequests:(BOOL)recordsRequests {
+    @synchronized (self) {
+        SDBenchmarkRecordsRequests = recordsRequests;
+    }
+}
+
++ (void)recordStartedRequest:(NSURLRequest *)request {
+    @synchronized (self) {
+        if (SDBenchmarkRecordsRequests) {
+            [SDBenchmarkStartedRequests addObject:request];
+        }
+    }
+}
+
++ (void)resetStatistics {
+    atomic_store_explicit(&SDBenchmarkRequestCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&SDBenchmarkErrorCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&SDBenchmarkSentBytes, 0, memory_order_relaxed);
+    @synchronized (self) {
+        [SDBenchmarkStartedRequests removeAllObjects];
+    }
+}
+
++ (dispatch_queue_t)pacingQueue {
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.hackemist.SDBenchmarkURLProtocol.pacingQueue", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
+#pragma mark - NSURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    NSURL *url = request.URL;
+    if (![url.scheme.lowercaseString isEqualToString:@"http"]) {
+        return NO;
+    }
+    SDBenchmarkServerConfig *config = self.serverConfig;
+    NSString *host = url.host.lowercaseString;
+    return [host isEqualToString:config.host.lowercaseString] || config.latenciesForHosts[host] != nil;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    atomic_fetch_add_explicit(&SDBenchmarkRequestCount, 1, memory_order_relaxed);
+    [self.class recordStartedRequest:self.request];
+    self.config = self.class.serverConfig;
+    // The client must be called on the loading thread, in the run loop mode when started
+    self.clientThread = [NSThread currentThread];
+    NSMutableArray<NSString *> *modes = [NSMutableArray arrayWithObject:NSDefaultRunLoopMode];
+    NSString *currentMode = [NSRunLoop currentRunLoop].currentMode;
+    if (currentMode && ![currentMode isEqualToString:NSDefaultRunLoopMode]) {
+        [modes addObject:currentMode];
+    }
+    self.clientModes = modes;
+    NSNumber *hostLatency = self.config.latenciesForHosts[self.request.URL.host.lowercaseString];
+    NSTimeInterval latency = hostLatency != nil ? hostLatency.doubleValue : self.config.latency;
+    [self performOnClientThreadAfterDelay:latency block:^{
+        [self sendResponse];
+    }];
+}
+
+- (void)stopLoading {
+    self.stopped = YES;
+}
+
+#pragma mark - Response
+
+- (void)sendResponse {
+    SDBenchmarkServerConfig *config = self.config;
+    NSURLRequest *request = self.request;
+    if ([self.class shouldInjectErrorWithRate:config.errorRate]) {
+        atomic_fetch_add_explicit(&SDBenchmarkErrorCount, 1, memory_order_relaxed);
+        [self finishWithStatusCode:503 headers:@{@"Retry-After" : @"1"}];
+        return;
+    }
+    // `/image/<index>`
+    NSArray<SDBenchmarkCorpusItem *> *items = config.corpus.items;
+    NSString *lastComponent = request.URL.lastPathComponent;
+    NSScanner *scanner = [NSScanner scannerWithString:lastComponent ?: @""];
+    long long index = 0;
+    if (items.count == 0 || ![request.URL.path hasPrefix:@"/image/"] || ![scanner scanLongLong:&index] || index < 0) {
+        [self finishWithStatusCode:404 headers:nil];
+        return;
+    }
+    SDBenchmarkCorpusItem *item = items[(NSUInteger)(index % items.count)];
+    NSData *data = item.data;
+    NSString *ETag = [NSString stringWithFormat:@"\"%lld-%lu\"", index, (unsigned long)data.length];
+    NSMutableDictionary<NSString *, NSString *> *headers = [NSMutableDictionary dictionary];
+    headers[@"Content-Type"] = item.MIMEType;
+    headers[@"ETag"] = ETag;
+    headers[@"Last-Modified"] = @"Mon, 01 Jan 2024 00:00:00 GMT";
+    headers[@"Cache-Control"] = config.cacheControl;
+    if (config.supportsRange) {
+        headers[@"Accept-Ranges"] = @"bytes";
+    }
+    
+    if ([[request valueForHTTPHeaderField:@"If-None-Match"] isEqualToString:ETag]) {
+        [self finishWithStatusCode:304 headers:headers];
+        return;
+    }
+    
+    NSInteger statusCode = 200;
+    NSRange range = NSMakeRange(0, data.length);
+    NSString *rangeHeader = [request valueForHTTPHeaderField:@"Range"];
+    if (config.supportsRange && [rangeHeader hasPrefix:@"bytes="]) {
+        // Only the single range `bytes=<start>-[<end>]`, which the downloader use to resume
+        NSScanner *rangeScanner = [NSScanner scannerWithString:[rangeHeader substringFromIndex:6]];
+        long long start = 0;
+        long long end = (long long)data.length - 1;
+        if ([rangeScanner scanLongLong:&start] && [rangeScanner scanString:@"-" intoString:nil]) {
+            [rangeScanner scanLongLong:&end];
+            if (start < 0 || start >= (long long)data.length || end < start) {
+                headers[@"Content-Range"] = [NSString stringWithFormat:@"bytes */%lu", (unsigned long)data.length];
+                [self finishWithStatusCode:416 headers:headers];
+                return;
+            }
+            end = MIN(end, (long long)data.length - 1);
+            range = NSMakeRange((NSUInteger)start, (NSUInteger)(end - start + 1));
+            statusCode = 206;
+            headers[@"Content-Range"] = [NSString stringWithFormat:@"bytes %lld-%lld/%lu", start, end, (unsigned long)data.length];
+        }
+    }
+    headers[@"Content-Length"] = [NSString stringWithFormat:@"%lu", (unsigned long)range.length];
+    
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:request.URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headers];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageAllowed];
+    self.body = [data subdataWithRange:range];
+    self.offset = 0;
+    [self sendNextChunk];
+}
+
+- (void)sendNextChunk {
+    if (self.stopped) {
+        return;
+    }
+    NSData *body = self.body;
+    if (self.offset >= body.length) {
+        [self.client URLProtocolDidFinishLoading:self];
+        return;
+    }
+    NSUInteger chunkSize = MAX(self.config.chunkSize, 1);
+    NSData *chunk = [body subdataWithRange:NSMakeRange(self.offset, MIN(chunkSize, body.length - self.offset))];
+    self.offset += chunk.length;
+    atomic_fetch_add_explicit(&SDBenchmarkSentBytes, chunk.length, memory_order_relaxed);
+    [self.client URLProtocol:self didLoadData:chunk];
+    NSUInteger bandwidth = self.config.bandwidth;
+    NSTimeInterval delay = bandwidth > 0 ? (double)chunk.length / bandwidth : 0;
+    [self performOnClientThreadAfterDelay:delay block:^{
+        [self sendNextChunk];
+    }];
+}
+
+- (void)finishWithStatusCode:(NSInteger)statusCode headers:(NSDictionary<NSString *, NSString *> *)headers {
+    NSMutableDictionary<NSString *, NSString *> *responseHeaders = [NSMutableDictionary dictionaryWithDictionary:headers ?: @{}];
+    responseHeaders[@"Content-Length"] = @"0";
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:responseHeaders];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+#pragma mark - Helper
+
+- (void)performOnClientThreadAfterDelay:(NSTimeInterval)delay block:(dispatch_block_t)block {
+    dispatch_block_t deliverBlock = ^{
+        [self performSelector:@selector(performBlock:) onThread:self.clientThread withObject:block waitUntilDone:NO modes:self.clientModes];
+    };
+    if (delay > 0) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), self.class.pacingQueue, deliverBlock);
+    } else {
+        dispatch_async(self.class.pacingQueue, deliverBlock);
+    }
+}
+
+- (void)performBlock:(dispatch_block_t)block {
+    if (self.stopped) {
+        return;
+    }
+    block();
+}
+
+@end
@@ -0,0 +1,137 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import <ImageLoader/ImageLoader.h>
+#import "SDBenchmarkCorpus.h"
+#import "SDBenchmarkURLProtocol.h"
+#import "SDBenchmarkLoadGenerator.h"
+
+// The arguments use the `NSUserDefaults` argument domain, such as `-client manager -latency 0.05`, see README.md
+static id SDBenchmarkArgument(NSString *key, id defaultValue) {
+    id value = [[NSUserDefaults standardUserDefaults] objectForKey:key];
+    return value ?: defaultValue;
+}
+
+static void SDBenchmarkPrintResult(NSString *name, SDBenchmarkResult *result) {
+    printf("%-8s requests %5lu  images %5lu  hits %5lu  failed %4lu  cancelled %5lu  p50 %7.1fms  p95 %7.1fms  p99 %7.1fms  %7.1f img/s  %8.1f KB/s  wall %6.2fs  cpu %6.2fs\n",
+           name.UTF8String,
+           (unsigned long)result.requestCount,
+           (unsigned long)result.imageCount,
+           (unsigned long)result.cacheHitCount,
+           (unsigned long)result.failedCount,
+           (unsigned long)result.cancelledCount,
+           [result timeToImageAtPercentile:0.5] * 1000,
+           [result timeToImageAtPercentile:0.95] * 1000,
+           [result timeToImageAtPercentile:0.99] * 1000,
+           result.imageThroughput,
+           result.byteThroughput / 1024,
+           result.wallTime,
+           result.CPUTime);
+}
+
+int main(int argc, const char * argv[]) {
+    @autoreleasepool {
+        NSString *client = SDBenchmarkArgument(@"client", @"downloader");
+        BOOL useManager = [client isEqualToString:@"manager"];
+        NSInteger runCount = MAX([SDBenchmarkArgument(@"runs", @3) integerValue], 1);
+        NSInteger warmupCount = MAX([SDBenchmarkArgument(@"warmup", @1) integerValue], 0);
+        BOOL progressive = [SDBenchmarkArgument(@"progressive", @NO) boolValue];
+        NSString *outputPath = SDBenchmarkArgument(@"output", nil);
+        
+        // Stand-in server
+        unsigned short seed = (unsigned short)[SDBenchmarkArgument(@"seed", @1) integerValue];
+        SDBenchmarkCorpus *corpus = [[SDBenchmarkCorpus alloc] initWithCount:[SDBenchmarkArgument(@"corpus", @24) unsignedIntegerValue] seed:seed];
+        SDBenchmarkServerConfig *serverConfig = [SDBenchmarkServerConfig new];
+        serverConfig.corpus = corpus;
+        serverConfig.seed = seed;
+        serverConfig.latency = [SDBenchmarkArgument(@"latency", @0.05) doubleValue];
+        serverConfig.bandwidth = [SDBenchmarkArgument(@"bandwidth", @(1024 * 1024)) unsignedIntegerValue];
+        serverConfig.errorRate = [SDBenchmarkArgument(@"errorRate", @0) doubleValue];
+        serverConfig.chunkSize = [SDBenchmarkArgument(@"chunkSize", @(16 * 1024)) unsignedIntegerValue];
+        serverConfig.supportsRange = [SDBenchmarkArgument(@"range", @YES) boolValue];
+        serverConfig.cacheControl = SDBenchmarkArgument(@"cacheControl", serverConfig.cacheControl);
+        SDBenchmarkURLProtocol.serverConfig = serverConfig;
+        
+        // Trace
+        SDBenchmarkScrollTrace *trace = [SDBenchmarkScrollTrace new];
+        trace.itemCount = [SDBenchmarkArgument(@"items", @(trace.itemCount)) unsignedIntegerValue];
+        trace.visibleCount = [SDBenchmarkArgument(@"visible", @(trace.visibleCount)) unsignedIntegerValue];
+        trace.prefetchCount = [SDBenchmarkArgument(@"prefetch", @(trace.prefetchCount)) unsignedIntegerValue];
+        trace.maxVelocity = [SDBenchmarkArgument(@"velocity", @(trace.maxVelocity)) doubleValue];
+        trace.seed = seed;
+        
+        // Downloader, no URL cache so each run measures the loading
+        ImageLoaderDownloaderConfig *downloaderConfig = [ImageLoaderDownloaderConfig.defaultDownloaderConfig copy];
+        NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+        sessionConfiguration.protocolClasses = @[SDBenchmarkURLProtocol.class];
+        sessionConfiguration.URLCache = nil;
+        downloaderConfig.sessionConfiguration = sessionConfiguration;
+        downloaderConfig.maxConcurrentDownloads = [SDBenchmarkArgument(@"maxConcurrentDownloads", @(downloaderConfig.maxConcurrentDownloads)) integerValue];
+        downloaderConfig.maxConcurrentDownloadsPerHost = [SDBenchmarkArgument(@"maxConcurrentDownloadsPerHost", @(downloaderConfig.maxConcurrentDownloadsPerHost)) integerValue];
+        ImageLoaderDownloader *downloader = [[ImageLoaderDownloader alloc] initWithConfig:downloaderConfig];
+        
+        SDBenchmarkLoadGenerator *generator;
+        LoadImageCache *cache;
+        if (useManager) {
+            NSString *cachePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"ImageLoaderBenchmark"];
+            cache = [[LoadImageCache alloc] initWithNamespace:@"benchmark" diskCacheDirectory:cachePath];
+            ImageLoaderManager *manager = [[ImageLoaderManager alloc] initWithCache:cache loader:downloader];
+            // Retry the injected errors, else the failed URL is blocked in the next runs
+            ImageLoaderOptions options = ImageLoaderRetryFailed | (progressive ? ImageLoaderProgressiveLoad : 0);
+            generator = [[SDBenchmarkLoadGenerator alloc] initWithManager:manager options:options];
+        } else {
+            ImageLoaderDownloaderOptions options = progressive ? ImageLoaderDownloaderProgressiveLoad : 0;
+            generator = [[SDBenchmarkLoadGenerator alloc] initWithDownloader:downloader options:options];
+        }
+        
+        printf("client %s, corpus %lu images (%.1f KB), latency %.0fms, bandwidth %lu B/s, error rate %.3f, chunk %lu B, range %s, %lu items\n",
+               client.UTF8String,
+               (unsigned long)corpus.items.count,
+               corpus.totalBytes / 1024.0,
+               serverConfig.latency * 1000,
+               (unsigned long)serverConfig.bandwidth,
+               serverConfig.errorRate,
+               (unsigned long)serverConfig.chunkSize,
+               serverConfig.supportsRange ? "YES" : "NO",
+               (unsigned long)trace.itemCount);
+        
+        NSMutableArray<NSDictionary *> *runs = [NSMutableArray array];
+        for (NSInteger i = 0; i < warmupCount + runCount; i++) {
+            if (cache) {
+                // Each run starts from cold cache, the hits are from the scrolling back
+                [cache clearMemory];
+                __block BOOL cleared = NO;
+                [cache clearDiskOnCompletion:^{
+                    cleared = YES;
+                }];
+                while (!cleared) {
+                    [[NSRunLoop mainRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+                }
+            }
+            [SDBenchmarkURLProtocol resetStatistics];
+            SDBenchmarkResult *result = [generator runTrace:trace];
+            BOOL warmup = i < warmupCount;
+            NSString *name = warmup ? @"warmup" : [NSString stringWithFormat:@"run %ld", (long)(i - warmupCount + 1)];
+            SDBenchmarkPrintResult(name, result);
+            if (!warmup) {
+                [runs addObject:result.dictionaryRepresentation];
+            }
+        }
+        
+        if (outputPath.length > 0) {
+            NSDictionary *report = @{@"client" : client, @"runs" : runs};
+            NSData *data = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:nil];
+            if (![data writeToFile:outputPath atomically:YES]) {
+                fprintf(stderr, "Failed to write the report to %s\n", outputPath.UTF8String);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -51,7 +51,7 @@ FOUNDATION_EXPORT UIImage * _Nullable SDScaledImageForScaleFactor(CGFloat scale,
 /// WebCache options
 typedef NS_OPTIONS(NSUInteger, ImageLoaderOptions) {
     /**
-     * By default, when a URL fail to be downloaded, the URL is blacklisted so the library won't keep trying.
+     * By default, when a URL fail to be downloaded, the URL is blacklisted for a backoff interval so the library won't keep trying, see `ImageLoaderManager.failedURLRetryInterval`.
      * This flag disable this blacklisting.
      */
     ImageLoaderRetryFailed = 1 << 0,
@@ -59,6 +59,7 @@ typedef NS_OPTIONS(NSUInteger, ImageLoaderOptions) {
     /**
      * By default, image downloads are started during UI interactions, this flags disable this feature,
      * leading to delayed download on UIScrollView deceleration for instance.
+     * The image decoding (both from disk cache and network) is also queued after the others.
      */
     ImageLoaderLowPriority = 1 << 1,
     
@@ -98,7 +99,7 @@ typedef NS_OPTIONS(NSUInteger, ImageLoaderOptions) {
     
     /**
      * By default, images are loaded in the order in which they were queued. This flag moves them to
-     * the front of the queue.
+     * the front of the queue. The image decoding (both from disk cache and network) is also queued before the others.
      */
     ImageLoaderHighPriority = 1 << 7,
     
@@ -205,7 +206,21 @@ typedef NS_OPTIONS(NSUInteger, ImageLoaderOptions) {
      * We usually don't apply transform on vector images, because vector images supports dynamically changing to any size, rasterize to a fixed size will loss details. To modify vector images, you can process the vector data at runtime (such as modifying PDF tag / SVG element).
      * Use this flag to transform them anyway.
      */
-    ImageLoaderTransformVectorImage = 1 << 23
+    ImageLoaderTransformVectorImage = 1 << 23,
+    
+    /**
+     * By default, the downloaded image data is buffered in memory, and written to the disk cache after decoding. For large images, the encoded bytes sit in memory twice.
+     * Use this flag to stream the download into a disk cache staging file as it arrives, and commit it as the original image data when finished. The image is then decoded from the memory-mapped cache file.
+     * @note This only works when the original image cache is `LoadImageCache` and the original store cache type contains disk. It's ignored when using the data decryptor (unless it supports streaming decryption, which stores the decrypted bytes) or the cache serializer, because the stored data is not the downloaded bytes.
+     */
+    ImageLoaderStreamToDiskCache = 1 << 24,
+    
+    /**
+     * By default, when the download is cancelled or failed midway, the received data is discarded, and the next request starts from byte 0.
+     * Use this flag to persist the partial body with its validator (strong `ETag` or `Last-Modified`) in the disk cache, and the next request for the URL sends `Range` and `If-Range` to append the rest. If the server respond the full body (such as the image changed), the partial body is discarded.
+     * @note This only works when the original image cache is `LoadImageCache`. The partial body is removed after one day without resuming.
+     */
+    ImageLoaderResumeDownload = 1 << 25
 };
 
 
@@ -371,11 +386,21 @@ FOUNDATION_EXPORT ImageLoaderContextOption _Nonnull const ImageLoaderContextDown
  */
 FOUNDATION_EXPORT ImageLoaderContextOption _Nonnull const ImageLoaderContextDownloadDecryptor;
 
+/**
+ A id<ImageLoaderDownloaderHeaderPolicy> instance to make decision after the image header (format, pixel size and animation) parsed from the first few KB of download data. It can abort the download, switch to another URL, or decode as thumbnail, before the full body arrives. If you provide one, it will ignore the `headerPolicy` in downloader and use provided one instead. (id<ImageLoaderDownloaderHeaderPolicy>)
+ */
+FOUNDATION_EXPORT ImageLoaderContextOption _Nonnull const ImageLoaderContextDownloadHeaderPolicy;
+
 /**
  A id<ImageLoaderCacheKeyFilter> instance to convert an URL into a cache key. It's used when manager need cache key to use image cache. If you provide one, it will ignore the `cacheKeyFilter` in manager and use provided one instead. (id<ImageLoaderCacheKeyFilter>)
  */
 FOUNDATION_EXPORT ImageLoaderContextOption _Nonnull const ImageLoaderContextCacheKeyFilter;
 
+/**
+ A id<ImageLoaderVariantResolver> instance to map an URL into the asset variant (asset identifier and pixel size). It's used when manager query cache miss, to derive the requested variant by downsampling a cached larger variant of the same asset, instead of downloading again. If you provide one, it will ignore the `variantResolver` in manager and use provided one instead. Pass NSNull to disable it. (id<ImageLoaderVariantResolver>)
+ */
+FOUNDATION_EXPORT ImageLoaderContextOption _Nonnull const ImageLoaderContextVariantResolver;
+
 /**
  A id<ImageLoaderCacheSerializer> instance to convert the decoded image, the source downloaded data, to the actual data. It's used for manager to store image to the disk cache. If you provide one, it will ignore the `cacheSerializer` in manager and use provided one instead. (id<ImageLoaderCacheSerializer>)
  */
@@ -167,5 +167,7 @@ ImageLoaderContextOption const ImageLoaderContextAnimatedImageClass = @"animated
 ImageLoaderContextOption const ImageLoaderContextDownloadRequestModifier = @"downloadRequestModifier";
 ImageLoaderContextOption const ImageLoaderContextDownloadResponseModifier = @"downloadResponseModifier";
 ImageLoaderContextOption const ImageLoaderContextDownloadDecryptor = @"downloadDecryptor";
+ImageLoaderContextOption const ImageLoaderContextDownloadHeaderPolicy = @"downloadHeaderPolicy";
 ImageLoaderContextOption const ImageLoaderContextCacheKeyFilter = @"cacheKeyFilter";
+ImageLoaderContextOption const ImageLoaderContextVariantResolver = @"variantResolver";
 ImageLoaderContextOption const ImageLoaderContextCacheSerializer = @"cacheSerializer";
@@ -11,9 +11,13 @@
 #import "ImageLoaderDefine.h"
 #import "ImageLoaderOperation.h"
 #import "ImageLoaderDownloaderConfig.h"
+#import "ImageLoaderDownloaderConcurrencyDecision.h"
+#import "ImageLoaderDownloaderMetricsAggregator.h"
 #import "ImageLoaderDownloaderRequestModifier.h"
 #import "ImageLoaderDownloaderResponseModifier.h"
 #import "ImageLoaderDownloaderDecryptor.h"
+#import "ImageLoaderDownloaderHeaderPolicy.h"
+#import "ImageLoaderCacheKeyFilter.h"
 #import "LoadImageLoader.h"
 
 /// Downloader options
@@ -93,6 +97,41 @@ typedef NS_OPTIONS(NSUInteger, ImageLoaderDownloaderOptions) {
      * Note this options is not compatible with `ImageLoaderDownloaderDecodeFirstFrameOnly`, which always produce a UIImage/NSImage.
      */
     ImageLoaderDownloaderMatchAnimatedImageClass = 1 << 12,
+    
+    /**
+     * Stream the download into a staging file of the disk cache (`ImageLoaderContextOriginalImageCache` or `ImageLoaderContextImageCache` from context, should be `LoadImageCache`), and commit it under the original cache key when finished, instead of buffering the whole data in memory.
+     * The completion block receives the memory-mapped data of the committed file.
+     */
+    ImageLoaderDownloaderStreamToDiskCache = 1 << 13,
+    
+    /**
+     * Persist the partial body into the disk cache (the same as `ImageLoaderDownloaderStreamToDiskCache`) when the download is cancelled or failed, and resume it with `Range` and `If-Range` request next time.
+     * The body is written into the staging file during downloading, and only read back into memory when finished, unless `ImageLoaderDownloaderStreamToDiskCache` is used as well.
+     */
+    ImageLoaderDownloaderResumeDownload = 1 << 14,
+};
+
+/// The download priority, which can be changed during the download, see `ImageLoaderDownloadToken.priority`
+typedef NS_ENUM(NSInteger, ImageLoaderDownloadPriority) {
+    /**
+     * The download is for background work, like warming the cache. The running download can be paused for more important downloads, see `ImageLoaderDownloaderConfig.shouldPauseBackgroundDownloads`.
+     */
+    ImageLoaderDownloadPriorityBackground = 0,
+    
+    /**
+     * The download is for prefetching, the image is not on screen yet. Same as `ImageLoaderDownloaderLowPriority`.
+     */
+    ImageLoaderDownloadPriorityPrefetch = 1,
+    
+    /**
+     * Default value. The image is near the visible area, and will be on screen soon.
+     */
+    ImageLoaderDownloadPriorityNearVisible = 2,
+    
+    /**
+     * The image is on screen. Same as `ImageLoaderDownloaderHighPriority`.
+     */
+    ImageLoaderDownloadPriorityVisible = 3
 };
 
 /// Posed when URLSessionTask started (`resume` called))
@@ -106,6 +145,7 @@ FOUNDATION_EXPORT NSNotificationName _Nonnull const ImageLoaderDownloadFinishNot
 
 typedef LoadImageLoaderProgressBlock ImageLoaderDownloaderProgressBlock;
 typedef LoadImageLoaderCompletedBlock ImageLoaderDownloaderCompletedBlock;
+typedef void(^ImageLoaderDownloaderProbeCompletedBlock)(LoadImageHeaderInfo * _Nullable headerInfo, NSError * _Nullable error);
 
 /**
  *  A token associated with each download. Can be used to cancel a download
@@ -137,6 +177,21 @@ typedef LoadImageLoaderCompletedBlock ImageLoaderDownloaderCompletedBlock;
  */
 @property (nonatomic, strong, nullable, readonly) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
 
+/**
+ The download's retry count, updated when download stopped. The metrics is for the last attempt. See `ImageLoaderDownloaderConfig.retryPolicy`.
+ This will be 0 if download operation does not support retry.
+ */
+@property (nonatomic, assign, readonly) NSUInteger retryCount;
+
+/**
+ The download's priority. Change it will reorder the pending downloads, or update the task priority of running download.
+ When the same URL is downloaded by multiple tokens, the download use the highest priority of the tokens which are not cancelled.
+ Defaults to `ImageLoaderDownloadPriorityVisible` for `ImageLoaderDownloaderHighPriority`, `ImageLoaderDownloadPriorityPrefetch` for `ImageLoaderDownloaderLowPriority`, else `ImageLoaderDownloadPriorityNearVisible`.
+ @note To update the priorities of many tokens (like during scrolling), use `-[ImageLoaderDownloader performPriorityUpdates:]` to reorder only once.
+ @note The token can be accessed from `ImageLoaderCombinedOperation.loaderOperation`, when image is loaded by downloader.
+ */
+@property (nonatomic, assign) ImageLoaderDownloadPriority priority;
+
 @end
 
 
@@ -171,11 +226,28 @@ typedef LoadImageLoaderCompletedBlock ImageLoaderDownloaderCompletedBlock;
  * Set the decryptor to decrypt the original download data before image decoding. This can be used for encrypted image data, like Base64.
  * This decryptor method will be called for each downloading image data. Return the original data means no modification. Return nil will mark this download failed.
  * Defaults to nil, means does not modify the original download data.
- * @note When using decryptor, progressive decoding will be disabled, to avoid data corrupt issue.
+ * @note When using decryptor, progressive decoding will be disabled, to avoid data corrupt issue. Unless the decryptor supports streaming decryption, see `decryptStreamWithResponse:`.
  * @note If you want to decrypt single download data, consider using `ImageLoaderContextDownloadDecryptor` context option.
  */
 @property (nonatomic, strong, nullable) id<ImageLoaderDownloaderDecryptor> decryptor;
 
+/**
+ * Set the header policy to make decision after the image header parsed from the first few KB of download data, before the full body arrives. This can be used to abort a too large image, switch to a smaller URL variant, or decode it as thumbnail.
+ * This header policy method will be called for each downloading image which header can be parsed. Return nil means continue.
+ * Defaults to nil, means does not parse the image header during download.
+ * @note The header policy does not work with decryptor, because the downloading data is encrypted. Unless the decryptor supports streaming decryption, see `decryptStreamWithResponse:`.
+ * @note If you want to use policy for single download, consider using `ImageLoaderContextDownloadHeaderPolicy` context option.
+ */
+@property (nonatomic, strong, nullable) id<ImageLoaderDownloaderHeaderPolicy> headerPolicy;
+
+/**
+ * Set the request key filter to compute the canonical key of the download request, which is used to coalesce the in-flight downloads. The requests with the same key attach to the same download operation.
+ * This can be used to ignore the query parameters which does not change the image, such as tracking or signature parameters.
+ * Defaults to nil, means coalesce by the URL, or by the cache key if `config.shouldCoalesceRequestsByCacheKey` is YES.
+ * @note If the filter returns nil, the URL is used.
+ */
+@property (nonatomic, strong, nullable) id<ImageLoaderCacheKeyFilter> requestKeyFilter;
+
 /**
  * The configuration in use by the internal NSURLSession. If you want to provide a custom sessionConfiguration, use `ImageLoaderDownloaderConfig.sessionConfiguration` and create a new downloader instance.
  @note This is immutable according to NSURLSession's documentation. Mutating this object directly has no effect.
@@ -184,6 +256,7 @@ typedef LoadImageLoaderCompletedBlock ImageLoaderDownloaderCompletedBlock;
 
 /**
  * Gets/Sets the download queue suspension state.
+ * @note Suspension does not pause the running downloads, it only stop starting the pending downloads.
  */
 @property (nonatomic, assign, getter=isSuspended) BOOL suspended;
 
@@ -192,6 +265,18 @@ typedef LoadImageLoaderCompletedBlock ImageLoaderDownloaderCompletedBlock;
  */
 @property (nonatomic, assign, readonly) NSUInteger currentDownloadCount;
 
+/**
+ * The latest adaptive concurrency decision, nil if `ImageLoaderDownloaderConfig.shouldAdaptConcurrentDownloads` is disabled or no decision made yet.
+ * The `ImageLoaderDownloaderConcurrencyDecisionNotification` is posted on main queue for each decision, which can be used for telemetry.
+ */
+@property (strong, atomic, nullable, readonly) ImageLoaderDownloaderConcurrencyDecision *concurrencyDecision;
+
+/**
+ * The per host aggregation of download metrics, which is recorded when `ImageLoaderDownloaderConfig.shouldAggregateMetrics` is enabled.
+ * @note The recorded metrics is kept after disabled, call `removeAllMetrics` to clear.
+ */
+@property (strong, nonatomic, nonnull, readonly) ImageLoaderDownloaderMetricsAggregator *metricsAggregator;
+
 /**
  *  Returns the global shared downloader instance. Which use the `ImageLoaderDownloaderConfig.defaultDownloaderConfig` config.
  */
@@ -292,6 +377,41 @@ typedef LoadImageLoaderCompletedBlock ImageLoaderDownloaderCompletedBlock;
                                                   progress:(nullable ImageLoaderDownloaderProgressBlock)progressBlock
                                                  completed:(nullable ImageLoaderDownloaderCompletedBlock)completedBlock;
 
+/**
+ * Probes the image header (format, pixel size and animation) at the given URL, without downloading the full body.
+ * This issues a bounded `Range: bytes=0-N` request, parses the header incrementally, and stops the request as soon as the header is known.
+ *
+ * @param url            The URL to the image to probe
+ * @param options        The options to be used for this probe, only the request related options (`.handleCookies`, `.useNSURLCache`) take effect
+ * @param context        A context contains different options, only `.downloadRequestModifier` and `.callbackQueue` take effect
+ * @param completedBlock A block called once the probe is completed, the header info is nil if failed.
+ *
+ * @return An operation that can be used to cancel this probe
+ * @note The probe does not go through the download queue, and does not support encrypted image (see `decryptor`), which fails with `ImageLoaderErrorBadImageData`.
+ * @note To answer from the cache and remember the result, use `-[ImageLoaderManager probeImageWithURL:options:context:completed:]` instead.
+ */
+- (nullable id<ImageLoaderOperation>)probeImageWithURL:(nullable NSURL *)url
+                                              options:(ImageLoaderDownloaderOptions)options
+                                              context:(nullable ImageLoaderContext *)context
+                                            completed:(nullable ImageLoaderDownloaderProbeCompletedBlock)completedBlock;
+
+/**
+ * Pre-connects to the origins (scheme, host and port) of the given URLs, so the DNS, TCP and TLS setup is done before the images are downloaded.
+ * This sends one `HEAD` request for each origin on the download session, and the connection is kept alive for the following downloads. The request headers and `requestModifier` are applied, no body is transferred.
+ *
+ * @param urls The upcoming image URLs, only http and https URLs take effect
+ * @note To never steal bandwidth from the visible loads, this does nothing when all download slots are taken, the origins which are connected (or pre-connected) in the last 30 seconds are skipped, and the concurrent warm-ups are limited by `config.maxConcurrentPreconnects` (the extra origins are dropped).
+ */
+- (void)preconnectURLs:(nullable NSArray<NSURL *> *)urls;
+
+/**
+ * Update the priorities of download tokens in batch. The pending downloads are reordered only once after the block returns, instead of once per token.
+ * This is designed for view layer to update the priorities per frame, for example, in `scrollViewDidScroll:`.
+ *
+ * @param updates The block to change `ImageLoaderDownloadToken.priority`, which is called synchronously.
+ */
+- (void)performPriorityUpdates:(nonnull NS_NOESCAPE void (^)(void))updates;
+
 /**
  * Cancels all download operations in the queue
  */
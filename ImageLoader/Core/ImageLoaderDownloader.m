@@ -13,6 +13,12 @@
 #import "ImageLoaderCacheKeyFilter.h"
 #import "LoadImageCacheDefine.h"
 #import "SDInternalMacros.h"
+#import "SDDownloadScheduler.h"
+#import "SDAdaptiveConcurrencyController.h"
+#import "SDImageProber.h"
+#import "SDConnectionPrewarmer.h"
+#import "SDImageHeaderParser.h"
+#import "SDCallbackQueue.h"
 #import "objc/runtime.h"
 
 NSNotificationName const ImageLoaderDownloadStartNotification = @"ImageLoaderDownloadStartNotification";
@@ -44,30 +50,43 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
 @property (nonatomic, strong, nullable, readwrite) NSURLRequest *request;
 @property (nonatomic, strong, nullable, readwrite) NSURLResponse *response;
 @property (nonatomic, strong, nullable, readwrite) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+@property (nonatomic, assign, readwrite) NSUInteger retryCount;
 @property (nonatomic, weak, nullable, readwrite) id downloadOperationCancelToken;
 @property (nonatomic, weak, nullable) NSOperation<ImageLoaderDownloaderOperation> *downloadOperation;
+@property (nonatomic, weak, nullable) ImageLoaderDownloader *downloader;
 @property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
 
 - (nonnull instancetype)init NS_UNAVAILABLE;
 + (nonnull instancetype)new  NS_UNAVAILABLE;
-- (nonnull instancetype)initWithDownloadOperation:(nullable NSOperation<ImageLoaderDownloaderOperation> *)downloadOperation;
+- (nonnull instancetype)initWithDownloadOperation:(nullable NSOperation<ImageLoaderDownloaderOperation> *)downloadOperation priority:(ImageLoaderDownloadPriority)priority;
 
 @end
 
 @interface ImageLoaderDownloader () <NSURLSessionTaskDelegate, NSURLSessionDataDelegate>
 
 @property (strong, nonatomic, nonnull) NSOperationQueue *downloadQueue;
-@property (strong, nonatomic, nonnull) NSMutableDictionary<NSURL *, NSOperation<ImageLoaderDownloaderOperation> *> *URLOperations;
+@property (strong, nonatomic, nonnull) SDDownloadScheduler *scheduler;
+@property (strong, nonatomic, nonnull) SDAdaptiveConcurrencyController *concurrencyController;
+@property (strong, atomic, nullable, readwrite) ImageLoaderDownloaderConcurrencyDecision *concurrencyDecision;
+@property (strong, nonatomic, nonnull, readwrite) ImageLoaderDownloaderMetricsAggregator *metricsAggregator;
+@property (strong, nonatomic, nonnull) NSMutableDictionary<id<NSCopying>, NSOperation<ImageLoaderDownloaderOperation> *> *URLOperations; // keyed by URL, or the coalescing key
+@property (strong, nonatomic, nonnull) NSMapTable<NSOperation<ImageLoaderDownloaderOperation> *, NSHashTable<ImageLoaderDownloadToken *> *> *operationTokens;
 @property (strong, nonatomic, nullable) NSMutableDictionary<NSString *, NSString *> *HTTPHeaders;
 
 // The session in which data tasks will run
 @property (strong, nonatomic) NSURLSession *session;
+// The prober for header probe tasks, which run on `session`
+@property (strong, nonatomic, nonnull) SDImageProber *prober;
+// The warmer for pre-connect tasks, which run in `session`
+@property (strong, nonatomic, nonnull) SDConnectionPrewarmer *prewarmer;
+
+- (void)updatePriorityForOperation:(nullable NSOperation<ImageLoaderDownloaderOperation> *)operation;
 
 @end
 
 @implementation ImageLoaderDownloader {
     SD_LOCK_DECLARE(_HTTPHeadersLock); // A lock to keep the access to `HTTPHeaders` thread-safe
-    SD_LOCK_DECLARE(_operationsLock); // A lock to keep the access to `URLOperations` thread-safe
+    SD_LOCK_DECLARE(_operationsLock); // A lock to keep the access to `URLOperations` and `operationTokens` thread-safe
 }
 
 + (void)initialize {
@@ -113,11 +132,20 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
             config = ImageLoaderDownloaderConfig.defaultDownloaderConfig;
         }
         _config = [config copy];
-        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) options:0 context:ImageLoaderDownloaderContext];
+        for (NSString *keyPath in [self.class schedulerConfigKeyPaths]) {
+            [_config addObserver:self forKeyPath:keyPath options:0 context:ImageLoaderDownloaderContext];
+        }
         _downloadQueue = [NSOperationQueue new];
-        _downloadQueue.maxConcurrentOperationCount = _config.maxConcurrentDownloads;
+        // The concurrent limit is controlled by scheduler. The paused operation (task suspended) is still executing in queue but does not take the scheduler slot, so the queue itself must not limit, or the submitted operations wait behind the paused ones
+        // The paused operations are bounded by scheduler, see `SDDownloadScheduler.shouldPauseBackgroundOperations`
+        _downloadQueue.maxConcurrentOperationCount = NSIntegerMax;
         _downloadQueue.name = @"com.hackemist.ImageLoaderDownloader.downloadQueue";
+        _scheduler = [[SDDownloadScheduler alloc] initWithOperationQueue:_downloadQueue];
+        _concurrencyController = [[SDAdaptiveConcurrencyController alloc] initWithConcurrency:_config.maxConcurrentDownloads];
+        [self updateSchedulerWithConfig];
+        _metricsAggregator = [ImageLoaderDownloaderMetricsAggregator new];
         _URLOperations = [NSMutableDictionary new];
+        _operationTokens = [NSMapTable weakToStrongObjectsMapTable];
         NSMutableDictionary<NSString *, NSString *> *headerDictionary = [NSMutableDictionary dictionary];
         NSString *userAgent = nil;
 #if SD_UIKIT
@@ -154,13 +182,18 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
         _session = [NSURLSession sessionWithConfiguration:sessionConfiguration
                                                  delegate:self
                                             delegateQueue:nil];
+        _prewarmer = [[SDConnectionPrewarmer alloc] initWithSession:_session];
+        _prober = [[SDImageProber alloc] initWithSession:_session];
     }
     return self;
 }
 
 - (void)dealloc {
+    [self.scheduler cancelAllOperations];
     [self.downloadQueue cancelAllOperations];
-    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) context:ImageLoaderDownloaderContext];
+    for (NSString *keyPath in [self.class schedulerConfigKeyPaths]) {
+        [self.config removeObserver:self forKeyPath:keyPath context:ImageLoaderDownloaderContext];
+    }
     
     // Invalide the URLSession after all operations been cancelled
     [self.session invalidateAndCancel];
@@ -233,8 +266,23 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
         cacheKey = url.absoluteString;
     }
     LoadImageCoderOptions *decodeOptions = SDGetDecodeOptionsFromContext(context, [self.class imageOptionsFromDownloaderOptions:options], cacheKey);
+    ImageLoaderDownloadPriority priority = ImageLoaderDownloadPriorityNearVisible;
+    if (options & ImageLoaderDownloaderHighPriority) {
+        priority = ImageLoaderDownloadPriorityVisible;
+    } else if (options & ImageLoaderDownloaderLowPriority) {
+        priority = ImageLoaderDownloadPriorityPrefetch;
+    }
+    // The requests with the same key share the in-flight download operation
+    id<NSCopying> operationKey = url;
+    id<ImageLoaderCacheKeyFilter> requestKeyFilter = self.requestKeyFilter;
+    if (requestKeyFilter) {
+        operationKey = [requestKeyFilter cacheKeyForURL:url] ?: url;
+    } else if (self.config.shouldCoalesceRequestsByCacheKey) {
+        operationKey = cacheKey ?: url;
+    }
+    ImageLoaderDownloadToken *token;
     SD_LOCK(_operationsLock);
-    NSOperation<ImageLoaderDownloaderOperation> *operation = [self.URLOperations objectForKey:url];
+    NSOperation<ImageLoaderDownloaderOperation> *operation = [self.URLOperations objectForKey:operationKey];
     // There is a case that the operation may be marked as finished or cancelled, but not been removed from `self.URLOperations`.
     BOOL shouldNotReuseOperation;
     if (operation) {
@@ -255,21 +303,33 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
             return nil;
         }
         @weakify(self);
+        @weakify(operation);
         operation.completionBlock = ^{
             @strongify(self);
+            @strongify(operation);
             if (!self) {
                 return;
             }
             SD_LOCK(self->_operationsLock);
-            [self.URLOperations removeObjectForKey:url];
+            // The key may be taken by a new operation, after this one marked as completed
+            if ([self.URLOperations objectForKey:operationKey] == operation) {
+                [self.URLOperations removeObjectForKey:operationKey];
+            }
+            if (operation) {
+                [self.operationTokens removeObjectForKey:operation];
+            }
             SD_UNLOCK(self->_operationsLock);
+            // Free the slot for pending download
+            [self.scheduler operationDidFinish:operation];
         };
-        [self.URLOperations setObject:operation forKey:url];
+        [self.URLOperations setObject:operation forKey:operationKey];
+        // The connection to this origin is being set up by the download, no need to pre-connect
+        [self.prewarmer markOriginWarmForURL:url];
         // Add the handlers before submitting to operation queue, avoid the race condition that operation finished before setting handlers.
         downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock decodeOptions:decodeOptions];
-        // Add operation to operation queue only after all configuration done according to Apple's doc.
+        // Add operation to scheduler only after all configuration done according to Apple's doc. The scheduler submit it to operation queue when there is a free slot.
         // `addOperation:` does not synchronously execute the `operation.completionBlock` so this will not cause deadlock.
-        [self.downloadQueue addOperation:operation];
+        [self.scheduler addOperation:operation priority:priority];
     } else {
         // When we reuse the download operation to attach more callbacks, there may be thread safe issue because the getter of callbacks may in another queue (decoding queue or delegate queue)
         // So we lock the operation here, and in `ImageLoaderDownloaderOperation`, we use `@synchonzied (self)`, to ensure the thread safe between these two classes.
@@ -277,16 +337,62 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
             downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock decodeOptions:decodeOptions];
         }
     }
-    SD_UNLOCK(_operationsLock);
-    
-    ImageLoaderDownloadToken *token = [[ImageLoaderDownloadToken alloc] initWithDownloadOperation:operation];
+    // The initial priority does not notify the downloader, which hold `_operationsLock` (non-recursive) here, the reused operation is updated after unlock
+    token = [[ImageLoaderDownloadToken alloc] initWithDownloadOperation:operation priority:priority];
     token.url = url;
     token.request = operation.request;
     token.downloadOperationCancelToken = downloadOperationCancelToken;
+    token.downloader = self;
+    NSHashTable<ImageLoaderDownloadToken *> *tokens = [self.operationTokens objectForKey:operation];
+    if (!tokens) {
+        tokens = [NSHashTable weakObjectsHashTable];
+        [self.operationTokens setObject:tokens forKey:operation];
+    }
+    [tokens addObject:token];
+    SD_UNLOCK(_operationsLock);
+    
+    if (!shouldNotReuseOperation) {
+        // The reused operation may need higher priority for the new token
+        [self updatePriorityForOperation:operation];
+    }
     
     return token;
 }
 
+- (void)performPriorityUpdates:(void (NS_NOESCAPE ^)(void))updates {
+    if (!updates) {
+        return;
+    }
+    [self.scheduler beginUpdates];
+    updates();
+    [self.scheduler endUpdates];
+}
+
+- (void)updatePriorityForOperation:(nullable NSOperation<ImageLoaderDownloaderOperation> *)operation {
+    if (!operation) {
+        return;
+    }
+    // The operation shared by tokens use the highest priority of the tokens which are not cancelled
+    BOOL hasToken = NO;
+    ImageLoaderDownloadPriority priority = ImageLoaderDownloadPriorityBackground;
+    SD_LOCK(_operationsLock);
+    NSHashTable<ImageLoaderDownloadToken *> *tokens = [self.operationTokens objectForKey:operation];
+    for (ImageLoaderDownloadToken *token in tokens) {
+        if (token.isCancelled) {
+            continue;
+        }
+        hasToken = YES;
+        priority = MAX(priority, token.priority);
+    }
+    SD_UNLOCK(_operationsLock);
+    if (hasToken) {
+        [self.scheduler setPriority:priority forOperation:operation];
+    } else {
+        // All tokens cancelled, the pending operation should be submitted to finish
+        [self.scheduler setNeedsSchedule];
+    }
+}
+
 #pragma mark Helper methods
 + (ImageLoaderOptions)imageOptionsFromDownloaderOptions:(ImageLoaderDownloaderOptions)downloadOptions {
     ImageLoaderOptions options = 0;
@@ -365,6 +471,17 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
         mutableContext[ImageLoaderContextDownloadDecryptor] = decryptor;
     }
     
+    // Header Policy
+    id<ImageLoaderDownloaderHeaderPolicy> headerPolicy;
+    if ([context valueForKey:ImageLoaderContextDownloadHeaderPolicy]) {
+        headerPolicy = [context valueForKey:ImageLoaderContextDownloadHeaderPolicy];
+    } else {
+        headerPolicy = self.headerPolicy;
+    }
+    if (headerPolicy) {
+        mutableContext[ImageLoaderContextDownloadHeaderPolicy] = headerPolicy;
+    }
+    
     context = [mutableContext copy];
     
     // Operation Class
@@ -386,6 +503,14 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
         operation.minimumProgressInterval = MIN(MAX(self.config.minimumProgressInterval, 0), 1);
     }
     
+    if ([operation respondsToSelector:@selector(setProgressCoalescingInterval:)]) {
+        operation.progressCoalescingInterval = MAX(self.config.progressCoalescingInterval, 0);
+    }
+    
+    if ([operation respondsToSelector:@selector(setProgressiveDecodeBudget:)]) {
+        operation.progressiveDecodeBudget = MAX(self.config.progressiveDecodeBudget, 0);
+    }
+    
     if ([operation respondsToSelector:@selector(setAcceptableStatusCodes:)]) {
         operation.acceptableStatusCodes = self.config.acceptableStatusCodes;
     }
@@ -394,25 +519,120 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
         operation.acceptableContentTypes = self.config.acceptableContentTypes;
     }
     
-    if (options & ImageLoaderDownloaderHighPriority) {
-        operation.queuePriority = NSOperationQueuePriorityHigh;
-    } else if (options & ImageLoaderDownloaderLowPriority) {
-        operation.queuePriority = NSOperationQueuePriorityLow;
+    if ([operation respondsToSelector:@selector(setRetryPolicy:)]) {
+        operation.retryPolicy = self.config.retryPolicy;
     }
     
-    if (self.config.executionOrder == ImageLoaderDownloaderLIFOExecutionOrder) {
-        // Emulate LIFO execution order by systematically, each previous adding operation can dependency the new operation
-        // This can gurantee the new operation to be execulated firstly, even if when some operations finished, meanwhile you appending new operations
-        // Just make last added operation dependents new operation can not solve this problem. See test case #test15DownloaderLIFOExecutionOrder
-        for (NSOperation *pendingOperation in self.downloadQueue.operations) {
-            [pendingOperation addDependency:operation];
+    if ([operation respondsToSelector:@selector(setCacheKey:)]) {
+        // The same key as the manager store, which use the original URL
+        id<ImageLoaderCacheKeyFilter> cacheKeyFilter = context[ImageLoaderContextCacheKeyFilter];
+        if (cacheKeyFilter) {
+            operation.cacheKey = [cacheKeyFilter cacheKeyForURL:url];
+        } else {
+            operation.cacheKey = url.absoluteString;
         }
     }
     
+    // The queue priority and execution order (LIFO) are applied by scheduler, see `SDDownloadScheduler`
     return operation;
 }
 
+- (nullable id<ImageLoaderOperation>)probeImageWithURL:(nullable NSURL *)url
+                                              options:(ImageLoaderDownloaderOptions)options
+                                              context:(nullable ImageLoaderContext *)context
+                                            completed:(nullable ImageLoaderDownloaderProbeCompletedBlock)completedBlock {
+    SDCallbackQueue *queue = context[ImageLoaderContextCallbackQueue];
+    void (^callCompletion)(LoadImageHeaderInfo *, NSError *) = ^(LoadImageHeaderInfo *headerInfo, NSError *error) {
+        if (completedBlock) {
+            [(queue ?: SDCallbackQueue.mainQueue) async:^{
+                completedBlock(headerInfo, error);
+            }];
+        }
+    };
+    // The URL will be used as the key to the callbacks dictionary so it cannot be nil. If it is nil immediately call the completed block with no image or data.
+    if (url == nil) {
+        callCompletion(nil, [NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorInvalidURL userInfo:@{NSLocalizedDescriptionKey : @"Image url is nil"}]);
+        return nil;
+    }
+    
+    NSTimeInterval timeoutInterval = self.config.downloadTimeout;
+    if (timeoutInterval == 0.0) {
+        timeoutInterval = 15.0;
+    }
+    NSURLRequestCachePolicy cachePolicy = options & ImageLoaderDownloaderUseNSURLCache ? NSURLRequestUseProtocolCachePolicy : NSURLRequestReloadIgnoringLocalCacheData;
+    NSMutableURLRequest *mutableRequest = [[NSMutableURLRequest alloc] initWithURL:url cachePolicy:cachePolicy timeoutInterval:timeoutInterval];
+    mutableRequest.HTTPShouldHandleCookies = SD_OPTIONS_CONTAINS(options, ImageLoaderDownloaderHandleCookies);
+    mutableRequest.HTTPShouldUsePipelining = YES;
+    SD_LOCK(_HTTPHeadersLock);
+    mutableRequest.allHTTPHeaderFields = self.HTTPHeaders;
+    SD_UNLOCK(_HTTPHeadersLock);
+    // Only the header is needed, bound the response body. The parser gives up beyond this length anyway
+    [mutableRequest setValue:[NSString stringWithFormat:@"bytes=0-%lu", (unsigned long)(SDImageHeaderParser.maxHeaderLength - 1)] forHTTPHeaderField:@"Range"];
+    
+    // Request Modifier
+    id<ImageLoaderDownloaderRequestModifier> requestModifier;
+    if ([context valueForKey:ImageLoaderContextDownloadRequestModifier]) {
+        requestModifier = [context valueForKey:ImageLoaderContextDownloadRequestModifier];
+    } else {
+        requestModifier = self.requestModifier;
+    }
+    NSURLRequest *request;
+    if (requestModifier) {
+        request = [[requestModifier modifiedRequestWithRequest:[mutableRequest copy]] copy];
+    } else {
+        request = [mutableRequest copy];
+    }
+    if (!request) {
+        callCompletion(nil, [NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorInvalidDownloadOperation userInfo:@{NSLocalizedDescriptionKey : @"Probe request is nil after request modifier"}]);
+        return nil;
+    }
+    
+    return [self.prober probeWithRequest:request completion:callCompletion];
+}
+
+- (void)preconnectURLs:(nullable NSArray<NSURL *> *)urls {
+    if (urls.count == 0) {
+        return;
+    }
+    // The free bandwidth is taken by the downloads, warm-up can only slow them down
+    if (self.scheduler.isSaturated) {
+        return;
+    }
+    self.prewarmer.maxConcurrentCount = self.config.maxConcurrentPreconnects;
+    if (self.prewarmer.maxConcurrentCount <= 0) {
+        return;
+    }
+    NSTimeInterval timeoutInterval = self.config.downloadTimeout;
+    if (timeoutInterval == 0.0) {
+        timeoutInterval = 15.0;
+    }
+    SD_LOCK(_HTTPHeadersLock);
+    NSDictionary<NSString *, NSString *> *HTTPHeaders = [self.HTTPHeaders copy];
+    SD_UNLOCK(_HTTPHeadersLock);
+    id<ImageLoaderDownloaderRequestModifier> requestModifier = self.requestModifier;
+    for (NSURL *url in [self.prewarmer coldOriginURLsFromURLs:urls]) {
+        NSMutableURLRequest *mutableRequest = [[NSMutableURLRequest alloc] initWithURL:url cachePolicy:NSURLRequestReloadIgnoringLocalCacheData timeoutInterval:timeoutInterval];
+        mutableRequest.HTTPShouldUsePipelining = YES;
+        mutableRequest.allHTTPHeaderFields = HTTPHeaders;
+        // Apply the modifier, so the warm-up goes to the same host (and proxy) as the real download
+        NSURLRequest *request;
+        if (requestModifier) {
+            request = [[requestModifier modifiedRequestWithRequest:[mutableRequest copy]] copy];
+        } else {
+            request = [mutableRequest copy];
+        }
+        if (!request) {
+            continue;
+        }
+        if (![self.prewarmer warmWithRequest:request forURL:url]) {
+            // Beyond the concurrent limit, drop the rest, they are still cold for the next preconnect
+            break;
+        }
+    }
+}
+
 - (void)cancelAllDownloads {
+    [self.scheduler cancelAllOperations];
     [self.downloadQueue cancelAllOperations];
 }
 
@@ -424,10 +644,11 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
 
 - (void)setSuspended:(BOOL)suspended {
     self.downloadQueue.suspended = suspended;
+    self.scheduler.suspended = suspended;
 }
 
 - (NSUInteger)currentDownloadCount {
-    return self.downloadQueue.operationCount;
+    return self.downloadQueue.operationCount + self.scheduler.pendingCount;
 }
 
 - (NSURLSessionConfiguration *)sessionConfiguration {
@@ -438,8 +659,8 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
     if (context == ImageLoaderDownloaderContext) {
-        if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxConcurrentDownloads))]) {
-            self.downloadQueue.maxConcurrentOperationCount = self.config.maxConcurrentDownloads;
+        if ([[self.class schedulerConfigKeyPaths] containsObject:keyPath]) {
+            [self updateSchedulerWithConfig];
         }
     } else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
@@ -448,6 +669,60 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
 
 #pragma mark Helper methods
 
+// The config properties which support dynamic changes, applied to scheduler
++ (NSArray<NSString *> *)schedulerConfigKeyPaths {
+    static NSArray<NSString *> *keyPaths;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        keyPaths = @[NSStringFromSelector(@selector(maxConcurrentDownloads)),
+                     NSStringFromSelector(@selector(maxConcurrentDownloadsPerHost)),
+                     NSStringFromSelector(@selector(maxConcurrentDownloadsForHosts)),
+                     NSStringFromSelector(@selector(downloadWeightsForHosts)),
+                     NSStringFromSelector(@selector(executionOrder)),
+                     NSStringFromSelector(@selector(shouldPauseBackgroundDownloads)),
+                     NSStringFromSelector(@selector(shouldAdaptConcurrentDownloads)),
+                     NSStringFromSelector(@selector(minAdaptiveConcurrentDownloads)),
+                     NSStringFromSelector(@selector(maxAdaptiveConcurrentDownloads))];
+    });
+    return keyPaths;
+}
+
+- (void)updateSchedulerWithConfig {
+    ImageLoaderDownloaderConfig *config = self.config;
+    SDDownloadScheduler *scheduler = self.scheduler;
+    [scheduler beginUpdates];
+    if (config.shouldAdaptConcurrentDownloads) {
+        SDAdaptiveConcurrencyController *concurrencyController = self.concurrencyController;
+        concurrencyController.minConcurrency = config.minAdaptiveConcurrentDownloads;
+        concurrencyController.maxConcurrency = config.maxAdaptiveConcurrentDownloads;
+        scheduler.maxConcurrentCount = concurrencyController.concurrency;
+    } else {
+        scheduler.maxConcurrentCount = config.maxConcurrentDownloads;
+        self.concurrencyDecision = nil;
+    }
+    scheduler.maxConcurrentCountPerHost = config.maxConcurrentDownloadsPerHost;
+    scheduler.hostConcurrencyLimits = config.maxConcurrentDownloadsForHosts;
+    scheduler.hostWeights = config.downloadWeightsForHosts;
+    scheduler.LIFO = config.executionOrder == ImageLoaderDownloaderLIFOExecutionOrder;
+    scheduler.shouldPauseBackgroundOperations = config.shouldPauseBackgroundDownloads;
+    [scheduler endUpdates];
+}
+
+- (void)updateConcurrencyIfNeeded {
+    if (!self.config.shouldAdaptConcurrentDownloads || !self.concurrencyController.isWindowElapsed) {
+        return;
+    }
+    ImageLoaderDownloaderConcurrencyDecision *decision = [self.concurrencyController decisionWithSaturated:self.scheduler.isSaturated];
+    if (!decision) {
+        return;
+    }
+    self.concurrencyDecision = decision;
+    self.scheduler.maxConcurrentCount = decision.concurrentDownloads;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:ImageLoaderDownloaderConcurrencyDecisionNotification object:self];
+    });
+}
+
 - (NSOperation<ImageLoaderDownloaderOperation> *)operationWithTask:(NSURLSessionTask *)task {
     NSOperation<ImageLoaderDownloaderOperation> *returnOperation = nil;
     for (NSOperation<ImageLoaderDownloaderOperation> *operation in self.downloadQueue.operations) {
@@ -472,6 +747,11 @@ void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperatio
           dataTask:(NSURLSessionDataTask *)dataTask
 didReceiveResponse:(NSURLResponse *)response
  completionHandler:(void (^)(NSURLSessionResponseDisposition disposition))completionHandler {
+    // The probe task is not a download
+    if ([self.prober isProbeTask:dataTask]) {
+        [self.prober URLSession:session dataTask:dataTask didReceiveResponse:response completionHandler:completionHandler];
+        return;
+    }
 
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<ImageLoaderDownloaderOperation> *dataOperation = [self operationWithTask:dataTask];
@@ -485,6 +765,14 @@ didReceiveResponse:(NSURLResponse *)response
 }
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
+    if ([self.prober isProbeTask:dataTask]) {
+        [self.prober URLSession:session dataTask:dataTask didReceiveData:data];
+        return;
+    }
+    if (self.config.shouldAdaptConcurrentDownloads) {
+        [self.concurrencyController recordReceivedBytes:data.length];
+        [self updateConcurrencyIfNeeded];
+    }
 
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<ImageLoaderDownloaderOperation> *dataOperation = [self operationWithTask:dataTask];
@@ -497,6 +785,10 @@ didReceiveResponse:(NSURLResponse *)response
           dataTask:(NSURLSessionDataTask *)dataTask
  willCacheResponse:(NSCachedURLResponse *)proposedResponse
  completionHandler:(void (^)(NSCachedURLResponse *cachedResponse))completionHandler {
+    if ([self.prober isProbeTask:dataTask]) {
+        [self.prober URLSession:session dataTask:dataTask willCacheResponse:proposedResponse completionHandler:completionHandler];
+        return;
+    }
 
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<ImageLoaderDownloaderOperation> *dataOperation = [self operationWithTask:dataTask];
@@ -512,6 +804,18 @@ didReceiveResponse:(NSURLResponse *)response
 #pragma mark NSURLSessionTaskDelegate
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
+    // The warm-up task is not a download
+    if ([self.prewarmer isWarmupTask:task]) {
+        return;
+    }
+    if ([self.prober isProbeTask:task]) {
+        [self.prober URLSession:session task:task didCompleteWithError:error];
+        return;
+    }
+    if (self.config.shouldAdaptConcurrentDownloads) {
+        [self.concurrencyController recordError:error];
+        [self updateConcurrencyIfNeeded];
+    }
     
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<ImageLoaderDownloaderOperation> *dataOperation = [self operationWithTask:task];
@@ -527,6 +831,13 @@ didReceiveResponse:(NSURLResponse *)response
 }
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task willPerformHTTPRedirection:(NSHTTPURLResponse *)response newRequest:(NSURLRequest *)request completionHandler:(void (^)(NSURLRequest * _Nullable))completionHandler {
+    // The connection to the origin is already set up, do not follow the redirection for warm-up task
+    if ([self.prewarmer isWarmupTask:task]) {
+        if (completionHandler) {
+            completionHandler(nil);
+        }
+        return;
+    }
     
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<ImageLoaderDownloaderOperation> *dataOperation = [self operationWithTask:task];
@@ -553,9 +864,22 @@ didReceiveResponse:(NSURLResponse *)response
 }
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics *)metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0)) {
+    // The warm-up and probe task is not a download, which should not affect the concurrency and the metrics
+    if ([self.prewarmer isWarmupTask:task] || [self.prober isProbeTask:task]) {
+        return;
+    }
+    if (self.config.shouldAdaptConcurrentDownloads) {
+        [self.concurrencyController recordMetrics:metrics];
+        [self updateConcurrencyIfNeeded];
+    }
     
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<ImageLoaderDownloaderOperation> *dataOperation = [self operationWithTask:task];
+    if (self.config.shouldAggregateMetrics) {
+        // The retry count is increased before the retried task created
+        BOOL retried = [dataOperation respondsToSelector:@selector(retryCount)] && dataOperation.retryCount > 0;
+        [self.metricsAggregator recordMetrics:metrics error:task.error retried:retried];
+    }
     if ([dataOperation respondsToSelector:@selector(URLSession:task:didFinishCollectingMetrics:)]) {
         [dataOperation URLSession:session task:task didFinishCollectingMetrics:metrics];
     }
@@ -563,17 +887,23 @@ didReceiveResponse:(NSURLResponse *)response
 
 @end
 
-@implementation ImageLoaderDownloadToken
+@implementation ImageLoaderDownloadToken {
+    SD_LOCK_DECLARE(_priorityLock); // A leaf lock for `priority`, which is read by downloader in its lock
+}
+
+@synthesize priority = _priority;
 
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self name:ImageLoaderDownloadReceiveResponseNotification object:nil];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:ImageLoaderDownloadStopNotification object:nil];
 }
 
-- (instancetype)initWithDownloadOperation:(NSOperation<ImageLoaderDownloaderOperation> *)downloadOperation {
+- (instancetype)initWithDownloadOperation:(NSOperation<ImageLoaderDownloaderOperation> *)downloadOperation priority:(ImageLoaderDownloadPriority)priority {
     self = [super init];
     if (self) {
         _downloadOperation = downloadOperation;
+        _priority = priority;
+        SD_LOCK_INIT(_priorityLock);
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(downloadDidReceiveResponse:) name:ImageLoaderDownloadReceiveResponseNotification object:downloadOperation];
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(downloadDidStop:) name:ImageLoaderDownloadStopNotification object:downloadOperation];
     }
@@ -595,6 +925,26 @@ didReceiveResponse:(NSURLResponse *)response
                 self.metrics = downloadOperation.metrics;
             }
         }
+        if ([downloadOperation respondsToSelector:@selector(retryCount)]) {
+            self.retryCount = downloadOperation.retryCount;
+        }
+    }
+}
+
+- (ImageLoaderDownloadPriority)priority {
+    SD_LOCK(_priorityLock);
+    ImageLoaderDownloadPriority priority = _priority;
+    SD_UNLOCK(_priorityLock);
+    return priority;
+}
+
+- (void)setPriority:(ImageLoaderDownloadPriority)priority {
+    SD_LOCK(_priorityLock);
+    BOOL changed = _priority != priority;
+    _priority = priority;
+    SD_UNLOCK(_priorityLock);
+    if (changed && !self.isCancelled) {
+        [self.downloader updatePriorityForOperation:self.downloadOperation];
     }
 }
 
@@ -607,6 +957,8 @@ didReceiveResponse:(NSURLResponse *)response
         [self.downloadOperation cancel:self.downloadOperationCancelToken];
         self.downloadOperationCancelToken = nil;
     }
+    // The operation may lower the priority, or be cancelled when pending
+    [self.downloader updatePriorityForOperation:self.downloadOperation];
 }
 
 @end
@@ -641,6 +993,8 @@ didReceiveResponse:(NSURLResponse *)response
     if (options & ImageLoaderDecodeFirstFrameOnly) downloaderOptions |= ImageLoaderDownloaderDecodeFirstFrameOnly;
     if (options & ImageLoaderPreloadAllFrames) downloaderOptions |= ImageLoaderDownloaderPreloadAllFrames;
     if (options & ImageLoaderMatchAnimatedImageClass) downloaderOptions |= ImageLoaderDownloaderMatchAnimatedImageClass;
+    if (options & ImageLoaderStreamToDiskCache) downloaderOptions |= ImageLoaderDownloaderStreamToDiskCache;
+    if (options & ImageLoaderResumeDownload) downloaderOptions |= ImageLoaderDownloaderResumeDownload;
     
     if (cachedImage && options & ImageLoaderRefreshCached) {
         // force progressive off if image already cached but forced refreshing
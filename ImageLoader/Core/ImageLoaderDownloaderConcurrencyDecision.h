@@ -0,0 +1,60 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+/// The action of adaptive concurrency decision
+typedef NS_ENUM(NSInteger, ImageLoaderDownloaderConcurrencyAction) {
+    /**
+     * Keep the concurrent downloads unchanged.
+     */
+    ImageLoaderDownloaderConcurrencyActionHold = 0,
+
+    /**
+     * Increase the concurrent downloads by one, because all slots are taken and the network is not congested (additive increase).
+     */
+    ImageLoaderDownloaderConcurrencyActionIncrease,
+
+    /**
+     * Decrease the concurrent downloads, because the time to first byte grows, the request timed out, or the last increase did not improve throughput (multiplicative decrease).
+     */
+    ImageLoaderDownloaderConcurrencyActionDecrease
+};
+
+/// Posted when the downloader make an adaptive concurrency decision, the object is the downloader. See `ImageLoaderDownloader.concurrencyDecision`.
+FOUNDATION_EXPORT NSNotificationName _Nonnull const ImageLoaderDownloaderConcurrencyDecisionNotification;
+
+/**
+ The decision of adaptive download concurrency, made once per sampling window when `ImageLoaderDownloaderConfig.shouldAdaptConcurrentDownloads` is enabled. Which can be used for telemetry.
+ */
+@interface ImageLoaderDownloaderConcurrencyDecision : NSObject
+
+/// The concurrent downloads after the decision
+@property (nonatomic, assign, readonly) NSInteger concurrentDownloads;
+/// The action of the decision
+@property (nonatomic, assign, readonly) ImageLoaderDownloaderConcurrencyAction action;
+/// The aggregate throughput of all downloads in the sampling window, in bytes per second
+@property (nonatomic, assign, readonly) double throughput;
+/// The smoothed time to first byte of the finished requests
+@property (nonatomic, assign, readonly) NSTimeInterval timeToFirstByte;
+/// The baseline (minimum observed) time to first byte, which represent the uncongested network
+@property (nonatomic, assign, readonly) NSTimeInterval baselineTimeToFirstByte;
+/// Whether all slots were taken with pending downloads, when the decision made
+@property (nonatomic, assign, readonly, getter=isSaturated) BOOL saturated;
+/// The date when the decision made
+@property (nonatomic, strong, readonly, nonnull) NSDate *date;
+
+- (nonnull instancetype)initWithConcurrentDownloads:(NSInteger)concurrentDownloads
+                                             action:(ImageLoaderDownloaderConcurrencyAction)action
+                                         throughput:(double)throughput
+                                    timeToFirstByte:(NSTimeInterval)timeToFirstByte
+                            baselineTimeToFirstByte:(NSTimeInterval)baselineTimeToFirstByte
+                                          saturated:(BOOL)saturated;
+
+@end
@@ -0,0 +1,38 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "ImageLoaderDownloaderConcurrencyDecision.h"
+
+NSNotificationName const ImageLoaderDownloaderConcurrencyDecisionNotification = @"ImageLoaderDownloaderConcurrencyDecisionNotification";
+
+@implementation ImageLoaderDownloaderConcurrencyDecision
+
+- (instancetype)initWithConcurrentDownloads:(NSInteger)concurrentDownloads
+                                     action:(ImageLoaderDownloaderConcurrencyAction)action
+                                 throughput:(double)throughput
+                            timeToFirstByte:(NSTimeInterval)timeToFirstByte
+                    baselineTimeToFirstByte:(NSTimeInterval)baselineTimeToFirstByte
+                                  saturated:(BOOL)saturated {
+    self = [super init];
+    if (self) {
+        _concurrentDownloads = concurrentDownloads;
+        _action = action;
+        _throughput = throughput;
+        _timeToFirstByte = timeToFirstByte;
+        _baselineTimeToFirstByte = baselineTimeToFirstByte;
+        _saturated = saturated;
+        _date = [NSDate date];
+    }
+    return self;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, concurrentDownloads: %ld, action: %ld, throughput: %.0f B/s, TTFB: %.3fs, baseline TTFB: %.3fs, saturated: %d>", NSStringFromClass(self.class), self, (long)self.concurrentDownloads, (long)self.action, self.throughput, self.timeToFirstByte, self.baselineTimeToFirstByte, self.saturated];
+}
+
+@end
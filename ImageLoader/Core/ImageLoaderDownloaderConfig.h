@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import "ImageLoaderCompat.h"
+#import "ImageLoaderDownloaderRetryPolicy.h"
 
 /// Operation execution order
 typedef NS_ENUM(NSInteger, ImageLoaderDownloaderExecutionOrder) {
@@ -40,6 +41,67 @@ typedef NS_ENUM(NSInteger, ImageLoaderDownloaderExecutionOrder) {
  */
 @property (nonatomic, assign) NSInteger maxConcurrentDownloads;
 
+/**
+ * The maximum number of concurrent downloads for each host, so a burst of requests to a slow host does not take all the slots of `maxConcurrentDownloads`.
+ * Zero or negative value means no limit.
+ * Defaults to 0.
+ * @note The session also limits the connections to each host, see `NSURLSessionConfiguration.HTTPMaximumConnectionsPerHost`.
+ */
+@property (nonatomic, assign) NSInteger maxConcurrentDownloadsPerHost;
+
+/**
+ * The maximum number of concurrent downloads for specify hosts, which override `maxConcurrentDownloadsPerHost`. The key is the host name (case insensitive), the value is the integer limit, zero or negative value means no limit.
+ * Defaults to nil.
+ */
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *maxConcurrentDownloadsForHosts;
+
+/**
+ * The weights of hosts to share the free slots, when pending downloads from different hosts have the same priority. The hosts are picked by weighted round-robin, a host with weight 3 start 3 downloads when a host with weight 1 start 1 download.
+ * The key is the host name (case insensitive), the value is the positive integer weight.
+ * Defaults to nil, means each host has the weight 1.
+ */
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *downloadWeightsForHosts;
+
+/**
+ * The maximum number of concurrent connection warm-ups started by `-[ImageLoaderDownloader preconnectURLs:]`, the extra origins are dropped. Zero or negative value disables the pre-connect.
+ * Defaults to 2.
+ */
+@property (nonatomic, assign) NSInteger maxConcurrentPreconnects;
+
+/**
+ * Whether to adapt the concurrent downloads by the measured network, instead of using the fixed `maxConcurrentDownloads`.
+ * The downloader samples the aggregate throughput (per received chunk) and the time to first byte (from `NSURLSessionTaskMetrics`) each second. It increases the concurrent downloads by one when all slots are taken, and decreases it multiplicatively when the time to first byte grows far above the baseline or the request timed out (AIMD).
+ * The concurrent downloads start from `maxConcurrentDownloads`, and is limited between `minAdaptiveConcurrentDownloads` and `maxAdaptiveConcurrentDownloads`. The decisions can be observed with `ImageLoaderDownloader.concurrencyDecision`.
+ * Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL shouldAdaptConcurrentDownloads;
+
+/**
+ * The lower bound of adaptive concurrent downloads. See `shouldAdaptConcurrentDownloads`.
+ * Defaults to 2.
+ */
+@property (nonatomic, assign) NSInteger minAdaptiveConcurrentDownloads;
+
+/**
+ * The upper bound of adaptive concurrent downloads. See `shouldAdaptConcurrentDownloads`.
+ * Defaults to 16.
+ */
+@property (nonatomic, assign) NSInteger maxAdaptiveConcurrentDownloads;
+
+/**
+ * Whether to aggregate the download metrics (DNS, connect, TLS, time to first byte, transfer, bytes, protocol and connection reuse) per host, which can be queried or exported as JSON with `ImageLoaderDownloader.metricsAggregator`.
+ * Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL shouldAggregateMetrics;
+
+/**
+ * Whether to coalesce the in-flight downloads by the cache key (see `ImageLoaderContextCacheKeyFilter`) instead of the exact URL. When enabled, the requests whose URLs differ (such as in ignored query parameters) but map to the same cache key attach to the same download operation, and share the decoding when the decode options are the same.
+ * The callbacks receive the image downloaded from the URL of the first request.
+ * Defaults to NO, which coalesce the downloads with the same URL only.
+ * @note `ImageLoaderDownloader.requestKeyFilter` takes precedence if provided.
+ */
+@property (nonatomic, assign) BOOL shouldCoalesceRequestsByCacheKey;
+
 /**
  * The timeout value (in seconds) for each download operation.
  * Defaults to 15.0.
@@ -55,6 +117,20 @@ typedef NS_ENUM(NSInteger, ImageLoaderDownloaderExecutionOrder) {
  */
 @property (nonatomic, assign) double minimumProgressInterval;
 
+/**
+ * The interval (in seconds) to coalesce the progress callbacks. When it's larger than 0, each download operation only publishes the received size, and the progress blocks are fanned out by a single timer covering all download operations, at most once per interval. For example, use `1.0 / 60` for at most once per display frame.
+ * The progress callbacks happen on the internal coalescing queue instead of the URLSession delegate queue, and the pending progress is always delivered before the completion callback.
+ * Defaults to 0, which means each time we receive the new data from URLSession, we callback the progressBlock immediately.
+ */
+@property (nonatomic, assign) NSTimeInterval progressCoalescingInterval;
+
+/**
+ * The CPU time budget of the partial image decoding for each progressive download (see `ImageLoaderDownloaderProgressiveLoad`). When the total duration of partial decodes exceeds the budget, no more partial image is produced, and the final image is still decoded when download finished.
+ * The partial decoding is also adaptive to the measured decode cost: the next partial decode happens only when a new progressive JPEG scan is completed (or enough new bytes arrived for other formats), and the decoding takes at most half of the wall time.
+ * Defaults to 1 second. 0 means no budget limit.
+ */
+@property (nonatomic, assign) NSTimeInterval progressiveDecodeBudget;
+
 /**
  * The custom session configuration in use by NSURLSession. If you don't provide one, we will use `defaultSessionConfiguration` instead.
  * Defatuls to nil.
@@ -77,6 +153,12 @@ typedef NS_ENUM(NSInteger, ImageLoaderDownloaderExecutionOrder) {
  */
 @property (nonatomic, assign) ImageLoaderDownloaderExecutionOrder executionOrder;
 
+/**
+ * Whether to pause (suspend the task of) the running downloads with `ImageLoaderDownloadPriorityBackground` priority, when all slots are taken and there are pending downloads with higher priority. The paused download is resumed when it's picked again.
+ * Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL shouldPauseBackgroundDownloads;
+
 /**
  * Set the default URL credential to be set for request operations.
  * Defaults to nil.
@@ -110,4 +192,12 @@ typedef NS_ENUM(NSInteger, ImageLoaderDownloaderExecutionOrder) {
  */
 @property (nonatomic, copy, nullable) NSSet<NSString *> *acceptableContentTypes;
 
+/**
+ * The retry policy for the transient download failures, such as timeout, connection lost, or 5xx response. The retry is performed inside the download operation, so all the tokens of the same URL wait for one retried request.
+ * The retry count can be queried from `ImageLoaderDownloadToken.retryCount`.
+ * Defaults to nil, means no retry. Use `ImageLoaderDownloaderRetryPolicy.defaultPolicy` to enable it.
+ * @note The retry status codes take effect only when they're not in `acceptableStatusCodes`.
+ */
+@property (nonatomic, copy, nullable) ImageLoaderDownloaderRetryPolicy *retryPolicy;
+
 @end
@@ -25,7 +25,11 @@ static ImageLoaderDownloaderConfig * _defaultDownloaderConfig;
     self = [super init];
     if (self) {
         _maxConcurrentDownloads = 6;
+        _minAdaptiveConcurrentDownloads = 2;
+        _maxAdaptiveConcurrentDownloads = 16;
+        _maxConcurrentPreconnects = 2;
         _downloadTimeout = 15.0;
+        _progressiveDecodeBudget = 1.0;
         _executionOrder = ImageLoaderDownloaderFIFOExecutionOrder;
         _acceptableStatusCodes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(200, 100)];
     }
@@ -35,16 +39,29 @@ static ImageLoaderDownloaderConfig * _defaultDownloaderConfig;
 - (id)copyWithZone:(NSZone *)zone {
     ImageLoaderDownloaderConfig *config = [[[self class] allocWithZone:zone] init];
     config.maxConcurrentDownloads = self.maxConcurrentDownloads;
+    config.maxConcurrentDownloadsPerHost = self.maxConcurrentDownloadsPerHost;
+    config.maxConcurrentDownloadsForHosts = self.maxConcurrentDownloadsForHosts;
+    config.downloadWeightsForHosts = self.downloadWeightsForHosts;
+    config.maxConcurrentPreconnects = self.maxConcurrentPreconnects;
+    config.shouldAdaptConcurrentDownloads = self.shouldAdaptConcurrentDownloads;
+    config.minAdaptiveConcurrentDownloads = self.minAdaptiveConcurrentDownloads;
+    config.maxAdaptiveConcurrentDownloads = self.maxAdaptiveConcurrentDownloads;
+    config.shouldAggregateMetrics = self.shouldAggregateMetrics;
+    config.shouldCoalesceRequestsByCacheKey = self.shouldCoalesceRequestsByCacheKey;
     config.downloadTimeout = self.downloadTimeout;
     config.minimumProgressInterval = self.minimumProgressInterval;
+    config.progressCoalescingInterval = self.progressCoalescingInterval;
+    config.progressiveDecodeBudget = self.progressiveDecodeBudget;
     config.sessionConfiguration = [self.sessionConfiguration copyWithZone:zone];
     config.operationClass = self.operationClass;
     config.executionOrder = self.executionOrder;
+    config.shouldPauseBackgroundDownloads = self.shouldPauseBackgroundDownloads;
     config.urlCredential = self.urlCredential;
     config.username = self.username;
     config.password = self.password;
     config.acceptableStatusCodes = self.acceptableStatusCodes;
     config.acceptableContentTypes = self.acceptableContentTypes;
+    config.retryPolicy = self.retryPolicy;
     
     return config;
 }
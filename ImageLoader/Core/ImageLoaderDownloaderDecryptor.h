@@ -9,10 +9,31 @@
 #import <Foundation/Foundation.h>
 #import "ImageLoaderCompat.h"
 
+/**
+This is the protocol for streaming decryption of one download. It's created with the URL response, updated with each received chunk, and finalized when the download finished.
+This allows the stream cipher (such as AES-CTR/GCM) to decrypt the chunks in place as they arrive, so progressive decoding and `ImageLoaderStreamToDiskCache` works for encrypted image.
+The methods are called serially on the URLSession delegate queue.
+*/
+@protocol ImageLoaderDownloaderDecryptStream <NSObject>
+
+/// Decrypt the received chunk, and return the decrypted bytes available now.
+/// @param data The received chunk of original download data
+/// @return The decrypted bytes, which can be empty if the stream buffers the chunk (such as waiting for a full block). If nil is returned, the image download will be marked as failed with error `ImageLoaderErrorBadImageData`
+- (nullable NSData *)decryptedDataWithData:(nonnull NSData *)data;
+
+/// Finalize the decryption when all data is received, such as verify the authentication tag.
+/// @return The remaining decrypted bytes, empty if none. If nil is returned, the image download will be marked as failed with error `ImageLoaderErrorBadImageData`
+- (nullable NSData *)finalizeDecryptedData;
+
+@end
+
 typedef NSData * _Nullable (^ImageLoaderDownloaderDecryptorBlock)(NSData * _Nonnull data, NSURLResponse * _Nullable response);
+typedef id<ImageLoaderDownloaderDecryptStream> _Nullable (^ImageLoaderDownloaderDecryptStreamBlock)(NSURLResponse * _Nullable response);
+typedef NSData * _Nullable (^ImageLoaderDownloaderDecryptStreamUpdateBlock)(NSData * _Nonnull data);
+typedef NSData * _Nullable (^ImageLoaderDownloaderDecryptStreamFinalizeBlock)(void);
 
 /**
-This is the protocol for downloader decryptor. Which decrypt the original encrypted data before decoding. Note progressive decoding is not compatible for decryptor.
+This is the protocol for downloader decryptor. Which decrypt the original encrypted data before decoding. Note progressive decoding is not compatible for decryptor, unless it supports streaming decryption (see `decryptStreamWithResponse:`).
 We can use a block to specify the downloader decryptor. But Using protocol can make this extensible, and allow Swift user to use it easily instead of using `@convention(block)` to store a block into context options.
 */
 @protocol ImageLoaderDownloaderDecryptor <NSObject>
@@ -23,6 +44,25 @@ We can use a block to specify the downloader decryptor. But Using protocol can m
 /// @note If nil is returned, the image download will be marked as failed with error `ImageLoaderErrorBadImageData`
 - (nullable NSData *)decryptedDataWithData:(nonnull NSData *)data response:(nullable NSURLResponse *)response;
 
+@optional
+/// Create the streaming decryption for one download, called when the URL response is received.
+/// @param response The URL response for data. If you modify the original URL response via response modifier, the modified version will be here. This arg is nullable.
+/// @return The decrypt stream. If nil is returned, the whole data is decrypted once the download finished, using `decryptedDataWithData:response:`
+/// @note The partial download can not be resumed (see `ImageLoaderDownloaderResumeDownload`) when the decryptor implements this method, because the stream can not start from the middle.
+- (nullable id<ImageLoaderDownloaderDecryptStream>)decryptStreamWithResponse:(nullable NSURLResponse *)response;
+
+@end
+
+/**
+A downloader decrypt stream class with block.
+*/
+@interface ImageLoaderDownloaderDecryptStream : NSObject <ImageLoaderDownloaderDecryptStream>
+
+/// Create the decrypt stream with block
+/// @param updateBlock A block to decrypt each chunk
+/// @param finalizeBlock A block to finalize the decryption, nil means no remaining bytes
+- (nonnull instancetype)initWithUpdateBlock:(nonnull ImageLoaderDownloaderDecryptStreamUpdateBlock)updateBlock finalizeBlock:(nullable ImageLoaderDownloaderDecryptStreamFinalizeBlock)finalizeBlock;
+
 @end
 
 /**
@@ -38,12 +78,20 @@ A downloader response modifier class with block.
 /// @param block A block to control decrypt logic
 + (nonnull instancetype)decryptorWithBlock:(nonnull ImageLoaderDownloaderDecryptorBlock)block;
 
+/// Create the streaming data decryptor with block. The whole data decryption (`decryptedDataWithData:response:`) uses the same stream.
+/// @param streamBlock A block to create the decrypt stream for each download
+- (nonnull instancetype)initWithStreamBlock:(nonnull ImageLoaderDownloaderDecryptStreamBlock)streamBlock;
+
+/// Create the streaming data decryptor with block. The whole data decryption (`decryptedDataWithData:response:`) uses the same stream.
+/// @param streamBlock A block to create the decrypt stream for each download
++ (nonnull instancetype)decryptorWithStreamBlock:(nonnull ImageLoaderDownloaderDecryptStreamBlock)streamBlock;
+
 @end
 
 /// Convenience way to create decryptor for common data encryption.
 @interface ImageLoaderDownloaderDecryptor (Conveniences)
 
-/// Base64 Encoded image data decryptor
+/// Base64 Encoded image data decryptor, which supports streaming decryption
 @property (class, readonly, nonnull) ImageLoaderDownloaderDecryptor *base64Decryptor;
 
 @end
@@ -8,9 +8,98 @@
 
 #import "ImageLoaderDownloaderDecryptor.h"
 
+@interface ImageLoaderDownloaderDecryptStream ()
+
+@property (nonatomic, copy, nonnull) ImageLoaderDownloaderDecryptStreamUpdateBlock updateBlock;
+@property (nonatomic, copy, nullable) ImageLoaderDownloaderDecryptStreamFinalizeBlock finalizeBlock;
+
+@end
+
+@implementation ImageLoaderDownloaderDecryptStream
+
+- (instancetype)initWithUpdateBlock:(ImageLoaderDownloaderDecryptStreamUpdateBlock)updateBlock finalizeBlock:(ImageLoaderDownloaderDecryptStreamFinalizeBlock)finalizeBlock {
+    self = [super init];
+    if (self) {
+        self.updateBlock = updateBlock;
+        self.finalizeBlock = finalizeBlock;
+    }
+    return self;
+}
+
+- (nullable NSData *)decryptedDataWithData:(nonnull NSData *)data {
+    if (!self.updateBlock) {
+        return nil;
+    }
+    return self.updateBlock(data);
+}
+
+- (nullable NSData *)finalizeDecryptedData {
+    if (!self.finalizeBlock) {
+        return [NSData data];
+    }
+    return self.finalizeBlock();
+}
+
+@end
+
+static inline BOOL SDIsBase64Character(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/' || c == '=';
+}
+
+// Decode the complete 4-character groups as they arrive, the unknown characters (such as line breaks) are ignored
+@interface SDBase64DecryptStream : NSObject <ImageLoaderDownloaderDecryptStream>
+
+@property (nonatomic, strong, nonnull) NSMutableData *pendingData;
+
+@end
+
+@implementation SDBase64DecryptStream
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _pendingData = [NSMutableData data];
+    }
+    return self;
+}
+
+- (nullable NSData *)decryptedDataWithData:(nonnull NSData *)data {
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger start = 0;
+    // Append the runs of valid characters
+    for (NSUInteger i = 0; i <= length; i++) {
+        if (i == length || !SDIsBase64Character(bytes[i])) {
+            if (i > start) {
+                [self.pendingData appendBytes:bytes + start length:i - start];
+            }
+            start = i + 1;
+        }
+    }
+    NSUInteger decodableLength = self.pendingData.length / 4 * 4;
+    if (decodableLength == 0) {
+        return [NSData data];
+    }
+    NSData *decodableData = [NSData dataWithBytesNoCopy:self.pendingData.mutableBytes length:decodableLength freeWhenDone:NO];
+    NSData *decodedData = [[NSData alloc] initWithBase64EncodedData:decodableData options:0];
+    [self.pendingData replaceBytesInRange:NSMakeRange(0, decodableLength) withBytes:NULL length:0];
+    return decodedData;
+}
+
+- (nullable NSData *)finalizeDecryptedData {
+    if (self.pendingData.length > 0) {
+        // Incomplete group
+        return nil;
+    }
+    return [NSData data];
+}
+
+@end
+
 @interface ImageLoaderDownloaderDecryptor ()
 
-@property (nonatomic, copy, nonnull) ImageLoaderDownloaderDecryptorBlock block;
+@property (nonatomic, copy, nullable) ImageLoaderDownloaderDecryptorBlock block;
+@property (nonatomic, copy, nullable) ImageLoaderDownloaderDecryptStreamBlock streamBlock;
 
 @end
 
@@ -29,11 +118,51 @@
     return decryptor;
 }
 
+- (instancetype)initWithStreamBlock:(ImageLoaderDownloaderDecryptStreamBlock)streamBlock {
+    self = [super init];
+    if (self) {
+        self.streamBlock = streamBlock;
+    }
+    return self;
+}
+
++ (instancetype)decryptorWithStreamBlock:(ImageLoaderDownloaderDecryptStreamBlock)streamBlock {
+    ImageLoaderDownloaderDecryptor *decryptor = [[ImageLoaderDownloaderDecryptor alloc] initWithStreamBlock:streamBlock];
+    return decryptor;
+}
+
+- (BOOL)respondsToSelector:(SEL)aSelector {
+    // The downloader checks this to decide streaming decryption. The block based one supports it only when created with stream block, the subclass which overrides the method is always respected
+    if (aSelector == @selector(decryptStreamWithResponse:) && [self methodForSelector:aSelector] == [ImageLoaderDownloaderDecryptor instanceMethodForSelector:aSelector]) {
+        return self.streamBlock != nil;
+    }
+    return [super respondsToSelector:aSelector];
+}
+
 - (nullable NSData *)decryptedDataWithData:(nonnull NSData *)data response:(nullable NSURLResponse *)response {
-    if (!self.block) {
+    if (self.block) {
+        return self.block(data, response);
+    }
+    // Decrypt the whole data with one stream
+    id<ImageLoaderDownloaderDecryptStream> stream = [self decryptStreamWithResponse:response];
+    NSData *decryptedData = [stream decryptedDataWithData:data];
+    NSData *finalData = [stream finalizeDecryptedData];
+    if (!decryptedData || !finalData) {
+        return nil;
+    }
+    if (finalData.length == 0) {
+        return decryptedData;
+    }
+    NSMutableData *mutableData = [decryptedData mutableCopy];
+    [mutableData appendData:finalData];
+    return [mutableData copy];
+}
+
+- (nullable id<ImageLoaderDownloaderDecryptStream>)decryptStreamWithResponse:(nullable NSURLResponse *)response {
+    if (!self.streamBlock) {
         return nil;
     }
-    return self.block(data, response);
+    return self.streamBlock(response);
 }
 
 @end
@@ -44,9 +173,8 @@
     static ImageLoaderDownloaderDecryptor *decryptor;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        decryptor = [ImageLoaderDownloaderDecryptor decryptorWithBlock:^NSData * _Nullable(NSData * _Nonnull data, NSURLResponse * _Nullable response) {
-            NSData *modifiedData = [[NSData alloc] initWithBase64EncodedData:data options:NSDataBase64DecodingIgnoreUnknownCharacters];
-            return modifiedData;
+        decryptor = [ImageLoaderDownloaderDecryptor decryptorWithStreamBlock:^id<ImageLoaderDownloaderDecryptStream> _Nullable(NSURLResponse * _Nullable response) {
+            return [SDBase64DecryptStream new];
         }];
     });
     return decryptor;
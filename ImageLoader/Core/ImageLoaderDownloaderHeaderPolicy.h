@@ -0,0 +1,107 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "LoadImageHeaderInfo.h"
+
+/// The action of header policy decision
+typedef NS_ENUM(NSInteger, ImageLoaderDownloaderHeaderAction) {
+    /**
+     * Continue the download without change.
+     */
+    ImageLoaderDownloaderHeaderActionContinue = 0,
+
+    /**
+     * Abort the download, the download fails with error code `ImageLoaderErrorDownloadRejectedByHeader`.
+     */
+    ImageLoaderDownloaderHeaderActionAbort,
+
+    /**
+     * Cancel the current request and download the image from another URL (such as a smaller variant from CDN) in the same operation. The callbacks receive the image from the new URL.
+     */
+    ImageLoaderDownloaderHeaderActionSwitchURL,
+
+    /**
+     * Continue the download, and decode the image as a thumbnail with the max pixel size, see `ImageLoaderContextImageThumbnailPixelSize`.
+     */
+    ImageLoaderDownloaderHeaderActionScaleDown
+};
+
+/**
+ The decision of header policy.
+ */
+@interface ImageLoaderDownloaderHeaderDecision : NSObject
+
+/// The action
+@property (nonatomic, assign, readonly) ImageLoaderDownloaderHeaderAction action;
+/// The URL to switch for `ImageLoaderDownloaderHeaderActionSwitchURL`
+@property (nonatomic, copy, readonly, nullable) NSURL *URL;
+/// The thumbnail pixel size for `ImageLoaderDownloaderHeaderActionScaleDown`
+@property (nonatomic, assign, readonly) CGSize thumbnailPixelSize;
+
+/// Continue the download
++ (nonnull instancetype)continueDecision;
+/// Abort the download
++ (nonnull instancetype)abortDecision;
+/// Download from another URL
++ (nonnull instancetype)switchDecisionWithURL:(nonnull NSURL *)URL;
+/// Decode as thumbnail with the max pixel size (aspect ratio is preserved)
++ (nonnull instancetype)scaleDownDecisionWithThumbnailPixelSize:(CGSize)thumbnailPixelSize;
+
+@end
+
+typedef ImageLoaderDownloaderHeaderDecision * _Nullable (^ImageLoaderDownloaderHeaderPolicyBlock)(LoadImageHeaderInfo * _Nonnull headerInfo, NSURLResponse * _Nonnull response);
+
+/**
+ This is the protocol for downloader header policy.
+ The downloader parse the image header (format, pixel size and animation) from the first few KB of the downloading data, before the full body arrives. The policy can abort a too large image, switch to a smaller URL variant, or decode it as thumbnail.
+ We can use a block to specify the downloader header policy. But Using protocol can make this extensible, and allow Swift user to use it easily instead of using `@convention(block)` to store a block into context options.
+ */
+@protocol ImageLoaderDownloaderHeaderPolicy <NSObject>
+
+/// Make the decision for the parsed image header. This is called at most once for each request, on the URLSession delegate queue.
+/// @param headerInfo The header info parsed from the downloading data
+/// @param response The URL response of the download
+/// @return The decision, nil means continue
+/// @note If the header can not be parsed (unsupported format, or too long header), the policy is not called and the download continues.
+- (nullable ImageLoaderDownloaderHeaderDecision *)decisionForHeaderInfo:(nonnull LoadImageHeaderInfo *)headerInfo response:(nonnull NSURLResponse *)response;
+
+@end
+
+/**
+ A downloader header policy class with block.
+ */
+@interface ImageLoaderDownloaderHeaderPolicy : NSObject <ImageLoaderDownloaderHeaderPolicy>
+
+/// Create the header policy with block
+/// @param block A block to control policy logic
+- (nonnull instancetype)initWithBlock:(nonnull ImageLoaderDownloaderHeaderPolicyBlock)block;
+
+/// Create the header policy with block
+/// @param block A block to control policy logic
++ (nonnull instancetype)headerPolicyWithBlock:(nonnull ImageLoaderDownloaderHeaderPolicyBlock)block;
+
+@end
+
+/**
+ A convenient header policy to limit the image pixel size.
+ */
+@interface ImageLoaderDownloaderHeaderPolicy (Conveniences)
+
+/// Create the header policy which scale down the image larger than the max pixel size (either width or height), into a thumbnail fit the max pixel size.
+/// @param maxPixelSize The max pixel size
+/// @note This is for convenience, if you need code to control the logic, use block API instead.
+- (nonnull instancetype)initWithScaleDownMaxPixelSize:(CGSize)maxPixelSize;
+
+/// Create the header policy which abort the download of image which pixel count (width * height) is larger than the limit.
+/// @param maxPixelCount The max pixel count
+/// @note This is for convenience, if you need code to control the logic, use block API instead.
+- (nonnull instancetype)initWithAbortMaxPixelCount:(NSUInteger)maxPixelCount;
+
+@end
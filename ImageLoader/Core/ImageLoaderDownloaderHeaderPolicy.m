@@ -0,0 +1,99 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "ImageLoaderDownloaderHeaderPolicy.h"
+
+@interface ImageLoaderDownloaderHeaderDecision ()
+
+@property (nonatomic, assign, readwrite) ImageLoaderDownloaderHeaderAction action;
+@property (nonatomic, copy, readwrite, nullable) NSURL *URL;
+@property (nonatomic, assign, readwrite) CGSize thumbnailPixelSize;
+
+@end
+
+@implementation ImageLoaderDownloaderHeaderDecision
+
++ (instancetype)continueDecision {
+    return [self new];
+}
+
++ (instancetype)abortDecision {
+    ImageLoaderDownloaderHeaderDecision *decision = [self new];
+    decision.action = ImageLoaderDownloaderHeaderActionAbort;
+    return decision;
+}
+
++ (instancetype)switchDecisionWithURL:(NSURL *)URL {
+    ImageLoaderDownloaderHeaderDecision *decision = [self new];
+    decision.action = ImageLoaderDownloaderHeaderActionSwitchURL;
+    decision.URL = URL;
+    return decision;
+}
+
++ (instancetype)scaleDownDecisionWithThumbnailPixelSize:(CGSize)thumbnailPixelSize {
+    ImageLoaderDownloaderHeaderDecision *decision = [self new];
+    decision.action = ImageLoaderDownloaderHeaderActionScaleDown;
+    decision.thumbnailPixelSize = thumbnailPixelSize;
+    return decision;
+}
+
+@end
+
+@interface ImageLoaderDownloaderHeaderPolicy ()
+
+@property (nonatomic, copy, nonnull) ImageLoaderDownloaderHeaderPolicyBlock block;
+
+@end
+
+@implementation ImageLoaderDownloaderHeaderPolicy
+
+- (instancetype)initWithBlock:(ImageLoaderDownloaderHeaderPolicyBlock)block {
+    self = [super init];
+    if (self) {
+        self.block = block;
+    }
+    return self;
+}
+
++ (instancetype)headerPolicyWithBlock:(ImageLoaderDownloaderHeaderPolicyBlock)block {
+    ImageLoaderDownloaderHeaderPolicy *headerPolicy = [[ImageLoaderDownloaderHeaderPolicy alloc] initWithBlock:block];
+    return headerPolicy;
+}
+
+- (nullable ImageLoaderDownloaderHeaderDecision *)decisionForHeaderInfo:(nonnull LoadImageHeaderInfo *)headerInfo response:(nonnull NSURLResponse *)response {
+    if (!self.block) {
+        return nil;
+    }
+    return self.block(headerInfo, response);
+}
+
+@end
+
+@implementation ImageLoaderDownloaderHeaderPolicy (Conveniences)
+
+- (instancetype)initWithScaleDownMaxPixelSize:(CGSize)maxPixelSize {
+    return [self initWithBlock:^ImageLoaderDownloaderHeaderDecision * _Nullable(LoadImageHeaderInfo * _Nonnull headerInfo, NSURLResponse * _Nonnull response) {
+        CGSize pixelSize = headerInfo.pixelSize;
+        if (pixelSize.width <= maxPixelSize.width && pixelSize.height <= maxPixelSize.height) {
+            return nil;
+        }
+        return [ImageLoaderDownloaderHeaderDecision scaleDownDecisionWithThumbnailPixelSize:maxPixelSize];
+    }];
+}
+
+- (instancetype)initWithAbortMaxPixelCount:(NSUInteger)maxPixelCount {
+    return [self initWithBlock:^ImageLoaderDownloaderHeaderDecision * _Nullable(LoadImageHeaderInfo * _Nonnull headerInfo, NSURLResponse * _Nonnull response) {
+        CGSize pixelSize = headerInfo.pixelSize;
+        if (pixelSize.width * pixelSize.height <= maxPixelCount) {
+            return nil;
+        }
+        return [ImageLoaderDownloaderHeaderDecision abortDecision];
+    }];
+}
+
+@end
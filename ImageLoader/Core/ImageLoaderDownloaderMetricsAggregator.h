@@ -0,0 +1,123 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+/**
+ A histogram of durations (in seconds), with fixed exponential buckets from 1ms to 10s. The last bucket counts the durations larger than 10s.
+ */
+@interface ImageLoaderDownloaderMetricsHistogram : NSObject <NSCopying>
+
+/// The upper bounds (inclusive) of the buckets except the last one, in seconds
+@property (nonatomic, class, readonly, nonnull) NSArray<NSNumber *> *bucketUpperBounds;
+
+/// The sample count of each bucket, the count is `bucketUpperBounds.count + 1`
+@property (nonatomic, copy, readonly, nonnull) NSArray<NSNumber *> *bucketCounts;
+/// The total sample count
+@property (nonatomic, assign, readonly) NSUInteger count;
+/// The sum of samples
+@property (nonatomic, assign, readonly) NSTimeInterval sum;
+/// The min sample, 0 if no sample
+@property (nonatomic, assign, readonly) NSTimeInterval min;
+/// The max sample, 0 if no sample
+@property (nonatomic, assign, readonly) NSTimeInterval max;
+/// The mean of samples, 0 if no sample
+@property (nonatomic, assign, readonly) NSTimeInterval mean;
+
+/**
+ The estimated percentile, which is the upper bound of the bucket contains that rank, and limited by the max sample.
+
+ @param percentile The percentile in 0.0-1.0, such as 0.9 for p90
+ @return The estimated duration, 0 if no sample
+ */
+- (NSTimeInterval)valueAtPercentile:(double)percentile;
+
+/// The JSON compatible dictionary, contains count, sum, min, max, mean, p50, p90, p99 and buckets
+- (nonnull NSDictionary<NSString *, id> *)dictionaryRepresentation;
+
+@end
+
+/**
+ The rolled-up download metrics of one host. The instance is a snapshot and does not change.
+ Each sample is from the last network transaction of a task (after redirection), so a retried download count each attempt as one request.
+ */
+@interface ImageLoaderDownloaderHostMetrics : NSObject <NSCopying>
+
+/// The host, lowercased
+@property (nonatomic, copy, readonly, nonnull) NSString *host;
+/// The request count, including the retries
+@property (nonatomic, assign, readonly) NSUInteger requestCount;
+/// The failed request count, which has an error or responded with status code >= 400
+@property (nonatomic, assign, readonly) NSUInteger failedCount;
+/// The request count which is a retry of the failed request, see `ImageLoaderDownloaderConfig.retryPolicy`
+@property (nonatomic, assign, readonly) NSUInteger retriedCount;
+/// The request count which reused a persistent connection
+@property (nonatomic, assign, readonly) NSUInteger reusedConnectionCount;
+/// The received response body bytes
+@property (nonatomic, assign, readonly) unsigned long long receivedBytes;
+/// The request count by the network protocol name, such as `http/1.1`, `h2`, `h3`. The unknown protocol use `unknown`
+@property (nonatomic, copy, readonly, nonnull) NSDictionary<NSString *, NSNumber *> *protocolCounts;
+/// The date of the last sample
+@property (nonatomic, strong, readonly, nullable) NSDate *lastUpdateDate;
+
+/// The DNS lookup duration, only for the new connection
+@property (nonatomic, copy, readonly, nonnull) ImageLoaderDownloaderMetricsHistogram *domainLookup;
+/// The connect duration (including TLS), only for the new connection
+@property (nonatomic, copy, readonly, nonnull) ImageLoaderDownloaderMetricsHistogram *connect;
+/// The TLS handshake duration, only for the new secure connection
+@property (nonatomic, copy, readonly, nonnull) ImageLoaderDownloaderMetricsHistogram *secureConnection;
+/// The time to first byte, from request start to response start
+@property (nonatomic, copy, readonly, nonnull) ImageLoaderDownloaderMetricsHistogram *timeToFirstByte;
+/// The transfer duration, from response start to response end
+@property (nonatomic, copy, readonly, nonnull) ImageLoaderDownloaderMetricsHistogram *transfer;
+/// The total task duration, including redirection
+@property (nonatomic, copy, readonly, nonnull) ImageLoaderDownloaderMetricsHistogram *duration;
+
+/// The JSON compatible dictionary
+- (nonnull NSDictionary<NSString *, id> *)dictionaryRepresentation;
+
+@end
+
+/**
+ A thread-safe aggregator which rolls up the download metrics (`NSURLSessionTaskMetrics`) per host. Which can be used to make CDN decisions, or tie the image latency to the network stages.
+ The downloader records into it when `ImageLoaderDownloaderConfig.shouldAggregateMetrics` is enabled, see `ImageLoaderDownloader.metricsAggregator`.
+ */
+@interface ImageLoaderDownloaderMetricsAggregator : NSObject
+
+/**
+ * The max host count. The least recently updated host is removed when exceeded.
+ * Defaults to 100. 0 means no limit.
+ */
+@property (nonatomic, assign) NSUInteger maxHostCount;
+
+/**
+ Record the metrics of one task.
+
+ @param metrics The task metrics
+ @param error The task error, may be nil
+ @param retried Whether the task is a retry of the failed request
+ */
+- (void)recordMetrics:(nonnull NSURLSessionTaskMetrics *)metrics error:(nullable NSError *)error retried:(BOOL)retried API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+
+/// The recorded hosts, sorted
+@property (nonatomic, copy, readonly, nonnull) NSArray<NSString *> *hosts;
+
+/// The snapshot of the host, nil if not recorded. The host is case-insensitive
+- (nullable ImageLoaderDownloaderHostMetrics *)metricsForHost:(nonnull NSString *)host;
+
+/// The snapshot of all hosts, keyed by host
+- (nonnull NSDictionary<NSString *, ImageLoaderDownloaderHostMetrics *> *)allHostMetrics;
+
+/// The JSON data of all hosts, in `{"hosts": {<host>: <host metrics>}}`
+- (nullable NSData *)JSONData;
+
+/// Remove all recorded metrics
+- (void)removeAllMetrics;
+
+@end
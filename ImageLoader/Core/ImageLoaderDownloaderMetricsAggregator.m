@@ -0,0 +1,338 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "ImageLoaderDownloaderMetricsAggregator.h"
+#import "SDInternalMacros.h"
+
+// 1ms, 2ms, 5ms, ... 10s, plus the overflow bucket
+#define SD_METRICS_BUCKET_COUNT 14
+static const NSTimeInterval SDMetricsBucketUpperBounds[SD_METRICS_BUCKET_COUNT - 1] = {0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5, 10};
+
+static NSTimeInterval SDMetricsIntervalBetweenDates(NSDate *startDate, NSDate *endDate) {
+    if (!startDate || !endDate) {
+        return -1;
+    }
+    return [endDate timeIntervalSinceDate:startDate];
+}
+
+@interface ImageLoaderDownloaderMetricsHistogram ()
+
+- (void)addValue:(NSTimeInterval)value;
+
+@end
+
+@implementation ImageLoaderDownloaderMetricsHistogram {
+    NSUInteger _counts[SD_METRICS_BUCKET_COUNT];
+}
+
++ (NSArray<NSNumber *> *)bucketUpperBounds {
+    static NSArray<NSNumber *> *bucketUpperBounds;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray<NSNumber *> *bounds = [NSMutableArray arrayWithCapacity:SD_METRICS_BUCKET_COUNT - 1];
+        for (NSUInteger i = 0; i < SD_METRICS_BUCKET_COUNT - 1; i++) {
+            [bounds addObject:@(SDMetricsBucketUpperBounds[i])];
+        }
+        bucketUpperBounds = [bounds copy];
+    });
+    return bucketUpperBounds;
+}
+
+- (void)addValue:(NSTimeInterval)value {
+    if (value < 0) {
+        return;
+    }
+    NSUInteger index = 0;
+    while (index < SD_METRICS_BUCKET_COUNT - 1 && value > SDMetricsBucketUpperBounds[index]) {
+        index++;
+    }
+    _counts[index]++;
+    _min = _count == 0 ? value : MIN(_min, value);
+    _max = MAX(_max, value);
+    _sum += value;
+    _count++;
+}
+
+- (NSArray<NSNumber *> *)bucketCounts {
+    NSMutableArray<NSNumber *> *bucketCounts = [NSMutableArray arrayWithCapacity:SD_METRICS_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < SD_METRICS_BUCKET_COUNT; i++) {
+        [bucketCounts addObject:@(_counts[i])];
+    }
+    return [bucketCounts copy];
+}
+
+- (NSTimeInterval)mean {
+    return _count > 0 ? _sum / _count : 0;
+}
+
+- (NSTimeInterval)valueAtPercentile:(double)percentile {
+    if (_count == 0) {
+        return 0;
+    }
+    percentile = MIN(MAX(percentile, 0), 1);
+    NSUInteger rank = MAX((NSUInteger)ceil(percentile * _count), 1);
+    NSUInteger cumulative = 0;
+    for (NSUInteger i = 0; i < SD_METRICS_BUCKET_COUNT - 1; i++) {
+        cumulative += _counts[i];
+        if (cumulative >= rank) {
+            return MIN(MAX(SDMetricsBucketUpperBounds[i], _min), _max);
+        }
+    }
+    return _max;
+}
+
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation {
+    NSMutableArray<NSDictionary *> *buckets = [NSMutableArray arrayWithCapacity:SD_METRICS_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < SD_METRICS_BUCKET_COUNT; i++) {
+        // The overflow bucket use `+Inf` as Prometheus
+        id upperBound = i < SD_METRICS_BUCKET_COUNT - 1 ? @(SDMetricsBucketUpperBounds[i]) : @"+Inf";
+        [buckets addObject:@{@"le" : upperBound, @"count" : @(_counts[i])}];
+    }
+    return @{@"count" : @(_count),
+             @"sum" : @(_sum),
+             @"min" : @(_min),
+             @"max" : @(_max),
+             @"mean" : @(self.mean),
+             @"p50" : @([self valueAtPercentile:0.5]),
+             @"p90" : @([self valueAtPercentile:0.9]),
+             @"p99" : @([self valueAtPercentile:0.99]),
+             @"buckets" : [buckets copy]};
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    ImageLoaderDownloaderMetricsHistogram *histogram = [[[self class] allocWithZone:zone] init];
+    memcpy(histogram->_counts, _counts, sizeof(_counts));
+    histogram->_count = _count;
+    histogram->_sum = _sum;
+    histogram->_min = _min;
+    histogram->_max = _max;
+    return histogram;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, count: %lu, mean: %.3fs, p50: %.3fs, p90: %.3fs, max: %.3fs>", NSStringFromClass(self.class), self, (unsigned long)_count, self.mean, [self valueAtPercentile:0.5], [self valueAtPercentile:0.9], _max];
+}
+
+@end
+
+@interface ImageLoaderDownloaderHostMetrics ()
+
+@property (nonatomic, copy, readwrite, nonnull) NSString *host;
+@property (nonatomic, assign, readwrite) NSUInteger requestCount;
+@property (nonatomic, assign, readwrite) NSUInteger failedCount;
+@property (nonatomic, assign, readwrite) NSUInteger retriedCount;
+@property (nonatomic, assign, readwrite) NSUInteger reusedConnectionCount;
+@property (nonatomic, assign, readwrite) unsigned long long receivedBytes;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, NSNumber *> *mutableProtocolCounts;
+@property (nonatomic, strong, readwrite, nullable) NSDate *lastUpdateDate;
+@property (nonatomic, copy, readwrite, nonnull) ImageLoaderDownloaderMetricsHistogram *domainLookup;
+@property (nonatomic, copy, readwrite, nonnull) ImageLoaderDownloaderMetricsHistogram *connect;
+@property (nonatomic, copy, readwrite, nonnull) ImageLoaderDownloaderMetricsHistogram *secureConnection;
+@property (nonatomic, copy, readwrite, nonnull) ImageLoaderDownloaderMetricsHistogram *timeToFirstByte;
+@property (nonatomic, copy, readwrite, nonnull) ImageLoaderDownloaderMetricsHistogram *transfer;
+@property (nonatomic, copy, readwrite, nonnull) ImageLoaderDownloaderMetricsHistogram *duration;
+
+- (nonnull instancetype)initWithHost:(nonnull NSString *)host;
+
+@end
+
+@implementation ImageLoaderDownloaderHostMetrics
+
+- (instancetype)initWithHost:(NSString *)host {
+    self = [super init];
+    if (self) {
+        _host = [host copy];
+        _mutableProtocolCounts = [NSMutableDictionary dictionary];
+        _domainLookup = [ImageLoaderDownloaderMetricsHistogram new];
+        _connect = [ImageLoaderDownloaderMetricsHistogram new];
+        _secureConnection = [ImageLoaderDownloaderMetricsHistogram new];
+        _timeToFirstByte = [ImageLoaderDownloaderMetricsHistogram new];
+        _transfer = [ImageLoaderDownloaderMetricsHistogram new];
+        _duration = [ImageLoaderDownloaderMetricsHistogram new];
+    }
+    return self;
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)protocolCounts {
+    return [self.mutableProtocolCounts copy];
+}
+
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation {
+    NSMutableDictionary<NSString *, id> *dictionary = [NSMutableDictionary dictionary];
+    dictionary[@"host"] = self.host;
+    dictionary[@"requestCount"] = @(self.requestCount);
+    dictionary[@"failedCount"] = @(self.failedCount);
+    dictionary[@"retriedCount"] = @(self.retriedCount);
+    dictionary[@"reusedConnectionCount"] = @(self.reusedConnectionCount);
+    dictionary[@"receivedBytes"] = @(self.receivedBytes);
+    dictionary[@"protocols"] = self.protocolCounts;
+    if (self.lastUpdateDate) {
+        dictionary[@"lastUpdate"] = @(self.lastUpdateDate.timeIntervalSince1970);
+    }
+    dictionary[@"domainLookup"] = self.domainLookup.dictionaryRepresentation;
+    dictionary[@"connect"] = self.connect.dictionaryRepresentation;
+    dictionary[@"secureConnection"] = self.secureConnection.dictionaryRepresentation;
+    dictionary[@"timeToFirstByte"] = self.timeToFirstByte.dictionaryRepresentation;
+    dictionary[@"transfer"] = self.transfer.dictionaryRepresentation;
+    dictionary[@"duration"] = self.duration.dictionaryRepresentation;
+    return [dictionary copy];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    ImageLoaderDownloaderHostMetrics *metrics = [[[self class] allocWithZone:zone] initWithHost:self.host];
+    metrics.requestCount = self.requestCount;
+    metrics.failedCount = self.failedCount;
+    metrics.retriedCount = self.retriedCount;
+    metrics.reusedConnectionCount = self.reusedConnectionCount;
+    metrics.receivedBytes = self.receivedBytes;
+    metrics.mutableProtocolCounts = [self.mutableProtocolCounts mutableCopy];
+    metrics.lastUpdateDate = self.lastUpdateDate;
+    // The histograms are copied by property
+    metrics.domainLookup = self.domainLookup;
+    metrics.connect = self.connect;
+    metrics.secureConnection = self.secureConnection;
+    metrics.timeToFirstByte = self.timeToFirstByte;
+    metrics.transfer = self.transfer;
+    metrics.duration = self.duration;
+    return metrics;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, host: %@, requests: %lu, failed: %lu, retried: %lu, reused: %lu, bytes: %llu, TTFB: %@>", NSStringFromClass(self.class), self, self.host, (unsigned long)self.requestCount, (unsigned long)self.failedCount, (unsigned long)self.retriedCount, (unsigned long)self.reusedConnectionCount, self.receivedBytes, self.timeToFirstByte];
+}
+
+@end
+
+@implementation ImageLoaderDownloaderMetricsAggregator {
+    NSMutableDictionary<NSString *, ImageLoaderDownloaderHostMetrics *> *_hostMetrics;
+    NSMutableOrderedSet<NSString *> *_recentHosts; // The least recently updated first
+    SD_LOCK_DECLARE(_lock);
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _maxHostCount = 100;
+        _hostMetrics = [NSMutableDictionary dictionary];
+        _recentHosts = [NSMutableOrderedSet orderedSet];
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+- (void)recordMetrics:(NSURLSessionTaskMetrics *)metrics error:(NSError *)error retried:(BOOL)retried {
+    NSURLSessionTaskTransactionMetrics *transactionMetrics = metrics.transactionMetrics.lastObject;
+    NSString *host = (transactionMetrics.request.URL.host ?: transactionMetrics.response.URL.host).lowercaseString;
+    if (host.length == 0) {
+        return;
+    }
+    NSInteger statusCode = [transactionMetrics.response isKindOfClass:NSHTTPURLResponse.class] ? ((NSHTTPURLResponse *)transactionMetrics.response).statusCode : 0;
+    BOOL failed = error != nil || statusCode >= 400;
+    BOOL networkLoad = transactionMetrics.resourceFetchType == NSURLSessionTaskMetricsResourceFetchTypeNetworkLoad;
+    NSString *protocol = transactionMetrics.networkProtocolName.lowercaseString ?: @"unknown";
+    unsigned long long receivedBytes = 0;
+    if (@available(iOS 13.0, tvOS 13.0, macOS 10.15, watchOS 6.0, *)) {
+        for (NSURLSessionTaskTransactionMetrics *metric in metrics.transactionMetrics) {
+            receivedBytes += metric.countOfResponseBodyBytesReceived;
+        }
+    }
+
+    SD_LOCK(_lock);
+    ImageLoaderDownloaderHostMetrics *hostMetrics = _hostMetrics[host];
+    if (!hostMetrics) {
+        hostMetrics = [[ImageLoaderDownloaderHostMetrics alloc] initWithHost:host];
+        _hostMetrics[host] = hostMetrics;
+    }
+    [_recentHosts removeObject:host];
+    [_recentHosts addObject:host];
+    hostMetrics.requestCount++;
+    if (failed) hostMetrics.failedCount++;
+    if (retried) hostMetrics.retriedCount++;
+    hostMetrics.receivedBytes += receivedBytes;
+    hostMetrics.lastUpdateDate = [NSDate date];
+    [hostMetrics.duration addValue:metrics.taskInterval.duration];
+    if (networkLoad) {
+        // The local cache or server push does not reflect the network stages
+        NSNumber *protocolCount = hostMetrics.mutableProtocolCounts[protocol];
+        hostMetrics.mutableProtocolCounts[protocol] = @(protocolCount.unsignedIntegerValue + 1);
+        if (transactionMetrics.isReusedConnection) {
+            hostMetrics.reusedConnectionCount++;
+        } else {
+            [hostMetrics.domainLookup addValue:SDMetricsIntervalBetweenDates(transactionMetrics.domainLookupStartDate, transactionMetrics.domainLookupEndDate)];
+            [hostMetrics.connect addValue:SDMetricsIntervalBetweenDates(transactionMetrics.connectStartDate, transactionMetrics.connectEndDate)];
+            [hostMetrics.secureConnection addValue:SDMetricsIntervalBetweenDates(transactionMetrics.secureConnectionStartDate, transactionMetrics.secureConnectionEndDate)];
+        }
+        [hostMetrics.timeToFirstByte addValue:SDMetricsIntervalBetweenDates(transactionMetrics.requestStartDate, transactionMetrics.responseStartDate)];
+        [hostMetrics.transfer addValue:SDMetricsIntervalBetweenDates(transactionMetrics.responseStartDate, transactionMetrics.responseEndDate)];
+    }
+    [self trimToMaxHostCount];
+    SD_UNLOCK(_lock);
+}
+
+- (NSArray<NSString *> *)hosts {
+    SD_LOCK(_lock);
+    NSArray<NSString *> *hosts = _hostMetrics.allKeys;
+    SD_UNLOCK(_lock);
+    return [hosts sortedArrayUsingSelector:@selector(compare:)];
+}
+
+- (ImageLoaderDownloaderHostMetrics *)metricsForHost:(NSString *)host {
+    if (!host) {
+        return nil;
+    }
+    SD_LOCK(_lock);
+    ImageLoaderDownloaderHostMetrics *hostMetrics = [_hostMetrics[host.lowercaseString] copy];
+    SD_UNLOCK(_lock);
+    return hostMetrics;
+}
+
+- (NSDictionary<NSString *, ImageLoaderDownloaderHostMetrics *> *)allHostMetrics {
+    SD_LOCK(_lock);
+    NSMutableDictionary<NSString *, ImageLoaderDownloaderHostMetrics *> *allHostMetrics = [NSMutableDictionary dictionaryWithCapacity:_hostMetrics.count];
+    [_hostMetrics enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull host, ImageLoaderDownloaderHostMetrics * _Nonnull hostMetrics, BOOL * _Nonnull stop) {
+        allHostMetrics[host] = [hostMetrics copy];
+    }];
+    SD_UNLOCK(_lock);
+    return [allHostMetrics copy];
+}
+
+- (NSData *)JSONData {
+    NSDictionary<NSString *, ImageLoaderDownloaderHostMetrics *> *allHostMetrics = [self allHostMetrics];
+    NSMutableDictionary<NSString *, id> *hosts = [NSMutableDictionary dictionaryWithCapacity:allHostMetrics.count];
+    [allHostMetrics enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull host, ImageLoaderDownloaderHostMetrics * _Nonnull hostMetrics, BOOL * _Nonnull stop) {
+        hosts[host] = hostMetrics.dictionaryRepresentation;
+    }];
+    NSJSONWritingOptions options = 0;
+    if (@available(iOS 11.0, tvOS 11.0, macOS 10.13, watchOS 4.0, *)) {
+        options |= NSJSONWritingSortedKeys;
+    }
+    return [NSJSONSerialization dataWithJSONObject:@{@"hosts" : hosts} options:options error:nil];
+}
+
+- (void)removeAllMetrics {
+    SD_LOCK(_lock);
+    [_hostMetrics removeAllObjects];
+    [_recentHosts removeAllObjects];
+    SD_UNLOCK(_lock);
+}
+
+#pragma mark - Helper
+
+// Must be called in lock
+- (void)trimToMaxHostCount {
+    if (_maxHostCount == 0) {
+        return;
+    }
+    while (_recentHosts.count > _maxHostCount) {
+        NSString *host = _recentHosts.firstObject;
+        [_recentHosts removeObjectAtIndex:0];
+        [_hostMetrics removeObjectForKey:host];
+    }
+}
+
+@end
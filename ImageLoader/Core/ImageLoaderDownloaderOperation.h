@@ -45,8 +45,16 @@
 // These operation-level config was inherited from downloader. See `ImageLoaderDownloaderConfig` for documentation.
 @property (strong, nonatomic, nullable) NSURLCredential *credential;
 @property (assign, nonatomic) double minimumProgressInterval;
+@property (assign, nonatomic) NSTimeInterval progressCoalescingInterval;
+@property (assign, nonatomic) NSTimeInterval progressiveDecodeBudget;
 @property (copy, nonatomic, nullable) NSIndexSet *acceptableStatusCodes;
 @property (copy, nonatomic, nullable) NSSet<NSString *> *acceptableContentTypes;
+@property (copy, nonatomic, nullable) ImageLoaderDownloaderRetryPolicy *retryPolicy;
+
+@property (assign, nonatomic, readonly) NSUInteger retryCount;
+
+// The cache key of the original URL (before request modifier), set by downloader
+@property (copy, nonatomic, nullable) NSString *cacheKey;
 
 @end
 
@@ -93,6 +101,18 @@
  */
 @property (assign, nonatomic) double minimumProgressInterval;
 
+/**
+ * The interval to coalesce the progress callbacks. The received size is published with atomic counters, and the progress blocks are called by a single timer shared by all download operations.
+ * Defaults to 0, which means each time we receive the new data from URLSession, we callback the progressBlock immediately.
+ */
+@property (assign, nonatomic) NSTimeInterval progressCoalescingInterval;
+
+/**
+ * The CPU time budget of the partial image decoding for progressive download. The partial decoding is adaptive to the measured decode cost, and stops when the total duration exceeds the budget.
+ * Defaults to 1 second. 0 means no budget limit.
+ */
+@property (assign, nonatomic) NSTimeInterval progressiveDecodeBudget;
+
 /**
  * Set the acceptable HTTP Response status code. The status code which beyond the range will mark the download operation failed.
  * For example, if we config [200, 400) but server response is 503, the download will fail with error code `ImageLoaderErrorInvalidDownloadStatusCode`.
@@ -108,6 +128,23 @@
  */
 @property (copy, nonatomic, nullable) NSSet<NSString *> *acceptableContentTypes;
 
+/**
+ * The retry policy for the transient download failures. The retry use a new task in the same operation, and the callbacks are kept.
+ * Defaults to nil, means no retry.
+ */
+@property (copy, nonatomic, nullable) ImageLoaderDownloaderRetryPolicy *retryPolicy;
+
+/**
+ * The retry count already performed, see `retryPolicy`.
+ */
+@property (assign, nonatomic, readonly) NSUInteger retryCount;
+
+/**
+ * The cache key of the original URL, which is used to store the image. The request modifier may change the request URL, so the key can not be derived from the `request`.
+ * Used as the key to stream the data into disk cache. Defaults to nil, means use the key of request URL.
+ */
+@property (copy, nonatomic, nullable) NSString *cacheKey;
+
 /**
  * The options for the receiver.
  */
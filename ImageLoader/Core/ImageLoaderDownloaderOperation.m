@@ -13,8 +13,21 @@
 #import "ImageLoaderDownloaderDecryptor.h"
 #import "LoadImageCacheDefine.h"
 #import "SDCallbackQueue.h"
+#import "SDDataRope.h"
+#import "LoadImageCache.h"
+#import "ImageLoaderCacheKeyFilter.h"
+#import "SDPartialDownloadStore.h"
+#import "SDDownloadScheduler.h"
+#import "SDImageHeaderParser.h"
+#import "SDProgressiveDecodeThrottle.h"
+#import "SDImageCacheVariant.h"
+#import "UIImage+Metadata.h"
+#import "SDProgressCoalescer.h"
+#import "SDImageDecodeExecutor.h"
+#import <stdatomic.h>
 
 BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperation> operation); // Private currently, mark open if needed
+void ImageLoaderDownloaderOperationSetCompleted(id<ImageLoaderDownloaderOperation> operation, BOOL isCompleted);
 
 // A handler to represent individual request
 @interface ImageLoaderDownloaderOperationToken : NSObject
@@ -22,6 +35,8 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
 @property (nonatomic, copy, nullable) ImageLoaderDownloaderCompletedBlock completedBlock;
 @property (nonatomic, copy, nullable) ImageLoaderDownloaderProgressBlock progressBlock;
 @property (nonatomic, copy, nullable) LoadImageCoderOptions *decodeOptions;
+@property (nonatomic, weak, nullable) NSOperation *decodeOperation; // the final decode for this token, cancelled with token
+@property (atomic, assign) BOOL completed; // the completion block is called with finished
 
 @end
 
@@ -45,7 +60,13 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
 
 @end
 
-@interface ImageLoaderDownloaderOperation ()
+@interface ImageLoaderDownloaderOperation () <SDProgressCoalescing> {
+    // The progress published for the coalescer, written on the URLSession delegate queue
+    atomic_ullong _publishedReceivedSize;
+    atomic_ullong _publishedExpectedSize;
+    atomic_bool _progressPending;
+    SD_LOCK_DECLARE(_decodeOperationsLock);
+}
 
 @property (strong, nonatomic, nonnull) NSMutableArray<ImageLoaderDownloaderOperationToken *> *callbackTokens;
 
@@ -54,16 +75,37 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
 
 @property (assign, nonatomic, getter = isExecuting) BOOL executing;
 @property (assign, nonatomic, getter = isFinished) BOOL finished;
-@property (strong, nonatomic, nullable) NSMutableData *imageData;
+@property (strong, nonatomic, nullable) SDDataRope *imageData; // the received chunks, avoid reallocate when expected size is unknown or wrong
 @property (copy, nonatomic, nullable) NSData *cachedData; // for `ImageLoaderDownloaderIgnoreCachedResponse`
+@property (strong, nonatomic, nullable) LoadImageCache *stagingCache; // for `ImageLoaderDownloaderStreamToDiskCache` and `ImageLoaderDownloaderResumeDownload`
+@property (copy, nonatomic, nullable) NSString *stagingKey;
+@property (copy, nonatomic, nullable) NSString *stagingPath; // the staging file which is not committed
+@property (strong, nonatomic, nullable) NSFileHandle *stagingHandle;
+@property (assign, nonatomic) BOOL shouldCommitStagingFile; // commit into disk cache, or read back into memory
+@property (strong, nonatomic, nullable) SDPartialDownloadStore *partialStore; // for `ImageLoaderDownloaderResumeDownload`
+@property (strong, nonatomic, nullable) SDPartialDownload *partialDownload; // the claimed partial body to resume
+@property (copy, nonatomic, nullable) NSString *resumeValidator; // the validator of current body, nil if can not resume
+@property (assign, nonatomic) BOOL shouldRetryWithoutRange; // the range of partial body is not satisfiable (416)
+@property (assign, nonatomic) BOOL rangeDisabled; // already retried without range, do not resume again
 @property (assign, nonatomic) NSUInteger expectedSize; // may be 0
 @property (assign, nonatomic) NSUInteger receivedSize;
 @property (strong, nonatomic, nullable, readwrite) NSURLResponse *response;
 @property (strong, nonatomic, nullable) NSError *responseError;
 @property (assign, nonatomic) double previousProgress; // previous progress percent
+@property (strong, nonatomic, nullable) SDProgressiveDecodeThrottle *progressiveThrottle; // decide the partial decode by measured cost
+@property (assign, nonatomic) BOOL progressCoalescing; // registered into the coalescer
+@property (assign, nonatomic, readwrite) NSUInteger retryCount;
+@property (assign, nonatomic) CFAbsoluteTime startTime; // the first attempt start time, for retry deadline
 
 @property (strong, nonatomic, nullable) id<ImageLoaderDownloaderResponseModifier> responseModifier; // modify original URLResponse
 @property (strong, nonatomic, nullable) id<ImageLoaderDownloaderDecryptor> decryptor; // decrypt image data
+@property (strong, nonatomic, nullable) id<ImageLoaderDownloaderDecryptStream> decryptStream; // decrypt each chunk of current response, nil for whole data decryption
+@property (strong, nonatomic, nullable) id<ImageLoaderDownloaderHeaderPolicy> headerPolicy; // decide after image header parsed
+@property (strong, nonatomic, nullable) NSMutableData *headerData; // the received prefix before image header parsed
+@property (assign, nonatomic) BOOL headerDecided; // the header policy is called, or the header can not be parsed
+@property (copy, nonatomic, nullable) NSURL *switchURL; // the URL to switch after current task cancelled
+@property (copy, nonatomic, nullable) NSURLRequest *switchedRequest; // the request of switched URL, used for the next tasks
+@property (assign, nonatomic) CGSize scaleDownPixelSize; // the thumbnail pixel size decided by header policy
 
 // This is weak because it is injected by whoever manages this session. If this gets nil-ed out, we won't be able to run
 // the task associated with this operation
@@ -75,7 +117,8 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
 
 @property (strong, nonatomic, readwrite, nullable) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
 
-@property (strong, nonatomic, nonnull) NSOperationQueue *coderQueue; // the serial operation queue to do image decoding
+@property (strong, nonatomic, nonnull) NSHashTable<NSOperation *> *decodeOperations; // the decodes submitted into the shared executor, in order
+@property (weak, nonatomic, nullable) NSOperation *progressiveDecodeOperation; // the queued or running partial decode
 
 @property (strong, nonatomic, nonnull) NSMapTable<LoadImageCoderOptions *, UIImage *> *imageMap; // each variant of image is weak-referenced to avoid too many re-decode during downloading
 #if SD_UIKIT
@@ -108,13 +151,14 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
         _callbackTokens = [NSMutableArray new];
         _responseModifier = context[ImageLoaderContextDownloadResponseModifier];
         _decryptor = context[ImageLoaderContextDownloadDecryptor];
+        _headerPolicy = context[ImageLoaderContextDownloadHeaderPolicy];
         _executing = NO;
         _finished = NO;
         _expectedSize = 0;
+        _progressiveDecodeBudget = 1.0;
         _unownedSession = session;
-        _coderQueue = [[NSOperationQueue alloc] init];
-        _coderQueue.maxConcurrentOperationCount = 1;
-        _coderQueue.name = @"com.hackemist.ImageLoaderDownloaderOperation.coderQueue";
+        _decodeOperations = [NSHashTable weakObjectsHashTable];
+        SD_LOCK_INIT(_decodeOperationsLock);
         _imageMap = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:1];
 #if SD_UIKIT
         _backgroundTaskId = UIBackgroundTaskInvalid;
@@ -161,6 +205,8 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
         @synchronized (self) {
             [self.callbackTokens removeObjectIdenticalTo:token];
         }
+        // The queued decode for this token is not needed
+        [((ImageLoaderDownloaderOperationToken *)token).decodeOperation cancel];
         [self callCompletionBlockWithToken:token image:nil imageData:nil error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during sending the request"}] finished:YES];
     }
     return shouldCancel;
@@ -227,18 +273,18 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
             return;
         }
         
-        self.dataTask = [session dataTaskWithRequest:self.request];
+        NSURLRequest *request = self.request;
+        if (self.options & ImageLoaderDownloaderResumeDownload) {
+            request = [self resumeRequestWithRequest:request];
+        }
+        self.dataTask = [session dataTaskWithRequest:request];
+        self.startTime = CFAbsoluteTimeGetCurrent();
         self.executing = YES;
     }
 
     if (self.dataTask) {
-        if (self.options & ImageLoaderDownloaderHighPriority) {
-            self.dataTask.priority = NSURLSessionTaskPriorityHigh;
-        } else if (self.options & ImageLoaderDownloaderLowPriority) {
-            self.dataTask.priority = NSURLSessionTaskPriorityLow;
-        } else {
-            self.dataTask.priority = NSURLSessionTaskPriorityDefault;
-        }
+        // The queue priority is set from options, and updated by the downloader token priority
+        self.dataTask.priority = SDURLSessionTaskPriorityForQueuePriority(self.queuePriority);
         [self.dataTask resume];
         NSArray<ImageLoaderDownloaderOperationToken *> *tokens;
         @synchronized (self) {
@@ -281,6 +327,9 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
         self.dataTask = nil;
     }
     
+    // All tokens are gone, the queued decodes never run
+    [self cancelDecodeOperations];
+    
     // NSOperation disallow setFinished=YES **before** operation's start method been called
     // We check for the initialized status, which is isExecuting == NO && isFinished = NO
     // Ony update for non-intialized status, which is !(isExecuting == NO && isFinished = NO), or if (self.isExecuting || self.isFinished) {...}
@@ -306,6 +355,29 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
         [self.callbackTokens removeAllObjects];
         self.dataTask = nil;
         
+        if (self.progressCoalescing) {
+            [[SDProgressCoalescer sharedCoalescer] removeTarget:self];
+            self.progressCoalescing = NO;
+        }
+        
+        // The file handle is closed on dealloc
+        // The delegate queue may be writing the staging file when cancelled, save or remove it after the write
+        NSOperationQueue *delegateQueue = (self.ownedSession ?: self.unownedSession).delegateQueue;
+        if (self.stagingPath && delegateQueue && NSOperationQueue.currentQueue != delegateQueue) {
+            [delegateQueue addOperationWithBlock:^{
+                @synchronized (self) {
+                    [self discardStagingFile];
+                }
+            }];
+        } else {
+            [self discardStagingFile];
+        }
+        if (self.partialDownload) {
+            // Claimed but not resumed
+            [self.stagingCache removeStagingFile:self.partialDownload.path];
+            self.partialDownload = nil;
+        }
+        
         if (self.ownedSession) {
             [self.ownedSession invalidateAndCancel];
             self.ownedSession = nil;
@@ -322,6 +394,23 @@ BOOL ImageLoaderDownloaderOperationGetCompleted(id<ImageLoaderDownloaderOperatio
     }
 }
 
+// Not committed, keep the partial body if it can be resumed, else remove it. Must be called in lock
+- (void)discardStagingFile {
+    if (!self.stagingPath) {
+        return;
+    }
+    if (self.partialStore && self.resumeValidator && self.receivedSize > 0) {
+        SDPartialDownload *partialDownload = [SDPartialDownload new];
+        partialDownload.path = self.stagingPath;
+        partialDownload.validator = self.resumeValidator;
+        partialDownload.expectedLength = self.expectedSize;
+        [self.partialStore savePartialDownload:partialDownload forKey:self.stagingKey];
+    } else {
+        [self.stagingCache removeStagingFile:self.stagingPath];
+    }
+    self.stagingPath = nil;
+}
+
 - (void)setFinished:(BOOL)finished {
     [self willChangeValueForKey:@"isFinished"];
     _finished = finished;
@@ -369,7 +458,11 @@ didReceiveResponse:(NSURLResponse *)response
     if (valid && statusCode > 0 && self.acceptableStatusCodes) {
         statusCodeValid = [self.acceptableStatusCodes containsIndex:statusCode];
     }
-    if (!statusCodeValid) {
+    // The partial body is out of range (such as the resource changed without validator), discard it and retry once without range
+    if (valid && statusCode == 416 && self.partialDownload && !self.rangeDisabled) {
+        valid = NO;
+        self.shouldRetryWithoutRange = YES;
+    } else if (!statusCodeValid) {
         valid = NO;
         self.responseError = [NSError errorWithDomain:ImageLoaderErrorDomain
                                                  code:ImageLoaderErrorInvalidDownloadStatusCode
@@ -402,13 +495,19 @@ didReceiveResponse:(NSURLResponse *)response
     }
     
     if (valid) {
+        // The stream decrypts each chunk as it arrives, the staging file stores the decrypted bytes
+        if ([self.decryptor respondsToSelector:@selector(decryptStreamWithResponse:)]) {
+            self.decryptStream = [self.decryptor decryptStreamWithResponse:response];
+        }
+        // Resume the partial body, or create the staging file for the new body
+        [self createStagingFileWithResponse:response];
         NSArray<ImageLoaderDownloaderOperationToken *> *tokens;
         @synchronized (self) {
             tokens = [self.callbackTokens copy];
         }
         for (ImageLoaderDownloaderOperationToken *token in tokens) {
             if (token.progressBlock) {
-                token.progressBlock(0, expected, self.request.URL);
+                token.progressBlock(self.receivedSize, self.expectedSize, self.request.URL);
             }
         }
     } else {
@@ -426,23 +525,62 @@ didReceiveResponse:(NSURLResponse *)response
 }
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
-    if (!self.imageData) {
-        self.imageData = [[NSMutableData alloc] initWithCapacity:self.expectedSize];
+    // The progress is in the downloaded bytes, which is the same as expected size
+    NSUInteger receivedLength = data.length;
+    if (self.decryptStream) {
+        data = [self.decryptStream decryptedDataWithData:data];
+        if (!data) {
+            self.responseError = [NSError errorWithDomain:ImageLoaderErrorDomain
+                                                     code:ImageLoaderErrorBadImageData
+                                                 userInfo:@{NSLocalizedDescriptionKey : @"Download marked as failed because decrypting data failed"}];
+            [dataTask cancel];
+            return;
+        }
     }
-    [self.imageData appendData:data];
     
-    self.receivedSize = self.imageData.length;
-    NSArray<ImageLoaderDownloaderOperationToken *> *tokens;
-    @synchronized (self) {
-        tokens = [self.callbackTokens copy];
+    // Parse the image header from the first few KB, the encrypted data can not be parsed unless decrypted by stream
+    if (self.headerPolicy && !self.headerDecided && (!self.decryptor || self.decryptStream)) {
+        if (![self decideHeaderWithData:data dataTask:dataTask]) {
+            // Aborted or switched, drop the data
+            return;
+        }
+    }
+    
+    if (self.stagingHandle) {
+        if (self.isCancelled) {
+            // The staging file may be already persisted as partial body
+            return;
+        }
+        // Stream into disk cache staging file, keep nothing in memory
+        if (![self writeStagingData:data]) {
+            self.responseError = [NSError errorWithDomain:ImageLoaderErrorDomain
+                                                     code:ImageLoaderErrorBadImageData
+                                                 userInfo:@{NSLocalizedDescriptionKey : @"Download marked as failed because writing staging file failed"}];
+            // The chunk may be partially written, do not resume from it
+            self.resumeValidator = nil;
+            [dataTask cancel];
+            return;
+        }
+    } else {
+        if (!self.imageData) {
+            self.imageData = [[SDDataRope alloc] init];
+        }
+        [self.imageData appendData:data];
+    }
+    
+    // Using data decryptor will disable the progressive decoding, unless it decrypts each chunk by stream
+    BOOL supportProgressive = (self.options & ImageLoaderDownloaderProgressiveLoad) && (!self.decryptor || self.decryptStream);
+    if (supportProgressive) {
+        if (!self.progressiveThrottle) {
+            self.progressiveThrottle = [[SDProgressiveDecodeThrottle alloc] initWithBudget:self.progressiveDecodeBudget];
+        }
+        [self.progressiveThrottle appendData:data];
     }
+    
+    self.receivedSize += receivedLength;
     if (self.expectedSize == 0) {
         // Unknown expectedSize, immediately call progressBlock and return
-        for (ImageLoaderDownloaderOperationToken *token in tokens) {
-            if (token.progressBlock) {
-                token.progressBlock(self.receivedSize, self.expectedSize, self.request.URL);
-            }
-        }
+        [self notifyProgress];
         return;
     }
     
@@ -458,45 +596,50 @@ didReceiveResponse:(NSURLResponse *)response
     }
     self.previousProgress = currentProgress;
     
-    // Using data decryptor will disable the progressive decoding, since there are no support for progressive decrypt
-    BOOL supportProgressive = (self.options & ImageLoaderDownloaderProgressiveLoad) && !self.decryptor;
-    // When multiple thumbnail decoding use different size, this progressive decoding will cause issue because each callback assume called with different size's image, can not share the same decoding part
-    // We currently only pick the first thumbnail size, see #3423 talks
+    // When multiple thumbnail decoding use different size, the partial image is decoded once at the largest size, and downscaled for each callback, see #3423 talks
     // Progressive decoding Only decode partial image, full image in `URLSession:task:didCompleteWithError:`
     if (supportProgressive && !finished) {
-        // Get the image data
-        NSData *imageData = self.imageData;
-        
-        // keep maximum one progressive decode process during download
-        if (self.coderQueue.operationCount == 0) {
+        // keep maximum one progressive decode process during download, and decode only when the image can be visibly improved within the budget
+        SDProgressiveDecodeThrottle *progressiveThrottle = self.progressiveThrottle;
+        NSOperation *progressiveDecodeOperation = self.progressiveDecodeOperation;
+        // Get the image data snapshot only when decode, mapping the staging file for each chunk is not cheap
+        NSData *imageData;
+        if ((!progressiveDecodeOperation || progressiveDecodeOperation.isFinished) && [progressiveThrottle shouldDecodeWithExpectedSize:self.expectedSize]) {
+            if (self.stagingHandle) {
+                // Map the bytes written so far, no copy
+                imageData = [NSData dataWithContentsOfFile:self.stagingPath options:NSDataReadingMappedAlways error:nil];
+            } else {
+                // No copy for the received chunks
+                imageData = self.imageData.data;
+            }
+        }
+        if (imageData.length > 0) {
             // NSOperation have autoreleasepool, don't need to create extra one
             @weakify(self);
-            [self.coderQueue addOperationWithBlock:^{
+            __weak NSURLSessionTask *decodeTask = dataTask;
+            self.progressiveDecodeOperation = [self addDecodeOperationWithBlock:^{
                 @strongify(self);
                 if (!self) {
                     return;
                 }
                 // When cancelled or transfer finished (`didCompleteWithError`), cancel the progress callback, only completed block is called and enough
+                // When the task restarted (retry, resume or URL switch), the data belongs to the previous body
                 @synchronized (self) {
-                    if (self.isCancelled || ImageLoaderDownloaderOperationGetCompleted(self)) {
+                    if (self.isCancelled || ImageLoaderDownloaderOperationGetCompleted(self) || self.dataTask != decodeTask) {
                         return;
                     }
                 }
-                UIImage *image = LoadImageLoaderDecodeProgressiveImageData(imageData, self.request.URL, NO, self, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
-                if (image) {
-                    // We do not keep the progressive decoding image even when `finished`=YES. Because they are for view rendering but not take full function from downloader options. And some coders implementation may not keep consistent between progressive decoding and normal decoding.
-                    
-                    [self callCompletionBlocksWithImage:image imageData:nil error:nil finished:NO];
-                }
-            }];
+                CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+                // We do not keep the progressive decoding image even when `finished`=YES. Because they are for view rendering but not take full function from downloader options. And some coders implementation may not keep consistent between progressive decoding and normal decoding.
+                [self decodeProgressiveImageWithData:imageData];
+                [progressiveThrottle recordDecodeDuration:CFAbsoluteTimeGetCurrent() - startTime];
+            } dependencies:nil];
+            // The snapshot is taken, the state is for the data received so far (the delegate queue is serial)
+            [progressiveThrottle markDecodeScheduled];
         }
     }
     
-    for (ImageLoaderDownloaderOperationToken *token in tokens) {
-        if (token.progressBlock) {
-            token.progressBlock(self.receivedSize, self.expectedSize, self.request.URL);
-        }
-    }
+    [self notifyProgress];
 }
 
 - (void)URLSession:(NSURLSession *)session
@@ -521,6 +664,51 @@ didReceiveResponse:(NSURLResponse *)response
     // If we already cancel the operation or anything mark the operation finished, don't callback twice
     if (self.isFinished) return;
     
+    // Switch to the URL decided by header policy, the current task is cancelled
+    if (self.switchURL) {
+        [self switchToURL:self.switchURL];
+        return;
+    }
+    
+    // The callbacks wait for the full body request
+    if (self.shouldRetryWithoutRange) {
+        [self retryWithoutRange];
+        return;
+    }
+    
+    // Retry the transient failure with a new task, the callbacks wait for it
+    if (error && [self retryIfNeededWithError:self.responseError ?: error]) {
+        return;
+    }
+    
+    // Finalize the stream decryption, the remaining bytes (such as the last block) are appended
+    if (!error && self.decryptStream) {
+        NSData *finalData = [self.decryptStream finalizeDecryptedData];
+        BOOL success = finalData != nil;
+        if (success && finalData.length > 0) {
+            if (self.stagingHandle) {
+                success = [self writeStagingData:finalData];
+            } else {
+                if (!self.imageData) {
+                    self.imageData = [[SDDataRope alloc] init];
+                }
+                [self.imageData appendData:finalData];
+            }
+        }
+        if (!success) {
+            self.responseError = [NSError errorWithDomain:ImageLoaderErrorDomain
+                                                     code:ImageLoaderErrorBadImageData
+                                                 userInfo:@{NSLocalizedDescriptionKey : @"Download marked as failed because decrypting data failed"}];
+            error = self.responseError;
+        }
+    }
+    
+    // Deliver the pending progress before any completion callback
+    if (self.progressCoalescing) {
+        [[SDProgressCoalescer sharedCoalescer] flushTarget:self];
+        self.progressCoalescing = NO;
+    }
+    
     NSArray<ImageLoaderDownloaderOperationToken *> *tokens;
     @synchronized (self) {
         tokens = [self.callbackTokens copy];
@@ -544,10 +732,18 @@ didReceiveResponse:(NSURLResponse *)response
         [self done];
     } else {
         if (tokens.count > 0) {
-            NSData *imageData = self.imageData;
+            NSData *imageData;
+            BOOL streamed = NO;
+            if (self.stagingHandle) {
+                // Commit into disk cache, decode from the mapped cache file
+                imageData = [self finishStagingFile:&streamed];
+            } else {
+                // The coders and decryptor need the contiguous bytes, merge the chunks once
+                imageData = self.imageData.contiguousData;
+            }
             self.imageData = nil;
-            // data decryptor
-            if (imageData && self.decryptor) {
+            // data decryptor, the stream already decrypted each chunk
+            if (imageData && self.decryptor && !self.decryptStream) {
                 imageData = [self.decryptor decryptedDataWithData:imageData response:self.response];
             }
             if (imageData) {
@@ -563,11 +759,18 @@ didReceiveResponse:(NSURLResponse *)response
                     [self callCompletionBlocksWithError:self.responseError];
                     [self done];
                 } else {
-                    // decode the image in coder queue, cancel all previous decoding process
-                    [self.coderQueue cancelAllOperations];
+                    // decode the image in the shared decode executor, cancel the queued progressive decoding, and wait for the running one
+                    NSOperation *progressiveDecodeOperation = self.progressiveDecodeOperation;
+                    [progressiveDecodeOperation cancel];
+                    // A cancelled operation is ready at once and ignores its dependencies, so depend on all the previous decodes, not only the last one
+                    NSMutableArray<NSOperation *> *previousOperations = [NSMutableArray arrayWithCapacity:tokens.count + 1];
+                    if (progressiveDecodeOperation) {
+                        [previousOperations addObject:progressiveDecodeOperation];
+                    }
                     @weakify(self);
                     for (ImageLoaderDownloaderOperationToken *token in tokens) {
-                        [self.coderQueue addOperationWithBlock:^{
+                        // Decode one by one, the same variant is decoded only once
+                        NSOperation *decodeOperation = [self addDecodeOperationWithBlock:^{
                             @strongify(self);
                             if (!self) {
                                 return;
@@ -589,6 +792,7 @@ didReceiveResponse:(NSURLResponse *)response
                                 } else {
                                     context = self.context;
                                 }
+                                context = [self contextByApplyingScaleDown:context];
                                 if (progressiveCoder) {
                                     image = LoadImageLoaderDecodeProgressiveImageData(imageData, self.request.URL, YES, self, options, context);
                                 } else {
@@ -598,31 +802,35 @@ didReceiveResponse:(NSURLResponse *)response
                                     [self.imageMap setObject:image forKey:token.decodeOptions];
                                 }
                             }
+                            if (SDImageDecodeExecutor.isCurrentDecodeCancelled) {
+                                // The token is cancelled during decoding, which is already called back, and the data is fine
+                                return;
+                            }
                             CGSize imageSize = image.size;
                             if (imageSize.width == 0 || imageSize.height == 0) {
+                                if (streamed) {
+                                    // Do not keep the bad data in disk cache
+                                    [self.stagingCache removeImageForKey:self.stagingKey fromMemory:NO fromDisk:YES withCompletion:nil];
+                                }
                                 NSString *description = image == nil ? @"Downloaded image decode failed" : @"Downloaded image has 0 pixels";
                                 NSError *error = [NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : description}];
                                 [self callCompletionBlockWithToken:token image:nil imageData:nil error:error finished:YES];
                             } else {
                                 [self callCompletionBlockWithToken:token image:image imageData:imageData error:nil finished:YES];
                             }
-                        }];
+                        } dependencies:previousOperations];
+                        token.decodeOperation = decodeOperation;
+                        [previousOperations addObject:decodeOperation];
                     }
-                    // call [self done] after all completed block was dispatched
-                    dispatch_block_t doneBlock = ^{
+                    // call [self done] after all the decodes finished (including the cancelled ones) and all completed block was dispatched
+                    [self addDecodeOperationWithBlock:^{
                         @strongify(self);
                         if (!self) {
                             return;
                         }
+                        [self callCompletionBlocksForSkippedTokens:tokens];
                         [self done];
-                    };
-                    if (@available(iOS 13, tvOS 13, macOS 10.15, watchOS 6, *)) {
-                        // seems faster than `addOperationWithBlock`
-                        [self.coderQueue addBarrierBlock:doneBlock];
-                    } else {
-                        // serial queue, this does the same effect in semantics
-                        [self.coderQueue addOperationWithBlock:doneBlock];
-                    }
+                    } dependencies:previousOperations];
                 }
             } else {
                 [self callCompletionBlocksWithError:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : @"Image data is nil"}]];
@@ -670,6 +878,604 @@ didReceiveResponse:(NSURLResponse *)response
     self.metrics = metrics;
 }
 
+#pragma mark Retry methods
+
+- (BOOL)retryIfNeededWithError:(nonnull NSError *)error {
+    ImageLoaderDownloaderRetryPolicy *retryPolicy = self.retryPolicy;
+    if (!retryPolicy) {
+        return NO;
+    }
+    NSTimeInterval delay;
+    @synchronized (self) {
+        if (self.isCancelled || self.callbackTokens.count == 0) {
+            return NO;
+        }
+        if (![retryPolicy shouldRetryRequest:self.request response:self.response error:error retryCount:self.retryCount]) {
+            return NO;
+        }
+        delay = [retryPolicy delayForRetryCount:self.retryCount response:self.response];
+        NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - self.startTime;
+        if (retryPolicy.deadline > 0 && elapsed + delay > retryPolicy.deadline) {
+            return NO;
+        }
+        self.retryCount++;
+        [self prepareForNextTask];
+    }
+    
+    @weakify(self);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        @strongify(self);
+        if (!self) {
+            return;
+        }
+        [self startNextTask];
+    });
+    return YES;
+}
+
+- (void)retryWithoutRange {
+    @synchronized (self) {
+        self.shouldRetryWithoutRange = NO;
+        self.rangeDisabled = YES;
+        // Claimed but not satisfiable, do not claim it again
+        if (self.partialDownload) {
+            [self.stagingCache removeStagingFile:self.partialDownload.path];
+            self.partialDownload = nil;
+        }
+        [self prepareForNextTask];
+    }
+    [self startNextTask];
+}
+
+- (void)switchToURL:(nonnull NSURL *)URL {
+    @synchronized (self) {
+        NSMutableURLRequest *mutableRequest = [self.request mutableCopy];
+        mutableRequest.URL = URL;
+        self.switchedRequest = [mutableRequest copy];
+        self.switchURL = nil;
+        [self prepareForNextTask];
+    }
+    [self startNextTask];
+}
+
+// Reset the state of current task, keep the callbacks. Must be called in lock
+- (void)prepareForNextTask {
+    self.dataTask = nil;
+    // The task already completed, no more data written into staging file
+    [self.stagingHandle closeFile];
+    self.stagingHandle = nil;
+    [self discardStagingFile];
+    if (self.partialDownload) {
+        // Claimed but not resumed, claim it again for the next task
+        [self.partialStore savePartialDownload:self.partialDownload forKey:self.stagingKey];
+        self.partialDownload = nil;
+    }
+    self.imageData = nil;
+    self.response = nil;
+    self.responseError = nil;
+    self.expectedSize = 0;
+    self.receivedSize = 0;
+    self.previousProgress = 0;
+    // Drop the pending progress of the previous task
+    atomic_store_explicit(&_progressPending, false, memory_order_relaxed);
+    self.progressiveThrottle = nil;
+    // The progressive decoder consumed the previous body, start over with a new one
+    [self.progressiveDecodeOperation cancel];
+    self.progressiveDecodeOperation = nil;
+    LoadImageLoaderSetProgressiveCoder(self, nil);
+    self.headerData = nil;
+    self.headerDecided = NO;
+    self.decryptStream = nil;
+    // Reuse this operation for the new request comes in before next task completed
+    ImageLoaderDownloaderOperationSetCompleted(self, NO);
+}
+
+- (void)startNextTask {
+    NSURLSessionTask *dataTask;
+    @synchronized (self) {
+        // Cancelled during backoff or switching, the callbacks are already called
+        if (self.isCancelled || self.isFinished) {
+            return;
+        }
+        NSURLSession *session = self.ownedSession ?: self.unownedSession;
+        if (session.delegate) {
+            // The switched URL is a different resource, do not resume
+            NSURLRequest *request = self.switchedRequest;
+            if (!request) {
+                request = self.request;
+                if (self.options & ImageLoaderDownloaderResumeDownload) {
+                    request = [self resumeRequestWithRequest:request];
+                }
+            }
+            self.dataTask = [session dataTaskWithRequest:request];
+        }
+        dataTask = self.dataTask;
+    }
+    
+    if (dataTask) {
+        dataTask.priority = SDURLSessionTaskPriorityForQueuePriority(self.queuePriority);
+        [dataTask resume];
+    } else {
+        [self callCompletionBlocksWithError:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorInvalidDownloadOperation userInfo:@{NSLocalizedDescriptionKey : @"Task can't be initialized for next request"}]];
+        [self done];
+    }
+}
+
+#pragma mark Progress methods
+
+// Called on the URLSession delegate queue
+- (void)notifyProgress {
+    NSUInteger receivedSize = self.receivedSize;
+    NSUInteger expectedSize = self.expectedSize;
+    if (self.progressCoalescingInterval <= 0) {
+        [self callProgressBlocksWithReceivedSize:receivedSize expectedSize:expectedSize];
+        return;
+    }
+    // Publish only, no lock and no block call for each chunk
+    atomic_store_explicit(&_publishedReceivedSize, receivedSize, memory_order_relaxed);
+    atomic_store_explicit(&_publishedExpectedSize, expectedSize, memory_order_relaxed);
+    atomic_store_explicit(&_progressPending, true, memory_order_release);
+    if (!self.progressCoalescing) {
+        self.progressCoalescing = YES;
+        [[SDProgressCoalescer sharedCoalescer] addTarget:self interval:self.progressCoalescingInterval];
+    }
+}
+
+// Called on the coalescer queue
+- (void)deliverCoalescedProgress {
+    if (!atomic_exchange_explicit(&_progressPending, false, memory_order_acquire)) {
+        return;
+    }
+    NSUInteger receivedSize = (NSUInteger)atomic_load_explicit(&_publishedReceivedSize, memory_order_relaxed);
+    NSUInteger expectedSize = (NSUInteger)atomic_load_explicit(&_publishedExpectedSize, memory_order_relaxed);
+    [self callProgressBlocksWithReceivedSize:receivedSize expectedSize:expectedSize];
+}
+
+- (void)callProgressBlocksWithReceivedSize:(NSUInteger)receivedSize expectedSize:(NSUInteger)expectedSize {
+    NSArray<ImageLoaderDownloaderOperationToken *> *tokens;
+    @synchronized (self) {
+        tokens = [self.callbackTokens copy];
+    }
+    for (ImageLoaderDownloaderOperationToken *token in tokens) {
+        if (token.progressBlock) {
+            token.progressBlock(receivedSize, expectedSize, self.request.URL);
+        }
+    }
+}
+
+#pragma mark Decode methods
+
+// Submit into the shared decode executor, the priority is inherited from this download
+- (nonnull NSOperation *)addDecodeOperationWithBlock:(nonnull dispatch_block_t)block dependencies:(nullable NSArray<NSOperation *> *)dependencies {
+    NSOperation *operation = [[SDImageDecodeExecutor sharedExecutor] operationWithBlock:block];
+    operation.queuePriority = self.queuePriority;
+    for (NSOperation *dependency in dependencies) {
+        [operation addDependency:dependency];
+    }
+    SD_LOCK(_decodeOperationsLock);
+    [self.decodeOperations addObject:operation];
+    SD_UNLOCK(_decodeOperationsLock);
+    [[SDImageDecodeExecutor sharedExecutor] addOperation:operation];
+    return operation;
+}
+
+// The tokens still registered (not cancelled) whose decode did not call back, each token must be called back once
+- (void)callCompletionBlocksForSkippedTokens:(nonnull NSArray<ImageLoaderDownloaderOperationToken *> *)tokens {
+    NSArray<ImageLoaderDownloaderOperationToken *> *callbackTokens;
+    @synchronized (self) {
+        callbackTokens = [self.callbackTokens copy];
+    }
+    for (ImageLoaderDownloaderOperationToken *token in tokens) {
+        if (token.completed || [callbackTokens indexOfObjectIdenticalTo:token] == NSNotFound) {
+            continue;
+        }
+        [self callCompletionBlockWithToken:token image:nil imageData:nil error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Downloaded image decode was skipped"}] finished:YES];
+    }
+}
+
+- (void)cancelDecodeOperations {
+    SD_LOCK(_decodeOperationsLock);
+    NSArray<NSOperation *> *operations = self.decodeOperations.allObjects;
+    SD_UNLOCK(_decodeOperationsLock);
+    for (NSOperation *operation in operations) {
+        [operation cancel];
+    }
+}
+
+- (void)setQueuePriority:(NSOperationQueuePriority)queuePriority {
+    [super setQueuePriority:queuePriority];
+    // The queued decodes follow the download priority
+    SD_LOCK(_decodeOperationsLock);
+    NSArray<NSOperation *> *operations = self.decodeOperations.allObjects;
+    SD_UNLOCK(_decodeOperationsLock);
+    for (NSOperation *operation in operations) {
+        if (!operation.isExecuting && !operation.isFinished) {
+            operation.queuePriority = queuePriority;
+        }
+    }
+}
+
+#pragma mark Progressive methods
+
+static inline CGSize SDThumbnailPixelSizeFromDecodeOptions(LoadImageCoderOptions * _Nullable decodeOptions) {
+    NSValue *thumbnailSizeValue = decodeOptions[LoadImageCoderDecodeThumbnailPixelSize];
+    if (thumbnailSizeValue == nil) {
+        return CGSizeZero;
+    }
+#if SD_MAC
+    return thumbnailSizeValue.sizeValue;
+#else
+    return thumbnailSizeValue.CGSizeValue;
+#endif
+}
+
+// Decode the partial image once, and callback each token with its thumbnail size. Called on the decode executor
+- (void)decodeProgressiveImageWithData:(nonnull NSData *)imageData {
+    NSArray<ImageLoaderDownloaderOperationToken *> *tokens;
+    @synchronized (self) {
+        tokens = [self.callbackTokens copy];
+    }
+    // Find the largest size to decode, which all the tokens can be downscaled from
+    BOOL sameDecodeOptions = YES;
+    BOOL fullSize = NO;
+    CGSize decodeSize = CGSizeZero;
+    LoadImageCoderOptions *firstDecodeOptions = tokens.firstObject.decodeOptions;
+    for (ImageLoaderDownloaderOperationToken *token in tokens) {
+        LoadImageCoderOptions *decodeOptions = token.decodeOptions;
+        if (decodeOptions != firstDecodeOptions && ![decodeOptions isEqual:firstDecodeOptions]) {
+            sameDecodeOptions = NO;
+        }
+        CGSize thumbnailSize = SDThumbnailPixelSizeFromDecodeOptions(decodeOptions);
+        NSNumber *preserveAspectRatioValue = decodeOptions[LoadImageCoderDecodePreserveAspectRatio];
+        BOOL preserveAspectRatio = preserveAspectRatioValue != nil ? preserveAspectRatioValue.boolValue : YES;
+        if (thumbnailSize.width <= 0 || thumbnailSize.height <= 0 || !preserveAspectRatio) {
+            // The stretched thumbnail can not be downscaled from an aspect-fit one
+            fullSize = YES;
+        } else {
+            decodeSize = CGSizeMake(MAX(decodeSize.width, thumbnailSize.width), MAX(decodeSize.height, thumbnailSize.height));
+        }
+    }
+    
+    ImageLoaderOptions options = [[self class] imageOptionsFromDownloaderOptions:self.options];
+    ImageLoaderContext *context = self.context;
+    if (!sameDecodeOptions) {
+        ImageLoaderMutableContext *mutableContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+        if (fullSize) {
+            mutableContext[ImageLoaderContextImageThumbnailPixelSize] = nil;
+        } else {
+#if SD_MAC
+            mutableContext[ImageLoaderContextImageThumbnailPixelSize] = [NSValue valueWithSize:decodeSize];
+#else
+            mutableContext[ImageLoaderContextImageThumbnailPixelSize] = [NSValue valueWithCGSize:decodeSize];
+#endif
+            mutableContext[ImageLoaderContextImagePreserveAspectRatio] = @(YES);
+        }
+        context = [mutableContext copy];
+    }
+    UIImage *image = LoadImageLoaderDecodeProgressiveImageData(imageData, self.request.URL, NO, self, options, [self contextByApplyingScaleDown:context]);
+    if (!image) {
+        return;
+    }
+    if (sameDecodeOptions) {
+        [self callCompletionBlocksWithImage:image imageData:nil error:nil finished:NO];
+        return;
+    }
+    
+    // Downscale for each variant, the CPU cost is much less than decoding
+    NSMutableDictionary<LoadImageCoderOptions *, UIImage *> *derivedImages = [NSMutableDictionary dictionary];
+    for (ImageLoaderDownloaderOperationToken *token in tokens) {
+        LoadImageCoderOptions *decodeOptions = token.decodeOptions;
+        UIImage *derivedImage = image;
+        if (decodeOptions) {
+            derivedImage = derivedImages[decodeOptions];
+            if (!derivedImage) {
+                NSNumber *preserveAspectRatioValue = decodeOptions[LoadImageCoderDecodePreserveAspectRatio];
+                BOOL preserveAspectRatio = preserveAspectRatioValue != nil ? preserveAspectRatioValue.boolValue : YES;
+                CGFloat scale = [decodeOptions[LoadImageCoderDecodeScaleFactor] doubleValue];
+                derivedImage = SDImageCacheDownscaledImage(image, SDThumbnailPixelSizeFromDecodeOptions(decodeOptions), preserveAspectRatio, scale);
+                if (derivedImage) {
+                    derivedImage._decodeOptions = decodeOptions;
+                    derivedImage._isIncremental = YES;
+                } else {
+                    derivedImage = image;
+                }
+                derivedImages[decodeOptions] = derivedImage;
+            }
+        }
+        [self callCompletionBlockWithToken:token image:derivedImage imageData:nil error:nil finished:NO];
+    }
+}
+
+#pragma mark Header methods
+
+// Returns NO if the current task is cancelled by header policy
+- (BOOL)decideHeaderWithData:(nonnull NSData *)data dataTask:(nonnull NSURLSessionDataTask *)dataTask {
+    NSUInteger maxHeaderLength = SDImageHeaderParser.maxHeaderLength;
+    if (!self.headerData) {
+        self.headerData = [NSMutableData data];
+        if (self.receivedSize > 0 && self.stagingPath) {
+            // Resumed from the partial body, the header is in staging file
+            NSData *stagingData = [NSData dataWithContentsOfFile:self.stagingPath options:NSDataReadingMappedIfSafe error:nil];
+            [self.headerData appendData:[stagingData subdataWithRange:NSMakeRange(0, MIN(stagingData.length, maxHeaderLength))]];
+        }
+    }
+    if (self.headerData.length < maxHeaderLength) {
+        [self.headerData appendBytes:data.bytes length:MIN(data.length, maxHeaderLength - self.headerData.length)];
+    }
+    LoadImageHeaderInfo *headerInfo;
+    SDImageHeaderParseStatus status = [SDImageHeaderParser parseData:self.headerData headerInfo:&headerInfo];
+    if (status == SDImageHeaderParseStatusNeedMoreData) {
+        return YES;
+    }
+    self.headerDecided = YES;
+    self.headerData = nil;
+    if (status != SDImageHeaderParseStatusSuccess || !self.response) {
+        // Unsupported format, let the coders decide
+        return YES;
+    }
+    ImageLoaderDownloaderHeaderDecision *decision = [self.headerPolicy decisionForHeaderInfo:headerInfo response:self.response];
+    switch (decision.action) {
+        case ImageLoaderDownloaderHeaderActionAbort: {
+            self.responseError = [NSError errorWithDomain:ImageLoaderErrorDomain
+                                                     code:ImageLoaderErrorDownloadRejectedByHeader
+                                                 userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Download aborted by header policy, image pixel size %.0fx%.0f", headerInfo.pixelSize.width, headerInfo.pixelSize.height],
+                                                            ImageLoaderErrorDownloadHeaderInfoKey : headerInfo,
+                                                            ImageLoaderErrorDownloadResponseKey : self.response}];
+            // Do not keep the rejected body
+            self.resumeValidator = nil;
+            [dataTask cancel];
+            return NO;
+        }
+        case ImageLoaderDownloaderHeaderActionSwitchURL: {
+            // Switch only once, avoid the loop
+            if (!decision.URL || self.switchedRequest) {
+                return YES;
+            }
+            self.switchURL = decision.URL;
+            self.resumeValidator = nil;
+            [dataTask cancel];
+            return NO;
+        }
+        case ImageLoaderDownloaderHeaderActionScaleDown: {
+            CGSize thumbnailPixelSize = decision.thumbnailPixelSize;
+            if (thumbnailPixelSize.width > 0 && thumbnailPixelSize.height > 0) {
+                self.scaleDownPixelSize = thumbnailPixelSize;
+            }
+            return YES;
+        }
+        default:
+            return YES;
+    }
+}
+
+// Decode as thumbnail decided by header policy, unless the requested thumbnail is already smaller
+- (nullable ImageLoaderContext *)contextByApplyingScaleDown:(nullable ImageLoaderContext *)context {
+    CGSize scaleDownPixelSize = self.scaleDownPixelSize;
+    if (scaleDownPixelSize.width <= 0 || scaleDownPixelSize.height <= 0) {
+        return context;
+    }
+    NSValue *thumbnailSizeValue = context[ImageLoaderContextImageThumbnailPixelSize];
+    if (thumbnailSizeValue != nil) {
+        CGSize thumbnailSize = CGSizeZero;
+#if SD_MAC
+        thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+        thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+        if (thumbnailSize.width > 0 && thumbnailSize.height > 0 && thumbnailSize.width <= scaleDownPixelSize.width && thumbnailSize.height <= scaleDownPixelSize.height) {
+            return context;
+        }
+    }
+    ImageLoaderMutableContext *mutableContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+#if SD_MAC
+    mutableContext[ImageLoaderContextImageThumbnailPixelSize] = [NSValue valueWithSize:scaleDownPixelSize];
+#else
+    mutableContext[ImageLoaderContextImageThumbnailPixelSize] = [NSValue valueWithCGSize:scaleDownPixelSize];
+#endif
+    if (!mutableContext[ImageLoaderContextImagePreserveAspectRatio]) {
+        mutableContext[ImageLoaderContextImagePreserveAspectRatio] = @(YES);
+    }
+    return [mutableContext copy];
+}
+
+#pragma mark Staging methods
+
+// The same cache and key as the original image store
+- (nullable LoadImageCache *)stagingCacheForKey:(NSString * _Nullable * _Nonnull)key {
+    id<LoadImageCache> imageCache = self.context[ImageLoaderContextOriginalImageCache];
+    if (!imageCache) {
+        imageCache = self.context[ImageLoaderContextImageCache];
+    }
+    if (![imageCache isKindOfClass:LoadImageCache.class]) {
+        return nil;
+    }
+    // The request URL may be changed by request modifier, prefer the key of original URL
+    *key = self.cacheKey;
+    if (!*key) {
+        id<ImageLoaderCacheKeyFilter> cacheKeyFilter = self.context[ImageLoaderContextCacheKeyFilter];
+        if (cacheKeyFilter) {
+            *key = [cacheKeyFilter cacheKeyForURL:self.request.URL];
+        } else {
+            *key = self.request.URL.absoluteString;
+        }
+    }
+    if (!*key) {
+        return nil;
+    }
+    return (LoadImageCache *)imageCache;
+}
+
+- (BOOL)canCommitStagingFile {
+    // The stored data should be the downloaded bytes, see `ImageLoaderStreamToDiskCache`
+    if (!(self.options & ImageLoaderDownloaderStreamToDiskCache)) {
+        return NO;
+    }
+    // The stream decrypted bytes are the same as the whole data decryption, which is stored
+    if ((self.decryptor && !self.decryptStream) || self.context[ImageLoaderContextCacheSerializer]) {
+        return NO;
+    }
+    if (self.context[ImageLoaderContextOriginalStoreCacheType]) {
+        LoadImageCacheType originalStoreCacheType = [self.context[ImageLoaderContextOriginalStoreCacheType] integerValue];
+        if (originalStoreCacheType != LoadImageCacheTypeDisk && originalStoreCacheType != LoadImageCacheTypeAll) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (nonnull NSURLRequest *)resumeRequestWithRequest:(nonnull NSURLRequest *)request {
+    // The decrypt stream can not start from the middle of body
+    if ([self.decryptor respondsToSelector:@selector(decryptStreamWithResponse:)]) {
+        return request;
+    }
+    // The range is not satisfiable, request the full body
+    if (self.rangeDisabled) {
+        return request;
+    }
+    NSString *key;
+    LoadImageCache *stagingCache = [self stagingCacheForKey:&key];
+    if (!stagingCache) {
+        return request;
+    }
+    SDPartialDownloadStore *partialStore = [[SDPartialDownloadStore alloc] initWithImageCache:stagingCache];
+    SDPartialDownload *partialDownload = [partialStore claimPartialDownloadForKey:key];
+    self.stagingCache = stagingCache;
+    self.stagingKey = key;
+    self.partialStore = partialStore;
+    self.partialDownload = partialDownload;
+    if (!partialDownload) {
+        return request;
+    }
+    // If the validator does not match, server respond the full body with 200
+    NSMutableURLRequest *mutableRequest = [request mutableCopy];
+    [mutableRequest setValue:[NSString stringWithFormat:@"bytes=%llu-", partialDownload.length] forHTTPHeaderField:@"Range"];
+    [mutableRequest setValue:partialDownload.validator forHTTPHeaderField:@"If-Range"];
+    return [mutableRequest copy];
+}
+
+- (void)createStagingFileWithResponse:(nonnull NSURLResponse *)response {
+    BOOL shouldCommit = [self canCommitStagingFile];
+    // The switched URL is a different resource, its body can not be resumed for the original URL
+    BOOL shouldResume = self.partialStore != nil && !self.switchedRequest;
+    if (!shouldCommit && !shouldResume) {
+        return;
+    }
+    NSString *key = self.stagingKey;
+    LoadImageCache *stagingCache = self.stagingCache ?: [self stagingCacheForKey:&key];
+    if (!stagingCache) {
+        return;
+    }
+    SDPartialDownload *partialDownload;
+    @synchronized (self) {
+        partialDownload = self.partialDownload;
+        self.partialDownload = nil;
+    }
+    NSString *stagingPath;
+    NSString *validator;
+    unsigned long long receivedSize = 0;
+    unsigned long long expectedSize = self.expectedSize;
+    if (partialDownload) {
+        unsigned long long totalLength = 0;
+        if ([self.class contentRangeStartForResponse:response totalLength:&totalLength] == (long long)partialDownload.length) {
+            // Server accept the range, append to the partial body
+            stagingPath = partialDownload.path;
+            validator = partialDownload.validator;
+            receivedSize = partialDownload.length;
+            expectedSize = totalLength > 0 ? totalLength : partialDownload.length + self.expectedSize;
+        } else {
+            // Server send the full body (such as the validator changed), start from byte 0
+            [stagingCache removeStagingFile:partialDownload.path];
+        }
+    }
+    if (!stagingPath) {
+        validator = shouldResume ? [SDPartialDownloadStore validatorForResponse:response] : nil;
+        if (!shouldCommit && !validator) {
+            // Can not resume, keep the body in memory
+            return;
+        }
+        stagingPath = [stagingCache createStagingFileForKey:key];
+    }
+    NSFileHandle *stagingHandle = stagingPath ? [NSFileHandle fileHandleForWritingAtPath:stagingPath] : nil;
+    if (!stagingHandle) {
+        if (stagingPath) {
+            [stagingCache removeStagingFile:stagingPath];
+        }
+        return;
+    }
+    [stagingHandle seekToEndOfFile];
+    @synchronized (self) {
+        self.stagingCache = stagingCache;
+        self.stagingKey = key;
+        self.stagingPath = stagingPath;
+        self.stagingHandle = stagingHandle;
+        self.shouldCommitStagingFile = shouldCommit;
+        self.resumeValidator = validator;
+        self.receivedSize = (NSUInteger)receivedSize;
+        self.expectedSize = (NSUInteger)expectedSize;
+    }
+}
+
+- (BOOL)writeStagingData:(nonnull NSData *)data {
+    // `writeData:` raise exception when failed, such as no space left
+    @try {
+        [self.stagingHandle writeData:data];
+    } @catch (NSException *exception) {
+        return NO;
+    }
+    return YES;
+}
+
+- (nullable NSData *)finishStagingFile:(BOOL *)committed {
+    NSString *stagingPath;
+    @synchronized (self) {
+        stagingPath = self.stagingPath;
+        self.stagingPath = nil;
+    }
+    [self.stagingHandle closeFile];
+    self.stagingHandle = nil;
+    *committed = NO;
+    if (!stagingPath) {
+        // Already removed by cancel
+        return nil;
+    }
+    NSData *imageData;
+    if (self.shouldCommitStagingFile) {
+        imageData = [self.stagingCache commitStagingFile:stagingPath forKey:self.stagingKey];
+        *committed = imageData != nil;
+    }
+    if (!imageData) {
+        // Not committed, read from staging file directly. The mapped bytes are still valid after the file removed
+        imageData = [NSData dataWithContentsOfFile:stagingPath options:NSDataReadingMappedIfSafe error:nil];
+        [self.stagingCache removeStagingFile:stagingPath];
+    }
+    return imageData;
+}
+
+// Returns the start byte of `Content-Range` for 206 response, -1 if not a range response
++ (long long)contentRangeStartForResponse:(nonnull NSURLResponse *)response totalLength:(unsigned long long *)totalLength {
+    if (![response isKindOfClass:NSHTTPURLResponse.class] || ((NSHTTPURLResponse *)response).statusCode != 206) {
+        return -1;
+    }
+    NSDictionary *headers = ((NSHTTPURLResponse *)response).allHeaderFields;
+    NSString *contentRange;
+    for (NSString *field in headers) {
+        if ([field caseInsensitiveCompare:@"Content-Range"] == NSOrderedSame) {
+            contentRange = headers[field];
+            break;
+        }
+    }
+    // bytes <start>-<end>/<total or *>
+    NSScanner *scanner = [NSScanner scannerWithString:contentRange ?: @""];
+    long long start = 0;
+    long long end = 0;
+    if (![scanner scanString:@"bytes" intoString:NULL] || ![scanner scanLongLong:&start] || ![scanner scanString:@"-" intoString:NULL] || ![scanner scanLongLong:&end] || ![scanner scanString:@"/" intoString:NULL]) {
+        return -1;
+    }
+    long long total = 0;
+    *totalLength = [scanner scanLongLong:&total] && total > 0 ? (unsigned long long)total : 0;
+    return start;
+}
+
 #pragma mark Helper methods
 + (ImageLoaderOptions)imageOptionsFromDownloaderOptions:(ImageLoaderDownloaderOptions)downloadOptions {
     ImageLoaderOptions options = 0;
@@ -714,6 +1520,9 @@ didReceiveResponse:(NSURLResponse *)response
                            imageData:(nullable NSData *)imageData
                                error:(nullable NSError *)error
                             finished:(BOOL)finished {
+    if (finished) {
+        token.completed = YES;
+    }
     ImageLoaderDownloaderCompletedBlock completedBlock = token.completedBlock;
     if (completedBlock) {
         SDCallbackQueue *queue = self.context[ImageLoaderContextCallbackQueue];
@@ -0,0 +1,92 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+/**
+ The retry policy for the transient download failures, such as timeout, connection lost, or server unavailable (5xx).
+ The retry is performed inside the download operation with a new task, so all the callers of the same URL wait for one retried request. The partial body is resumed if `ImageLoaderDownloaderResumeDownload` is used.
+ Only the idempotent requests (GET and HEAD) are retried. The backoff grows exponentially with jitter, and the server `Retry-After` header is respected for 429 and 503 response.
+ @note You can subclass and override the methods to customize the policy.
+ */
+@interface ImageLoaderDownloaderRetryPolicy : NSObject <NSCopying>
+
+/**
+ The default policy, which retry at most 2 times in 30 seconds.
+ */
+@property (nonatomic, class, readonly, nonnull) ImageLoaderDownloaderRetryPolicy *defaultPolicy;
+
+/**
+ * The max retry count, not including the first attempt.
+ * Defaults to 2.
+ */
+@property (nonatomic, assign) NSUInteger maxRetryCount;
+
+/**
+ * The backoff (in seconds) before the first retry.
+ * Defaults to 0.5.
+ */
+@property (nonatomic, assign) NSTimeInterval initialBackoff;
+
+/**
+ * The backoff multiplier for each next retry.
+ * Defaults to 2.
+ */
+@property (nonatomic, assign) double backoffMultiplier;
+
+/**
+ * The max backoff (in seconds), not including the `Retry-After` from server.
+ * Defaults to 10.
+ */
+@property (nonatomic, assign) NSTimeInterval maxBackoff;
+
+/**
+ * The total deadline (in seconds) from the first attempt started. The retry which can not start before the deadline is not performed.
+ * Defaults to 30. 0 means no deadline.
+ */
+@property (nonatomic, assign) NSTimeInterval deadline;
+
+/**
+ * The response status codes which can be retried. It takes effect only when the status code is not acceptable, see `ImageLoaderDownloaderConfig.acceptableStatusCodes`.
+ * Defaults to [408, 429, 500, 502, 503, 504]. Nil means not retry for any status code.
+ */
+@property (nonatomic, copy, nullable) NSIndexSet *retryableStatusCodes;
+
+/**
+ * The `NSURLErrorDomain` error codes which can be retried.
+ * Defaults to [NSURLErrorTimedOut, NSURLErrorNetworkConnectionLost, NSURLErrorCannotConnectToHost, NSURLErrorCannotFindHost, NSURLErrorDNSLookupFailed]. Nil means not retry for any URL error.
+ */
+@property (nonatomic, copy, nullable) NSIndexSet *retryableURLErrorCodes;
+
+/**
+ Whether the failed request should be retried, without the deadline check.
+ The default implementation check the retry count, the idempotent request method, and the retryable status codes and URL error codes.
+
+ @param request The failed request
+ @param response The response of the failed request, may be nil
+ @param error The error of the failed request
+ @param retryCount The retry count already performed
+ @return Whether to retry
+ */
+- (BOOL)shouldRetryRequest:(nonnull NSURLRequest *)request
+                  response:(nullable NSURLResponse *)response
+                     error:(nonnull NSError *)error
+                retryCount:(NSUInteger)retryCount;
+
+/**
+ The delay (in seconds) before the next retry.
+ The default implementation use the exponential backoff with equal jitter, or the `Retry-After` from 429 and 503 response if longer.
+
+ @param retryCount The retry count already performed
+ @param response The response of the failed request, may be nil
+ @return The delay
+ */
+- (NSTimeInterval)delayForRetryCount:(NSUInteger)retryCount response:(nullable NSURLResponse *)response;
+
+@end
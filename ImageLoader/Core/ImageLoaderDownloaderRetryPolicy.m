@@ -0,0 +1,133 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "ImageLoaderDownloaderRetryPolicy.h"
+#import "ImageLoaderError.h"
+
+// The backoff exponent above this does not grow any more, avoid overflow
+#define SD_RETRY_MAX_BACKOFF_EXPONENT 16
+
+@implementation ImageLoaderDownloaderRetryPolicy
+
++ (ImageLoaderDownloaderRetryPolicy *)defaultPolicy {
+    return [self new];
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _maxRetryCount = 2;
+        _initialBackoff = 0.5;
+        _backoffMultiplier = 2;
+        _maxBackoff = 10;
+        _deadline = 30;
+        NSMutableIndexSet *retryableStatusCodes = [NSMutableIndexSet indexSet];
+        [retryableStatusCodes addIndex:408];
+        [retryableStatusCodes addIndex:429];
+        [retryableStatusCodes addIndex:500];
+        [retryableStatusCodes addIndexesInRange:NSMakeRange(502, 3)];
+        _retryableStatusCodes = [retryableStatusCodes copy];
+        // The URL error codes are negative, so they're stored as the absolute value in index set
+        NSMutableIndexSet *retryableURLErrorCodes = [NSMutableIndexSet indexSet];
+        [retryableURLErrorCodes addIndex:-NSURLErrorTimedOut];
+        [retryableURLErrorCodes addIndex:-NSURLErrorNetworkConnectionLost];
+        [retryableURLErrorCodes addIndex:-NSURLErrorCannotConnectToHost];
+        [retryableURLErrorCodes addIndex:-NSURLErrorCannotFindHost];
+        [retryableURLErrorCodes addIndex:-NSURLErrorDNSLookupFailed];
+        _retryableURLErrorCodes = [retryableURLErrorCodes copy];
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    ImageLoaderDownloaderRetryPolicy *policy = [[[self class] allocWithZone:zone] init];
+    policy.maxRetryCount = self.maxRetryCount;
+    policy.initialBackoff = self.initialBackoff;
+    policy.backoffMultiplier = self.backoffMultiplier;
+    policy.maxBackoff = self.maxBackoff;
+    policy.deadline = self.deadline;
+    policy.retryableStatusCodes = self.retryableStatusCodes;
+    policy.retryableURLErrorCodes = self.retryableURLErrorCodes;
+
+    return policy;
+}
+
+- (BOOL)shouldRetryRequest:(NSURLRequest *)request response:(NSURLResponse *)response error:(NSError *)error retryCount:(NSUInteger)retryCount {
+    if (retryCount >= self.maxRetryCount) {
+        return NO;
+    }
+    // Only retry the idempotent request, the default method is GET
+    NSString *method = request.HTTPMethod.uppercaseString;
+    if (method && ![method isEqualToString:@"GET"] && ![method isEqualToString:@"HEAD"]) {
+        return NO;
+    }
+    if ([error.domain isEqualToString:ImageLoaderErrorDomain] && error.code == ImageLoaderErrorInvalidDownloadStatusCode) {
+        NSInteger statusCode = [error.userInfo[ImageLoaderErrorDownloadStatusCodeKey] integerValue];
+        return statusCode > 0 && [self.retryableStatusCodes containsIndex:statusCode];
+    }
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code < 0) {
+        return [self.retryableURLErrorCodes containsIndex:-error.code];
+    }
+    return NO;
+}
+
+- (NSTimeInterval)delayForRetryCount:(NSUInteger)retryCount response:(NSURLResponse *)response {
+    NSUInteger exponent = MIN(retryCount, SD_RETRY_MAX_BACKOFF_EXPONENT);
+    NSTimeInterval backoff = MIN(MAX(self.initialBackoff, 0) * pow(MAX(self.backoffMultiplier, 1), exponent), self.maxBackoff);
+    // Equal jitter, in [backoff / 2, backoff], avoid the failed downloads to be retried at the same time
+    double random = (double)arc4random() / UINT32_MAX;
+    NSTimeInterval delay = backoff / 2 + backoff / 2 * random;
+    NSTimeInterval retryAfter = [self.class retryAfterForResponse:response];
+    return MAX(delay, retryAfter);
+}
+
+#pragma mark - Helper
+
+// The `Retry-After` of 429 and 503 response, in delay-seconds or HTTP-date, 0 if not available
++ (NSTimeInterval)retryAfterForResponse:(NSURLResponse *)response {
+    if (![response isKindOfClass:NSHTTPURLResponse.class]) {
+        return 0;
+    }
+    NSHTTPURLResponse *HTTPResponse = (NSHTTPURLResponse *)response;
+    if (HTTPResponse.statusCode != 429 && HTTPResponse.statusCode != 503) {
+        return 0;
+    }
+    NSDictionary *headers = HTTPResponse.allHeaderFields;
+    NSString *retryAfter;
+    for (NSString *field in headers) {
+        if ([field caseInsensitiveCompare:@"Retry-After"] == NSOrderedSame) {
+            retryAfter = headers[field];
+            break;
+        }
+    }
+    retryAfter = [retryAfter stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceCharacterSet];
+    if (retryAfter.length == 0) {
+        return 0;
+    }
+    NSScanner *scanner = [NSScanner scannerWithString:retryAfter];
+    long long seconds = 0;
+    if ([scanner scanLongLong:&seconds] && scanner.isAtEnd) {
+        return MAX(seconds, 0);
+    }
+    static NSDateFormatter *dateFormatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        // IMF-fixdate, such as `Wed, 21 Oct 2015 07:28:00 GMT`
+        dateFormatter = [NSDateFormatter new];
+        dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+        dateFormatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+    NSDate *date = [dateFormatter dateFromString:retryAfter];
+    if (!date) {
+        return 0;
+    }
+    return MAX(date.timeIntervalSinceNow, 0);
+}
+
+@end
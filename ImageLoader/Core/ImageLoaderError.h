@@ -18,6 +18,8 @@ FOUNDATION_EXPORT NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadResp
 FOUNDATION_EXPORT NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadStatusCodeKey;
 /// The HTTP MIME content type for invalid download response (NSString *)
 FOUNDATION_EXPORT NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadContentTypeKey;
+/// The image header info parsed during download (LoadImageHeaderInfo *)
+FOUNDATION_EXPORT NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadHeaderInfoKey;
 
 /// ImageLoader error domain and codes
 typedef NS_ERROR_ENUM(ImageLoaderErrorDomain, ImageLoaderError) {
@@ -30,4 +32,5 @@ typedef NS_ERROR_ENUM(ImageLoaderErrorDomain, ImageLoaderError) {
     ImageLoaderErrorCancelled = 2002, // The image loading operation is cancelled before finished, during either async disk cache query, or waiting before actual network request. For actual network request error, check `NSURLErrorDomain` error domain and code.
     ImageLoaderErrorInvalidDownloadResponse = 2003, // When using response modifier, the modified download response is nil and marked as failed.
     ImageLoaderErrorInvalidDownloadContentType = 2004, // The image download response a invalid content type. You can check the MIME content type in error's userInfo under `ImageLoaderErrorDownloadContentTypeKey`
+    ImageLoaderErrorDownloadRejectedByHeader = 2005, // The image download is aborted by header policy, after parsing the image header. You can check the header info in error's userInfo under `ImageLoaderErrorDownloadHeaderInfoKey`
 };
@@ -14,3 +14,4 @@ NSErrorDomain const _Nonnull ImageLoaderErrorDomain = @"ImageLoaderErrorDomain";
 NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadResponseKey = @"ImageLoaderErrorDownloadResponseKey";
 NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadStatusCodeKey = @"ImageLoaderErrorDownloadStatusCodeKey";
 NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadContentTypeKey = @"ImageLoaderErrorDownloadContentTypeKey";
+NSErrorUserInfoKey const _Nonnull ImageLoaderErrorDownloadHeaderInfoKey = @"ImageLoaderErrorDownloadHeaderInfoKey";
@@ -12,11 +12,15 @@
 #import "LoadImageLoader.h"
 #import "LoadImageTransformer.h"
 #import "ImageLoaderCacheKeyFilter.h"
+#import "ImageLoaderVariantResolver.h"
 #import "ImageLoaderCacheSerializer.h"
 #import "ImageLoaderOptionsProcessor.h"
+#import "LoadImageHeaderInfo.h"
 
 typedef void(^SDExternalCompletionBlock)(UIImage * _Nullable image, NSError * _Nullable error, LoadImageCacheType cacheType, NSURL * _Nullable imageURL);
 
+typedef void(^ImageLoaderManagerProbeCompletedBlock)(LoadImageHeaderInfo * _Nullable headerInfo, NSError * _Nullable error, LoadImageCacheType cacheType);
+
 typedef void(^SDInternalCompletionBlock)(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, LoadImageCacheType cacheType, BOOL finished, NSURL * _Nullable imageURL);
 
 /**
@@ -26,6 +30,7 @@ typedef void(^SDInternalCompletionBlock)(UIImage * _Nullable image, NSData * _Nu
 
 /**
  Cancel the current operation, including cache and loader process
+ @note The image decoding for this operation is cancelled as well, unless other requests still need it. The queued decoding never runs, and the running decoding stops early, see `LoadImageCoderHelper.isDecodingCancelled`.
  */
 - (void)cancel;
 
@@ -137,6 +142,23 @@ ImageLoaderManager *manager = [ImageLoaderManager sharedManager];
  */
 @property (nonatomic, strong, nullable) id<ImageLoaderCacheKeyFilter> cacheKeyFilter;
 
+/**
+ * The variant resolver is used to map an URL into the asset variant (asset identifier and pixel size), for example, a responsive image CDN which serve the same asset in different width by URL query.
+ * When the query cache miss, the manager find the closest larger cached variant of the same asset (in memory or on disk), and produce the requested size by downsampling it locally, instead of downloading again. The derived image is stored to cache under its own key as a downloaded one.
+ * @note The known variants are recorded when the image is downloaded or hit from cache by this manager, which only lives in memory.
+ *
+ * @code
+ ImageLoaderManager.sharedManager.variantResolver = [ImageLoaderVariantResolver variantResolverWithBlock:^ImageLoaderAssetVariant * _Nullable(NSURL * _Nonnull url) {
+    NSURLComponents *components = [NSURLComponents componentsWithURL:url resolvingAgainstBaseURL:NO];
+    NSString *width = [components.queryItems filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"name == 'w'"]].firstObject.value;
+    if (!width) return nil;
+    return [ImageLoaderAssetVariant variantWithAssetIdentifier:url.path pixelSize:CGSizeMake(width.doubleValue, width.doubleValue)];
+ }];
+ * @endcode
+ * The default value is nil. Means the variant is not resolved.
+ */
+@property (nonatomic, strong, nullable) id<ImageLoaderVariantResolver> variantResolver;
+
 /**
  * The cache serializer is used to convert the decoded image, the source downloaded data, to the actual data used for storing to the disk cache. If you return nil, means to generate the data from the image instance, see `LoadImageCache`.
  * For example, if you are using WebP images and facing the slow decoding time issue when later retrieving from disk cache again. You can try to encode the decoded image to JPEG/PNG format to disk cache instead of source downloaded data.
@@ -188,6 +210,39 @@ ImageLoaderManager *manager = [ImageLoaderManager sharedManager];
  */
 @property (nonatomic, assign, readonly, getter=isRunning) BOOL running;
 
+/**
+ * The failed URL is blocked for a backoff interval after each failure, the request for the blocked URL (without `ImageLoaderRetryFailed`) fails immediately with `ImageLoaderErrorBlackListed`.
+ * The backoff doubles for each consecutive failure, with random jitter (between half and full interval), and capped at `maxFailedURLBackoffInterval`. A successful load clears the failure record.
+ * This is the initial backoff for the transient failure, which `shouldBlockFailedURLWithURL:error:` of loader (or the delegate) return NO, like timeout, 5xx or 404 status code. The transient backoff is capped at `maxFailedURLRetryBackoffInterval`.
+ * The transient failures caused by connectivity (like not connected to internet) are removed when the next load succeeds, because the network is recovered.
+ * Defaults to 1 second.
+ */
+@property (nonatomic, assign) NSTimeInterval failedURLRetryInterval;
+
+/**
+ * The initial backoff for the failure which `shouldBlockFailedURLWithURL:error:` of loader (or the delegate) return YES, like invalid URL or bad image data. See `failedURLRetryInterval`.
+ * Defaults to 1 hour.
+ */
+@property (nonatomic, assign) NSTimeInterval failedURLBlockInterval;
+
+/**
+ * The max backoff of failed URL. See `failedURLRetryInterval`.
+ * Defaults to 1 day.
+ */
+@property (nonatomic, assign) NSTimeInterval maxFailedURLBackoffInterval;
+
+/**
+ * The max backoff of the transient failure, which is usually short so the URL can be loaded soon when the server or network recovered. See `failedURLRetryInterval`.
+ * Defaults to 1 minute.
+ */
+@property (nonatomic, assign) NSTimeInterval maxFailedURLRetryBackoffInterval;
+
+/**
+ * The max count of failed URL records, the least recently used one is removed when exceeding. The record is also removed when it's unblocked for one more backoff interval.
+ * Defaults to 1000. 0 means no limit.
+ */
+@property (nonatomic, assign) NSUInteger maxFailedURLCount;
+
 /**
  The default image cache when the manager which is created with no arguments. Such as shared manager or init.
  Defaults to nil. Means using `LoadImageCache.sharedImageCache`
@@ -259,6 +314,32 @@ ImageLoaderManager *manager = [ImageLoaderManager sharedManager];
                                                   progress:(nullable LoadImageLoaderProgressBlock)progressBlock
                                                  completed:(nonnull SDInternalCompletionBlock)completedBlock;
 
+/**
+ * Probes the image header (format, pixel size and animation) at the given URL, which is useful for layout before deciding whether to load the image.
+ * The probe result is answered in this order:
+ * 1. The header info cache in memory, keyed like the original image (cache key filter applied, without thumbnail and transformer)
+ * 2. The disk cache entry header of the original image, without decoding
+ * 3. The downloader probe, which issue a bounded range request and stop as soon as the header is known, see `-[ImageLoaderDownloader probeImageWithURL:options:context:completed:]`
+ * The probe result from disk or network is stored into the header info cache.
+ *
+ * @param url            The URL to the image
+ * @param options        A mask to specify options to use for this probe, `.fromCacheOnly`, `.fromLoaderOnly`, `.handleCookies` and `.refreshCached` take effect
+ * @param context        A context contains different options, `.cacheKeyFilter`, `.imageCache`, `.originalImageCache`, `.imageLoader`, `.downloadRequestModifier` and `.callbackQueue` take effect
+ * @param completedBlock A block called when probe has been completed. The cache type is `.memory` for the header info cache, `.disk` for disk cache entry, `.none` for network.
+ *
+ * @return Returns an instance of ImageLoaderCombinedOperation, which you can cancel the probe process.
+ * @note If the image loader is not `ImageLoaderDownloader`, the network probe is skipped (the loader may not load from network), the completion is called with nil header info and nil error if it's not in cache.
+ */
+- (nullable ImageLoaderCombinedOperation *)probeImageWithURL:(nullable NSURL *)url
+                                                    options:(ImageLoaderOptions)options
+                                                    context:(nullable ImageLoaderContext *)context
+                                                  completed:(nonnull ImageLoaderManagerProbeCompletedBlock)completedBlock;
+
+/**
+ * Remove all the probe results from the header info cache.
+ */
+- (void)removeAllProbeResults;
+
 /**
  * Cancel all current operations
  */
@@ -275,6 +356,12 @@ ImageLoaderManager *manager = [ImageLoaderManager sharedManager];
  */
 - (void)removeAllFailedURLs;
 
+/**
+ * Returns the date when the failed URL can be loaded again, or nil if the URL is not blocked now.
+ * @param url The failed URL.
+ */
+- (nullable NSDate *)nextAllowedDateForFailedURL:(nonnull NSURL *)url;
+
 /**
  * Return the cache key for a given URL, does not considerate transformer or thumbnail.
  * @note This method does not have context option, only use the url and manager level cacheKeyFilter to generate the cache key.
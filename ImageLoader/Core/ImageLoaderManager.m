@@ -14,6 +14,14 @@
 #import "ImageLoaderError.h"
 #import "SDInternalMacros.h"
 #import "SDCallbackQueue.h"
+#import "SDAssetVariantRegistry.h"
+#import "SDFailedURLTable.h"
+#import "SDImageCacheVariant.h"
+#import "LoadImageCodersManager.h"
+#import "LoadImageCoderHelper.h"
+#import "UIImage+MemoryCacheCost.h"
+#import "SDImageHeaderParser.h"
+#import "SDImageDecodeExecutor.h"
 
 static id<LoadImageCache> _defaultImageCache;
 static id<LoadImageLoader> _defaultImageLoader;
@@ -28,14 +36,15 @@ static id<LoadImageLoader> _defaultImageLoader;
 @end
 
 @interface ImageLoaderManager () {
-    SD_LOCK_DECLARE(_failedURLsLock); // a lock to keep the access to `failedURLs` thread-safe
     SD_LOCK_DECLARE(_runningOperationsLock); // a lock to keep the access to `runningOperations` thread-safe
 }
 
 @property (strong, nonatomic, readwrite, nonnull) LoadImageCache *imageCache;
 @property (strong, nonatomic, readwrite, nonnull) id<LoadImageLoader> imageLoader;
-@property (strong, nonatomic, nonnull) NSMutableSet<NSURL *> *failedURLs;
+@property (strong, nonatomic, nonnull) SDFailedURLTable *failedURLTable;
 @property (strong, nonatomic, nonnull) NSMutableSet<ImageLoaderCombinedOperation *> *runningOperations;
+@property (strong, nonatomic, nonnull) SDAssetVariantRegistry *variantRegistry;
+@property (strong, nonatomic, nonnull) NSCache<NSString *, LoadImageHeaderInfo *> *headerInfoCache;
 
 @end
 
@@ -88,10 +97,14 @@ static id<LoadImageLoader> _defaultImageLoader;
     if ((self = [super init])) {
         _imageCache = cache;
         _imageLoader = loader;
-        _failedURLs = [NSMutableSet new];
-        SD_LOCK_INIT(_failedURLsLock);
+        _failedURLTable = [SDFailedURLTable new];
         _runningOperations = [NSMutableSet new];
         SD_LOCK_INIT(_runningOperationsLock);
+        _variantRegistry = [SDAssetVariantRegistry new];
+        _headerInfoCache = [NSCache new];
+        _headerInfoCache.name = @"com.hackemist.ImageLoaderManager.headerInfoCache";
+        // Header info is tiny, but keep it small
+        _headerInfoCache.countLimit = 1000;
     }
     return self;
 }
@@ -210,9 +223,7 @@ static id<LoadImageLoader> _defaultImageLoader;
 
     BOOL isFailedUrl = NO;
     if (url) {
-        SD_LOCK(_failedURLsLock);
-        isFailedUrl = [self.failedURLs containsObject:url];
-        SD_UNLOCK(_failedURLsLock);
+        isFailedUrl = [self.failedURLTable isBlockedURL:url];
     }
     
     // Preprocess the options and context arg to decide the final the result for manager
@@ -247,6 +258,97 @@ static id<LoadImageLoader> _defaultImageLoader;
     return operation;
 }
 
+- (ImageLoaderCombinedOperation *)probeImageWithURL:(nullable NSURL *)url
+                                           options:(ImageLoaderOptions)options
+                                           context:(nullable ImageLoaderContext *)context
+                                         completed:(nonnull ImageLoaderManagerProbeCompletedBlock)completedBlock {
+    NSAssert(completedBlock != nil, @"Invoking probe without a completedBlock is pointless");
+    
+    if ([url isKindOfClass:NSString.class]) {
+        url = [NSURL URLWithString:(NSString *)url];
+    }
+    if (![url isKindOfClass:NSURL.class]) {
+        url = nil;
+    }
+    
+    ImageLoaderCombinedOperation *operation = [ImageLoaderCombinedOperation new];
+    operation.manager = self;
+    
+    ImageLoaderOptionsResult *result = [self processedResultForURL:url options:options context:context];
+    options = result.options;
+    context = result.context;
+    SDCallbackQueue *queue = context[ImageLoaderContextCallbackQueue];
+    
+    if (url.absoluteString.length == 0) {
+        [(queue ?: SDCallbackQueue.mainQueue) async:^{
+            completedBlock(nil, [NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorInvalidURL userInfo:@{NSLocalizedDescriptionKey : @"Image url is nil"}], LoadImageCacheTypeNone);
+        }];
+        return operation;
+    }
+    
+    // Header info does not change with thumbnail or transformer, use the original key
+    NSString *key = [self originalCacheKeyForURL:url context:context];
+    BOOL shouldQueryCache = !SD_OPTIONS_CONTAINS(options, ImageLoaderFromLoaderOnly);
+    if (shouldQueryCache) {
+        LoadImageHeaderInfo *headerInfo = [self.headerInfoCache objectForKey:key];
+        if (headerInfo) {
+            [(queue ?: SDCallbackQueue.mainQueue) async:^{
+                completedBlock(headerInfo, nil, LoadImageCacheTypeMemory);
+            }];
+            return operation;
+        }
+    }
+    
+    SD_LOCK(_runningOperationsLock);
+    [self.runningOperations addObject:operation];
+    SD_UNLOCK(_runningOperationsLock);
+    
+    // Grab the image cache to use, the downloaded original data is stored into original cache firstly
+    id<LoadImageCache> imageCache = context[ImageLoaderContextOriginalImageCache];
+    if (!imageCache) {
+        imageCache = context[ImageLoaderContextImageCache];
+        if (!imageCache) {
+            imageCache = self.imageCache;
+        }
+    }
+    // Only `LoadImageCache` expose the disk data, other cache can not be read without decoding
+    if (shouldQueryCache && [imageCache isKindOfClass:LoadImageCache.class]) {
+        @weakify(operation);
+        // The query is performed on cache's IO queue, the completion is on main queue. Only the header bytes are parsed
+        [(LoadImageCache *)imageCache diskImageDataQueryForKey:key completion:^(NSData * _Nullable data) {
+            @strongify(operation);
+            if (!operation || operation.isCancelled) {
+                [(queue ?: SDCallbackQueue.mainQueue) async:^{
+                    completedBlock(nil, [NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during querying the cache"}], LoadImageCacheTypeNone);
+                }];
+                [self safelyRemoveOperationFromRunning:operation];
+                return;
+            }
+            if (data.length > SDImageHeaderParser.maxHeaderLength) {
+                data = [data subdataWithRange:NSMakeRange(0, SDImageHeaderParser.maxHeaderLength)];
+            }
+            LoadImageHeaderInfo *headerInfo;
+            if (data && [SDImageHeaderParser parseData:data headerInfo:&headerInfo] == SDImageHeaderParseStatusSuccess) {
+                [self.headerInfoCache setObject:headerInfo forKey:key];
+                [(queue ?: SDCallbackQueue.mainQueue) async:^{
+                    completedBlock(headerInfo, nil, LoadImageCacheTypeDisk);
+                }];
+                [self safelyRemoveOperationFromRunning:operation];
+                return;
+            }
+            [self callProbeProcessForOperation:operation url:url key:key options:options context:context completed:completedBlock];
+        }];
+    } else {
+        [self callProbeProcessForOperation:operation url:url key:key options:options context:context completed:completedBlock];
+    }
+    
+    return operation;
+}
+
+- (void)removeAllProbeResults {
+    [self.headerInfoCache removeAllObjects];
+}
+
 - (void)cancelAll {
     SD_LOCK(_runningOperationsLock);
     NSSet<ImageLoaderCombinedOperation *> *copiedOperations = [self.runningOperations copy];
@@ -266,15 +368,60 @@ static id<LoadImageLoader> _defaultImageLoader;
     if (!url) {
         return;
     }
-    SD_LOCK(_failedURLsLock);
-    [self.failedURLs removeObject:url];
-    SD_UNLOCK(_failedURLsLock);
+    [self.failedURLTable removeURL:url];
 }
 
 - (void)removeAllFailedURLs {
-    SD_LOCK(_failedURLsLock);
-    [self.failedURLs removeAllObjects];
-    SD_UNLOCK(_failedURLsLock);
+    [self.failedURLTable removeAllURLs];
+}
+
+- (nullable NSDate *)nextAllowedDateForFailedURL:(NSURL *)url {
+    if (!url) {
+        return nil;
+    }
+    return [self.failedURLTable nextAllowedDateForURL:url];
+}
+
+#pragma mark - Failed URLs
+
+- (NSTimeInterval)failedURLRetryInterval {
+    return self.failedURLTable.retryInterval;
+}
+
+- (void)setFailedURLRetryInterval:(NSTimeInterval)failedURLRetryInterval {
+    self.failedURLTable.retryInterval = failedURLRetryInterval;
+}
+
+- (NSTimeInterval)failedURLBlockInterval {
+    return self.failedURLTable.blockInterval;
+}
+
+- (void)setFailedURLBlockInterval:(NSTimeInterval)failedURLBlockInterval {
+    self.failedURLTable.blockInterval = failedURLBlockInterval;
+}
+
+- (NSTimeInterval)maxFailedURLBackoffInterval {
+    return self.failedURLTable.maxBackoffInterval;
+}
+
+- (void)setMaxFailedURLBackoffInterval:(NSTimeInterval)maxFailedURLBackoffInterval {
+    self.failedURLTable.maxBackoffInterval = maxFailedURLBackoffInterval;
+}
+
+- (NSTimeInterval)maxFailedURLRetryBackoffInterval {
+    return self.failedURLTable.maxRetryBackoffInterval;
+}
+
+- (void)setMaxFailedURLRetryBackoffInterval:(NSTimeInterval)maxFailedURLRetryBackoffInterval {
+    self.failedURLTable.maxRetryBackoffInterval = maxFailedURLRetryBackoffInterval;
+}
+
+- (NSUInteger)maxFailedURLCount {
+    return self.failedURLTable.countLimit;
+}
+
+- (void)setMaxFailedURLCount:(NSUInteger)maxFailedURLCount {
+    self.failedURLTable.countLimit = maxFailedURLCount;
 }
 
 #pragma mark - Private
@@ -319,6 +466,12 @@ static id<LoadImageLoader> _defaultImageLoader;
                     [self callOriginalCacheProcessForOperation:operation url:url options:options context:context progress:progressBlock completed:completedBlock];
                     return;
                 }
+                // Have a chance to derive from a cached larger variant instead of downloading
+                [self callVariantProcessForOperation:operation url:url options:options context:context progress:progressBlock completed:completedBlock];
+                return;
+            } else if (!cachedImage._isThumbnail && !cachedImage._isTransformed) {
+                // Full size image hit, record the variant
+                [self addAssetVariantForURL:url key:key context:context];
             }
             // Continue download process
             [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:cachedImage cachedData:cachedData cacheType:cacheType progress:progressBlock completed:completedBlock];
@@ -356,6 +509,10 @@ static id<LoadImageLoader> _defaultImageLoader;
     if (shouldQueryOriginalCache) {
         // Get original cache key generation without transformer
         NSString *key = [self originalCacheKeyForURL:url context:context];
+        LoadImageCacheStatistics *statistics;
+        if ([imageCache respondsToSelector:@selector(statistics)]) {
+            statistics = [(id)imageCache statistics];
+        }
         @weakify(operation);
         operation.cacheOperation = [imageCache queryImageForKey:key options:options context:context cacheType:originalQueryCacheType completion:^(UIImage * _Nullable cachedImage, NSData * _Nullable cachedData, LoadImageCacheType cacheType) {
             @strongify(operation);
@@ -365,11 +522,16 @@ static id<LoadImageLoader> _defaultImageLoader;
                 [self safelyRemoveOperationFromRunning:operation];
                 return;
             } else if (!cachedImage) {
-                // Original image cache miss. Continue download process
-                [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:nil cachedData:nil cacheType:LoadImageCacheTypeNone progress:progressBlock completed:completedBlock];
+                [statistics recordMissForTier:LoadImageCacheStatisticsTierOriginal];
+                // Original image cache miss. Continue variant process, then download process
+                [self callVariantProcessForOperation:operation url:url options:options context:context progress:progressBlock completed:completedBlock];
                 return;
             }
-                        
+            [statistics recordHitForTier:LoadImageCacheStatisticsTierOriginal];
+            if (!cachedImage._isThumbnail) {
+                [self addAssetVariantForURL:url key:key context:context];
+            }
+            
             // Skip downloading and continue transform process, and ignore .refreshCached option for now
             [self callTransformProcessForOperation:operation url:url options:options context:context originalImage:cachedImage originalData:cachedData cacheType:cacheType finished:YES completed:completedBlock];
             
@@ -381,6 +543,116 @@ static id<LoadImageLoader> _defaultImageLoader;
     }
 }
 
+// Derive variant process
+- (void)callVariantProcessForOperation:(nonnull ImageLoaderCombinedOperation *)operation
+                                   url:(nonnull NSURL *)url
+                               options:(ImageLoaderOptions)options
+                               context:(nullable ImageLoaderContext *)context
+                              progress:(nullable LoadImageLoaderProgressBlock)progressBlock
+                             completed:(nullable SDInternalCompletionBlock)completedBlock {
+    ImageLoaderAssetVariant *variant = [self assetVariantForURL:url context:context];
+    NSString *originKey = [self originalCacheKeyForURL:url context:context];
+    NSString *sourceKey;
+    // Check whether we should derive from cached variant
+    BOOL shouldDeriveVariant = variant && !SD_OPTIONS_CONTAINS(options, ImageLoaderRefreshCached);
+    if (shouldDeriveVariant) {
+        sourceKey = [self.variantRegistry sourceKeyForVariant:variant excludingKey:originKey];
+    }
+    if (!sourceKey) {
+        // Continue download process
+        [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:nil cachedData:nil cacheType:LoadImageCacheTypeNone progress:progressBlock completed:completedBlock];
+        return;
+    }
+    // Grab the image cache to use, the source variant is stored as original image
+    id<LoadImageCache> imageCache = context[ImageLoaderContextOriginalImageCache];
+    if (!imageCache) {
+        imageCache = context[ImageLoaderContextImageCache];
+        if (!imageCache) {
+            imageCache = self.imageCache;
+        }
+    }
+    // Query the source variant with requested size as thumbnail, so the disk cache can decode the smaller size directly
+    ImageLoaderMutableContext *sourceContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+#if SD_MAC
+    sourceContext[ImageLoaderContextImageThumbnailPixelSize] = [NSValue valueWithSize:variant.pixelSize];
+#else
+    sourceContext[ImageLoaderContextImageThumbnailPixelSize] = [NSValue valueWithCGSize:variant.pixelSize];
+#endif
+    sourceContext[ImageLoaderContextImagePreserveAspectRatio] = @(YES);
+    @synchronized (operation) {
+        // Mark the previous cache operation end
+        operation.cacheOperation = nil;
+    }
+    @weakify(operation);
+    id<ImageLoaderOperation> queryOperation = [imageCache queryImageForKey:sourceKey options:options context:[sourceContext copy] cacheType:LoadImageCacheTypeAll completion:^(UIImage * _Nullable cachedImage, NSData * _Nullable cachedData, LoadImageCacheType cacheType) {
+        @strongify(operation);
+        if (!operation || operation.isCancelled) {
+            // Image combined operation cancelled by user
+            [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during querying the cache"}] queue:context[ImageLoaderContextCallbackQueue] url:url];
+            [self safelyRemoveOperationFromRunning:operation];
+            return;
+        } else if (!cachedImage) {
+            // The source variant is already removed from cache. Continue download process
+            [self.variantRegistry removeKey:sourceKey forAssetIdentifier:variant.assetIdentifier];
+            [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:nil cachedData:nil cacheType:LoadImageCacheTypeNone progress:progressBlock completed:completedBlock];
+            return;
+        }
+        NSOperationQueuePriority priority = NSOperationQueuePriorityNormal;
+        if (options & ImageLoaderHighPriority) {
+            priority = NSOperationQueuePriorityHigh;
+        } else if (options & ImageLoaderLowPriority) {
+            priority = NSOperationQueuePriorityLow;
+        }
+        // Downscale and encode in the shared decode executor, bounded with the other image decoding
+        __block BOOL processed = NO;
+        NSOperation *deriveOperation = [[SDImageDecodeExecutor sharedExecutor] operationWithBlock:^{
+            if (operation.isCancelled) {
+                // Callback in completion block
+                return;
+            }
+            NSData *derivedData;
+            UIImage *derivedImage = [self derivedImageWithImage:cachedImage variant:variant url:url options:options context:context data:&derivedData];
+            if (operation.isCancelled) {
+                // Cancelled during deriving, drop the result
+                return;
+            }
+            processed = YES;
+            if (!derivedImage) {
+                // Continue download process
+                [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:nil cachedData:nil cacheType:LoadImageCacheTypeNone progress:progressBlock completed:completedBlock];
+                return;
+            }
+            if (!derivedImage._isThumbnail) {
+                [self addAssetVariantForURL:url key:originKey context:context];
+            }
+            // Continue transform process, like the derived image is downloaded
+            [self callTransformProcessForOperation:operation url:url options:options context:context originalImage:derivedImage originalData:derivedData cacheType:LoadImageCacheTypeNone finished:YES completed:completedBlock];
+            [self safelyRemoveOperationFromRunning:operation];
+        }];
+        deriveOperation.queuePriority = priority;
+        // The cancelled operation which is still queued never run the block, but always call the completion block
+        deriveOperation.completionBlock = ^{
+            if (processed) {
+                return;
+            }
+            // Image combined operation cancelled by user
+            [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during deriving the image variant"}] queue:context[ImageLoaderContextCallbackQueue] url:url];
+            [self safelyRemoveOperationFromRunning:operation];
+        };
+        @synchronized (operation) {
+            // Let the combined operation cancel the derive
+            operation.cacheOperation = deriveOperation;
+        }
+        [[SDImageDecodeExecutor sharedExecutor] addOperation:deriveOperation];
+    }];
+    @synchronized (operation) {
+        // The completion may be called synchronously (memory cache hit), do not replace the derive operation
+        if (!operation.cacheOperation) {
+            operation.cacheOperation = queryOperation;
+        }
+    }
+}
+
 // Download process
 - (void)callDownloadProcessForOperation:(nonnull ImageLoaderCombinedOperation *)operation
                                     url:(nonnull NSURL *)url
@@ -426,6 +698,18 @@ static id<LoadImageLoader> _defaultImageLoader;
             mutableContext[ImageLoaderContextLoaderCachedImage] = cachedImage;
             context = [mutableContext copy];
         }
+        BOOL shouldUseDiskCache = SD_OPTIONS_CONTAINS(options, ImageLoaderStreamToDiskCache) || SD_OPTIONS_CONTAINS(options, ImageLoaderResumeDownload);
+        if (shouldUseDiskCache && !context[ImageLoaderContextOriginalImageCache] && !context[ImageLoaderContextImageCache]) {
+            // The loader stream (or persist partial) the data into the same cache as original image store
+            ImageLoaderMutableContext *mutableContext;
+            if (context) {
+                mutableContext = [context mutableCopy];
+            } else {
+                mutableContext = [NSMutableDictionary dictionary];
+            }
+            mutableContext[ImageLoaderContextImageCache] = self.imageCache;
+            context = [mutableContext copy];
+        }
         
         @weakify(operation);
         operation.loaderOperation = [imageLoader requestImageWithURL:url options:options context:context progress:progressBlock completed:^(UIImage *downloadedImage, NSData *downloadedData, NSError *error, BOOL finished) {
@@ -441,17 +725,16 @@ static id<LoadImageLoader> _defaultImageLoader;
             } else if (error) {
                 [self callCompletionBlockForOperation:operation completion:completedBlock error:error queue:context[ImageLoaderContextCallbackQueue] url:url];
                 BOOL shouldBlockFailedURL = [self shouldBlockFailedURLWithURL:url error:error options:options context:context];
-                
-                if (shouldBlockFailedURL) {
-                    SD_LOCK(self->_failedURLsLock);
-                    [self.failedURLs addObject:url];
-                    SD_UNLOCK(self->_failedURLsLock);
-                }
+                // The blockable failure backoff from `failedURLBlockInterval`, else it's transient and backoff from `failedURLRetryInterval`
+                [self.failedURLTable recordFailureForURL:url error:error permanent:shouldBlockFailedURL];
             } else {
-                if ((options & ImageLoaderRetryFailed)) {
-                    SD_LOCK(self->_failedURLsLock);
-                    [self.failedURLs removeObject:url];
-                    SD_UNLOCK(self->_failedURLsLock);
+                // The URL may be retried after backoff, or with `ImageLoaderRetryFailed`
+                [self.failedURLTable removeURL:url];
+                // The network is recovered, the URLs failed by connectivity can be loaded again
+                [self.failedURLTable removeConnectivityFailedURLs];
+                if (finished) {
+                    // The original data is stored under original cache key, record the variant
+                    [self addAssetVariantForURL:url key:[self originalCacheKeyForURL:url context:context] context:context];
                 }
                 // Continue transform process
                 [self callTransformProcessForOperation:operation url:url options:options context:context originalImage:downloadedImage originalData:downloadedData cacheType:LoadImageCacheTypeNone finished:finished completed:completedBlock];
@@ -471,6 +754,59 @@ static id<LoadImageLoader> _defaultImageLoader;
     }
 }
 
+// Probe process
+- (void)callProbeProcessForOperation:(nonnull ImageLoaderCombinedOperation *)operation
+                                 url:(nonnull NSURL *)url
+                                 key:(nonnull NSString *)key
+                             options:(ImageLoaderOptions)options
+                             context:(nullable ImageLoaderContext *)context
+                           completed:(nonnull ImageLoaderManagerProbeCompletedBlock)completedBlock {
+    SDCallbackQueue *queue = context[ImageLoaderContextCallbackQueue];
+    // Grab the downloader to use
+    id<LoadImageLoader> imageLoader = context[ImageLoaderContextImageLoader];
+    if (!imageLoader) {
+        imageLoader = self.imageLoader;
+    }
+    // Only the downloader can probe, the other loader may not load from network (such as Photos or the custom request)
+    ImageLoaderDownloader *downloader = [imageLoader isKindOfClass:ImageLoaderDownloader.class] ? (ImageLoaderDownloader *)imageLoader : nil;
+    
+    // Check whether we should probe from network
+    BOOL shouldDownload = downloader != nil && !SD_OPTIONS_CONTAINS(options, ImageLoaderFromCacheOnly);
+    shouldDownload &= (![self.delegate respondsToSelector:@selector(imageManager:shouldDownloadImageForURL:)] || [self.delegate imageManager:self shouldDownloadImageForURL:url]);
+    if (!shouldDownload) {
+        // Header not in cache and download disallowed (or not supported by loader)
+        [(queue ?: SDCallbackQueue.mainQueue) async:^{
+            completedBlock(nil, nil, LoadImageCacheTypeNone);
+        }];
+        [self safelyRemoveOperationFromRunning:operation];
+        return;
+    }
+    
+    ImageLoaderDownloaderOptions downloaderOptions = 0;
+    if (options & ImageLoaderRefreshCached) downloaderOptions |= ImageLoaderDownloaderUseNSURLCache;
+    if (options & ImageLoaderHandleCookies) downloaderOptions |= ImageLoaderDownloaderHandleCookies;
+    @weakify(operation);
+    id<ImageLoaderOperation> loaderOperation = [downloader probeImageWithURL:url options:downloaderOptions context:context completed:^(LoadImageHeaderInfo * _Nullable headerInfo, NSError * _Nullable error) {
+        @strongify(operation);
+        // Already on the callback queue
+        if (!operation || operation.isCancelled) {
+            completedBlock(nil, [NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during sending the request"}], LoadImageCacheTypeNone);
+        } else {
+            if (headerInfo) {
+                [self.headerInfoCache setObject:headerInfo forKey:key];
+            }
+            completedBlock(headerInfo, error, LoadImageCacheTypeNone);
+        }
+        [self safelyRemoveOperationFromRunning:operation];
+    }];
+    @synchronized (operation) {
+        operation.loaderOperation = loaderOperation;
+    }
+    if (operation.isCancelled) {
+        [loaderOperation cancel];
+    }
+}
+
 // Transform process
 - (void)callTransformProcessForOperation:(nonnull ImageLoaderCombinedOperation *)operation
                                      url:(nonnull NSURL *)url
@@ -496,6 +832,8 @@ static id<LoadImageLoader> _defaultImageLoader;
     if (isThumbnail) {
         cacheData = nil; // thumbnail don't store full size data
         originalImage = nil; // thumbnail don't have full size image
+        // The loader may decide a smaller thumbnail than requested, store it under its own thumbnail key
+        context = [self contextByApplyingThumbnailOfImage:cacheImage context:context];
     }
     
     if (shouldTransformImage) {
@@ -613,6 +951,86 @@ static id<LoadImageLoader> _defaultImageLoader;
 
 #pragma mark - Helper
 
+// The thumbnail size decided by loader (such as the scale down by downloader header policy) is not in context, which is used for the cache key
+- (nullable ImageLoaderContext *)contextByApplyingThumbnailOfImage:(nonnull UIImage *)image context:(nullable ImageLoaderContext *)context {
+    NSValue *thumbnailSizeValue = image._decodeOptions[LoadImageCoderDecodeThumbnailPixelSize];
+    if (thumbnailSizeValue == nil || [thumbnailSizeValue isEqual:context[ImageLoaderContextImageThumbnailPixelSize]]) {
+        return context;
+    }
+    ImageLoaderMutableContext *mutableContext;
+    if (context) {
+        mutableContext = [context mutableCopy];
+    } else {
+        mutableContext = [NSMutableDictionary dictionary];
+    }
+    mutableContext[ImageLoaderContextImageThumbnailPixelSize] = thumbnailSizeValue;
+    NSNumber *preserveAspectRatioValue = image._decodeOptions[LoadImageCoderDecodePreserveAspectRatio];
+    if (preserveAspectRatioValue != nil) {
+        mutableContext[ImageLoaderContextImagePreserveAspectRatio] = preserveAspectRatioValue;
+    }
+    return [mutableContext copy];
+}
+
+- (nullable ImageLoaderAssetVariant *)assetVariantForURL:(nonnull NSURL *)url context:(nullable ImageLoaderContext *)context {
+    id<ImageLoaderVariantResolver> variantResolver = self.variantResolver;
+    if (context[ImageLoaderContextVariantResolver]) {
+        variantResolver = context[ImageLoaderContextVariantResolver];
+        if ([variantResolver isEqual:NSNull.null]) {
+            variantResolver = nil;
+        }
+    }
+    ImageLoaderAssetVariant *variant = [variantResolver assetVariantForURL:url];
+    if (variant.assetIdentifier.length == 0 || variant.pixelSize.width <= 0 || variant.pixelSize.height <= 0) {
+        return nil;
+    }
+    return variant;
+}
+
+- (void)addAssetVariantForURL:(nonnull NSURL *)url key:(nullable NSString *)key context:(nullable ImageLoaderContext *)context {
+    if (!key) {
+        return;
+    }
+    ImageLoaderAssetVariant *variant = [self assetVariantForURL:url context:context];
+    if (variant) {
+        [self.variantRegistry addVariant:variant forKey:key];
+    }
+}
+
+// Downsample the cached larger variant into the requested variant, and encode the data to store, as the same as a downloaded image
+- (nullable UIImage *)derivedImageWithImage:(nonnull UIImage *)image variant:(nonnull ImageLoaderAssetVariant *)variant url:(nonnull NSURL *)url options:(ImageLoaderOptions)options context:(nullable ImageLoaderContext *)context data:(NSData * _Nullable * _Nonnull)data {
+    LoadImageCoderOptions *decodeOptions = SDGetDecodeOptionsFromContext(context, options, [self originalCacheKeyForURL:url context:context]);
+    CGFloat scale = [decodeOptions[LoadImageCoderDecodeScaleFactor] doubleValue];
+    UIImage *derivedImage = SDImageCacheDownscaledImage(image, variant.pixelSize, YES, scale);
+    // Apply the thumbnail for request as well
+    NSValue *thumbnailSizeValue = decodeOptions[LoadImageCoderDecodeThumbnailPixelSize];
+    if (derivedImage && thumbnailSizeValue != nil) {
+#if SD_MAC
+        CGSize thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+        CGSize thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+        BOOL preserveAspectRatio = YES;
+        NSNumber *preserveAspectRatioValue = decodeOptions[LoadImageCoderDecodePreserveAspectRatio];
+        if (preserveAspectRatioValue != nil) {
+            preserveAspectRatio = preserveAspectRatioValue.boolValue;
+        }
+        derivedImage = SDImageCacheDownscaledImage(derivedImage, thumbnailSize, preserveAspectRatio, scale);
+    }
+    if (!derivedImage) {
+        return nil;
+    }
+    // The same decode options as decoding from the URL's data
+    derivedImage._decodeOptions = decodeOptions;
+    derivedImage._memoryCost = SDMemoryCacheCostForImage(derivedImage);
+    // Encode once here, avoid both original and target store to encode again
+    LoadImageFormat format = derivedImage._imageFormat;
+    if (format == LoadImageFormatUndefined) {
+        format = [LoadImageCoderHelper CGImageContainsAlpha:derivedImage.CGImage] ? LoadImageFormatPNG : LoadImageFormatJPEG;
+    }
+    *data = [[LoadImageCodersManager sharedManager] encodedDataWithImage:derivedImage format:format options:context[ImageLoaderContextImageEncodeOptions]];
+    return derivedImage;
+}
+
 - (void)safelyRemoveOperationFromRunning:(nullable ImageLoaderCombinedOperation*)operation {
     if (!operation) {
         return;
@@ -725,6 +1143,11 @@ static id<LoadImageLoader> _defaultImageLoader;
         id<ImageLoaderCacheKeyFilter> cacheKeyFilter = self.cacheKeyFilter;
         [mutableContext setValue:cacheKeyFilter forKey:ImageLoaderContextCacheKeyFilter];
     }
+    // Variant resolver from manager
+    if (!context[ImageLoaderContextVariantResolver]) {
+        id<ImageLoaderVariantResolver> variantResolver = self.variantResolver;
+        [mutableContext setValue:variantResolver forKey:ImageLoaderContextVariantResolver];
+    }
     // Cache serializer from manager
     if (!context[ImageLoaderContextCacheSerializer]) {
         id<ImageLoaderCacheSerializer> cacheSerializer = self.cacheSerializer;
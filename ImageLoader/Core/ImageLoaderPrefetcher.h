@@ -86,6 +86,12 @@ typedef void(^ImageLoaderPrefetcherCompletionBlock)(NSUInteger noOfFinishedUrls,
  */
 @property (nonatomic, copy, nullable) ImageLoaderContext *context API_DEPRECATED("Use individual prefetch context param instead", macos(10.10, API_TO_BE_DEPRECATED), ios(8.0, API_TO_BE_DEPRECATED), tvos(9.0, API_TO_BE_DEPRECATED), watchos(2.0, API_TO_BE_DEPRECATED));
 
+/**
+ * Whether to pre-connect to the origins of the URLs when prefetching starts, see `preconnectURLs:`. Defaults to NO.
+ * @note This warms the connections for the URLs queued behind `maxConcurrentPrefetchCount`, so they do not pay the DNS, TCP and TLS setup when their turn comes.
+ */
+@property (nonatomic, assign) BOOL shouldPreconnectUpcomingURLs;
+
 /**
  * Queue options for prefetcher when call the progressBlock, completionBlock and delegate methods. Defaults to Main Queue.
  * @deprecated 5.15.0 introduce SDCallbackQueue, use that is preferred and has higher priority. The set/get to this property will translate to that instead.
@@ -159,6 +165,15 @@ typedef void(^ImageLoaderPrefetcherCompletionBlock)(NSUInteger noOfFinishedUrls,
                                           progress:(nullable ImageLoaderPrefetcherProgressBlock)progressBlock
                                          completed:(nullable ImageLoaderPrefetcherCompletionBlock)completionBlock;
 
+/**
+ * Pre-connects to the origins of the upcoming URLs without downloading the images, which is lighter than prefetching. The URLs which are likely to be displayed later, but not worth to be downloaded now, can use this.
+ * This uses the `ImageLoaderDownloader` of the manager's image loader (or in the `LoadImageLoadersManager`), and does nothing for other image loaders.
+ *
+ * @param urls list of upcoming URLs
+ * @note See `-[ImageLoaderDownloader preconnectURLs:]` for the limits.
+ */
+- (void)preconnectURLs:(nullable NSArray<NSURL *> *)urls;
+
 /**
  * Remove and cancel all the prefeching for the prefetcher.
  */
@@ -7,6 +7,8 @@
  */
 
 #import "ImageLoaderPrefetcher.h"
+#import "ImageLoaderDownloader.h"
+#import "LoadImageLoadersManager.h"
 #import "SDAsyncBlockOperation.h"
 #import "SDCallbackQueue.h"
 #import "SDInternalMacros.h"
@@ -99,6 +101,25 @@
 }
 
 #pragma mark - Prefetch
++ (nullable ImageLoaderDownloader *)downloaderForImageLoader:(nullable id<LoadImageLoader>)imageLoader {
+    if ([imageLoader isKindOfClass:ImageLoaderDownloader.class]) {
+        return (ImageLoaderDownloader *)imageLoader;
+    }
+    if ([imageLoader isKindOfClass:LoadImageLoadersManager.class]) {
+        // The later added loader has the higher priority
+        for (id<LoadImageLoader> loader in ((LoadImageLoadersManager *)imageLoader).loaders.reverseObjectEnumerator) {
+            if ([loader isKindOfClass:ImageLoaderDownloader.class]) {
+                return (ImageLoaderDownloader *)loader;
+            }
+        }
+    }
+    return nil;
+}
+
+- (void)preconnectURLs:(nullable NSArray<NSURL *> *)urls {
+    [[self.class downloaderForImageLoader:self.manager.imageLoader] preconnectURLs:urls];
+}
+
 - (nullable ImageLoaderPrefetchToken *)prefetchURLs:(nullable NSArray<NSURL *> *)urls {
     return [self prefetchURLs:urls progress:nil completed:nil];
 }
@@ -140,6 +161,11 @@
 }
 
 - (void)startPrefetchWithToken:(ImageLoaderPrefetchToken * _Nonnull)token {
+    if (self.shouldPreconnectUpcomingURLs) {
+        // Warm the connections before the prefetch operations are queued, the downloads which are already started skip their origins
+        id<LoadImageLoader> imageLoader = token.context[ImageLoaderContextImageLoader] ?: self.manager.imageLoader;
+        [[self.class downloaderForImageLoader:imageLoader] preconnectURLs:token.urls];
+    }
     for (NSURL *url in token.urls) {
         @weakify(self);
         SDAsyncBlockOperation *prefetchOperation = [SDAsyncBlockOperation blockOperationWithBlock:^(SDAsyncBlockOperation * _Nonnull asyncOperation) {
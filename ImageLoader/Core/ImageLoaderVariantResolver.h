@@ -0,0 +1,49 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+/**
+ The asset variant which an URL represent, the same asset may be served in different pixel size by different URL (like a responsive image CDN).
+ */
+@interface ImageLoaderAssetVariant : NSObject <NSCopying>
+
+/// The identifier for the asset, the variants with same identifier are the same image content in different size
+@property (nonatomic, copy, readonly, nonnull) NSString *assetIdentifier;
+/// The pixel size of this variant, must be positive
+@property (nonatomic, assign, readonly) CGSize pixelSize;
+
+- (nonnull instancetype)initWithAssetIdentifier:(nonnull NSString *)assetIdentifier pixelSize:(CGSize)pixelSize;
++ (nonnull instancetype)variantWithAssetIdentifier:(nonnull NSString *)assetIdentifier pixelSize:(CGSize)pixelSize;
+
+@end
+
+typedef ImageLoaderAssetVariant * _Nullable(^ImageLoaderVariantResolverBlock)(NSURL * _Nonnull url);
+
+/**
+ This is the protocol for variant resolver.
+ The variant resolver map an URL into the asset variant, so the manager can derive a smaller variant by downsampling a larger cached variant, instead of downloading again.
+ We can use a block to specify the variant resolver. But Using protocol can make this extensible, and allow Swift user to use it easily instead of using `@convention(block)` to store a block into context options.
+ */
+@protocol ImageLoaderVariantResolver <NSObject>
+
+/// Return the asset variant for URL, or nil if the URL does not represent a variant
+- (nullable ImageLoaderAssetVariant *)assetVariantForURL:(nonnull NSURL *)url;
+
+@end
+
+/**
+ A variant resolver class with block.
+ */
+@interface ImageLoaderVariantResolver : NSObject <ImageLoaderVariantResolver>
+
+- (nonnull instancetype)initWithBlock:(nonnull ImageLoaderVariantResolverBlock)block;
++ (nonnull instancetype)variantResolverWithBlock:(nonnull ImageLoaderVariantResolverBlock)block;
+
+@end
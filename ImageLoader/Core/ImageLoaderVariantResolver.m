@@ -0,0 +1,86 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "ImageLoaderVariantResolver.h"
+
+@interface ImageLoaderAssetVariant ()
+
+@property (nonatomic, copy, readwrite, nonnull) NSString *assetIdentifier;
+@property (nonatomic, assign, readwrite) CGSize pixelSize;
+
+@end
+
+@implementation ImageLoaderAssetVariant
+
+- (instancetype)initWithAssetIdentifier:(NSString *)assetIdentifier pixelSize:(CGSize)pixelSize {
+    self = [super init];
+    if (self) {
+        self.assetIdentifier = assetIdentifier;
+        self.pixelSize = pixelSize;
+    }
+    return self;
+}
+
++ (instancetype)variantWithAssetIdentifier:(NSString *)assetIdentifier pixelSize:(CGSize)pixelSize {
+    return [[self alloc] initWithAssetIdentifier:assetIdentifier pixelSize:pixelSize];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (NSUInteger)hash {
+    return self.assetIdentifier.hash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    if (![object isKindOfClass:[ImageLoaderAssetVariant class]]) {
+        return NO;
+    }
+    ImageLoaderAssetVariant *variant = object;
+    return [self.assetIdentifier isEqualToString:variant.assetIdentifier] && CGSizeEqualToSize(self.pixelSize, variant.pixelSize);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, asset: %@, pixelSize: {%.0f, %.0f}>", NSStringFromClass(self.class), self, self.assetIdentifier, self.pixelSize.width, self.pixelSize.height];
+}
+
+@end
+
+@interface ImageLoaderVariantResolver ()
+
+@property (nonatomic, copy, nonnull) ImageLoaderVariantResolverBlock block;
+
+@end
+
+@implementation ImageLoaderVariantResolver
+
+- (instancetype)initWithBlock:(ImageLoaderVariantResolverBlock)block {
+    self = [super init];
+    if (self) {
+        self.block = block;
+    }
+    return self;
+}
+
++ (instancetype)variantResolverWithBlock:(ImageLoaderVariantResolverBlock)block {
+    ImageLoaderVariantResolver *variantResolver = [[ImageLoaderVariantResolver alloc] initWithBlock:block];
+    return variantResolver;
+}
+
+- (ImageLoaderAssetVariant *)assetVariantForURL:(NSURL *)url {
+    if (!self.block) {
+        return nil;
+    }
+    return self.block(url);
+}
+
+@end
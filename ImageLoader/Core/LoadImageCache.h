@@ -13,6 +13,7 @@
 #import "LoadImageCacheDefine.h"
 #import "SDMemoryCache.h"
 #import "SDDiskCache.h"
+#import "LoadImageCacheStatistics.h"
 
 /// Image Cache Options
 typedef NS_OPTIONS(NSUInteger, LoadImageCacheOptions) {
@@ -53,6 +54,14 @@ typedef NS_OPTIONS(NSUInteger, LoadImageCacheOptions) {
      * Note this options is not compatible with `LoadImageCacheDecodeFirstFrameOnly`, which always produce a UIImage/NSImage.
      */
     LoadImageCacheMatchAnimatedImageClass = 1 << 7,
+    /**
+     * By default, the disk cache decoding runs in the shared decode executor with normal priority. This flag decodes after the other queued decodes, such as for prefetching.
+     */
+    LoadImageCacheLowPriority = 1 << 8,
+    /**
+     * This flag decodes before the other queued decodes, such as for the visible image.
+     */
+    LoadImageCacheHighPriority = 1 << 9,
 };
 
 /**
@@ -113,6 +122,13 @@ typedef NS_OPTIONS(NSUInteger, LoadImageCacheOptions) {
  */
 @property (nonatomic, copy, nullable) LoadImageCacheAdditionalCachePathBlock additionalCachePathBlock;
 
+/**
+ *  The statistics recorder for current image cache, including the hit/miss count for memory/weak/disk tier, the eviction count, the bytes read/written on disk, and the latency histogram for query/decode/store.
+ *  Call `statistics.snapshot` to read the values from any thread.
+ *  @note The weak cache hit and the memory limit/memory warning eviction are only available when using `SDMemoryCache`, the disk expired/limit eviction are only available when using `SDDiskCache`.
+ */
+@property (nonatomic, strong, readonly, nonnull) LoadImageCacheStatistics *statistics;
+
 #pragma mark - Singleton and initialization
 
 /**
@@ -265,6 +281,32 @@ typedef NS_OPTIONS(NSUInteger, LoadImageCacheOptions) {
 - (void)storeImageDataToDisk:(nullable NSData *)imageData
                       forKey:(nullable NSString *)key;
 
+#pragma mark - Staging Ops
+
+/**
+ * Synchronously create a staging file in disk cache for the given key, which can be written progressively, such as streaming a large download. The staging file is not visible to query until committed.
+ *
+ * @param key The unique image cache key, usually it's image absolute URL
+ * @return The staging file path, or nil if the disk cache does not support staging (See `SDDiskCache` protocol)
+ */
+- (nullable NSString *)createStagingFileForKey:(nonnull NSString *)key;
+
+/**
+ * Synchronously commit the staging file as the disk cache data for the given key, replace the existing one.
+ *
+ * @param stagingPath The staging file path returned by `createStagingFileForKey:`
+ * @param key The unique image cache key, usually it's image absolute URL
+ * @return The memory-mapped image data of committed file, or nil if failed. Storing this data object into disk cache with the same key does not write the file again.
+ */
+- (nullable NSData *)commitStagingFile:(nonnull NSString *)stagingPath forKey:(nonnull NSString *)key;
+
+/**
+ * Asynchronously remove the staging file which is not committed.
+ *
+ * @param stagingPath The staging file path returned by `createStagingFileForKey:`
+ */
+- (void)removeStagingFile:(nonnull NSString *)stagingPath;
+
 
 #pragma mark - Contains and Check Ops
 
@@ -344,6 +386,7 @@ typedef NS_OPTIONS(NSUInteger, LoadImageCacheOptions) {
  * @param context   A context contains different options to perform specify changes or processes, see `ImageLoaderContextOption`. This hold the extra objects which `options` enum can not hold.
  * @param queryCacheType Specify where to query the cache from. By default we use `.all`, which means both memory cache and disk cache. You can choose to query memory only or disk only as well. Pass `.none` is invalid and callback with nil immediately.
  * @param doneBlock The completion block. Will not get called if the operation is cancelled
+ * @note The memory cache entry is keyed by (cache key, decode variant), the variant covers the thumbnail pixel size, scale factor and first-frame-only in `context` and `options`. The thumbnail or first frame image decoded from disk is stored into memory cache with its variant, instead of skipped. A request for a smaller thumbnail can reuse a larger cached variant (or the full size static image), which is downscaled on the fly.
  *
  * @return a LoadImageCacheToken instance containing the cache operation, will callback immediately when cancelled
  */
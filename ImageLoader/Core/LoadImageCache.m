@@ -15,6 +15,8 @@
 #import "UIImage+Metadata.h"
 #import "UIImage+ExtendedCacheData.h"
 #import "SDCallbackQueue.h"
+#import "SDImageCacheVariant.h"
+#import "SDImageDecodeExecutor.h"
 
 @interface LoadImageCacheToken ()
 
@@ -22,6 +24,7 @@
 @property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
 @property (nonatomic, copy, nullable) LoadImageCacheQueryCompletionBlock doneBlock;
 @property (nonatomic, strong, nullable) SDCallbackQueue *callbackQueue;
+@property (nonatomic, weak, nullable) NSOperation *decodeOperation; // the queued disk data decoding
 
 @end
 
@@ -41,6 +44,8 @@
             return;
         }
         self.cancelled = YES;
+        // The queued decoding never run
+        [self.decodeOperation cancel];
         
         LoadImageCacheQueryCompletionBlock doneBlock = self.doneBlock;
         self.doneBlock = nil;
@@ -64,6 +69,9 @@ static NSString * _defaultDiskCacheDirectory;
 @property (nonatomic, copy, readwrite, nonnull) LoadImageCacheConfig *config;
 @property (nonatomic, copy, readwrite, nonnull) NSString *diskCachePath;
 @property (nonatomic, strong, nonnull) dispatch_queue_t ioQueue;
+@property (nonatomic, strong, readwrite, nonnull) LoadImageCacheStatistics *statistics;
+@property (nonatomic, strong, nonnull) SDImageCacheVariantIndex *variantIndex;
+@property (nonatomic, strong, nonnull) NSMapTable<NSData *, NSString *> *committedDataMap; // committed staging data -> key, only access in ioQueue
 
 @end
 
@@ -115,6 +123,10 @@ static NSString * _defaultDiskCacheDirectory;
             config = LoadImageCacheConfig.defaultCacheConfig;
         }
         _config = [config copy];
+        _statistics = [[LoadImageCacheStatistics alloc] init];
+        _variantIndex = [[SDImageCacheVariantIndex alloc] init];
+        // Weak and pointer identity, the committed data is only skipped when the same object is stored again
+        _committedDataMap = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory capacity:0];
         
         // Create IO queue
         dispatch_queue_attr_t ioQueueAttributes = _config.ioQueueAttributes;
@@ -124,6 +136,9 @@ static NSString * _defaultDiskCacheDirectory;
         // Init the memory cache
         NSAssert([config.memoryCacheClass conformsToProtocol:@protocol(SDMemoryCache)], @"Custom memory cache class must conform to `SDMemoryCache` protocol");
         _memoryCache = [[config.memoryCacheClass alloc] initWithConfig:_config];
+        if ([_memoryCache isKindOfClass:[SDMemoryCache class]]) {
+            ((SDMemoryCache *)_memoryCache).statistics = _statistics;
+        }
         
         // Init the disk cache
         if (!directory) {
@@ -134,6 +149,9 @@ static NSString * _defaultDiskCacheDirectory;
         
         NSAssert([config.diskCacheClass conformsToProtocol:@protocol(SDDiskCache)], @"Custom disk cache class must conform to `SDDiskCache` protocol");
         _diskCache = [[config.diskCacheClass alloc] initWithCachePath:_diskCachePath config:_config];
+        if ([_diskCache isKindOfClass:[SDDiskCache class]]) {
+            ((SDDiskCache *)_diskCache).statistics = _statistics;
+        }
         
         // Check and migrate disk cache directory if need
         [self migrateDiskCacheDirectory];
@@ -242,6 +260,11 @@ static NSString * _defaultDiskCacheDirectory;
     if (image && toMemory && self.config.shouldCacheImagesInMemory) {
         NSUInteger cost = image._memoryCost;
         [self.memoryCache setObject:image forKey:key cost:cost];
+        // Thumbnail key store, record the variant so the smaller request can derive from it
+        SDImageCacheVariant *variant = [SDImageCacheVariant variantWithKey:key options:options context:context];
+        if (variant && [variant.memoryKey isEqualToString:key]) {
+            [self _addImageVariant:variant];
+        }
     }
     
     if (!toDisk) {
@@ -349,7 +372,57 @@ static NSString * _defaultDiskCacheDirectory;
         return;
     }
     
+    // The data is committed from staging file for the same key, which is already on disk
+    if ([[self.committedDataMap objectForKey:imageData] isEqualToString:key]) {
+        return;
+    }
+    NSTimeInterval startTime = LoadImageCacheStatisticsTimestamp();
     [self.diskCache setData:imageData forKey:key];
+    [self.statistics recordLatency:LoadImageCacheStatisticsTimestamp() - startTime forMetric:LoadImageCacheLatencyMetricStore];
+    [self.statistics recordBytesWritten:imageData.length];
+}
+
+#pragma mark - Staging Ops
+
+- (nullable NSString *)createStagingFileForKey:(nonnull NSString *)key {
+    if (!key || ![self.diskCache respondsToSelector:@selector(stagingPathForKey:)]) {
+        return nil;
+    }
+    __block NSString *stagingPath;
+    dispatch_sync(self.ioQueue, ^{
+        stagingPath = [self.diskCache stagingPathForKey:key];
+    });
+    return stagingPath;
+}
+
+- (nullable NSData *)commitStagingFile:(nonnull NSString *)stagingPath forKey:(nonnull NSString *)key {
+    if (!stagingPath || !key || ![self.diskCache respondsToSelector:@selector(commitStagingPath:forKey:)]) {
+        return nil;
+    }
+    __block NSData *data;
+    dispatch_sync(self.ioQueue, ^{
+        NSTimeInterval startTime = LoadImageCacheStatisticsTimestamp();
+        if (![self.diskCache commitStagingPath:stagingPath forKey:key]) {
+            return;
+        }
+        // Map the committed file, avoid holding the bytes in memory again
+        data = [NSData dataWithContentsOfFile:[self.diskCache cachePathForKey:key] options:NSDataReadingMappedIfSafe error:nil];
+        if (data) {
+            [self.committedDataMap setObject:key forKey:data];
+            [self.statistics recordLatency:LoadImageCacheStatisticsTimestamp() - startTime forMetric:LoadImageCacheLatencyMetricStore];
+            [self.statistics recordBytesWritten:data.length];
+        }
+    });
+    return data;
+}
+
+- (void)removeStagingFile:(nonnull NSString *)stagingPath {
+    if (!stagingPath || ![self.diskCache respondsToSelector:@selector(removeStagingPath:)]) {
+        return;
+    }
+    dispatch_async(self.ioQueue, ^{
+        [self.diskCache removeStagingPath:stagingPath];
+    });
 }
 
 #pragma mark - Query and Retrieve Ops
@@ -414,6 +487,44 @@ static NSString * _defaultDiskCacheDirectory;
     return [self.memoryCache objectForKey:key];
 }
 
+// Query the memory cache for the decode variant, the image may be derived from a cached larger variant
+- (nullable UIImage *)imageFromMemoryCacheForVariant:(nonnull SDImageCacheVariant *)variant key:(nonnull NSString *)key {
+    if (!self.config.shouldCacheImagesInMemory) {
+        return nil;
+    }
+    UIImage *image;
+    if (![variant.memoryKey isEqualToString:key]) {
+        image = [self.memoryCache objectForKey:variant.memoryKey];
+        if (image) {
+            return image;
+        }
+    }
+    for (SDImageCacheVariant *candidate in [self.variantIndex candidateVariantsForVariant:variant]) {
+        UIImage *candidateImage = [self.memoryCache objectForKey:candidate.memoryKey];
+        if (!candidateImage) {
+            // Already evicted from memory cache
+            [self.variantIndex removeVariant:candidate];
+            continue;
+        }
+        image = [variant derivedImageFromImage:candidateImage];
+        if (image) {
+            break;
+        }
+    }
+    if (!image && ![variant.groupKey isEqualToString:key]) {
+        // Try the full size image
+        UIImage *fullSizeImage = [self.memoryCache objectForKey:variant.groupKey];
+        if (fullSizeImage && !fullSizeImage._isThumbnail) {
+            image = [variant derivedImageFromImage:fullSizeImage];
+        }
+    }
+    if (image) {
+        [self.memoryCache setObject:image forKey:variant.memoryKey cost:image._memoryCost];
+        [self _addImageVariant:variant];
+    }
+    return image;
+}
+
 - (nullable UIImage *)imageFromDiskCacheForKey:(nullable NSString *)key {
     return [self imageFromDiskCacheForKey:key options:0 context:nil];
 }
@@ -518,11 +629,18 @@ static NSString * _defaultDiskCacheDirectory;
 }
 
 - (nullable UIImage *)diskImageForKey:(nullable NSString *)key data:(nullable NSData *)data options:(LoadImageCacheOptions)options context:(ImageLoaderContext *)context {
+    UIImage *image = [self _decodeDiskImageForKey:key data:data options:options context:context];
+    [self _unarchiveObjectWithImage:image forKey:key];
+    return image;
+}
+
+- (nullable UIImage *)_decodeDiskImageForKey:(nullable NSString *)key data:(nullable NSData *)data options:(LoadImageCacheOptions)options context:(ImageLoaderContext *)context {
     if (!data) {
         return nil;
     }
+    NSTimeInterval startTime = LoadImageCacheStatisticsTimestamp();
     UIImage *image = LoadImageCacheDecodeImageData(data, key, [[self class] imageOptionsFromCacheOptions:options], context);
-    [self _unarchiveObjectWithImage:image forKey:key];
+    [self.statistics recordLatency:LoadImageCacheStatisticsTimestamp() - startTime forMetric:LoadImageCacheLatencyMetricDecode];
     return image;
 }
 
@@ -532,7 +650,11 @@ static NSString * _defaultDiskCacheDirectory;
     }
     // Check extended data
     NSData *extendedData = [self.diskCache extendedDataForKey:key];
-    if (!extendedData) {
+    [self _unarchiveObjectWithImage:image extendedData:extendedData];
+}
+
+- (void)_unarchiveObjectWithImage:(UIImage *)image extendedData:(NSData *)extendedData {
+    if (!image || !extendedData) {
         return;
     }
     id extendedObject;
@@ -584,10 +706,22 @@ static NSString * _defaultDiskCacheDirectory;
         return nil;
     }
     
+    NSTimeInterval startTime = LoadImageCacheStatisticsTimestamp();
+    LoadImageCacheStatistics *statistics = self.statistics;
+    // The decode variant (thumbnail size, scale, first frame only) for memory cache, nil for full size
+    SDImageCacheVariant *variant = [SDImageCacheVariant variantWithKey:key options:[[self class] imageOptionsFromCacheOptions:options] context:context];
     // First check the in-memory cache...
     UIImage *image;
     if (queryCacheType != LoadImageCacheTypeDisk) {
         image = [self imageFromMemoryCacheForKey:key];
+        if (!image && variant) {
+            image = [self imageFromMemoryCacheForVariant:variant key:key];
+        }
+        if (image) {
+            [statistics recordHitForTier:LoadImageCacheStatisticsTierMemory];
+        } else {
+            [statistics recordMissForTier:LoadImageCacheStatisticsTierMemory];
+        }
     }
     
     if (image) {
@@ -612,6 +746,7 @@ static NSString * _defaultDiskCacheDirectory;
 
     BOOL shouldQueryMemoryOnly = (queryCacheType == LoadImageCacheTypeMemory) || (image && !(options & LoadImageCacheQueryMemoryData));
     if (shouldQueryMemoryOnly) {
+        [statistics recordLatency:LoadImageCacheStatisticsTimestamp() - startTime forMetric:LoadImageCacheLatencyMetricQuery];
         if (doneBlock) {
             doneBlock(image, nil, LoadImageCacheTypeMemory);
         }
@@ -635,10 +770,34 @@ static NSString * _defaultDiskCacheDirectory;
             }
         }
         
-        return [self diskImageDataBySearchingAllPathsForKey:key];
+        NSData *diskData = [self diskImageDataBySearchingAllPathsForKey:key];
+        if (!image) {
+            // Only count the disk tier when the image is not from in-memory cache
+            if (diskData) {
+                [statistics recordHitForTier:LoadImageCacheStatisticsTierDisk];
+            } else {
+                [statistics recordMissForTier:LoadImageCacheStatisticsTierDisk];
+            }
+        }
+        [statistics recordBytesRead:diskData.length];
+        return diskData;
+    };
+    
+    // The extended data is read from disk cache, so call this in ioQueue as well
+    NSData* (^queryExtendedDataBlock)(NSData*) = ^NSData*(NSData* diskData) {
+        if (image || !diskData) {
+            return nil;
+        }
+        @synchronized (operation) {
+            if (operation.isCancelled) {
+                return nil;
+            }
+        }
+        return [self.diskCache extendedDataForKey:key];
     };
     
-    UIImage* (^queryDiskImageBlock)(NSData*) = ^UIImage*(NSData* diskData) {
+    // The decoding may run outside ioQueue, do not access disk cache here
+    UIImage* (^queryDiskImageBlock)(NSData*, NSData*) = ^UIImage*(NSData* diskData, NSData* extendedData) {
         @synchronized (operation) {
             if (operation.isCancelled) {
                 return nil;
@@ -655,29 +814,22 @@ static NSString * _defaultDiskCacheDirectory;
                 LoadImageCacheType cacheType = [context[ImageLoaderContextStoreCacheType] integerValue];
                 shouldCacheToMomery = (cacheType == LoadImageCacheTypeAll || cacheType == LoadImageCacheTypeMemory);
             }
-            CGSize thumbnailSize = CGSizeZero;
-            NSValue *thumbnailSizeValue = context[ImageLoaderContextImageThumbnailPixelSize];
-            if (thumbnailSizeValue != nil) {
-        #if SD_MAC
-                thumbnailSize = thumbnailSizeValue.sizeValue;
-        #else
-                thumbnailSize = thumbnailSizeValue.CGSizeValue;
-        #endif
-            }
-            if (thumbnailSize.width > 0 && thumbnailSize.height > 0) {
-                // Query full size cache key which generate a thumbnail, should not write back to full size memory cache
-                shouldCacheToMomery = NO;
-            }
+            // Thumbnail or first frame decoding should not write back to full size memory cache, use the variant key instead
+            NSString *memoryKey = variant ? variant.memoryKey : key;
             // Special case: If user query image in list for the same URL, to avoid decode and write **same** image object into disk cache multiple times, we query and check memory cache here again.
             if (shouldCacheToMomery && self.config.shouldCacheImagesInMemory) {
-                diskImage = [self.memoryCache objectForKey:key];
+                diskImage = [self.memoryCache objectForKey:memoryKey];
             }
             // decode image data only if in-memory cache missed
             if (!diskImage) {
-                diskImage = [self diskImageForKey:key data:diskData options:options context:context];
+                diskImage = [self _decodeDiskImageForKey:key data:diskData options:options context:context];
+                [self _unarchiveObjectWithImage:diskImage extendedData:extendedData];
                 if (shouldCacheToMomery && diskImage && self.config.shouldCacheImagesInMemory) {
                     NSUInteger cost = diskImage._memoryCost;
-                    [self.memoryCache setObject:diskImage forKey:key cost:cost];
+                    [self.memoryCache setObject:diskImage forKey:memoryKey cost:cost];
+                    if (variant) {
+                        [self _addImageVariant:variant];
+                    }
                 }
             }
         }
@@ -690,20 +842,20 @@ static NSString * _defaultDiskCacheDirectory;
         __block UIImage* diskImage;
         dispatch_sync(self.ioQueue, ^{
             diskData = queryDiskDataBlock();
-            diskImage = queryDiskImageBlock(diskData);
+            diskImage = queryDiskImageBlock(diskData, queryExtendedDataBlock(diskData));
         });
+        [statistics recordLatency:LoadImageCacheStatisticsTimestamp() - startTime forMetric:LoadImageCacheLatencyMetricQuery];
         if (doneBlock) {
             doneBlock(diskImage, diskData, LoadImageCacheTypeDisk);
         }
     } else {
-        dispatch_async(self.ioQueue, ^{
-            NSData* diskData = queryDiskDataBlock();
-            UIImage* diskImage = queryDiskImageBlock(diskData);
+        void(^completeBlock)(UIImage*, NSData*) = ^(UIImage *diskImage, NSData *diskData) {
             @synchronized (operation) {
                 if (operation.isCancelled) {
                     return;
                 }
             }
+            [statistics recordLatency:LoadImageCacheStatisticsTimestamp() - startTime forMetric:LoadImageCacheLatencyMetricQuery];
             if (doneBlock) {
                 [(queue ?: SDCallbackQueue.mainQueue) async:^{
                     // Dispatch from IO queue to main queue need time, user may call cancel during the dispatch timing
@@ -716,6 +868,31 @@ static NSString * _defaultDiskCacheDirectory;
                     doneBlock(diskImage, diskData, LoadImageCacheTypeDisk);
                 }];
             }
+        };
+        NSOperationQueuePriority priority = NSOperationQueuePriorityNormal;
+        if (options & LoadImageCacheHighPriority) {
+            priority = NSOperationQueuePriorityHigh;
+        } else if (options & LoadImageCacheLowPriority) {
+            priority = NSOperationQueuePriorityLow;
+        }
+        dispatch_async(self.ioQueue, ^{
+            NSData* diskData = queryDiskDataBlock();
+            if (image || !diskData) {
+                // Nothing to decode
+                completeBlock(queryDiskImageBlock(diskData, nil), diskData);
+                return;
+            }
+            NSData* extendedData = queryExtendedDataBlock(diskData);
+            // Decode in the shared decode executor, do not block the IO queue, and bounded with the download decoding
+            NSOperation *decodeOperation = [[SDImageDecodeExecutor sharedExecutor] addDecodeBlock:^{
+                completeBlock(queryDiskImageBlock(diskData, extendedData), diskData);
+            } priority:priority];
+            @synchronized (operation) {
+                operation.decodeOperation = decodeOperation;
+                if (operation.isCancelled) {
+                    [decodeOperation cancel];
+                }
+            }
         });
     }
     
@@ -739,11 +916,12 @@ static NSString * _defaultDiskCacheDirectory;
 
     if (fromMemory && self.config.shouldCacheImagesInMemory) {
         [self.memoryCache removeObjectForKey:key];
+        [self _removeImageVariantsFromMemoryForKey:key];
     }
 
     if (fromDisk) {
         dispatch_async(self.ioQueue, ^{
-            [self.diskCache removeDataForKey:key];
+            [self _removeImageFromDiskForKey:key];
             
             if (completion) {
                 dispatch_async(dispatch_get_main_queue(), ^{
@@ -762,6 +940,21 @@ static NSString * _defaultDiskCacheDirectory;
     }
     
     [self.memoryCache removeObjectForKey:key];
+    [self _removeImageVariantsFromMemoryForKey:key];
+}
+
+// Record the decode variant stored in memory cache, the variants out of the index limit are removed from memory cache, else they can not be found by the key removal
+- (void)_addImageVariant:(SDImageCacheVariant *)variant {
+    for (SDImageCacheVariant *evictedVariant in [self.variantIndex addVariant:variant]) {
+        [self.memoryCache removeObjectForKey:evictedVariant.memoryKey];
+    }
+}
+
+// Remove all the decode variants (thumbnail, first frame) of the key from memory cache
+- (void)_removeImageVariantsFromMemoryForKey:(NSString *)key {
+    for (SDImageCacheVariant *variant in [self.variantIndex removeVariantsForGroupKey:key]) {
+        [self.memoryCache removeObjectForKey:variant.memoryKey];
+    }
 }
 
 - (void)removeImageFromDiskForKey:(NSString *)key {
@@ -779,18 +972,25 @@ static NSString * _defaultDiskCacheDirectory;
         return;
     }
     
-    [self.diskCache removeDataForKey:key];
+    // Count the removed files, the same unit as the other evictions
+    if ([self.diskCache containsDataForKey:key]) {
+        [self.diskCache removeDataForKey:key];
+        [self.statistics recordEvictionForTier:LoadImageCacheStatisticsTierDisk reason:LoadImageCacheEvictionReasonRemoved count:1];
+    }
 }
 
 #pragma mark - Cache clean Ops
 
 - (void)clearMemory {
     [self.memoryCache removeAllObjects];
+    [self.variantIndex removeAllVariants];
 }
 
 - (void)clearDiskOnCompletion:(nullable ImageLoaderNoParamsBlock)completion {
     dispatch_async(self.ioQueue, ^{
         [self.diskCache removeAllData];
+        // Counting the files need a full directory enumeration, record the clear itself
+        [self.statistics recordEvictionForTier:LoadImageCacheStatisticsTierDisk reason:LoadImageCacheEvictionReasonCleared count:1];
         if (completion) {
             dispatch_async(dispatch_get_main_queue(), ^{
                 completion();
@@ -914,6 +1114,8 @@ static NSString * _defaultDiskCacheDirectory;
     if (options & ImageLoaderDecodeFirstFrameOnly) cacheOptions |= LoadImageCacheDecodeFirstFrameOnly;
     if (options & ImageLoaderPreloadAllFrames) cacheOptions |= LoadImageCachePreloadAllFrames;
     if (options & ImageLoaderMatchAnimatedImageClass) cacheOptions |= LoadImageCacheMatchAnimatedImageClass;
+    if (options & ImageLoaderLowPriority) cacheOptions |= LoadImageCacheLowPriority;
+    if (options & ImageLoaderHighPriority) cacheOptions |= LoadImageCacheHighPriority;
     
     return [self queryCacheOperationForKey:key options:cacheOptions context:context cacheType:cacheType done:completionBlock];
 }
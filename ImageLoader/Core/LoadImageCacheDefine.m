@@ -11,6 +11,7 @@
 #import "LoadImageCoderHelper.h"
 #import "SDAnimatedImage.h"
 #import "UIImage+Metadata.h"
+#import "UIImage+MemoryCacheCost.h"
 #import "SDInternalMacros.h"
 
 #import <CoreServices/CoreServices.h>
@@ -122,6 +123,10 @@ UIImage * _Nullable LoadImageCacheDecodeImageData(NSData * _Nonnull imageData, N
     if (!image) {
         image = [imageCoder decodedImageWithData:imageData options:coderOptions];
     }
+    if (LoadImageCoderHelper.isDecodingCancelled) {
+        // All the requests went away, the result is dropped, do not force decode
+        return nil;
+    }
     if (image) {
         BOOL shouldDecode = !SD_OPTIONS_CONTAINS(options, ImageLoaderAvoidDecodeImage);
         BOOL lazyDecode = [coderOptions[LoadImageCoderDecodeUseLazyDecoding] boolValue];
@@ -134,6 +139,8 @@ UIImage * _Nullable LoadImageCacheDecodeImageData(NSData * _Nonnull imageData, N
         }
         // assign the decode options, to let manager check whether to re-decode if needed
         image._decodeOptions = coderOptions;
+        // calculate the memory cost once, the memory cache use this stored value
+        image._memoryCost = SDMemoryCacheCostForImage(image);
     }
     
     return image;
@@ -0,0 +1,161 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+/// The cache tier for statistics
+typedef NS_ENUM(NSUInteger, LoadImageCacheStatisticsTier) {
+    /**
+     * The memory cache, the hit count include the image resurrected from weak cache.
+     */
+    LoadImageCacheStatisticsTierMemory = 0,
+    /**
+     * The weak memory cache (See `LoadImageCacheConfig.shouldUseWeakMemoryCache`), only hit count is recorded.
+     */
+    LoadImageCacheStatisticsTierWeak,
+    /**
+     * The disk cache.
+     */
+    LoadImageCacheStatisticsTierDisk,
+    /**
+     * The original cache query from `ImageLoaderManager`, when the transformed or thumbnail image cache miss.
+     */
+    LoadImageCacheStatisticsTierOriginal
+};
+
+/// The reason for cache eviction
+typedef NS_ENUM(NSUInteger, LoadImageCacheEvictionReason) {
+    /**
+     * Removed by key, using API like `removeImageForKey:`
+     */
+    LoadImageCacheEvictionReasonRemoved = 0,
+    /**
+     * Clear all, using API like `clearMemory`. For disk cache, each clear is counted as one eviction, because counting the removed files needs a full directory enumeration.
+     */
+    LoadImageCacheEvictionReasonCleared,
+    /**
+     * Memory warning received.
+     */
+    LoadImageCacheEvictionReasonMemoryWarning,
+    /**
+     * Exceed the limit, including memory cost/count limit (or system memory pressure), and disk size limit.
+     */
+    LoadImageCacheEvictionReasonLimit,
+    /**
+     * Disk cache exceed the max age.
+     */
+    LoadImageCacheEvictionReasonExpired
+};
+
+/// The latency metric for statistics
+typedef NS_ENUM(NSUInteger, LoadImageCacheLatencyMetric) {
+    /**
+     * From the query begin, to the query result ready (before the completion block dispatch).
+     */
+    LoadImageCacheLatencyMetricQuery = 0,
+    /**
+     * The image decoding from disk data.
+     */
+    LoadImageCacheLatencyMetricDecode,
+    /**
+     * The disk cache store, including the image encoding if no image data provided.
+     */
+    LoadImageCacheLatencyMetricStore
+};
+
+/**
+ Returns the monotonic timestamp in seconds, used to measure latency for `recordLatency:forMetric:`.
+ */
+FOUNDATION_EXPORT NSTimeInterval LoadImageCacheStatisticsTimestamp(void);
+
+/**
+ An immutable latency histogram, the buckets are log-linear (HDR-style), each power of 2 range is split into 8 sub-buckets, which means the percentile value has 12.5% precision at most.
+ */
+@interface LoadImageCacheLatencyHistogram : NSObject
+
+/// The recorded sample count
+@property (nonatomic, assign, readonly) NSUInteger count;
+/// The minimum latency in seconds, 0 if no sample
+@property (nonatomic, assign, readonly) NSTimeInterval minimum;
+/// The maximum latency in seconds, 0 if no sample
+@property (nonatomic, assign, readonly) NSTimeInterval maximum;
+/// The mean latency in seconds, 0 if no sample
+@property (nonatomic, assign, readonly) NSTimeInterval mean;
+
+/**
+ Returns the latency at the percentile.
+
+ @param percentile The percentile, in range [0, 100]. Like 50 for p50, 99 for p99.
+ @return The latency in seconds, 0 if no sample
+ */
+- (NSTimeInterval)latencyAtPercentile:(double)percentile;
+
+@end
+
+/**
+ An immutable snapshot for the cache statistics. Created by `LoadImageCacheStatistics.snapshot`.
+ */
+@interface LoadImageCacheStatisticsSnapshot : NSObject
+
+/// The hit count for tier
+- (NSUInteger)hitCountForTier:(LoadImageCacheStatisticsTier)tier;
+/// The miss count for tier
+- (NSUInteger)missCountForTier:(LoadImageCacheStatisticsTier)tier;
+/// The hit ratio for tier, in range [0, 1]. 0 if nothing recorded
+- (double)hitRatioForTier:(LoadImageCacheStatisticsTier)tier;
+/// The eviction count for tier and reason. The count is the number of evicted entries (image objects for memory cache, files for disk cache), not the number of eviction events, except the disk cache clear (see `LoadImageCacheEvictionReasonCleared`)
+- (NSUInteger)evictionCountForTier:(LoadImageCacheStatisticsTier)tier reason:(LoadImageCacheEvictionReason)reason;
+/// The latency histogram for metric
+- (nonnull LoadImageCacheLatencyHistogram *)latencyHistogramForMetric:(LoadImageCacheLatencyMetric)metric;
+
+/// The total bytes read from disk cache
+@property (nonatomic, assign, readonly) unsigned long long bytesRead;
+/// The total bytes written to disk cache
+@property (nonatomic, assign, readonly) unsigned long long bytesWritten;
+
+/**
+ Returns a new snapshot which sum all the counters and histograms. Used to aggregate multiple caches' statistics.
+
+ @param snapshot The other snapshot
+ @return The merged snapshot
+ */
+- (nonnull LoadImageCacheStatisticsSnapshot *)snapshotByMergingSnapshot:(nonnull LoadImageCacheStatisticsSnapshot *)snapshot;
+
+@end
+
+/**
+ The statistics recorder for image cache. All the record methods use relaxed atomic counters, which is cheap and can be called from any thread.
+ The `snapshot` is safe to take from any thread as well, but it's not a transaction across all counters (some counters may include a record which others not).
+ */
+@interface LoadImageCacheStatistics : NSObject
+
+/// Record a cache hit for tier
+- (void)recordHitForTier:(LoadImageCacheStatisticsTier)tier;
+/// Record a cache miss for tier
+- (void)recordMissForTier:(LoadImageCacheStatisticsTier)tier;
+/// Record the eviction count for tier and reason
+- (void)recordEvictionForTier:(LoadImageCacheStatisticsTier)tier reason:(LoadImageCacheEvictionReason)reason count:(NSUInteger)count;
+/// Record the bytes read from disk cache
+- (void)recordBytesRead:(NSUInteger)bytes;
+/// Record the bytes written to disk cache
+- (void)recordBytesWritten:(NSUInteger)bytes;
+/// Record the latency in seconds for metric
+- (void)recordLatency:(NSTimeInterval)latency forMetric:(LoadImageCacheLatencyMetric)metric;
+
+/**
+ Take a snapshot of current statistics.
+ */
+- (nonnull LoadImageCacheStatisticsSnapshot *)snapshot;
+
+/**
+ Reset all the counters and histograms to zero.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,343 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "LoadImageCacheStatistics.h"
+#import <stdatomic.h>
+#import <mach/mach_time.h>
+
+#define SD_CACHE_TIER_COUNT (LoadImageCacheStatisticsTierOriginal + 1)
+#define SD_CACHE_EVICTION_REASON_COUNT (LoadImageCacheEvictionReasonExpired + 1)
+#define SD_CACHE_LATENCY_METRIC_COUNT (LoadImageCacheLatencyMetricStore + 1)
+
+// Log-linear buckets, 2^3 sub-buckets for each power of 2, values are in nanoseconds
+#define SD_HISTOGRAM_SUB_BUCKET_BITS 3
+#define SD_HISTOGRAM_SUB_BUCKET_COUNT (1 << SD_HISTOGRAM_SUB_BUCKET_BITS)
+// Up to 2^40 ns (about 18 minutes), larger value are clamped into the last bucket
+#define SD_HISTOGRAM_BUCKET_COUNT ((40 - SD_HISTOGRAM_SUB_BUCKET_BITS + 1) * SD_HISTOGRAM_SUB_BUCKET_COUNT)
+
+static inline NSUInteger SDHistogramBucketIndexForValue(uint64_t value) {
+    if (value < SD_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return (NSUInteger)value;
+    }
+    NSUInteger magnitude = 63 - __builtin_clzll(value);
+    NSUInteger shift = magnitude - SD_HISTOGRAM_SUB_BUCKET_BITS;
+    NSUInteger subIndex = (NSUInteger)((value >> shift) & (SD_HISTOGRAM_SUB_BUCKET_COUNT - 1));
+    NSUInteger index = (shift + 1) * SD_HISTOGRAM_SUB_BUCKET_COUNT + subIndex;
+    return MIN(index, SD_HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+static inline uint64_t SDHistogramLowerValueForBucketIndex(NSUInteger index) {
+    if (index < SD_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return index;
+    }
+    NSUInteger shift = index / SD_HISTOGRAM_SUB_BUCKET_COUNT - 1;
+    NSUInteger subIndex = index % SD_HISTOGRAM_SUB_BUCKET_COUNT;
+    return ((uint64_t)(SD_HISTOGRAM_SUB_BUCKET_COUNT + subIndex)) << shift;
+}
+
+static inline uint64_t SDHistogramUpperValueForBucketIndex(NSUInteger index) {
+    if (index < SD_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return index;
+    }
+    NSUInteger shift = index / SD_HISTOGRAM_SUB_BUCKET_COUNT - 1;
+    return SDHistogramLowerValueForBucketIndex(index) + (((uint64_t)1) << shift) - 1;
+}
+
+NSTimeInterval LoadImageCacheStatisticsTimestamp(void) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    uint64_t nanoseconds = mach_absolute_time() * timebase.numer / timebase.denom;
+    return (NSTimeInterval)nanoseconds / NSEC_PER_SEC;
+}
+
+#pragma mark - Histogram
+
+@interface LoadImageCacheLatencyHistogram () {
+    @package
+    uint64_t _buckets[SD_HISTOGRAM_BUCKET_COUNT];
+    uint64_t _count;
+    uint64_t _sum;
+    uint64_t _min;
+    uint64_t _max;
+}
+
+@end
+
+@implementation LoadImageCacheLatencyHistogram
+
+- (NSUInteger)count {
+    return (NSUInteger)_count;
+}
+
+- (NSTimeInterval)minimum {
+    return (NSTimeInterval)_min / NSEC_PER_SEC;
+}
+
+- (NSTimeInterval)maximum {
+    return (NSTimeInterval)_max / NSEC_PER_SEC;
+}
+
+- (NSTimeInterval)mean {
+    if (_count == 0) {
+        return 0;
+    }
+    return (NSTimeInterval)_sum / _count / NSEC_PER_SEC;
+}
+
+- (NSTimeInterval)latencyAtPercentile:(double)percentile {
+    if (_count == 0) {
+        return 0;
+    }
+    percentile = MIN(MAX(percentile, 0), 100);
+    uint64_t target = (uint64_t)ceil(percentile / 100.0 * _count);
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t cumulative = 0;
+    for (NSUInteger i = 0; i < SD_HISTOGRAM_BUCKET_COUNT; i++) {
+        cumulative += _buckets[i];
+        if (cumulative >= target) {
+            // Use the bucket upper value, clamped by the real recorded range
+            uint64_t value = SDHistogramUpperValueForBucketIndex(i);
+            value = MIN(MAX(value, _min), _max);
+            return (NSTimeInterval)value / NSEC_PER_SEC;
+        }
+    }
+    return (NSTimeInterval)_max / NSEC_PER_SEC;
+}
+
+- (LoadImageCacheLatencyHistogram *)histogramByMergingHistogram:(LoadImageCacheLatencyHistogram *)histogram {
+    LoadImageCacheLatencyHistogram *merged = [LoadImageCacheLatencyHistogram new];
+    for (NSUInteger i = 0; i < SD_HISTOGRAM_BUCKET_COUNT; i++) {
+        merged->_buckets[i] = _buckets[i] + histogram->_buckets[i];
+    }
+    merged->_count = _count + histogram->_count;
+    merged->_sum = _sum + histogram->_sum;
+    if (_count == 0) {
+        merged->_min = histogram->_min;
+    } else if (histogram->_count == 0) {
+        merged->_min = _min;
+    } else {
+        merged->_min = MIN(_min, histogram->_min);
+    }
+    merged->_max = MAX(_max, histogram->_max);
+    return merged;
+}
+
+@end
+
+#pragma mark - Snapshot
+
+@interface LoadImageCacheStatisticsSnapshot () {
+    @package
+    uint64_t _hitCounts[SD_CACHE_TIER_COUNT];
+    uint64_t _missCounts[SD_CACHE_TIER_COUNT];
+    uint64_t _evictionCounts[SD_CACHE_TIER_COUNT][SD_CACHE_EVICTION_REASON_COUNT];
+}
+
+@property (nonatomic, assign, readwrite) unsigned long long bytesRead;
+@property (nonatomic, assign, readwrite) unsigned long long bytesWritten;
+@property (nonatomic, copy) NSArray<LoadImageCacheLatencyHistogram *> *histograms;
+
+@end
+
+@implementation LoadImageCacheStatisticsSnapshot
+
+- (NSUInteger)hitCountForTier:(LoadImageCacheStatisticsTier)tier {
+    if (tier >= SD_CACHE_TIER_COUNT) {
+        return 0;
+    }
+    return (NSUInteger)_hitCounts[tier];
+}
+
+- (NSUInteger)missCountForTier:(LoadImageCacheStatisticsTier)tier {
+    if (tier >= SD_CACHE_TIER_COUNT) {
+        return 0;
+    }
+    return (NSUInteger)_missCounts[tier];
+}
+
+- (double)hitRatioForTier:(LoadImageCacheStatisticsTier)tier {
+    if (tier >= SD_CACHE_TIER_COUNT) {
+        return 0;
+    }
+    uint64_t total = _hitCounts[tier] + _missCounts[tier];
+    if (total == 0) {
+        return 0;
+    }
+    return (double)_hitCounts[tier] / total;
+}
+
+- (NSUInteger)evictionCountForTier:(LoadImageCacheStatisticsTier)tier reason:(LoadImageCacheEvictionReason)reason {
+    if (tier >= SD_CACHE_TIER_COUNT || reason >= SD_CACHE_EVICTION_REASON_COUNT) {
+        return 0;
+    }
+    return (NSUInteger)_evictionCounts[tier][reason];
+}
+
+- (LoadImageCacheLatencyHistogram *)latencyHistogramForMetric:(LoadImageCacheLatencyMetric)metric {
+    if (metric >= SD_CACHE_LATENCY_METRIC_COUNT) {
+        return [LoadImageCacheLatencyHistogram new];
+    }
+    return self.histograms[metric];
+}
+
+- (LoadImageCacheStatisticsSnapshot *)snapshotByMergingSnapshot:(LoadImageCacheStatisticsSnapshot *)snapshot {
+    NSParameterAssert(snapshot);
+    LoadImageCacheStatisticsSnapshot *merged = [LoadImageCacheStatisticsSnapshot new];
+    for (NSUInteger tier = 0; tier < SD_CACHE_TIER_COUNT; tier++) {
+        merged->_hitCounts[tier] = _hitCounts[tier] + snapshot->_hitCounts[tier];
+        merged->_missCounts[tier] = _missCounts[tier] + snapshot->_missCounts[tier];
+        for (NSUInteger reason = 0; reason < SD_CACHE_EVICTION_REASON_COUNT; reason++) {
+            merged->_evictionCounts[tier][reason] = _evictionCounts[tier][reason] + snapshot->_evictionCounts[tier][reason];
+        }
+    }
+    merged.bytesRead = self.bytesRead + snapshot.bytesRead;
+    merged.bytesWritten = self.bytesWritten + snapshot.bytesWritten;
+    NSMutableArray<LoadImageCacheLatencyHistogram *> *histograms = [NSMutableArray arrayWithCapacity:SD_CACHE_LATENCY_METRIC_COUNT];
+    for (NSUInteger metric = 0; metric < SD_CACHE_LATENCY_METRIC_COUNT; metric++) {
+        [histograms addObject:[self.histograms[metric] histogramByMergingHistogram:snapshot.histograms[metric]]];
+    }
+    merged.histograms = histograms;
+    return merged;
+}
+
+- (NSString *)description {
+    LoadImageCacheLatencyHistogram *query = self.histograms[LoadImageCacheLatencyMetricQuery];
+    return [NSString stringWithFormat:@"<%@: %p, memory hit: %lu, weak hit: %lu, disk hit: %lu/%lu, original hit: %lu/%lu, bytes read: %llu, written: %llu, query p50: %.3fms, p99: %.3fms>",
+            NSStringFromClass(self.class), self,
+            (unsigned long)[self hitCountForTier:LoadImageCacheStatisticsTierMemory],
+            (unsigned long)[self hitCountForTier:LoadImageCacheStatisticsTierWeak],
+            (unsigned long)[self hitCountForTier:LoadImageCacheStatisticsTierDisk], (unsigned long)([self hitCountForTier:LoadImageCacheStatisticsTierDisk] + [self missCountForTier:LoadImageCacheStatisticsTierDisk]),
+            (unsigned long)[self hitCountForTier:LoadImageCacheStatisticsTierOriginal], (unsigned long)([self hitCountForTier:LoadImageCacheStatisticsTierOriginal] + [self missCountForTier:LoadImageCacheStatisticsTierOriginal]),
+            self.bytesRead, self.bytesWritten,
+            [query latencyAtPercentile:50] * 1000, [query latencyAtPercentile:99] * 1000];
+}
+
+@end
+
+#pragma mark - Statistics
+
+@implementation LoadImageCacheStatistics {
+    atomic_ullong _hitCounts[SD_CACHE_TIER_COUNT];
+    atomic_ullong _missCounts[SD_CACHE_TIER_COUNT];
+    atomic_ullong _evictionCounts[SD_CACHE_TIER_COUNT][SD_CACHE_EVICTION_REASON_COUNT];
+    atomic_ullong _bytesRead;
+    atomic_ullong _bytesWritten;
+    atomic_ullong _latencyBuckets[SD_CACHE_LATENCY_METRIC_COUNT][SD_HISTOGRAM_BUCKET_COUNT];
+    atomic_ullong _latencySums[SD_CACHE_LATENCY_METRIC_COUNT];
+    atomic_ullong _latencyMins[SD_CACHE_LATENCY_METRIC_COUNT];
+    atomic_ullong _latencyMaxs[SD_CACHE_LATENCY_METRIC_COUNT];
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        [self reset];
+    }
+    return self;
+}
+
+- (void)recordHitForTier:(LoadImageCacheStatisticsTier)tier {
+    if (tier >= SD_CACHE_TIER_COUNT) {
+        return;
+    }
+    atomic_fetch_add_explicit(&_hitCounts[tier], 1, memory_order_relaxed);
+}
+
+- (void)recordMissForTier:(LoadImageCacheStatisticsTier)tier {
+    if (tier >= SD_CACHE_TIER_COUNT) {
+        return;
+    }
+    atomic_fetch_add_explicit(&_missCounts[tier], 1, memory_order_relaxed);
+}
+
+- (void)recordEvictionForTier:(LoadImageCacheStatisticsTier)tier reason:(LoadImageCacheEvictionReason)reason count:(NSUInteger)count {
+    if (tier >= SD_CACHE_TIER_COUNT || reason >= SD_CACHE_EVICTION_REASON_COUNT || count == 0) {
+        return;
+    }
+    atomic_fetch_add_explicit(&_evictionCounts[tier][reason], count, memory_order_relaxed);
+}
+
+- (void)recordBytesRead:(NSUInteger)bytes {
+    atomic_fetch_add_explicit(&_bytesRead, bytes, memory_order_relaxed);
+}
+
+- (void)recordBytesWritten:(NSUInteger)bytes {
+    atomic_fetch_add_explicit(&_bytesWritten, bytes, memory_order_relaxed);
+}
+
+- (void)recordLatency:(NSTimeInterval)latency forMetric:(LoadImageCacheLatencyMetric)metric {
+    if (metric >= SD_CACHE_LATENCY_METRIC_COUNT) {
+        return;
+    }
+    uint64_t value = latency > 0 ? (uint64_t)(latency * NSEC_PER_SEC) : 0;
+    atomic_fetch_add_explicit(&_latencyBuckets[metric][SDHistogramBucketIndexForValue(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_latencySums[metric], value, memory_order_relaxed);
+    uint64_t min = atomic_load_explicit(&_latencyMins[metric], memory_order_relaxed);
+    while (value < min && !atomic_compare_exchange_weak_explicit(&_latencyMins[metric], &min, value, memory_order_relaxed, memory_order_relaxed));
+    uint64_t max = atomic_load_explicit(&_latencyMaxs[metric], memory_order_relaxed);
+    while (value > max && !atomic_compare_exchange_weak_explicit(&_latencyMaxs[metric], &max, value, memory_order_relaxed, memory_order_relaxed));
+}
+
+- (LoadImageCacheStatisticsSnapshot *)snapshot {
+    LoadImageCacheStatisticsSnapshot *snapshot = [LoadImageCacheStatisticsSnapshot new];
+    for (NSUInteger tier = 0; tier < SD_CACHE_TIER_COUNT; tier++) {
+        snapshot->_hitCounts[tier] = atomic_load_explicit(&_hitCounts[tier], memory_order_relaxed);
+        snapshot->_missCounts[tier] = atomic_load_explicit(&_missCounts[tier], memory_order_relaxed);
+        for (NSUInteger reason = 0; reason < SD_CACHE_EVICTION_REASON_COUNT; reason++) {
+            snapshot->_evictionCounts[tier][reason] = atomic_load_explicit(&_evictionCounts[tier][reason], memory_order_relaxed);
+        }
+    }
+    snapshot.bytesRead = atomic_load_explicit(&_bytesRead, memory_order_relaxed);
+    snapshot.bytesWritten = atomic_load_explicit(&_bytesWritten, memory_order_relaxed);
+    NSMutableArray<LoadImageCacheLatencyHistogram *> *histograms = [NSMutableArray arrayWithCapacity:SD_CACHE_LATENCY_METRIC_COUNT];
+    for (NSUInteger metric = 0; metric < SD_CACHE_LATENCY_METRIC_COUNT; metric++) {
+        LoadImageCacheLatencyHistogram *histogram = [LoadImageCacheLatencyHistogram new];
+        uint64_t count = 0;
+        for (NSUInteger i = 0; i < SD_HISTOGRAM_BUCKET_COUNT; i++) {
+            histogram->_buckets[i] = atomic_load_explicit(&_latencyBuckets[metric][i], memory_order_relaxed);
+            count += histogram->_buckets[i];
+        }
+        // Use the bucket sum as count, to keep percentile consistent with buckets
+        histogram->_count = count;
+        histogram->_sum = atomic_load_explicit(&_latencySums[metric], memory_order_relaxed);
+        if (count > 0) {
+            histogram->_min = atomic_load_explicit(&_latencyMins[metric], memory_order_relaxed);
+            histogram->_max = atomic_load_explicit(&_latencyMaxs[metric], memory_order_relaxed);
+        }
+        [histograms addObject:histogram];
+    }
+    snapshot.histograms = histograms;
+    return snapshot;
+}
+
+- (void)reset {
+    for (NSUInteger tier = 0; tier < SD_CACHE_TIER_COUNT; tier++) {
+        atomic_store_explicit(&_hitCounts[tier], 0, memory_order_relaxed);
+        atomic_store_explicit(&_missCounts[tier], 0, memory_order_relaxed);
+        for (NSUInteger reason = 0; reason < SD_CACHE_EVICTION_REASON_COUNT; reason++) {
+            atomic_store_explicit(&_evictionCounts[tier][reason], 0, memory_order_relaxed);
+        }
+    }
+    atomic_store_explicit(&_bytesRead, 0, memory_order_relaxed);
+    atomic_store_explicit(&_bytesWritten, 0, memory_order_relaxed);
+    for (NSUInteger metric = 0; metric < SD_CACHE_LATENCY_METRIC_COUNT; metric++) {
+        for (NSUInteger i = 0; i < SD_HISTOGRAM_BUCKET_COUNT; i++) {
+            atomic_store_explicit(&_latencyBuckets[metric][i], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&_latencySums[metric], 0, memory_order_relaxed);
+        atomic_store_explicit(&_latencyMins[metric], UINT64_MAX, memory_order_relaxed);
+        atomic_store_explicit(&_latencyMaxs[metric], 0, memory_order_relaxed);
+    }
+}
+
+@end
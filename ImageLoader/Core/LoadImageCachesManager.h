@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import "LoadImageCacheDefine.h"
+#import "LoadImageCacheStatistics.h"
 
 /// Policy for cache operation
 typedef NS_ENUM(NSUInteger, LoadImageCachesManagerOperationPolicy) {
@@ -78,4 +79,15 @@ typedef NS_ENUM(NSUInteger, LoadImageCachesManagerOperationPolicy) {
  */
 - (void)removeCache:(nonnull id<LoadImageCache>)cache;
 
+/**
+ The statistics recorder owned by caches manager itself, used to record the tier which is not belong to any of the managed caches (like the original cache query from `ImageLoaderManager`).
+ */
+@property (nonatomic, strong, readonly, nonnull) LoadImageCacheStatistics *statistics;
+
+/**
+ Returns the aggregated statistics snapshot, which merge the caches manager's own statistics and all the caches which provide a `statistics` property (like `LoadImageCache`).
+ The snapshot is safe to take from any thread.
+ */
+- (nonnull LoadImageCacheStatisticsSnapshot *)statisticsSnapshot;
+
 @end
@@ -14,6 +14,7 @@
 @interface LoadImageCachesManager ()
 
 @property (nonatomic, strong, nonnull) NSMutableArray<id<LoadImageCache>> *imageCaches;
+@property (nonatomic, strong, readwrite, nonnull) LoadImageCacheStatistics *statistics;
 
 @end
 
@@ -40,6 +41,7 @@
         self.clearOperationPolicy = LoadImageCachesManagerOperationPolicyConcurrent;
         // initialize with default image caches
         _imageCaches = [NSMutableArray arrayWithObject:[LoadImageCache sharedImageCache]];
+        _statistics = [[LoadImageCacheStatistics alloc] init];
         SD_LOCK_INIT(_cachesLock);
     }
     return self;
@@ -81,6 +83,23 @@
     SD_UNLOCK(_cachesLock);
 }
 
+#pragma mark - Statistics
+
+- (LoadImageCacheStatisticsSnapshot *)statisticsSnapshot {
+    LoadImageCacheStatisticsSnapshot *snapshot = [self.statistics snapshot];
+    for (id<LoadImageCache> cache in self.caches) {
+        if (![cache respondsToSelector:@selector(statistics)]) {
+            continue;
+        }
+        LoadImageCacheStatistics *statistics = [(id)cache statistics];
+        if (![statistics isKindOfClass:[LoadImageCacheStatistics class]]) {
+            continue;
+        }
+        snapshot = [snapshot snapshotByMergingSnapshot:[statistics snapshot]];
+    }
+    return snapshot;
+}
+
 #pragma mark - LoadImageCache
 
 - (id<ImageLoaderOperation>)queryImageForKey:(NSString *)key options:(ImageLoaderOptions)options context:(ImageLoaderContext *)context completion:(LoadImageCacheQueryCompletionBlock)completionBlock {
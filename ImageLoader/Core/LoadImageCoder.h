@@ -256,6 +256,16 @@ FOUNDATION_EXPORT LoadImageCoderOption _Nonnull const LoadImageCoderWebImageCont
  */
 - (nullable UIImage *)incrementalDecodedImageWithOptions:(nullable LoadImageCoderOptions *)options;
 
+@optional
+/**
+ Update the incremental decoding with the image data received since last update only. If implemented, the loader prefer this instead of `updateIncrementalData:finished:`, so the coder can consume the new chunks without accessing the whole downloaded data each time.
+ @note The data may be non-contiguous in memory (backed by `dispatch_data_t`), use `-[NSData enumerateByteRangesUsingBlock:]` to avoid merging the bytes.
+
+ @param data The image data received since last update
+ @param finished Whether the download has finished
+ */
+- (void)appendIncrementalData:(nullable NSData *)data finished:(BOOL)finished;
+
 @end
 
 #pragma mark - Animated Image Provider
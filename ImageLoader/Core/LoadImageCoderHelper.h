@@ -133,6 +133,12 @@ typedef NS_ENUM(NSUInteger, LoadImageCoderDecodeSolution) {
  */
 @property (class, readwrite) NSUInteger defaultScaleDownLimitBytes;
 
+/**
+ Whether the current image decoding is cancelled, because all the requests of the image went away (such as `ImageLoaderCombinedOperation` cancelled).
+ This is available during the decoding of ImageLoader loading system (the disk cache query and the download), and always NO on other threads. The long decoding should check this and stop early, the built-in coders check this between the frames of animated image, and between the tiles when scaling down.
+ */
+@property (class, readonly, getter=isDecodingCancelled) BOOL decodingCancelled;
+
 #if SD_UIKIT || SD_WATCH
 /**
  Convert an EXIF image orientation to an iOS one.
@@ -16,6 +16,7 @@
 #import "UIImage+Metadata.h"
 #import "SDInternalMacros.h"
 #import "SDGraphicsImageRenderer.h"
+#import "SDImageDecodeExecutor.h"
 #import "SDInternalMacros.h"
 #import <Accelerate/Accelerate.h>
 
@@ -428,10 +429,18 @@ static const CGFloat kDestSeemOverlap = 2.0f;   // the numbers of pixels to over
     return CGSizeMake(resultWidth, resultHeight);
 }
 
++ (BOOL)isDecodingCancelled {
+    return SDImageDecodeExecutor.isCurrentDecodeCancelled;
+}
+
 + (UIImage *)decodedImageWithImage:(UIImage *)image {
     if (![self shouldDecodeImage:image]) {
         return image;
     }
+    if (self.isDecodingCancelled) {
+        // The result is dropped
+        return image;
+    }
     
     UIImage *decodedImage;
     LoadImageCoderDecodeSolution decodeSolution = self.defaultDecodeSolution;
@@ -613,6 +622,11 @@ static const CGFloat kDestSeemOverlap = 2.0f;   // the numbers of pixels to over
         sourceTile.size.height += sourceSeemOverlap;
         destTile.size.height += kDestSeemOverlap;
         for( int y = 0; y < iterations; ++y ) {
+            if (self.isDecodingCancelled) {
+                // The result is dropped, stop drawing the remaining tiles
+                CGContextRelease(destContext);
+                return image;
+            }
             sourceTile.origin.y = y * sourceTileHeightMinusOverlap + sourceSeemOverlap;
             destTile.origin.y = destResolution.height - (( y + 1 ) * sourceTileHeightMinusOverlap * imageScale + kDestSeemOverlap);
             sourceTileImageRef = CGImageCreateWithImageInRect( sourceImageRef, sourceTile );
@@ -0,0 +1,30 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "NSData+ImageContentType.h"
+
+/**
+ The image metadata parsed from the file header (the first few KB), without decoding. Which include the format, the pixel size and whether it's animated.
+ The supported formats are JPEG (SOF), PNG (IHDR and acTL), GIF (logical screen descriptor), WebP (VP8, VP8L and VP8X) and HEIF (ispe).
+ */
+@interface LoadImageHeaderInfo : NSObject <NSCopying>
+
+/// The image format
+@property (nonatomic, assign, readonly) LoadImageFormat format;
+/// The pixel size of the image (or the canvas of animated image), without EXIF orientation applied
+@property (nonatomic, assign, readonly) CGSize pixelSize;
+/// The frame count, 1 for static image, 0 means unknown (such as animated GIF and animated WebP, which need the full data to count)
+@property (nonatomic, assign, readonly) NSUInteger frameCount;
+/// Whether the image is animated. For GIF, this is detected by the looping extension, which may be absent for the animated GIF which does not loop
+@property (nonatomic, assign, readonly, getter=isAnimated) BOOL animated;
+
+- (nonnull instancetype)initWithFormat:(LoadImageFormat)format pixelSize:(CGSize)pixelSize frameCount:(NSUInteger)frameCount animated:(BOOL)animated;
+
+@end
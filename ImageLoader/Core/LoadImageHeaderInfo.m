@@ -0,0 +1,48 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "LoadImageHeaderInfo.h"
+
+@implementation LoadImageHeaderInfo
+
+- (instancetype)initWithFormat:(LoadImageFormat)format pixelSize:(CGSize)pixelSize frameCount:(NSUInteger)frameCount animated:(BOOL)animated {
+    self = [super init];
+    if (self) {
+        _format = format;
+        _pixelSize = pixelSize;
+        _frameCount = frameCount;
+        _animated = animated;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    // Immutable
+    return self;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    if (![object isKindOfClass:LoadImageHeaderInfo.class]) {
+        return NO;
+    }
+    LoadImageHeaderInfo *other = object;
+    return self.format == other.format && CGSizeEqualToSize(self.pixelSize, other.pixelSize) && self.frameCount == other.frameCount && self.animated == other.animated;
+}
+
+- (NSUInteger)hash {
+    return (NSUInteger)self.format ^ ((NSUInteger)self.pixelSize.width << 16) ^ (NSUInteger)self.pixelSize.height;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, format: %ld, pixelSize: %.0fx%.0f, frameCount: %lu, animated: %d>", NSStringFromClass(self.class), self, (long)self.format, self.pixelSize.width, self.pixelSize.height, (unsigned long)self.frameCount, self.animated];
+}
+
+@end
@@ -47,6 +47,30 @@ static CGImageRef __nullable SDCGImageCreateCopy(CGImageRef cg_nullable image) {
     return newImage;
 }
 
+// Read the bytes from the non-contiguous data on demand, for the direct data provider of incremental image source
+static size_t SDDataProviderGetBytesAtPosition(void *info, void *buffer, off_t position, size_t count) {
+    NSData *data = (__bridge NSData *)info;
+    NSUInteger length = data.length;
+    if (position < 0 || (NSUInteger)position >= length) {
+        return 0;
+    }
+    NSRange requestRange = NSMakeRange((NSUInteger)position, MIN(count, length - (NSUInteger)position));
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        NSRange overlapRange = NSIntersectionRange(byteRange, requestRange);
+        if (overlapRange.length > 0) {
+            memcpy((uint8_t *)buffer + (overlapRange.location - requestRange.location), (const uint8_t *)bytes + (overlapRange.location - byteRange.location), overlapRange.length);
+        }
+        if (NSMaxRange(byteRange) >= NSMaxRange(requestRange)) {
+            *stop = YES;
+        }
+    }];
+    return requestRange.length;
+}
+
+static void SDDataProviderReleaseInfo(void *info) {
+    CFRelease(info);
+}
+
 static inline CGSize SDCalculateScaleDownPixelSize(NSUInteger limitBytes, CGSize originalSize, NSUInteger frameCount, NSUInteger bytesPerPixel) {
     if (CGSizeEqualToSize(originalSize, CGSizeZero)) return CGSizeMake(1, 1);
     NSUInteger totalFramePixelSize = limitBytes / bytesPerPixel / (frameCount ?: 1);
@@ -183,6 +207,31 @@ static inline CGSize SDCalculateScaleDownPixelSize(NSUInteger limitBytes, CGSize
     return NO;
 }
 
++ (void)updateIncrementalSource:(CGImageSourceRef)source data:(NSData *)data finished:(BOOL)finished {
+    __block NSUInteger rangeCount = 0;
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        rangeCount++;
+        if (rangeCount > 1) {
+            *stop = YES;
+        }
+    }];
+    if (rangeCount <= 1) {
+        CGImageSourceUpdateData(source, (__bridge CFDataRef)data, finished);
+        return;
+    }
+    // The downloaded data is non-contiguous (the chunks in `dispatch_data_t`), let ImageIO read the bytes on demand, instead of merging the whole data on each update
+    CGDataProviderDirectCallbacks callbacks = {0, NULL, NULL, SDDataProviderGetBytesAtPosition, SDDataProviderReleaseInfo};
+    void *info = (__bridge_retained void *)data;
+    CGDataProviderRef provider = CGDataProviderCreateDirect(info, data.length, &callbacks);
+    if (!provider) {
+        CFRelease(info);
+        CGImageSourceUpdateData(source, (__bridge CFDataRef)data, finished);
+        return;
+    }
+    CGImageSourceUpdateDataProvider(source, provider, finished);
+    CGDataProviderRelease(provider);
+}
+
 + (NSUInteger)imageLoopCountWithSource:(CGImageSourceRef)source {
     NSUInteger loopCount = self.defaultLoopCount;
     NSDictionary *imageProperties = (__bridge_transfer NSDictionary *)CGImageSourceCopyProperties(source, NULL);
@@ -458,6 +507,11 @@ static inline CGSize SDCalculateScaleDownPixelSize(NSUInteger limitBytes, CGSize
         NSMutableArray<LoadImageFrame *> *frames = [NSMutableArray arrayWithCapacity:frameCount];
         
         for (size_t i = 0; i < frameCount; i++) {
+            if (LoadImageCoderHelper.isDecodingCancelled) {
+                // Stop decoding the remaining frames
+                CFRelease(source);
+                return nil;
+            }
             UIImage *image = [self.class createFrameAtIndex:i source:source scale:scale preserveAspectRatio:preserveAspectRatio thumbnailSize:thumbnailSize lazyDecode:lazyDecode animatedImage:NO];
             if (!image) {
                 continue;
@@ -546,7 +600,7 @@ static inline CGSize SDCalculateScaleDownPixelSize(NSUInteger limitBytes, CGSize
     // Thanks to the author @Nyx0uf
     
     // Update the data source, we must pass ALL the data, not just the new bytes
-    CGImageSourceUpdateData(_imageSource, (__bridge CFDataRef)data, finished);
+    [self.class updateIncrementalSource:_imageSource data:data finished:finished];
     
     if (_width + _height == 0) {
         CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(_imageSource, 0, NULL);
@@ -273,7 +273,7 @@ static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestination
     // Thanks to the author @Nyx0uf
     
     // Update the data source, we must pass ALL the data, not just the new bytes
-    CGImageSourceUpdateData(_imageSource, (__bridge CFDataRef)data, finished);
+    [LoadImageIOAnimatedCoder updateIncrementalSource:_imageSource data:data finished:finished];
     
     if (_width + _height == 0) {
         CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(_imageSource, 0, NULL);
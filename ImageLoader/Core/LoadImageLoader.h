@@ -40,6 +40,7 @@ FOUNDATION_EXPORT UIImage * _Nullable LoadImageLoaderDecodeImageData(NSData * _N
 /**
  This is the built-in decoding process for image progressive download from network. It's used when `ImageLoaderProgressiveLoad` option is set. (It's not required when your loader does not support progressive image loading)
  @note If you want to implement your custom loader with `requestImageWithURL:options:context:progress:completed:` API, but also want to keep compatible with ImageLoader's behavior, you'd better use this to produce image.
+ @note If the progressive coder implements `appendIncrementalData:finished:`, only the bytes after the previous call for the same operation are passed to it. The image data can be non-contiguous (such as `dispatch_data_t`), the contiguous view is only needed by coder which access the whole data.
 
  @param imageData The image data from the network so far. Should not be nil
  @param imageURL The image URL from the input. Should not be nil
@@ -59,6 +60,7 @@ FOUNDATION_EXPORT id<SDProgressiveImageCoder> _Nullable LoadImageLoaderGetProgre
 
 /**
  This function set the progressive decoder for current loading operation. If no progressive decoding is happended, pass nil.
+ @note When the loading operation restarts the request (such as retry or resume), pass nil to reset the decoder, so the next progressive decoding starts from the new response body.
  @param operation The loading operation to associate the progerssive decoder.
  */
 FOUNDATION_EXPORT void LoadImageLoaderSetProgressiveCoder(id<ImageLoaderOperation> _Nonnull operation, id<SDProgressiveImageCoder> _Nullable progressiveCoder);
@@ -118,7 +120,7 @@ FOUNDATION_EXPORT void LoadImageLoaderSetProgressiveCoder(id<ImageLoaderOperatio
 
 /**
  Whether the error from image loader should be marked indeed un-recoverable or not.
- If this return YES, failed URL which does not using `ImageLoaderRetryFailed` will be blocked into black list. Else not.
+ If this return YES, failed URL which does not using `ImageLoaderRetryFailed` will be blocked into black list, for the backoff from `ImageLoaderManager.failedURLBlockInterval`. Else it's a transient failure, blocked for the shorter backoff from `ImageLoaderManager.failedURLRetryInterval`.
 
  @param url The URL represent the image. Note this may not be a HTTP URL
  @param error The URL's loading error, from previous `requestImageWithURL:options:context:progress:completed:` completedBlock's error.
@@ -130,7 +132,7 @@ FOUNDATION_EXPORT void LoadImageLoaderSetProgressiveCoder(id<ImageLoaderOperatio
 @optional
 /**
  Whether the error from image loader should be marked indeed un-recoverable or not, with associated options and context.
- If this return YES, failed URL which does not using `ImageLoaderRetryFailed` will be blocked into black list. Else not.
+ If this return YES, failed URL which does not using `ImageLoaderRetryFailed` will be blocked into black list, for the backoff from `ImageLoaderManager.failedURLBlockInterval`. Else it's a transient failure, blocked for the shorter backoff from `ImageLoaderManager.failedURLRetryInterval`.
 
  @param url The URL represent the image. Note this may not be a HTTP URL
  @param error The URL's loading error, from previous `requestImageWithURL:options:context:progress:completed:` completedBlock's error.
@@ -12,6 +12,7 @@
 #import "LoadImageCoderHelper.h"
 #import "SDAnimatedImage.h"
 #import "UIImage+Metadata.h"
+#import "UIImage+MemoryCacheCost.h"
 #import "SDInternalMacros.h"
 #import "LoadImageCacheDefine.h"
 #import "objc/runtime.h"
@@ -19,6 +20,7 @@
 ImageLoaderContextOption const ImageLoaderContextLoaderCachedImage = @"loaderCachedImage";
 
 static void * LoadImageLoaderProgressiveCoderKey = &LoadImageLoaderProgressiveCoderKey;
+static void * LoadImageLoaderProgressiveDataLengthKey = &LoadImageLoaderProgressiveDataLengthKey;
 
 id<SDProgressiveImageCoder> LoadImageLoaderGetProgressiveCoder(id<ImageLoaderOperation> operation) {
     NSCParameterAssert(operation);
@@ -30,6 +32,15 @@ void LoadImageLoaderSetProgressiveCoder(id<ImageLoaderOperation> operation, id<S
     objc_setAssociatedObject(operation, LoadImageLoaderProgressiveCoderKey, progressiveCoder, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
 }
 
+// The data length which already passed to `appendIncrementalData:finished:`. Stored on the coder, so a new coder (when the task restarted) always starts from zero
+static NSUInteger LoadImageLoaderGetProgressiveDataLength(id<SDProgressiveImageCoder> progressiveCoder) {
+    return [objc_getAssociatedObject(progressiveCoder, LoadImageLoaderProgressiveDataLengthKey) unsignedIntegerValue];
+}
+
+static void LoadImageLoaderSetProgressiveDataLength(id<SDProgressiveImageCoder> progressiveCoder, NSUInteger length) {
+    objc_setAssociatedObject(progressiveCoder, LoadImageLoaderProgressiveDataLengthKey, @(length), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
 UIImage * _Nullable LoadImageLoaderDecodeImageData(NSData * _Nonnull imageData, NSURL * _Nonnull imageURL, ImageLoaderOptions options, ImageLoaderContext * _Nullable context) {
     NSCParameterAssert(imageData);
     NSCParameterAssert(imageURL);
@@ -73,6 +84,10 @@ UIImage * _Nullable LoadImageLoaderDecodeImageData(NSData * _Nonnull imageData,
     if (!image) {
         image = [imageCoder decodedImageWithData:imageData options:coderOptions];
     }
+    if (LoadImageCoderHelper.isDecodingCancelled) {
+        // All the requests went away, the result is dropped, do not force decode
+        return nil;
+    }
     if (image) {
         BOOL shouldDecode = !SD_OPTIONS_CONTAINS(options, ImageLoaderAvoidDecodeImage);
         BOOL lazyDecode = [coderOptions[LoadImageCoderDecodeUseLazyDecoding] boolValue];
@@ -85,6 +100,8 @@ UIImage * _Nullable LoadImageLoaderDecodeImageData(NSData * _Nonnull imageData,
         }
         // assign the decode options, to let manager check whether to re-decode if needed
         image._decodeOptions = coderOptions;
+        // calculate the memory cost once, the memory cache use this stored value
+        image._memoryCost = SDMemoryCacheCostForImage(image);
     }
     
     return image;
@@ -131,7 +148,15 @@ UIImage * _Nullable LoadImageLoaderDecodeProgressiveImageData(NSData * _Nonnull
         return nil;
     }
     
-    [progressiveCoder updateIncrementalData:imageData finished:finished];
+    if ([progressiveCoder respondsToSelector:@selector(appendIncrementalData:finished:)]) {
+        // Only pass the new chunks, the subdata of dispatch data does not copy bytes
+        NSUInteger consumedLength = MIN(LoadImageLoaderGetProgressiveDataLength(progressiveCoder), imageData.length);
+        NSData *incrementalData = [imageData subdataWithRange:NSMakeRange(consumedLength, imageData.length - consumedLength)];
+        [progressiveCoder appendIncrementalData:incrementalData finished:finished];
+        LoadImageLoaderSetProgressiveDataLength(progressiveCoder, imageData.length);
+    } else {
+        [progressiveCoder updateIncrementalData:imageData finished:finished];
+    }
     if (!decodeFirstFrame) {
         // check whether we should use `SDAnimatedImage`
         Class animatedImageClass = context[ImageLoaderContextAnimatedImageClass];
@@ -150,6 +175,10 @@ UIImage * _Nullable LoadImageLoaderDecodeProgressiveImageData(NSData * _Nonnull
     if (!image) {
         image = [progressiveCoder incrementalDecodedImageWithOptions:coderOptions];
     }
+    if (LoadImageCoderHelper.isDecodingCancelled) {
+        // All the requests went away, the result is dropped, do not force decode
+        return nil;
+    }
     if (image) {
         BOOL shouldDecode = !SD_OPTIONS_CONTAINS(options, ImageLoaderAvoidDecodeImage);
         BOOL lazyDecode = [coderOptions[LoadImageCoderDecodeUseLazyDecoding] boolValue];
@@ -182,6 +182,8 @@ static CGFloat LoadImageScaleFromPath(NSString *string) {
         }
         self.loadedAnimatedImageFrames = frames;
         self.allFramesLoaded = YES;
+        // Frame buffers are now hold in memory, update the memory cost
+        self._memoryCost = SDMemoryCacheCostForImage(self);
     }
 }
 
@@ -192,6 +194,7 @@ static CGFloat LoadImageScaleFromPath(NSString *string) {
     if (self.isAllFramesLoaded) {
         self.loadedAnimatedImageFrames = nil;
         self.allFramesLoaded = NO;
+        self._memoryCost = SDMemoryCacheCostForImage(self);
     }
 }
 
@@ -275,30 +278,6 @@ static CGFloat LoadImageScaleFromPath(NSString *string) {
 
 @end
 
-@implementation SDAnimatedImage (MemoryCacheCost)
-
-- (NSUInteger)_memoryCost {
-    NSNumber *value = objc_getAssociatedObject(self, @selector(_memoryCost));
-    if (value != nil) {
-        return value.unsignedIntegerValue;
-    }
-    
-    CGImageRef imageRef = self.CGImage;
-    if (!imageRef) {
-        return 0;
-    }
-    NSUInteger bytesPerFrame = CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
-    NSUInteger frameCount = 1;
-    if (self.isAllFramesLoaded) {
-        frameCount = self.animatedImageFrameCount;
-    }
-    frameCount = frameCount > 0 ? frameCount : 1;
-    NSUInteger cost = bytesPerFrame * frameCount;
-    return cost;
-}
-
-@end
-
 @implementation SDAnimatedImage (Metadata)
 
 - (BOOL)_isAnimated {
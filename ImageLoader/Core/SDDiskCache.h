@@ -9,6 +9,7 @@
 #import "ImageLoaderCompat.h"
 
 @class LoadImageCacheConfig;
+@class LoadImageCacheStatistics;
 /**
  A protocol to allow custom disk cache used in LoadImageCache.
  */
@@ -117,6 +118,33 @@
  */
 - (NSUInteger)totalSize;
 
+@optional
+/**
+ Create a new staging file for the key, which can be written progressively (such as streaming a large download). The staging file is not visible to `dataForKey:` until committed.
+ This method may blocks the calling thread until file create finished.
+
+ @param key A string identifying the value
+ @return The staging file path. Or nil if failed
+ */
+- (nullable NSString *)stagingPathForKey:(nonnull NSString *)key;
+
+/**
+ Commit the staging file as the data for the key, replace the existing one. The staging file is moved, not copied.
+ This method may blocks the calling thread until file move finished.
+
+ @param stagingPath The staging file path returned by `stagingPathForKey:`
+ @param key A string identifying the value
+ @return YES if committed, NO if failed and the staging file is not changed
+ */
+- (BOOL)commitStagingPath:(nonnull NSString *)stagingPath forKey:(nonnull NSString *)key;
+
+/**
+ Remove the staging file which is not committed.
+
+ @param stagingPath The staging file path returned by `stagingPathForKey:`
+ */
+- (void)removeStagingPath:(nonnull NSString *)stagingPath;
+
 @end
 
 /**
@@ -128,6 +156,12 @@
  */
 @property (nonatomic, strong, readonly, nonnull) LoadImageCacheConfig *config;
 
+/**
+ The statistics recorder to report the expired and size limit eviction count during `removeExpiredData`. Set by `LoadImageCache` when the disk cache created.
+ Defaults to nil.
+ */
+@property (nonatomic, strong, nullable) LoadImageCacheStatistics *statistics;
+
 - (nonnull instancetype)init NS_UNAVAILABLE;
 
 /**
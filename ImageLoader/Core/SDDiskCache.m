@@ -9,9 +9,15 @@
 #import "SDDiskCache.h"
 #import "LoadImageCacheConfig.h"
 #import "SDFileAttributeHelper.h"
+#import "LoadImageCacheStatistics.h"
+#import "SDPartialDownloadStore.h"
 #import <CommonCrypto/CommonDigest.h>
 
 static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDiskCache";
+// Hidden directory, skipped by the expired data enumeration
+static NSString * const SDDiskCacheStagingDirectoryName = @".staging";
+// The staging file (and partial download) is abandoned if not modified for a long time, such as the app was killed during downloading
+static const NSTimeInterval SDDiskCacheStagingMaxAge = 60 * 60 * 24;
 
 @interface SDDiskCache ()
 
@@ -123,8 +129,18 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
 }
 
 - (void)removeAllData {
-    [self.fileManager removeItemAtPath:self.diskCachePath error:nil];
-    [self createDirectory];
+    NSArray<NSString *> *fileNames = [self.fileManager contentsOfDirectoryAtPath:self.diskCachePath error:nil];
+    if (!fileNames) {
+        [self createDirectory];
+        return;
+    }
+    for (NSString *fileName in fileNames) {
+        // The running downloads are writing into the staging files, which are committed (or removed) by themselves
+        if ([fileName isEqualToString:SDDiskCacheStagingDirectoryName]) {
+            continue;
+        }
+        [self.fileManager removeItemAtPath:[self.diskCachePath stringByAppendingPathComponent:fileName] error:nil];
+    }
 }
 
 - (void)createDirectory {
@@ -201,9 +217,13 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
         cacheFiles[fileURL] = resourceValues;
     }
     
+    NSUInteger expiredCount = 0;
     for (NSURL *fileURL in urlsToDelete) {
-        [self.fileManager removeItemAtURL:fileURL error:nil];
+        if ([self.fileManager removeItemAtURL:fileURL error:nil]) {
+            expiredCount++;
+        }
     }
+    [self.statistics recordEvictionForTier:LoadImageCacheStatisticsTierDisk reason:LoadImageCacheEvictionReasonExpired count:expiredCount];
     
     // If our remaining disk cache exceeds a configured maximum size, perform a second
     // size-based cleanup pass.  We delete the oldest files first.
@@ -219,8 +239,10 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
                                                                  }];
         
         // Delete files until we fall below our desired cache size.
+        NSUInteger limitCount = 0;
         for (NSURL *fileURL in sortedFiles) {
             if ([self.fileManager removeItemAtURL:fileURL error:nil]) {
+                limitCount++;
                 NSDictionary<NSString *, id> *resourceValues = cacheFiles[fileURL];
                 NSNumber *totalAllocatedSize = resourceValues[NSURLTotalFileAllocatedSizeKey];
                 currentCacheSize -= totalAllocatedSize.unsignedIntegerValue;
@@ -230,6 +252,24 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
                 }
             }
         }
+        [self.statistics recordEvictionForTier:LoadImageCacheStatisticsTierDisk reason:LoadImageCacheEvictionReasonLimit count:limitCount];
+    }
+    
+    [self removeAbandonedStagingFiles];
+}
+
+- (void)removeAbandonedStagingFiles {
+    NSDate *abandonedDate = [NSDate dateWithTimeIntervalSinceNow:-SDDiskCacheStagingMaxAge];
+    for (NSString *directoryName in @[SDDiskCacheStagingDirectoryName, SDPartialDownloadDirectoryName]) {
+        NSURL *stagingURL = [NSURL fileURLWithPath:[self.diskCachePath stringByAppendingPathComponent:directoryName] isDirectory:YES];
+        NSArray<NSURL *> *stagingFiles = [self.fileManager contentsOfDirectoryAtURL:stagingURL includingPropertiesForKeys:@[NSURLContentModificationDateKey] options:0 error:nil];
+        for (NSURL *fileURL in stagingFiles) {
+            NSDate *modifiedDate;
+            [fileURL getResourceValue:&modifiedDate forKey:NSURLContentModificationDateKey error:nil];
+            if (modifiedDate && [modifiedDate compare:abandonedDate] == NSOrderedAscending) {
+                [self.fileManager removeItemAtURL:fileURL error:nil];
+            }
+        }
     }
 }
 
@@ -238,10 +278,47 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
     return [self cachePathForKey:key inPath:self.diskCachePath];
 }
 
+#pragma mark - Staging
+
+- (nullable NSString *)stagingPathForKey:(NSString *)key {
+    NSParameterAssert(key);
+    NSString *stagingDirectory = [self.diskCachePath stringByAppendingPathComponent:SDDiskCacheStagingDirectoryName];
+    [self.fileManager createDirectoryAtPath:stagingDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+    // The same key may be downloading concurrently, use unique file name
+    NSString *fileName = [NSString stringWithFormat:@"%@-%@", [self cachePathForKey:key].lastPathComponent, [NSUUID UUID].UUIDString];
+    NSString *stagingPath = [stagingDirectory stringByAppendingPathComponent:fileName];
+    if (![self.fileManager createFileAtPath:stagingPath contents:nil attributes:nil]) {
+        return nil;
+    }
+    return stagingPath;
+}
+
+- (BOOL)commitStagingPath:(NSString *)stagingPath forKey:(NSString *)key {
+    NSParameterAssert(stagingPath);
+    NSParameterAssert(key);
+    NSString *cachePathForKey = [self cachePathForKey:key];
+    // `rename` replace the existing file atomically, the reader which mapped the old file is not affected
+    return rename(stagingPath.fileSystemRepresentation, cachePathForKey.fileSystemRepresentation) == 0;
+}
+
+- (void)removeStagingPath:(NSString *)stagingPath {
+    NSParameterAssert(stagingPath);
+    [self.fileManager removeItemAtPath:stagingPath error:nil];
+}
+
+// The staging files and partial downloads are not the cache data yet
+- (BOOL)isInternalDirectoryName:(NSString *)fileName {
+    return [fileName isEqualToString:SDDiskCacheStagingDirectoryName] || [fileName isEqualToString:SDPartialDownloadDirectoryName];
+}
+
 - (NSUInteger)totalSize {
     NSUInteger size = 0;
     NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtPath:self.diskCachePath];
     for (NSString *fileName in fileEnumerator) {
+        if ([self isInternalDirectoryName:fileName]) {
+            [fileEnumerator skipDescendants];
+            continue;
+        }
         NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:fileName];
         NSDictionary<NSString *, id> *attrs = [self.fileManager attributesOfItemAtPath:filePath error:nil];
         size += [attrs fileSize];
@@ -252,7 +329,13 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
 - (NSUInteger)totalCount {
     NSUInteger count = 0;
     NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtPath:self.diskCachePath];
-    count = fileEnumerator.allObjects.count;
+    for (NSString *fileName in fileEnumerator) {
+        if ([self isInternalDirectoryName:fileName]) {
+            [fileEnumerator skipDescendants];
+            continue;
+        }
+        count++;
+    }
     return count;
 }
 
@@ -9,6 +9,7 @@
 #import "ImageLoaderCompat.h"
 
 @class LoadImageCacheConfig;
+@class LoadImageCacheStatistics;
 /**
  A protocol to allow custom memory cache used in LoadImageCache.
  */
@@ -70,9 +71,22 @@
 
 /**
  A memory cache which auto purge the cache on memory warning and support weak cache.
+ @note The memory cache observes the eviction to record statistics, the `delegate` you set is still called for each eviction.
  */
 @interface SDMemoryCache <KeyType, ObjectType> : NSCache <KeyType, ObjectType> <SDMemoryCache>
 
 @property (nonatomic, strong, nonnull, readonly) LoadImageCacheConfig *config;
 
+/**
+ The count of memory cache miss which is resurrected from the weak cache (See `LoadImageCacheConfig.shouldUseWeakMemoryCache`).
+ The weak cache read is lock-free, and the resurrected object re-use the cost when it was stored. Only available on UIKit platform, else return 0.
+ */
+@property (nonatomic, assign, readonly) NSUInteger weakCacheHitCount;
+
+/**
+ The statistics recorder to report the weak cache hit, and the evicted object count for each reason (removal, clear, memory warning and cost/count limit). Set by `LoadImageCache` when the memory cache created.
+ Defaults to nil.
+ */
+@property (nonatomic, strong, nullable) LoadImageCacheStatistics *statistics;
+
 @end
@@ -8,20 +8,23 @@
 
 #import "SDMemoryCache.h"
 #import "LoadImageCacheConfig.h"
-#import "UIImage+MemoryCacheCost.h"
 #import "SDInternalMacros.h"
+#import "SDWeakCacheMap.h"
+#import "LoadImageCacheStatistics.h"
+#import "SDMemoryCacheCostTracker.h"
 
 static void * SDMemoryCacheContext = &SDMemoryCacheContext;
+// The eviction reason on current thread, NSCache call the delegate for each object evicted automatically (limit or system memory pressure) or removed explicitly
+static _Thread_local LoadImageCacheEvictionReason SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonLimit;
+// The object which is re-set with the new cost on current thread, its replacement is not an eviction
+static _Thread_local __unsafe_unretained id SDMemoryCacheUpdatingObject;
 
-@interface SDMemoryCache <KeyType, ObjectType> () {
-#if SD_UIKIT
-    SD_LOCK_DECLARE(_weakCacheLock); // a lock to keep the access to `weakCache` thread-safe
-#endif
-}
+@interface SDMemoryCache <KeyType, ObjectType> () <NSCacheDelegate>
 
 @property (nonatomic, strong, nullable) LoadImageCacheConfig *config;
+@property (nonatomic, weak, nullable) id<NSCacheDelegate> externalDelegate; // the delegate set by caller, NSCache's delegate is always self
 #if SD_UIKIT
-@property (nonatomic, strong, nonnull) NSMapTable<KeyType, ObjectType> *weakCache; // strong-weak cache
+@property (nonatomic, strong, nonnull) SDWeakCacheMap<KeyType, ObjectType> *weakCache; // strong-weak cache, lock-free read
 #endif
 @end
 
@@ -33,7 +36,7 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 #if SD_UIKIT
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
 #endif
-    self.delegate = nil;
+    [super setDelegate:nil];
 }
 
 - (instancetype)init {
@@ -58,13 +61,14 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
     LoadImageCacheConfig *config = self.config;
     self.totalCostLimit = config.maxMemoryCost;
     self.countLimit = config.maxMemoryCount;
+    // Observe the eviction, the caller's delegate is forwarded, see `setDelegate:`
+    [super setDelegate:self];
 
     [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) options:0 context:SDMemoryCacheContext];
     [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) options:0 context:SDMemoryCacheContext];
 
 #if SD_UIKIT
-    self.weakCache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:0];
-    SD_LOCK_INIT(_weakCacheLock);
+    self.weakCache = [[SDWeakCacheMap alloc] init];
 
     [[NSNotificationCenter defaultCenter] addObserver:self
                                              selector:@selector(didReceiveMemoryWarning:)
@@ -77,20 +81,21 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 #if SD_UIKIT
 - (void)didReceiveMemoryWarning:(NSNotification *)notification {
     // Only remove cache, but keep weak cache
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonMemoryWarning;
     [super removeAllObjects];
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonLimit;
 }
 
 // `setObject:forKey:` just call this with 0 cost. Override this is enough
 - (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g {
     [super setObject:obj forKey:key cost:g];
+    [self trackCostOfObject:obj forKey:key];
     if (!self.config.shouldUseWeakMemoryCache) {
         return;
     }
     if (key && obj) {
-        // Store weak cache
-        SD_LOCK(_weakCacheLock);
-        [self.weakCache setObject:obj forKey:key];
-        SD_UNLOCK(_weakCacheLock);
+        // Store weak cache, keep the cost to use when resurrected
+        [self.weakCache setObject:obj forKey:key cost:g];
     }
 }
 
@@ -101,15 +106,11 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
     }
     if (key && !obj) {
         // Check weak cache
-        SD_LOCK(_weakCacheLock);
-        obj = [self.weakCache objectForKey:key];
-        SD_UNLOCK(_weakCacheLock);
+        NSUInteger cost = 0;
+        obj = [self.weakCache objectForKey:key cost:&cost];
         if (obj) {
-            // Sync cache
-            NSUInteger cost = 0;
-            if ([obj isKindOfClass:[UIImage class]]) {
-                cost = [(UIImage *)obj _memoryCost];
-            }
+            [self.statistics recordHitForTier:LoadImageCacheStatisticsTierWeak];
+            // Sync cache, with the cost stored before
             [super setObject:obj forKey:key cost:cost];
         }
     }
@@ -117,30 +118,98 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 }
 
 - (void)removeObjectForKey:(id)key {
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonRemoved;
     [super removeObjectForKey:key];
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonLimit;
     if (!self.config.shouldUseWeakMemoryCache) {
         return;
     }
     if (key) {
         // Remove weak cache
-        SD_LOCK(_weakCacheLock);
         [self.weakCache removeObjectForKey:key];
-        SD_UNLOCK(_weakCacheLock);
     }
 }
 
 - (void)removeAllObjects {
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonCleared;
     [super removeAllObjects];
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonLimit;
     if (!self.config.shouldUseWeakMemoryCache) {
         return;
     }
     // Manually remove should also remove weak cache
-    SD_LOCK(_weakCacheLock);
     [self.weakCache removeAllObjects];
-    SD_UNLOCK(_weakCacheLock);
+}
+
+- (NSUInteger)weakCacheHitCount {
+    return self.weakCache.hitCount;
+}
+#else
+- (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g {
+    [super setObject:obj forKey:key cost:g];
+    [self trackCostOfObject:obj forKey:key];
+}
+
+- (void)removeObjectForKey:(id)key {
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonRemoved;
+    [super removeObjectForKey:key];
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonLimit;
+}
+
+- (void)removeAllObjects {
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonCleared;
+    [super removeAllObjects];
+    SDMemoryCacheEvictionReason = LoadImageCacheEvictionReasonLimit;
+}
+
+- (NSUInteger)weakCacheHitCount {
+    return 0;
 }
 #endif
 
+#pragma mark - Cost
+
+- (void)trackCostOfObject:(id)obj forKey:(id)key {
+    if (key && [obj isKindOfClass:[UIImage class]]) {
+        // The image cost may change later, such as animated image preload frames
+        [SDMemoryCacheCostTracker trackImage:obj inCache:self forKey:key];
+    }
+}
+
+- (void)sd_updateCost:(NSUInteger)cost ofObject:(id)object forKey:(id)key {
+    // Do not resurrect from weak cache, only update the object still in cache
+    if ([super objectForKey:key] != object) {
+        return;
+    }
+    SDMemoryCacheUpdatingObject = object;
+    [self setObject:object forKey:key cost:cost];
+    SDMemoryCacheUpdatingObject = nil;
+}
+
+#pragma mark - NSCacheDelegate
+
+- (id<NSCacheDelegate>)delegate {
+    return self.externalDelegate;
+}
+
+- (void)setDelegate:(id<NSCacheDelegate>)delegate {
+    // Keep observing the eviction, and forward to the caller's delegate
+    self.externalDelegate = delegate;
+}
+
+- (void)cache:(NSCache *)cache willEvictObject:(id)obj {
+    if (obj == SDMemoryCacheUpdatingObject) {
+        // Replaced by itself with the new cost
+        return;
+    }
+    // Count the evicted objects, the reason is limit (or system memory pressure) unless marked by the explicit removal
+    [self.statistics recordEvictionForTier:LoadImageCacheStatisticsTierMemory reason:SDMemoryCacheEvictionReason count:1];
+    id<NSCacheDelegate> delegate = self.externalDelegate;
+    if ([delegate respondsToSelector:@selector(cache:willEvictObject:)]) {
+        [delegate cache:cache willEvictObject:obj];
+    }
+}
+
 #pragma mark - KVO
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
@@ -19,9 +19,22 @@
  
  For `UIImage`, this method return the single frame bytes size when `image.images` is nil for static image. Return full frame bytes size when `image.images` is not nil for animated image.
  For `NSImage`, this method return the single frame bytes size because `NSImage` does not store all frames in memory.
+ For `SDAnimatedImage`, this method return the bytes size of the loaded frames (all frames when preloaded, else first frame only), plus the retained encoded animated image data.
+ @note The value is calculated once (see `SDMemoryCacheCostForImage`) and then stored on the image. The decode process of ImageLoader store it when the image is created, and `SDAnimatedImage` update it when frames are preloaded or unloaded.
+ @note `SDMemoryCache` stores the image with this value as cost, and when the value changes later (such as `preloadAllFrames` or `unloadAllFrames`), the image is re-set with the new cost under the same keys.
  @note Note that because of the limitations of category this property can get out of sync if you create another instance with CGImage or other methods.
  @note For custom animated class conforms to `SDAnimatedImage`, you can override this getter method in your subclass to return a more proper value instead, which representing the current frame's total bytes.
  */
 @property (assign, nonatomic) NSUInteger _memoryCost;
 
 @end
+
+/**
+ Calculate the exact memory cost for the image, without reading the stored `_memoryCost` value.
+ The cost is the bytes-per-row * height * unique frame count. For image without CGImage backing (like CIImage based), the cost use the pixel size with 4 bytes per pixel.
+ For image conforms to `SDAnimatedImage`, the unique frame count is the loaded frame count, and the length of `animatedImageData` is added as well.
+
+ @param image The image to calculate
+ @return The memory cost in bytes
+ */
+FOUNDATION_EXPORT NSUInteger SDMemoryCacheCostForImage(UIImage * _Nullable image);
@@ -9,21 +9,60 @@
 #import "UIImage+MemoryCacheCost.h"
 #import "objc/runtime.h"
 #import "NSImage+Compatibility.h"
+#import "UIImage+Metadata.h"
+#import "SDAnimatedImage.h"
+#import "SDMemoryCacheCostTracker.h"
 
-FOUNDATION_STATIC_INLINE NSUInteger SDMemoryCacheCostForImage(UIImage *image) {
+FOUNDATION_STATIC_INLINE NSUInteger SDMemoryCacheBytesPerFrameForImage(UIImage *image) {
     CGImageRef imageRef = image.CGImage;
-    if (!imageRef) {
+    if (imageRef) {
+        return CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
+    }
+    // Non-CGImage backing (CIImage, etc), use the pixel size with 4 bytes per pixel (RGBA8888)
+    CGFloat scale = MAX(image.scale, 1);
+    NSUInteger pixelWidth = (NSUInteger)ceil(image.size.width * scale);
+    NSUInteger pixelHeight = (NSUInteger)ceil(image.size.height * scale);
+    return pixelWidth * pixelHeight * 4;
+}
+
+#if SD_UIKIT || SD_WATCH
+// The unique frame count of `_UIAnimatedImage`, the same frame may appear non-adjacent (like A, B, A), so compare all frames by identity
+FOUNDATION_STATIC_INLINE NSUInteger SDMemoryCacheUniqueFrameCountForImage(UIImage *image) {
+    NSArray<UIImage *> *animatedImages = image.images;
+    if (animatedImages.count <= 1) {
+        return 1;
+    }
+    NSHashTable<UIImage *> *uniqueImages = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsObjectPointerPersonality capacity:animatedImages.count];
+    for (UIImage *animatedImage in animatedImages) {
+        [uniqueImages addObject:animatedImage];
+    }
+    return uniqueImages.count;
+}
+#endif
+
+NSUInteger SDMemoryCacheCostForImage(UIImage *image) {
+    if (!image) {
         return 0;
     }
-    NSUInteger bytesPerFrame = CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
-    NSUInteger frameCount;
+    NSUInteger bytesPerFrame = SDMemoryCacheBytesPerFrameForImage(image);
+    NSUInteger frameCount = 1;
+    NSUInteger encodedBytes = 0;
+    if ([image conformsToProtocol:@protocol(SDAnimatedImage)]) {
+        // `SDAnimatedImage` decode frames just in time, only the preloaded frames are hold in memory, as well as the encoded data
+        id<SDAnimatedImage> animatedImage = (id<SDAnimatedImage>)image;
+        if ([animatedImage respondsToSelector:@selector(isAllFramesLoaded)] && animatedImage.isAllFramesLoaded) {
+            frameCount = MAX(animatedImage.animatedImageFrameCount, 1);
+        }
+        encodedBytes = animatedImage.animatedImageData.length;
+    } else {
 #if SD_MAC
-    frameCount = 1;
+        frameCount = 1;
 #elif SD_UIKIT || SD_WATCH
-    // Filter the same frame in `_UIAnimatedImage`.
-    frameCount = image.images.count > 1 ? [NSSet setWithArray:image.images].count : 1;
+        // Filter the same frame in `_UIAnimatedImage`
+        frameCount = SDMemoryCacheUniqueFrameCountForImage(image);
 #endif
-    NSUInteger cost = bytesPerFrame * frameCount;
+    }
+    NSUInteger cost = bytesPerFrame * frameCount + encodedBytes;
     return cost;
 }
 
@@ -31,17 +70,22 @@ FOUNDATION_STATIC_INLINE NSUInteger SDMemoryCacheCostForImage(UIImage *image) {
 
 - (NSUInteger)_memoryCost {
     NSNumber *value = objc_getAssociatedObject(self, @selector(_memoryCost));
-    NSUInteger memoryCost;
     if (value != nil) {
-        memoryCost = [value unsignedIntegerValue];
-    } else {
-        memoryCost = SDMemoryCacheCostForImage(self);
+        return [value unsignedIntegerValue];
     }
+    // Not created from the decode process, calculate once and store it
+    NSUInteger memoryCost = SDMemoryCacheCostForImage(self);
+    self._memoryCost = memoryCost;
     return memoryCost;
 }
 
 - (void)set_memoryCost:(NSUInteger)_memoryCost {
+    NSNumber *previousValue = objc_getAssociatedObject(self, @selector(_memoryCost));
     objc_setAssociatedObject(self, @selector(_memoryCost), @(_memoryCost), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    if (previousValue != nil && previousValue.unsignedIntegerValue != _memoryCost) {
+        // Let the memory caches which hold this image follow the new cost
+        [SDMemoryCacheCostTracker imageMemoryCostDidChange:self];
+    }
 }
 
 @end
@@ -0,0 +1,40 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "ImageLoaderDownloaderConcurrencyDecision.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The AIMD controller for download concurrency. It samples the received bytes (per chunk) and the time to first byte (from task metrics) in a window, and decide once per window:
+/// Decrease multiplicatively when the time to first byte grows far above the baseline or the request timed out, decrease by one when the last increase reduced throughput, or increase by one when all slots are taken.
+@interface SDAdaptiveConcurrencyController : NSObject
+
+- (instancetype)initWithConcurrency:(NSInteger)concurrency NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// The current concurrency, always in bounds
+@property (nonatomic, assign, readonly) NSInteger concurrency;
+/// The lower bound, at least 1
+@property (nonatomic, assign) NSInteger minConcurrency;
+/// The upper bound, at least `minConcurrency`
+@property (nonatomic, assign) NSInteger maxConcurrency;
+
+- (void)recordReceivedBytes:(NSUInteger)bytes;
+- (void)recordMetrics:(NSURLSessionTaskMetrics *)metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+- (void)recordError:(nullable NSError *)error;
+
+/// Whether the current sampling window elapsed, which is cheap to check before `decisionWithSaturated:`
+@property (nonatomic, assign, readonly, getter=isWindowElapsed) BOOL windowElapsed;
+/// Make the decision and start a new window, return nil if the window does not elapse or does not have any sample
+- (nullable ImageLoaderDownloaderConcurrencyDecision *)decisionWithSaturated:(BOOL)saturated;
+
+@end
+
+NS_ASSUME_NONNULL_END
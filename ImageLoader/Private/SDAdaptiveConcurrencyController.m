@@ -0,0 +1,199 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDAdaptiveConcurrencyController.h"
+#import "SDInternalMacros.h"
+
+// The sampling window duration
+static const CFTimeInterval SDAdaptiveConcurrencyWindow = 1.0;
+// The smoothing factor for time to first byte
+static const double SDAdaptiveConcurrencyTTFBSmoothing = 0.2;
+// The time to first byte above baseline by this factor means congestion
+static const double SDAdaptiveConcurrencyTTFBTolerance = 2.0;
+// The baseline drift up per window, so a stale minimum (like from another network) can recover
+static const double SDAdaptiveConcurrencyBaselineDrift = 1.02;
+// The multiplicative decrease factor
+static const double SDAdaptiveConcurrencyDecreaseFactor = 0.75;
+// The throughput drop ratio which means the last increase does not help
+static const double SDAdaptiveConcurrencyThroughputDrop = 0.9;
+
+@implementation SDAdaptiveConcurrencyController {
+    NSInteger _concurrency;
+    NSInteger _minConcurrency;
+    NSInteger _maxConcurrency;
+    CFAbsoluteTime _windowStart;
+    unsigned long long _windowBytes;
+    NSUInteger _windowTimeouts;
+    NSUInteger _windowMetricsCount;
+    NSTimeInterval _timeToFirstByte;
+    NSTimeInterval _baselineTimeToFirstByte;
+    double _lastThroughput;
+    ImageLoaderDownloaderConcurrencyAction _lastAction;
+    SD_LOCK_DECLARE(_lock);
+}
+
+- (instancetype)initWithConcurrency:(NSInteger)concurrency {
+    self = [super init];
+    if (self) {
+        _minConcurrency = 1;
+        _maxConcurrency = MAX(concurrency, 1);
+        _concurrency = _maxConcurrency;
+        _windowStart = CFAbsoluteTimeGetCurrent();
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+#pragma mark - Properties
+
+- (NSInteger)concurrency {
+    SD_LOCK(_lock);
+    NSInteger concurrency = _concurrency;
+    SD_UNLOCK(_lock);
+    return concurrency;
+}
+
+- (NSInteger)minConcurrency {
+    SD_LOCK(_lock);
+    NSInteger minConcurrency = _minConcurrency;
+    SD_UNLOCK(_lock);
+    return minConcurrency;
+}
+
+- (void)setMinConcurrency:(NSInteger)minConcurrency {
+    SD_LOCK(_lock);
+    _minConcurrency = MAX(minConcurrency, 1);
+    _maxConcurrency = MAX(_maxConcurrency, _minConcurrency);
+    _concurrency = MIN(MAX(_concurrency, _minConcurrency), _maxConcurrency);
+    SD_UNLOCK(_lock);
+}
+
+- (NSInteger)maxConcurrency {
+    SD_LOCK(_lock);
+    NSInteger maxConcurrency = _maxConcurrency;
+    SD_UNLOCK(_lock);
+    return maxConcurrency;
+}
+
+- (void)setMaxConcurrency:(NSInteger)maxConcurrency {
+    SD_LOCK(_lock);
+    _maxConcurrency = MAX(maxConcurrency, _minConcurrency);
+    _concurrency = MIN(MAX(_concurrency, _minConcurrency), _maxConcurrency);
+    SD_UNLOCK(_lock);
+}
+
+- (BOOL)isWindowElapsed {
+    SD_LOCK(_lock);
+    BOOL elapsed = CFAbsoluteTimeGetCurrent() - _windowStart >= SDAdaptiveConcurrencyWindow;
+    SD_UNLOCK(_lock);
+    return elapsed;
+}
+
+#pragma mark - Samples
+
+- (void)recordReceivedBytes:(NSUInteger)bytes {
+    SD_LOCK(_lock);
+    if (_windowBytes == 0 && _windowMetricsCount == 0) {
+        // The idle time before the first sample does not count for throughput
+        _windowStart = CFAbsoluteTimeGetCurrent();
+    }
+    _windowBytes += bytes;
+    SD_UNLOCK(_lock);
+}
+
+- (void)recordMetrics:(NSURLSessionTaskMetrics *)metrics {
+    NSURLSessionTaskTransactionMetrics *transactionMetrics = metrics.transactionMetrics.lastObject;
+    // The response from local cache does not reflect the network
+    if (!transactionMetrics || transactionMetrics.resourceFetchType != NSURLSessionTaskMetricsResourceFetchTypeNetworkLoad) {
+        return;
+    }
+    NSDate *requestStartDate = transactionMetrics.requestStartDate;
+    NSDate *responseStartDate = transactionMetrics.responseStartDate;
+    if (!requestStartDate || !responseStartDate) {
+        return;
+    }
+    NSTimeInterval timeToFirstByte = [responseStartDate timeIntervalSinceDate:requestStartDate];
+    if (timeToFirstByte < 0) {
+        return;
+    }
+    SD_LOCK(_lock);
+    if (_windowMetricsCount == 0 && _windowBytes == 0) {
+        _windowStart = CFAbsoluteTimeGetCurrent();
+    }
+    _windowMetricsCount++;
+    if (_timeToFirstByte <= 0) {
+        _timeToFirstByte = timeToFirstByte;
+    } else {
+        _timeToFirstByte += SDAdaptiveConcurrencyTTFBSmoothing * (timeToFirstByte - _timeToFirstByte);
+    }
+    if (_baselineTimeToFirstByte <= 0 || timeToFirstByte < _baselineTimeToFirstByte) {
+        _baselineTimeToFirstByte = timeToFirstByte;
+    }
+    SD_UNLOCK(_lock);
+}
+
+- (void)recordError:(NSError *)error {
+    if (![error.domain isEqualToString:NSURLErrorDomain] || error.code != NSURLErrorTimedOut) {
+        return;
+    }
+    SD_LOCK(_lock);
+    _windowTimeouts++;
+    SD_UNLOCK(_lock);
+}
+
+#pragma mark - Decision
+
+- (ImageLoaderDownloaderConcurrencyDecision *)decisionWithSaturated:(BOOL)saturated {
+    SD_LOCK(_lock);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    CFTimeInterval duration = now - _windowStart;
+    if (duration < SDAdaptiveConcurrencyWindow) {
+        SD_UNLOCK(_lock);
+        return nil;
+    }
+    if (_windowBytes == 0 && _windowMetricsCount == 0 && _windowTimeouts == 0) {
+        // Idle, nothing to learn
+        _windowStart = now;
+        SD_UNLOCK(_lock);
+        return nil;
+    }
+    double throughput = _windowBytes / duration;
+    BOOL congested = _windowMetricsCount > 0 && _baselineTimeToFirstByte > 0 && _timeToFirstByte > _baselineTimeToFirstByte * SDAdaptiveConcurrencyTTFBTolerance;
+    ImageLoaderDownloaderConcurrencyAction action = ImageLoaderDownloaderConcurrencyActionHold;
+    NSInteger concurrency = _concurrency;
+    if (_windowTimeouts > 0 || congested) {
+        concurrency = MIN((NSInteger)floor(_concurrency * SDAdaptiveConcurrencyDecreaseFactor), _concurrency - 1);
+    } else if (_lastAction == ImageLoaderDownloaderConcurrencyActionIncrease && throughput < _lastThroughput * SDAdaptiveConcurrencyThroughputDrop) {
+        // The gradient is negative, step back
+        concurrency = _concurrency - 1;
+    } else if (saturated) {
+        concurrency = _concurrency + 1;
+    }
+    concurrency = MIN(MAX(concurrency, _minConcurrency), _maxConcurrency);
+    if (concurrency > _concurrency) {
+        action = ImageLoaderDownloaderConcurrencyActionIncrease;
+    } else if (concurrency < _concurrency) {
+        action = ImageLoaderDownloaderConcurrencyActionDecrease;
+    }
+    _concurrency = concurrency;
+    ImageLoaderDownloaderConcurrencyDecision *decision = [[ImageLoaderDownloaderConcurrencyDecision alloc] initWithConcurrentDownloads:concurrency action:action throughput:throughput timeToFirstByte:_timeToFirstByte baselineTimeToFirstByte:_baselineTimeToFirstByte saturated:saturated];
+
+    // Start a new window
+    _lastThroughput = throughput;
+    _lastAction = action;
+    _windowStart = now;
+    _windowBytes = 0;
+    _windowTimeouts = 0;
+    _windowMetricsCount = 0;
+    _baselineTimeToFirstByte *= SDAdaptiveConcurrencyBaselineDrift;
+    SD_UNLOCK(_lock);
+
+    return decision;
+}
+
+@end
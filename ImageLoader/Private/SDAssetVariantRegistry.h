@@ -0,0 +1,28 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "ImageLoaderVariantResolver.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A thread-safe registry which record the cache keys for the known asset variants, used by `ImageLoaderManager` to find a cached larger variant.
+/// The registry only lives in memory. The cache key may be already removed from image cache, caller should remove it when the query miss.
+@interface SDAssetVariantRegistry : NSObject
+
+/// Record the cache key for the asset variant
+- (void)addVariant:(ImageLoaderAssetVariant *)variant forKey:(NSString *)key;
+/// Remove the cache key for the asset
+- (void)removeKey:(NSString *)key forAssetIdentifier:(NSString *)assetIdentifier;
+/// Returns the cache key for the closest variant, whose pixel size is equal or larger than the requested one. The `excludedKey` is ignored.
+- (nullable NSString *)sourceKeyForVariant:(ImageLoaderAssetVariant *)variant excludingKey:(nullable NSString *)excludedKey;
+
+@end
+
+NS_ASSUME_NONNULL_END
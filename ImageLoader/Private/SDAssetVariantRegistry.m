@@ -0,0 +1,93 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDAssetVariantRegistry.h"
+#import "SDInternalMacros.h"
+
+// The max asset count in registry, the least recently used asset may be evicted by NSCache
+#define SD_ASSET_VARIANT_REGISTRY_LIMIT 1024
+
+@implementation SDAssetVariantRegistry {
+    NSCache<NSString *, NSMutableDictionary<NSString *, NSValue *> *> *_assets; // asset identifier -> (cache key -> pixel size)
+    SD_LOCK_DECLARE(_lock);
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _assets = [[NSCache alloc] init];
+        _assets.countLimit = SD_ASSET_VARIANT_REGISTRY_LIMIT;
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+- (void)addVariant:(ImageLoaderAssetVariant *)variant forKey:(NSString *)key {
+    if (!variant.assetIdentifier || !key) {
+        return;
+    }
+    SD_LOCK(_lock);
+    NSMutableDictionary<NSString *, NSValue *> *keys = [_assets objectForKey:variant.assetIdentifier];
+    if (!keys) {
+        keys = [NSMutableDictionary dictionary];
+        [_assets setObject:keys forKey:variant.assetIdentifier];
+    }
+#if SD_MAC
+    keys[key] = [NSValue valueWithSize:variant.pixelSize];
+#else
+    keys[key] = [NSValue valueWithCGSize:variant.pixelSize];
+#endif
+    SD_UNLOCK(_lock);
+}
+
+- (void)removeKey:(NSString *)key forAssetIdentifier:(NSString *)assetIdentifier {
+    if (!key || !assetIdentifier) {
+        return;
+    }
+    SD_LOCK(_lock);
+    NSMutableDictionary<NSString *, NSValue *> *keys = [_assets objectForKey:assetIdentifier];
+    [keys removeObjectForKey:key];
+    if (keys && keys.count == 0) {
+        [_assets removeObjectForKey:assetIdentifier];
+    }
+    SD_UNLOCK(_lock);
+}
+
+- (NSString *)sourceKeyForVariant:(ImageLoaderAssetVariant *)variant excludingKey:(NSString *)excludedKey {
+    if (!variant.assetIdentifier) {
+        return nil;
+    }
+    CGSize pixelSize = variant.pixelSize;
+    NSString *sourceKey;
+    CGFloat sourceArea = CGFLOAT_MAX;
+    SD_LOCK(_lock);
+    NSMutableDictionary<NSString *, NSValue *> *keys = [_assets objectForKey:variant.assetIdentifier];
+    for (NSString *key in keys) {
+        if (excludedKey && [key isEqualToString:excludedKey]) {
+            continue;
+        }
+#if SD_MAC
+        CGSize size = keys[key].sizeValue;
+#else
+        CGSize size = keys[key].CGSizeValue;
+#endif
+        if (size.width < pixelSize.width || size.height < pixelSize.height) {
+            continue;
+        }
+        // The closest one is cheaper to downsample
+        CGFloat area = size.width * size.height;
+        if (area < sourceArea) {
+            sourceArea = area;
+            sourceKey = key;
+        }
+    }
+    SD_UNLOCK(_lock);
+    return sourceKey;
+}
+
+@end
@@ -0,0 +1,40 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The connection warmer for downloader. It sends one HEAD request for each origin (scheme, host and port) on the download session, so the DNS, TCP and TLS setup is done before the image downloads, and the connection is reused by them.
+/// The origin is not warmed again when it's warm recently (a warm-up or download started within the interval). This class is thread-safe.
+@interface SDConnectionPrewarmer : NSObject
+
+/// The session is weak referenced, which is owned by downloader
+- (instancetype)initWithSession:(NSURLSession *)session NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// The max running warm-up count, the extra origins are dropped. Zero or negative value disables warm-up.
+@property (nonatomic, assign) NSInteger maxConcurrentCount;
+
+/// Returns one URL for each origin which is not warm, in order. The origin is marked warm only when its warm-up starts.
+- (NSArray<NSURL *> *)coldOriginURLsFromURLs:(NSArray<NSURL *> *)urls;
+
+/// Mark the origin of URL warm, such as when a download started
+- (void)markOriginWarmForURL:(NSURL *)url;
+
+/// Start the warm-up task for the origin of URL and mark the origin warm, returns NO if it's beyond the concurrent limit. Returns YES without a task if the origin is warm already.
+/// The request is the modified request for URL, which may go to another host (proxy)
+- (BOOL)warmWithRequest:(NSURLRequest *)request forURL:(NSURL *)url;
+
+/// Whether the task is a warm-up task, which should not be treated as download
+- (BOOL)isWarmupTask:(NSURLSessionTask *)task;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,158 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDConnectionPrewarmer.h"
+#import "SDInternalMacros.h"
+
+// The idle connection is usually kept alive for a while, do not warm the origin again within this interval
+static const NSTimeInterval SDConnectionWarmInterval = 30;
+// The warm-up does not need to wait for slow server
+static const NSTimeInterval SDConnectionWarmupTimeout = 10;
+
+static NSString * SDOriginForURL(NSURL *url) {
+    NSString *scheme = url.scheme.lowercaseString;
+    NSString *host = url.host.lowercaseString;
+    if (!host || !([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"])) {
+        return nil;
+    }
+    NSNumber *port = url.port;
+    if (port == nil) {
+        port = [scheme isEqualToString:@"https"] ? @443 : @80;
+    }
+    return [NSString stringWithFormat:@"%@://%@:%@", scheme, host, port];
+}
+
+@implementation SDConnectionPrewarmer {
+    SD_LOCK_DECLARE(_lock);
+    __weak NSURLSession *_session;
+    NSMutableDictionary<NSString *, NSNumber *> *_warmTimes; // origin -> the last warm time
+    NSMutableSet<NSNumber *> *_runningTaskIdentifiers;
+    NSUInteger _pendingCount; // the reserved warm-up count, whose task is being created
+}
+
+- (instancetype)initWithSession:(NSURLSession *)session {
+    self = [super init];
+    if (self) {
+        SD_LOCK_INIT(_lock);
+        _session = session;
+        _warmTimes = [NSMutableDictionary dictionary];
+        _runningTaskIdentifiers = [NSMutableSet set];
+        _maxConcurrentCount = 2;
+    }
+    return self;
+}
+
+- (NSArray<NSURL *> *)coldOriginURLsFromURLs:(NSArray<NSURL *> *)urls {
+    NSMutableArray<NSURL *> *coldURLs = [NSMutableArray array];
+    NSMutableSet<NSString *> *coldOrigins = [NSMutableSet set];
+    SD_LOCK(_lock);
+    [self purgeExpiredWarmTimes];
+    for (NSURL *url in urls) {
+        NSString *origin = SDOriginForURL(url);
+        if (!origin || _warmTimes[origin] || [coldOrigins containsObject:origin]) {
+            continue;
+        }
+        [coldOrigins addObject:origin];
+        [coldURLs addObject:url];
+    }
+    SD_UNLOCK(_lock);
+    return [coldURLs copy];
+}
+
+// Should be called with lock held
+- (void)purgeExpiredWarmTimes {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    // Drop the expired records, keep the dictionary small
+    for (NSString *origin in _warmTimes.allKeys) {
+        if (now - _warmTimes[origin].doubleValue >= SDConnectionWarmInterval) {
+            [_warmTimes removeObjectForKey:origin];
+        }
+    }
+}
+
+- (void)markOriginWarmForURL:(NSURL *)url {
+    NSString *origin = SDOriginForURL(url);
+    if (!origin) {
+        return;
+    }
+    SD_LOCK(_lock);
+    _warmTimes[origin] = @(CFAbsoluteTimeGetCurrent());
+    SD_UNLOCK(_lock);
+}
+
+- (BOOL)warmWithRequest:(NSURLRequest *)request forURL:(NSURL *)url {
+    NSURLSession *session = _session;
+    NSString *origin = SDOriginForURL(url);
+    if (!session || !request || !origin) {
+        return NO;
+    }
+    NSMutableURLRequest *mutableRequest = [request mutableCopy];
+    // No body is transferred, only the connection is set up
+    mutableRequest.HTTPMethod = @"HEAD";
+    mutableRequest.timeoutInterval = MIN(mutableRequest.timeoutInterval, SDConnectionWarmupTimeout);
+
+    // Reserve the slot and claim the origin, the task is created outside the lock
+    SD_LOCK(_lock);
+    if (_maxConcurrentCount <= 0 || _runningTaskIdentifiers.count + _pendingCount >= (NSUInteger)_maxConcurrentCount) {
+        SD_UNLOCK(_lock);
+        return NO;
+    }
+    [self purgeExpiredWarmTimes];
+    if (_warmTimes[origin]) {
+        // Warmed by other warm-up or download in the meantime
+        SD_UNLOCK(_lock);
+        return YES;
+    }
+    _warmTimes[origin] = @(CFAbsoluteTimeGetCurrent());
+    _pendingCount++;
+    SD_UNLOCK(_lock);
+
+    @weakify(self);
+    __block NSUInteger taskIdentifier = 0;
+    NSURLSessionDataTask *task = [session dataTaskWithRequest:[mutableRequest copy] completionHandler:^(NSData * _Nullable data, NSURLResponse * _Nullable response, NSError * _Nullable error) {
+        @strongify(self);
+        if (!self) {
+            return;
+        }
+        // The connection is in the pool now, nothing to do with the response
+        SD_LOCK(self->_lock);
+        [self->_runningTaskIdentifiers removeObject:@(taskIdentifier)];
+        SD_UNLOCK(self->_lock);
+    }];
+    // The completion handler is called after resume, so the identifier is recorded before it
+    taskIdentifier = task.taskIdentifier;
+    SD_LOCK(_lock);
+    _pendingCount--;
+    if (task) {
+        [_runningTaskIdentifiers addObject:@(taskIdentifier)];
+    } else {
+        // Release the origin, it's not warmed
+        [_warmTimes removeObjectForKey:origin];
+    }
+    SD_UNLOCK(_lock);
+    if (!task) {
+        return NO;
+    }
+
+    // Yield to the image downloads
+    task.priority = NSURLSessionTaskPriorityLow;
+    [task resume];
+    return YES;
+}
+
+- (BOOL)isWarmupTask:(NSURLSessionTask *)task {
+    if (!task) {
+        return NO;
+    }
+    SD_LOCK(_lock);
+    BOOL isWarmupTask = [_runningTaskIdentifiers containsObject:@(task.taskIdentifier)];
+    SD_UNLOCK(_lock);
+    return isWarmupTask;
+}
+
+@end
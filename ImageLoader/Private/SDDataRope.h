@@ -0,0 +1,32 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A rope buffer for the received data chunks, backed by `dispatch_data_t`. Appending a chunk does not copy or reallocate the bytes which already received.
+/// @note This class is not thread-safe, the downloader operation access it on the URLSession delegate queue only. The returned data is immutable snapshot and can be used on any thread.
+@interface SDDataRope : NSObject
+
+/// The total length of received chunks
+@property (nonatomic, assign, readonly) NSUInteger length;
+
+/// Append the received chunk, without copying or merging the bytes (the chunk can be non-contiguous as well)
+- (void)appendData:(nonnull NSData *)data;
+
+/// The snapshot for all the received chunks, without copying. The bytes may be non-contiguous in memory, the contiguous view is only materialized when someone access `-[NSData bytes]`.
+@property (nonatomic, strong, readonly, nullable) NSData *data;
+
+/// The contiguous snapshot for all the received chunks. The chunks are merged once, and reused until next append.
+@property (nonatomic, strong, readonly, nullable) NSData *contiguousData;
+
+@end
+
+NS_ASSUME_NONNULL_END
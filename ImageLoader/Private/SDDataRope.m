@@ -0,0 +1,66 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDDataRope.h"
+
+@implementation SDDataRope {
+    dispatch_data_t _rope;
+    BOOL _contiguous;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _rope = dispatch_data_empty;
+        _contiguous = YES;
+    }
+    return self;
+}
+
+- (NSUInteger)length {
+    return dispatch_data_get_size(_rope);
+}
+
+- (void)appendData:(NSData *)data {
+    if (data.length == 0) {
+        return;
+    }
+    // Keep the immutable data alive instead of copy the bytes. The data from URLSession may be non-contiguous itself, reference each byte range instead of `-[NSData bytes]`, which merges them
+    NSData *immutableData = [data copy];
+    __block dispatch_data_t rope = _rope;
+    [immutableData enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        dispatch_data_t chunk = dispatch_data_create(bytes, byteRange.length, NULL, ^{
+            [immutableData self];
+        });
+        rope = dispatch_data_create_concat(rope, chunk);
+    }];
+    _rope = rope;
+    _contiguous = NO;
+}
+
+- (NSData *)data {
+    if (self.length == 0) {
+        return nil;
+    }
+    // dispatch data is bridged to NSData
+    return (NSData *)_rope;
+}
+
+- (NSData *)contiguousData {
+    if (self.length == 0) {
+        return nil;
+    }
+    if (!_contiguous) {
+        // Merge once, and keep the merged one as the new rope, so the next append only concat the new chunk
+        _rope = dispatch_data_create_map(_rope, NULL, NULL);
+        _contiguous = YES;
+    }
+    return (NSData *)_rope;
+}
+
+@end
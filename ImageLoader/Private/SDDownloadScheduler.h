@@ -0,0 +1,63 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "ImageLoaderDownloader.h"
+#import "ImageLoaderDownloaderOperation.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Returns the `NSURLSessionTask.priority` for the operation queue priority, which used by the download operation when starting the task.
+FOUNDATION_EXPORT float SDURLSessionTaskPriorityForQueuePriority(NSOperationQueuePriority queuePriority);
+
+/// The scheduler which keep the pending download operations outside the operation queue, and submit them in priority order only when there is a free slot (both the global and the host limit). So the priority can be changed at any time before the download started.
+/// The running operations keep their slot, only the task priority is updated. The running background operations can be paused (the task suspended) to free the slot for more important operations.
+@interface SDDownloadScheduler : NSObject
+
+- (instancetype)initWithOperationQueue:(NSOperationQueue *)operationQueue NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// The max running operation count, zero or negative value means no limit
+@property (nonatomic, assign) NSInteger maxConcurrentCount;
+/// The max running operation count for each host, zero or negative value means no limit
+@property (nonatomic, assign) NSInteger maxConcurrentCountPerHost;
+/// The max running operation count for specify hosts, which override `maxConcurrentCountPerHost`
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *hostConcurrencyLimits;
+/// The weight of round-robin across hosts for the same priority, defaults to 1 for each host
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *hostWeights;
+/// Whether to stop submitting the pending operations
+@property (nonatomic, assign, getter=isSuspended) BOOL suspended;
+/// Whether to submit the latest added operation first for the same priority
+@property (nonatomic, assign) BOOL LIFO;
+/// Whether to pause the running background operations when there are pending operations with higher priority
+/// The paused operation is still executing in the operation queue, so at most `maxConcurrentCount` operations are paused at the same time, the queue should not limit the concurrent operations itself
+@property (nonatomic, assign) BOOL shouldPauseBackgroundOperations;
+/// The count of operations which are not submitted yet
+@property (nonatomic, assign, readonly) NSUInteger pendingCount;
+/// Whether all the slots are taken, and there are pending operations waiting for slot
+@property (nonatomic, assign, readonly, getter=isSaturated) BOOL saturated;
+
+/// Add the operation to be scheduled. The `completionBlock` of operation must call `operationDidFinish:`.
+- (void)addOperation:(NSOperation<ImageLoaderDownloaderOperation> *)operation priority:(ImageLoaderDownloadPriority)priority;
+/// Update the priority of a pending, running or paused operation
+- (void)setPriority:(ImageLoaderDownloadPriority)priority forOperation:(NSOperation<ImageLoaderDownloaderOperation> *)operation;
+/// Release the slot of finished operation
+- (void)operationDidFinish:(NSOperation<ImageLoaderDownloaderOperation> *)operation;
+/// Submit the cancelled pending operations, so they can finish, then fill the free slots
+- (void)setNeedsSchedule;
+/// Cancel and submit all the pending operations
+- (void)cancelAllOperations;
+
+/// Batch the changes, the schedule only happens once when the outermost `endUpdates` called
+- (void)beginUpdates;
+- (void)endUpdates;
+
+@end
+
+NS_ASSUME_NONNULL_END
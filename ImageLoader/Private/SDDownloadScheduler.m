@@ -0,0 +1,514 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDDownloadScheduler.h"
+#import "SDInternalMacros.h"
+
+typedef NS_ENUM(NSUInteger, SDDownloadSchedulerEntryState) {
+    SDDownloadSchedulerEntryStatePending,
+    SDDownloadSchedulerEntryStateRunning,
+    SDDownloadSchedulerEntryStatePaused
+};
+
+float SDURLSessionTaskPriorityForQueuePriority(NSOperationQueuePriority queuePriority) {
+    if (queuePriority >= NSOperationQueuePriorityHigh) {
+        return NSURLSessionTaskPriorityHigh;
+    } else if (queuePriority <= NSOperationQueuePriorityVeryLow) {
+        return 0;
+    } else if (queuePriority <= NSOperationQueuePriorityLow) {
+        return NSURLSessionTaskPriorityLow;
+    } else {
+        return NSURLSessionTaskPriorityDefault;
+    }
+}
+
+static NSOperationQueuePriority SDQueuePriorityForDownloadPriority(ImageLoaderDownloadPriority priority) {
+    switch (priority) {
+        case ImageLoaderDownloadPriorityVisible:
+            return NSOperationQueuePriorityHigh;
+        case ImageLoaderDownloadPriorityPrefetch:
+            return NSOperationQueuePriorityLow;
+        case ImageLoaderDownloadPriorityBackground:
+            return NSOperationQueuePriorityVeryLow;
+        default:
+            return NSOperationQueuePriorityNormal;
+    }
+}
+
+@interface SDDownloadSchedulerEntry : NSObject
+
+@property (nonatomic, strong) NSOperation<ImageLoaderDownloaderOperation> *operation;
+@property (nonatomic, assign) ImageLoaderDownloadPriority priority;
+@property (nonatomic, copy) NSString *host;
+@property (nonatomic, assign) NSUInteger sequence;
+@property (nonatomic, assign) SDDownloadSchedulerEntryState state;
+
+@end
+
+@implementation SDDownloadSchedulerEntry
+@end
+
+@implementation SDDownloadScheduler {
+    NSOperationQueue *_operationQueue;
+    NSMapTable<NSOperation *, SDDownloadSchedulerEntry *> *_entries;
+    NSMutableDictionary<NSString *, NSNumber *> *_hostCurrentWeights; // The current weight of smooth weighted round-robin
+    NSUInteger _sequence;
+    NSUInteger _updateCount;
+    // The side effects (submit, suspend and resume task) are performed on a serial queue in the order they are decided, but outside the lock, because they may lock the operation
+    dispatch_queue_t _actionQueue;
+    SD_LOCK_DECLARE(_lock);
+}
+
+@synthesize maxConcurrentCount = _maxConcurrentCount;
+@synthesize maxConcurrentCountPerHost = _maxConcurrentCountPerHost;
+@synthesize hostConcurrencyLimits = _hostConcurrencyLimits;
+@synthesize hostWeights = _hostWeights;
+@synthesize suspended = _suspended;
+@synthesize LIFO = _LIFO;
+@synthesize shouldPauseBackgroundOperations = _shouldPauseBackgroundOperations;
+
+- (instancetype)initWithOperationQueue:(NSOperationQueue *)operationQueue {
+    self = [super init];
+    if (self) {
+        _operationQueue = operationQueue;
+        _hostCurrentWeights = [NSMutableDictionary dictionary];
+        _entries = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+        _actionQueue = dispatch_queue_create("com.hackemist.SDDownloadScheduler", DISPATCH_QUEUE_SERIAL);
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+#pragma mark - Properties
+
+- (NSInteger)maxConcurrentCount {
+    SD_LOCK(_lock);
+    NSInteger maxConcurrentCount = _maxConcurrentCount;
+    SD_UNLOCK(_lock);
+    return maxConcurrentCount;
+}
+
+- (void)setMaxConcurrentCount:(NSInteger)maxConcurrentCount {
+    SD_LOCK(_lock);
+    _maxConcurrentCount = maxConcurrentCount;
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (NSInteger)maxConcurrentCountPerHost {
+    SD_LOCK(_lock);
+    NSInteger maxConcurrentCountPerHost = _maxConcurrentCountPerHost;
+    SD_UNLOCK(_lock);
+    return maxConcurrentCountPerHost;
+}
+
+- (void)setMaxConcurrentCountPerHost:(NSInteger)maxConcurrentCountPerHost {
+    SD_LOCK(_lock);
+    _maxConcurrentCountPerHost = maxConcurrentCountPerHost;
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (NSDictionary<NSString *,NSNumber *> *)hostConcurrencyLimits {
+    SD_LOCK(_lock);
+    NSDictionary<NSString *,NSNumber *> *hostConcurrencyLimits = _hostConcurrencyLimits;
+    SD_UNLOCK(_lock);
+    return hostConcurrencyLimits;
+}
+
+- (void)setHostConcurrencyLimits:(NSDictionary<NSString *,NSNumber *> *)hostConcurrencyLimits {
+    hostConcurrencyLimits = [self.class lowercaseHostDictionary:hostConcurrencyLimits];
+    SD_LOCK(_lock);
+    _hostConcurrencyLimits = hostConcurrencyLimits;
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (NSDictionary<NSString *,NSNumber *> *)hostWeights {
+    SD_LOCK(_lock);
+    NSDictionary<NSString *,NSNumber *> *hostWeights = _hostWeights;
+    SD_UNLOCK(_lock);
+    return hostWeights;
+}
+
+- (void)setHostWeights:(NSDictionary<NSString *,NSNumber *> *)hostWeights {
+    hostWeights = [self.class lowercaseHostDictionary:hostWeights];
+    SD_LOCK(_lock);
+    _hostWeights = hostWeights;
+    SD_UNLOCK(_lock);
+}
+
+- (BOOL)isSuspended {
+    SD_LOCK(_lock);
+    BOOL suspended = _suspended;
+    SD_UNLOCK(_lock);
+    return suspended;
+}
+
+- (void)setSuspended:(BOOL)suspended {
+    SD_LOCK(_lock);
+    _suspended = suspended;
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (BOOL)LIFO {
+    SD_LOCK(_lock);
+    BOOL LIFO = _LIFO;
+    SD_UNLOCK(_lock);
+    return LIFO;
+}
+
+- (void)setLIFO:(BOOL)LIFO {
+    SD_LOCK(_lock);
+    _LIFO = LIFO;
+    SD_UNLOCK(_lock);
+}
+
+- (BOOL)shouldPauseBackgroundOperations {
+    SD_LOCK(_lock);
+    BOOL shouldPause = _shouldPauseBackgroundOperations;
+    SD_UNLOCK(_lock);
+    return shouldPause;
+}
+
+- (void)setShouldPauseBackgroundOperations:(BOOL)shouldPauseBackgroundOperations {
+    SD_LOCK(_lock);
+    _shouldPauseBackgroundOperations = shouldPauseBackgroundOperations;
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (NSUInteger)pendingCount {
+    NSUInteger count = 0;
+    SD_LOCK(_lock);
+    for (SDDownloadSchedulerEntry *entry in _entries.objectEnumerator) {
+        if (entry.state == SDDownloadSchedulerEntryStatePending) {
+            count++;
+        }
+    }
+    SD_UNLOCK(_lock);
+    return count;
+}
+
+- (BOOL)isSaturated {
+    NSUInteger pendingCount = 0;
+    NSUInteger runningCount = 0;
+    SD_LOCK(_lock);
+    for (SDDownloadSchedulerEntry *entry in _entries.objectEnumerator) {
+        if (entry.state == SDDownloadSchedulerEntryStatePending) {
+            pendingCount++;
+        } else if (entry.state == SDDownloadSchedulerEntryStateRunning) {
+            runningCount++;
+        }
+    }
+    BOOL saturated = pendingCount > 0 && _maxConcurrentCount > 0 && runningCount >= (NSUInteger)_maxConcurrentCount;
+    SD_UNLOCK(_lock);
+    return saturated;
+}
+
+#pragma mark - Operations
+
+- (void)addOperation:(NSOperation<ImageLoaderDownloaderOperation> *)operation priority:(ImageLoaderDownloadPriority)priority {
+    if (!operation) {
+        return;
+    }
+    operation.queuePriority = SDQueuePriorityForDownloadPriority(priority);
+    SDDownloadSchedulerEntry *entry = [SDDownloadSchedulerEntry new];
+    entry.operation = operation;
+    entry.priority = priority;
+    entry.host = [self.class hostForOperation:operation];
+    entry.state = SDDownloadSchedulerEntryStatePending;
+    SD_LOCK(_lock);
+    entry.sequence = ++_sequence;
+    [_entries setObject:entry forKey:operation];
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (void)setPriority:(ImageLoaderDownloadPriority)priority forOperation:(NSOperation<ImageLoaderDownloaderOperation> *)operation {
+    if (!operation) {
+        return;
+    }
+    SD_LOCK(_lock);
+    SDDownloadSchedulerEntry *entry = [_entries objectForKey:operation];
+    if (!entry || entry.priority == priority) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    entry.priority = priority;
+    if (entry.state == SDDownloadSchedulerEntryStateRunning) {
+        // The running task can only change the task priority, which is a hint for HTTP/2 stream priority and the host connection order
+        dispatch_async(_actionQueue, ^{
+            operation.queuePriority = SDQueuePriorityForDownloadPriority(priority);
+            NSURLSessionTask *task = [self.class taskForOperation:operation];
+            task.priority = SDURLSessionTaskPriorityForQueuePriority(operation.queuePriority);
+        });
+    }
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (void)operationDidFinish:(NSOperation<ImageLoaderDownloaderOperation> *)operation {
+    if (!operation) {
+        return;
+    }
+    SD_LOCK(_lock);
+    [_entries removeObjectForKey:operation];
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+- (void)cancelAllOperations {
+    NSMutableArray<NSOperation *> *operations = [NSMutableArray array];
+    SD_LOCK(_lock);
+    for (SDDownloadSchedulerEntry *entry in _entries.objectEnumerator) {
+        if (entry.state == SDDownloadSchedulerEntryStatePending) {
+            [operations addObject:entry.operation];
+        }
+    }
+    SD_UNLOCK(_lock);
+    // Cancel outside the lock, because the completion blocks may start new download
+    for (NSOperation *operation in operations) {
+        [operation cancel];
+    }
+    [self setNeedsSchedule];
+}
+
+- (void)beginUpdates {
+    SD_LOCK(_lock);
+    _updateCount++;
+    SD_UNLOCK(_lock);
+}
+
+- (void)endUpdates {
+    SD_LOCK(_lock);
+    if (_updateCount > 0) {
+        _updateCount--;
+    }
+    SD_UNLOCK(_lock);
+    [self setNeedsSchedule];
+}
+
+#pragma mark - Schedule
+
+- (void)setNeedsSchedule {
+    SD_LOCK(_lock);
+    if (_updateCount > 0) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    NSOperationQueue *operationQueue = _operationQueue;
+    // The cancelled operation must be submitted, or it will never finish and call the completion block
+    NSMutableArray<NSOperation *> *cancelledOperations = [NSMutableArray array];
+    NSUInteger runningCount = 0;
+    NSUInteger pausedCount = 0;
+    NSMutableDictionary<NSString *, NSNumber *> *hostRunningCounts = [NSMutableDictionary dictionary];
+    for (SDDownloadSchedulerEntry *entry in _entries.objectEnumerator) {
+        if (entry.state == SDDownloadSchedulerEntryStatePending && entry.operation.isCancelled) {
+            [cancelledOperations addObject:entry.operation];
+        } else if (entry.state == SDDownloadSchedulerEntryStateRunning) {
+            runningCount++;
+            hostRunningCounts[entry.host] = @(hostRunningCounts[entry.host].unsignedIntegerValue + 1);
+        } else if (entry.state == SDDownloadSchedulerEntryStatePaused) {
+            pausedCount++;
+        }
+    }
+    for (NSOperation *operation in cancelledOperations) {
+        [_entries removeObjectForKey:operation];
+    }
+    if (cancelledOperations.count > 0) {
+        dispatch_async(_actionQueue, ^{
+            [operationQueue addOperations:cancelledOperations waitUntilFinished:NO];
+        });
+    }
+    if (_suspended) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+
+    while (YES) {
+        BOOL hasFreeSlot = _maxConcurrentCount <= 0 || runningCount < (NSUInteger)_maxConcurrentCount;
+        if (!hasFreeSlot && !_shouldPauseBackgroundOperations) {
+            break;
+        }
+        SDDownloadSchedulerEntry *entry = [self nextEntryWithHostRunningCounts:hostRunningCounts];
+        if (!entry) {
+            break;
+        }
+        if (!hasFreeSlot) {
+            // No free slot, pause a running background operation for more important one
+            // The paused operation keep executing in operation queue, bound them as the running ones
+            SDDownloadSchedulerEntry *pausedEntry = nil;
+            if (entry.priority > ImageLoaderDownloadPriorityBackground && pausedCount < (NSUInteger)_maxConcurrentCount) {
+                pausedEntry = [self pausableEntry];
+            }
+            if (!pausedEntry) {
+                break;
+            }
+            pausedEntry.state = SDDownloadSchedulerEntryStatePaused;
+            pausedCount++;
+            runningCount--;
+            hostRunningCounts[pausedEntry.host] = @(hostRunningCounts[pausedEntry.host].unsignedIntegerValue - 1);
+            NSOperation<ImageLoaderDownloaderOperation> *operation = pausedEntry.operation;
+            dispatch_async(_actionQueue, ^{
+                [[self.class taskForOperation:operation] suspend];
+            });
+        }
+        NSOperation<ImageLoaderDownloaderOperation> *operation = entry.operation;
+        // Apply the latest priority, the task priority is applied when the operation start
+        NSOperationQueuePriority queuePriority = SDQueuePriorityForDownloadPriority(entry.priority);
+        if (entry.state == SDDownloadSchedulerEntryStatePaused) {
+            pausedCount--;
+            dispatch_async(_actionQueue, ^{
+                operation.queuePriority = queuePriority;
+                NSURLSessionTask *task = [self.class taskForOperation:operation];
+                task.priority = SDURLSessionTaskPriorityForQueuePriority(queuePriority);
+                [task resume];
+            });
+        } else {
+            dispatch_async(_actionQueue, ^{
+                operation.queuePriority = queuePriority;
+                [operationQueue addOperation:operation];
+            });
+        }
+        entry.state = SDDownloadSchedulerEntryStateRunning;
+        runningCount++;
+        hostRunningCounts[entry.host] = @(hostRunningCounts[entry.host].unsignedIntegerValue + 1);
+    }
+    SD_UNLOCK(_lock);
+}
+
+// Returns the pending or paused entry to run next, from the hosts which do not reach the limit. Must be called in lock.
+// The highest priority wins. For the same priority, the hosts are picked by smooth weighted round-robin, so a burst to one host does not starve the others.
+- (nullable SDDownloadSchedulerEntry *)nextEntryWithHostRunningCounts:(NSDictionary<NSString *, NSNumber *> *)hostRunningCounts {
+    // The best entry of each host
+    NSMutableDictionary<NSString *, SDDownloadSchedulerEntry *> *hostEntries = [NSMutableDictionary dictionary];
+    for (SDDownloadSchedulerEntry *entry in _entries.objectEnumerator) {
+        if (entry.state == SDDownloadSchedulerEntryStateRunning) {
+            continue;
+        }
+        NSInteger limit = [self concurrencyLimitForHost:entry.host];
+        if (limit > 0 && hostRunningCounts[entry.host].integerValue >= limit) {
+            continue;
+        }
+        SDDownloadSchedulerEntry *hostEntry = hostEntries[entry.host];
+        if (!hostEntry || [self isEntry:entry preferredToEntry:hostEntry]) {
+            hostEntries[entry.host] = entry;
+        }
+    }
+    // The host without candidate restart from zero weight
+    for (NSString *host in _hostCurrentWeights.allKeys) {
+        if (!hostEntries[host]) {
+            [_hostCurrentWeights removeObjectForKey:host];
+        }
+    }
+    if (hostEntries.count == 0) {
+        return nil;
+    }
+    ImageLoaderDownloadPriority priority = ImageLoaderDownloadPriorityBackground;
+    for (SDDownloadSchedulerEntry *entry in hostEntries.objectEnumerator) {
+        priority = MAX(priority, entry.priority);
+    }
+    NSString *selectedHost;
+    NSInteger selectedWeight = 0;
+    NSInteger totalWeight = 0;
+    for (NSString *host in hostEntries) {
+        if (hostEntries[host].priority != priority) {
+            continue;
+        }
+        NSInteger weight = [self weightForHost:host];
+        NSInteger currentWeight = _hostCurrentWeights[host].integerValue + weight;
+        _hostCurrentWeights[host] = @(currentWeight);
+        totalWeight += weight;
+        if (!selectedHost || currentWeight > selectedWeight) {
+            selectedHost = host;
+            selectedWeight = currentWeight;
+        }
+    }
+    _hostCurrentWeights[selectedHost] = @(selectedWeight - totalWeight);
+    return hostEntries[selectedHost];
+}
+
+// The paused one first for same priority because it has downloaded some data, then by execution order. Must be called in lock.
+- (BOOL)isEntry:(SDDownloadSchedulerEntry *)entry preferredToEntry:(SDDownloadSchedulerEntry *)otherEntry {
+    if (entry.priority != otherEntry.priority) {
+        return entry.priority > otherEntry.priority;
+    }
+    if (entry.state != otherEntry.state) {
+        return entry.state == SDDownloadSchedulerEntryStatePaused;
+    }
+    return _LIFO ? entry.sequence > otherEntry.sequence : entry.sequence < otherEntry.sequence;
+}
+
+// Must be called in lock
+- (NSInteger)concurrencyLimitForHost:(NSString *)host {
+    NSNumber *limit = _hostConcurrencyLimits[host];
+    if (limit != nil) {
+        return limit.integerValue;
+    }
+    return _maxConcurrentCountPerHost;
+}
+
+// Must be called in lock
+- (NSInteger)weightForHost:(NSString *)host {
+    NSNumber *weight = _hostWeights[host];
+    if (weight == nil) {
+        return 1;
+    }
+    return MAX(weight.integerValue, 1);
+}
+
+// Returns the latest started background entry whose task is running. Must be called in lock.
+- (nullable SDDownloadSchedulerEntry *)pausableEntry {
+    SDDownloadSchedulerEntry *pausableEntry = nil;
+    for (SDDownloadSchedulerEntry *entry in _entries.objectEnumerator) {
+        if (entry.state != SDDownloadSchedulerEntryStateRunning || entry.priority != ImageLoaderDownloadPriorityBackground) {
+            continue;
+        }
+        // The task is created before marked as executing, and the operation which does not start yet can not be paused
+        NSOperation *operation = entry.operation;
+        if (!operation.isExecuting || operation.isCancelled || ![operation respondsToSelector:@selector(dataTask)]) {
+            continue;
+        }
+        if (!pausableEntry || entry.sequence > pausableEntry.sequence) {
+            pausableEntry = entry;
+        }
+    }
+    return pausableEntry;
+}
+
++ (NSString *)hostForOperation:(NSOperation<ImageLoaderDownloaderOperation> *)operation {
+    NSString *host = operation.request.URL.host.lowercaseString;
+    return host ?: @"";
+}
+
++ (nullable NSDictionary<NSString *, NSNumber *> *)lowercaseHostDictionary:(nullable NSDictionary<NSString *, NSNumber *> *)dictionary {
+    if (!dictionary) {
+        return nil;
+    }
+    NSMutableDictionary<NSString *, NSNumber *> *lowercaseDictionary = [NSMutableDictionary dictionaryWithCapacity:dictionary.count];
+    [dictionary enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSNumber * _Nonnull obj, BOOL * _Nonnull stop) {
+        lowercaseDictionary[key.lowercaseString] = obj;
+    }];
+    return [lowercaseDictionary copy];
+}
+
++ (nullable NSURLSessionTask *)taskForOperation:(NSOperation<ImageLoaderDownloaderOperation> *)operation {
+    if (![operation respondsToSelector:@selector(dataTask)]) {
+        return nil;
+    }
+    // So we lock the operation here, and in `ImageLoaderDownloaderOperation`, we use `@synchonzied (self)`, to ensure the thread safe between these two classes.
+    NSURLSessionTask *task;
+    @synchronized (operation) {
+        task = operation.dataTask;
+    }
+    return task;
+}
+
+@end
@@ -0,0 +1,44 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A thread-safe, bounded table for the failed URLs. Each failure blocks the URL until the next allowed time, with jittered exponential backoff by the failure count.
+/// The transient failure (like timeout) backoff from `retryInterval` and capped at `maxRetryBackoffInterval`, the permanent failure (the loader say should block) backoff from `blockInterval`. Both are capped at `maxBackoffInterval`.
+/// The transient failures caused by connectivity are removed when the network is recovered, see `removeConnectivityFailedURLs`.
+/// The record is kept for one more backoff interval after unblocked to keep the failure count, then expired. The least recently used record is evicted when exceeding `countLimit`.
+@interface SDFailedURLTable : NSObject
+
+/// The initial backoff for transient failure. Defaults to 1 second.
+@property (nonatomic, assign) NSTimeInterval retryInterval;
+/// The initial backoff for permanent failure. Defaults to 1 hour.
+@property (nonatomic, assign) NSTimeInterval blockInterval;
+/// The max backoff. Defaults to 1 day.
+@property (nonatomic, assign) NSTimeInterval maxBackoffInterval;
+/// The max backoff for transient failure. Defaults to 1 minute.
+@property (nonatomic, assign) NSTimeInterval maxRetryBackoffInterval;
+/// The max record count. Defaults to 1000.
+@property (nonatomic, assign) NSUInteger countLimit;
+
+/// Whether the URL is blocked now
+- (BOOL)isBlockedURL:(NSURL *)url;
+/// The date when the blocked URL is allowed again, nil if not blocked
+- (nullable NSDate *)nextAllowedDateForURL:(NSURL *)url;
+/// Record a failure, returns the failure count of the URL
+- (NSUInteger)recordFailureForURL:(NSURL *)url error:(NSError *)error permanent:(BOOL)permanent;
+- (void)removeURL:(NSURL *)url;
+- (void)removeAllURLs;
+/// Remove the transient failures caused by connectivity (like not connected to internet), call when the network is recovered. Cheap when there are no such records.
+- (void)removeConnectivityFailedURLs;
+
+@end
+
+NS_ASSUME_NONNULL_END
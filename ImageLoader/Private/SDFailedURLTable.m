@@ -0,0 +1,190 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDFailedURLTable.h"
+#import "SDInternalMacros.h"
+
+// The failure count above this does not grow the backoff any more, avoid overflow
+#define SD_FAILED_URL_MAX_BACKOFF_EXPONENT 16
+
+@interface SDFailedURLRecord : NSObject
+
+@property (nonatomic, assign) NSUInteger failureCount;
+@property (nonatomic, assign) BOOL permanent;
+@property (nonatomic, assign) BOOL connectivityFailure;
+@property (nonatomic, copy) NSString *errorDomain;
+@property (nonatomic, assign) NSInteger errorCode;
+@property (nonatomic, assign) CFAbsoluteTime nextAllowedTime;
+@property (nonatomic, assign) CFAbsoluteTime expireTime;
+
+@end
+
+@implementation SDFailedURLRecord
+@end
+
+@implementation SDFailedURLTable {
+    NSMutableDictionary<NSURL *, SDFailedURLRecord *> *_records;
+    NSMutableOrderedSet<NSURL *> *_recentURLs; // The least recently used first
+    BOOL _hasConnectivityFailure; // May be stale after the record expired or evicted, only to skip the scan
+    SD_LOCK_DECLARE(_lock);
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _retryInterval = 1;
+        _blockInterval = 60 * 60;
+        _maxBackoffInterval = 60 * 60 * 24;
+        _maxRetryBackoffInterval = 60;
+        _countLimit = 1000;
+        _records = [NSMutableDictionary dictionary];
+        _recentURLs = [NSMutableOrderedSet orderedSet];
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+- (BOOL)isBlockedURL:(NSURL *)url {
+    return [self nextAllowedDateForURL:url] != nil;
+}
+
+- (NSDate *)nextAllowedDateForURL:(NSURL *)url {
+    if (!url) {
+        return nil;
+    }
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    SD_LOCK(_lock);
+    SDFailedURLRecord *record = [self recordForURL:url now:now];
+    CFAbsoluteTime nextAllowedTime = record.nextAllowedTime;
+    SD_UNLOCK(_lock);
+    if (!record || nextAllowedTime <= now) {
+        return nil;
+    }
+    return [NSDate dateWithTimeIntervalSinceReferenceDate:nextAllowedTime];
+}
+
+- (NSUInteger)recordFailureForURL:(NSURL *)url error:(NSError *)error permanent:(BOOL)permanent {
+    if (!url) {
+        return 0;
+    }
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    SD_LOCK(_lock);
+    SDFailedURLRecord *record = [self recordForURL:url now:now];
+    if (!record) {
+        record = [SDFailedURLRecord new];
+        _records[url] = record;
+        [_recentURLs addObject:url];
+    }
+    record.failureCount++;
+    record.permanent = permanent;
+    record.connectivityFailure = !permanent && [self.class isConnectivityError:error];
+    if (record.connectivityFailure) {
+        _hasConnectivityFailure = YES;
+    }
+    record.errorDomain = error.domain;
+    record.errorCode = error.code;
+    NSTimeInterval backoff = [self backoffWithFailureCount:record.failureCount permanent:permanent];
+    record.nextAllowedTime = now + backoff;
+    // Keep the failure count for one more interval, so the next failure continue the backoff
+    record.expireTime = record.nextAllowedTime + backoff;
+    [self trimToCountLimit];
+    NSUInteger failureCount = record.failureCount;
+    SD_UNLOCK(_lock);
+    return failureCount;
+}
+
+- (void)removeURL:(NSURL *)url {
+    if (!url) {
+        return;
+    }
+    SD_LOCK(_lock);
+    [_records removeObjectForKey:url];
+    [_recentURLs removeObject:url];
+    SD_UNLOCK(_lock);
+}
+
+- (void)removeAllURLs {
+    SD_LOCK(_lock);
+    [_records removeAllObjects];
+    [_recentURLs removeAllObjects];
+    _hasConnectivityFailure = NO;
+    SD_UNLOCK(_lock);
+}
+
+- (void)removeConnectivityFailedURLs {
+    SD_LOCK(_lock);
+    if (!_hasConnectivityFailure) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    NSMutableArray<NSURL *> *urls = [NSMutableArray array];
+    [_records enumerateKeysAndObjectsUsingBlock:^(NSURL * _Nonnull url, SDFailedURLRecord * _Nonnull record, BOOL * _Nonnull stop) {
+        if (record.connectivityFailure) {
+            [urls addObject:url];
+        }
+    }];
+    [_records removeObjectsForKeys:urls];
+    [_recentURLs removeObjectsInArray:urls];
+    _hasConnectivityFailure = NO;
+    SD_UNLOCK(_lock);
+}
+
+#pragma mark - Helper
+
+// Returns the record not expired, and mark it as recently used. Must be called in lock.
+- (nullable SDFailedURLRecord *)recordForURL:(NSURL *)url now:(CFAbsoluteTime)now {
+    SDFailedURLRecord *record = _records[url];
+    if (!record) {
+        return nil;
+    }
+    [_recentURLs removeObject:url];
+    if (record.expireTime <= now) {
+        [_records removeObjectForKey:url];
+        return nil;
+    }
+    [_recentURLs addObject:url];
+    return record;
+}
+
+// Equal jitter, in [backoff / 2, backoff], avoid the failed URLs to be retried at the same time. Must be called in lock.
+- (NSTimeInterval)backoffWithFailureCount:(NSUInteger)failureCount permanent:(BOOL)permanent {
+    NSTimeInterval interval = permanent ? _blockInterval : _retryInterval;
+    NSTimeInterval maxBackoff = permanent ? _maxBackoffInterval : MIN(_maxRetryBackoffInterval, _maxBackoffInterval);
+    NSUInteger exponent = MIN(failureCount - 1, SD_FAILED_URL_MAX_BACKOFF_EXPONENT);
+    NSTimeInterval backoff = MIN(interval * (1 << exponent), maxBackoff);
+    double random = (double)arc4random() / UINT32_MAX;
+    return backoff / 2 + backoff / 2 * random;
+}
+
+// The failure which is not about the URL itself, but the device network
++ (BOOL)isConnectivityError:(NSError *)error {
+    if (![error.domain isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    return (   error.code == NSURLErrorNotConnectedToInternet
+            || error.code == NSURLErrorTimedOut
+            || error.code == NSURLErrorInternationalRoamingOff
+            || error.code == NSURLErrorDataNotAllowed
+            || error.code == NSURLErrorCannotFindHost
+            || error.code == NSURLErrorCannotConnectToHost
+            || error.code == NSURLErrorNetworkConnectionLost);
+}
+
+// Must be called in lock
+- (void)trimToCountLimit {
+    if (_countLimit == 0) {
+        return;
+    }
+    while (_recentURLs.count > _countLimit) {
+        NSURL *url = _recentURLs.firstObject;
+        [_recentURLs removeObjectAtIndex:0];
+        [_records removeObjectForKey:url];
+    }
+}
+
+@end
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "ImageLoaderDefine.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Downscale the static image (or the first frame of animated image) to fit the pixel size, never scale up. The pixel size is for the oriented image. Return nil if failed.
+/// @note The returned image keeps the image format, but the decode options and memory cost is not set.
+FOUNDATION_EXPORT UIImage * _Nullable SDImageCacheDownscaledImage(UIImage * _Nonnull image, CGSize pixelSize, BOOL preserveAspectRatio, CGFloat scale);
+
+/// The decode variant of a memory cache entry, which describe how the image was decoded from the same cache key (thumbnail size, scale, first-frame-only).
+@interface SDImageCacheVariant : NSObject
+
+/// The thumbnail pixel size, CGSizeZero means full size
+@property (nonatomic, assign, readonly) CGSize thumbnailPixelSize;
+/// Whether the thumbnail preserve aspect ratio
+@property (nonatomic, assign, readonly) BOOL preserveAspectRatio;
+/// The image scale factor
+@property (nonatomic, assign, readonly) CGFloat scale;
+/// Whether only the first frame is decoded
+@property (nonatomic, assign, readonly) BOOL firstFrameOnly;
+
+/// Returns the variant for query/store context, return nil if the request use the default variant (full size and all frames), which is keyed by the cache key itself.
++ (nullable instancetype)variantWithKey:(nonnull NSString *)key options:(ImageLoaderOptions)options context:(nullable ImageLoaderContext *)context;
+
+/// The key for the whole variant group. When the cache key is a thumbnail key (See `SDThumbnailedKeyForKey`), this is the original key without thumbnail, else it's the cache key itself.
+@property (nonatomic, copy, readonly) NSString *groupKey;
+/// The memory cache key for this variant. When the cache key is a thumbnail key, this is the cache key itself, else it's the cache key appended with variant info.
+@property (nonatomic, copy, readonly) NSString *memoryKey;
+
+/// Whether the image of this variant can be produced by downscaling the image of another variant.
+- (BOOL)canBeDerivedFromVariant:(nonnull SDImageCacheVariant *)variant;
+
+/// Downscale the image of a larger variant (or the full size image) to this variant. Return nil if failed, or the image is animated but this variant need all frames.
+- (nullable UIImage *)derivedImageFromImage:(nonnull UIImage *)image;
+
+@end
+
+/// A thread-safe index for the variants in the memory cache, grouped by `groupKey`. The index may contains the stale entries which already evicted from memory cache, caller should remove them when found.
+/// The group count is bounded, the index never drops a group silently, so removing the key can always find its variants.
+@interface SDImageCacheVariantIndex : NSObject
+
+/// Add the variant, returns the variants of the least recently added group which exceed the limit, caller should remove them from memory cache
+- (nonnull NSArray<SDImageCacheVariant *> *)addVariant:(nonnull SDImageCacheVariant *)variant;
+- (void)removeVariant:(nonnull SDImageCacheVariant *)variant;
+/// Returns all the variants in group which can produce the requested variant, sorted from the smallest to the largest
+- (nonnull NSArray<SDImageCacheVariant *> *)candidateVariantsForVariant:(nonnull SDImageCacheVariant *)variant;
+/// Remove and returns all the variants in group
+- (nonnull NSArray<SDImageCacheVariant *> *)removeVariantsForGroupKey:(nonnull NSString *)groupKey;
+- (void)removeAllVariants;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,327 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDImageCacheVariant.h"
+#import "LoadImageTransformer.h"
+#import "LoadImageCoderHelper.h"
+#import "LoadImageCoder.h"
+#import "NSImage+Compatibility.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+MemoryCacheCost.h"
+#import "SDInternalMacros.h"
+
+// The max group count in index, the least recently used group is evicted, and its variants should be removed from memory cache
+#define SD_IMAGE_CACHE_VARIANT_GROUP_LIMIT 1024
+
+// Returns the original key if the key is generated by `SDThumbnailedKeyForKey`, else nil
+static NSString * SDOriginalKeyForThumbnailedKey(NSString *key, CGSize thumbnailPixelSize, BOOL preserveAspectRatio) {
+    NSString *thumbnailKey = [NSString stringWithFormat:@"-Thumbnail({%f,%f},%d)", thumbnailPixelSize.width, thumbnailPixelSize.height, preserveAspectRatio];
+    // The URL key may contains the percent encoded thumbnail key in path
+    NSString *encodedThumbnailKey = [thumbnailKey stringByAddingPercentEncodingWithAllowedCharacters:NSCharacterSet.URLPathAllowedCharacterSet];
+    for (NSString *searchKey in @[thumbnailKey, encodedThumbnailKey ?: thumbnailKey]) {
+        NSRange range = [key rangeOfString:searchKey options:NSBackwardsSearch];
+        if (range.location == NSNotFound) {
+            continue;
+        }
+        NSString *originalKey = [key stringByReplacingCharactersInRange:range withString:@""];
+        // Verify by generating again, to avoid mismatch for custom key
+        if ([SDThumbnailedKeyForKey(originalKey, thumbnailPixelSize, preserveAspectRatio) isEqualToString:key]) {
+            return originalKey;
+        }
+    }
+    return nil;
+}
+
+UIImage * SDImageCacheDownscaledImage(UIImage *image, CGSize pixelSize, BOOL preserveAspectRatio, CGFloat scale) {
+    if (!image) {
+        return nil;
+    }
+    CGImageRef cgImage = image.CGImage;
+    if (!cgImage) {
+        return nil;
+    }
+    CGSize imagePixelSize = CGSizeMake(CGImageGetWidth(cgImage), CGImageGetHeight(cgImage));
+    CGSize targetSize = imagePixelSize;
+    if (pixelSize.width > 0 && pixelSize.height > 0) {
+#if SD_UIKIT || SD_WATCH
+        // The pixel size is for the oriented image, but CGImage is not oriented
+        switch (image.imageOrientation) {
+            case UIImageOrientationLeft:
+            case UIImageOrientationLeftMirrored:
+            case UIImageOrientationRight:
+            case UIImageOrientationRightMirrored:
+                pixelSize = CGSizeMake(pixelSize.height, pixelSize.width);
+                break;
+            default:
+                break;
+        }
+#endif
+        targetSize = [LoadImageCoderHelper scaledSizeWithImageSize:imagePixelSize scaleSize:pixelSize preserveAspectRatio:preserveAspectRatio shouldScaleUp:NO];
+        targetSize = CGSizeMake(MAX(round(targetSize.width), 1), MAX(round(targetSize.height), 1));
+    }
+    CGImageRef scaledImageRef;
+    if (CGSizeEqualToSize(targetSize, imagePixelSize)) {
+        scaledImageRef = CGImageRetain(cgImage);
+    } else {
+        scaledImageRef = [LoadImageCoderHelper CGImageCreateScaled:cgImage size:targetSize];
+    }
+    if (!scaledImageRef) {
+        return nil;
+    }
+    if (scale < 1) {
+        scale = image.scale;
+    }
+#if SD_MAC
+    UIImage *scaledImage = [[UIImage alloc] initWithCGImage:scaledImageRef scale:scale orientation:kCGImagePropertyOrientationUp];
+#else
+    UIImage *scaledImage = [[UIImage alloc] initWithCGImage:scaledImageRef scale:scale orientation:image.imageOrientation];
+#endif
+    CGImageRelease(scaledImageRef);
+    scaledImage._imageFormat = image._imageFormat;
+    return scaledImage;
+}
+
+@interface SDImageCacheVariant ()
+
+@property (nonatomic, assign, readwrite) CGSize thumbnailPixelSize;
+@property (nonatomic, assign, readwrite) BOOL preserveAspectRatio;
+@property (nonatomic, assign, readwrite) CGFloat scale;
+@property (nonatomic, assign, readwrite) BOOL firstFrameOnly;
+@property (nonatomic, copy, readwrite) NSString *groupKey;
+@property (nonatomic, copy, readwrite) NSString *memoryKey;
+
+@end
+
+@implementation SDImageCacheVariant
+
++ (instancetype)variantWithKey:(NSString *)key options:(ImageLoaderOptions)options context:(ImageLoaderContext *)context {
+    if (!key) {
+        return nil;
+    }
+    CGSize thumbnailPixelSize = CGSizeZero;
+    NSValue *thumbnailSizeValue = context[ImageLoaderContextImageThumbnailPixelSize];
+    if (thumbnailSizeValue != nil) {
+#if SD_MAC
+        thumbnailPixelSize = thumbnailSizeValue.sizeValue;
+#else
+        thumbnailPixelSize = thumbnailSizeValue.CGSizeValue;
+#endif
+    }
+    if (thumbnailPixelSize.width <= 0 || thumbnailPixelSize.height <= 0) {
+        thumbnailPixelSize = CGSizeZero;
+    }
+    BOOL firstFrameOnly = SD_OPTIONS_CONTAINS(options, ImageLoaderDecodeFirstFrameOnly);
+    if (CGSizeEqualToSize(thumbnailPixelSize, CGSizeZero) && !firstFrameOnly) {
+        // Default variant
+        return nil;
+    }
+    BOOL preserveAspectRatio = YES;
+    NSNumber *preserveAspectRatioValue = context[ImageLoaderContextImagePreserveAspectRatio];
+    if (preserveAspectRatioValue != nil) {
+        preserveAspectRatio = preserveAspectRatioValue.boolValue;
+    }
+    NSNumber *scaleValue = context[ImageLoaderContextImageScaleFactor];
+    CGFloat scale = scaleValue.doubleValue >= 1 ? scaleValue.doubleValue : LoadImageScaleFactorForKey(key);
+
+    SDImageCacheVariant *variant = [[self alloc] init];
+    variant.thumbnailPixelSize = thumbnailPixelSize;
+    variant.preserveAspectRatio = preserveAspectRatio;
+    variant.scale = scale;
+    variant.firstFrameOnly = firstFrameOnly;
+    NSString *originalKey;
+    if (!CGSizeEqualToSize(thumbnailPixelSize, CGSizeZero)) {
+        originalKey = SDOriginalKeyForThumbnailedKey(key, thumbnailPixelSize, preserveAspectRatio);
+    }
+    if (originalKey) {
+        // Thumbnail key already contains the variant info, which is used by `ImageLoaderManager` store as well
+        variant.groupKey = originalKey;
+        variant.memoryKey = key;
+    } else {
+        NSString *variantKey = [NSString stringWithFormat:@"Variant({%f,%f},%d,%f,%d)", thumbnailPixelSize.width, thumbnailPixelSize.height, preserveAspectRatio, scale, firstFrameOnly];
+        variant.groupKey = key;
+        variant.memoryKey = SDTransformedKeyForKey(key, variantKey);
+    }
+    return variant;
+}
+
+- (BOOL)isFullSize {
+    return CGSizeEqualToSize(self.thumbnailPixelSize, CGSizeZero);
+}
+
+- (BOOL)canBeDerivedFromVariant:(SDImageCacheVariant *)variant {
+    if (!variant || variant == self || ![variant.groupKey isEqualToString:self.groupKey]) {
+        return NO;
+    }
+    // All frames can not be derived from first frame
+    if (!self.firstFrameOnly && variant.firstFrameOnly) {
+        return NO;
+    }
+    if (variant.isFullSize) {
+        return YES;
+    }
+    if (self.isFullSize) {
+        return NO;
+    }
+    if (self.preserveAspectRatio != variant.preserveAspectRatio) {
+        return NO;
+    }
+    // Compare the pixel density as well, the same thumbnail size of 1x variant has fewer pixels per point than the 3x request
+    CGFloat densityRatio = MAX(variant.scale, 1) / MAX(self.scale, 1);
+    return variant.thumbnailPixelSize.width * densityRatio >= self.thumbnailPixelSize.width && variant.thumbnailPixelSize.height * densityRatio >= self.thumbnailPixelSize.height;
+}
+
+- (UIImage *)derivedImageFromImage:(UIImage *)image {
+    if (!image) {
+        return nil;
+    }
+    // Animated image can not be downscaled frame by frame on the fly
+    if (!self.firstFrameOnly && image._imageFrameCount > 1) {
+        return nil;
+    }
+    UIImage *derivedImage = SDImageCacheDownscaledImage(image, self.thumbnailPixelSize, self.preserveAspectRatio, self.scale);
+    if (!derivedImage) {
+        return nil;
+    }
+    // Keep the decode options consistent, to let manager check whether to re-decode if needed
+    LoadImageCoderMutableOptions *decodeOptions = [NSMutableDictionary dictionaryWithDictionary:image._decodeOptions ?: @{}];
+    decodeOptions[LoadImageCoderDecodeFirstFrameOnly] = @(self.firstFrameOnly);
+    decodeOptions[LoadImageCoderDecodeScaleFactor] = @(self.scale);
+    decodeOptions[LoadImageCoderDecodePreserveAspectRatio] = @(self.preserveAspectRatio);
+    if (self.isFullSize) {
+        decodeOptions[LoadImageCoderDecodeThumbnailPixelSize] = nil;
+    } else {
+#if SD_MAC
+        decodeOptions[LoadImageCoderDecodeThumbnailPixelSize] = [NSValue valueWithSize:self.thumbnailPixelSize];
+#else
+        decodeOptions[LoadImageCoderDecodeThumbnailPixelSize] = [NSValue valueWithCGSize:self.thumbnailPixelSize];
+#endif
+    }
+    derivedImage._decodeOptions = [decodeOptions copy];
+    derivedImage._memoryCost = SDMemoryCacheCostForImage(derivedImage);
+    return derivedImage;
+}
+
+- (NSUInteger)hash {
+    return self.memoryKey.hash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    if (![object isKindOfClass:[SDImageCacheVariant class]]) {
+        return NO;
+    }
+    return [self.memoryKey isEqualToString:((SDImageCacheVariant *)object).memoryKey];
+}
+
+@end
+
+@implementation SDImageCacheVariantIndex {
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, SDImageCacheVariant *> *> *_groups;
+    NSMutableOrderedSet<NSString *> *_groupKeys; // the least recently added first
+    SD_LOCK_DECLARE(_lock);
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _groups = [NSMutableDictionary dictionary];
+        _groupKeys = [NSMutableOrderedSet orderedSet];
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+- (NSArray<SDImageCacheVariant *> *)addVariant:(SDImageCacheVariant *)variant {
+    if (!variant) {
+        return @[];
+    }
+    NSMutableArray<SDImageCacheVariant *> *evictedVariants = [NSMutableArray array];
+    SD_LOCK(_lock);
+    NSString *groupKey = variant.groupKey;
+    NSMutableDictionary<NSString *, SDImageCacheVariant *> *group = _groups[groupKey];
+    if (!group) {
+        group = [NSMutableDictionary dictionary];
+        _groups[groupKey] = group;
+    } else {
+        [_groupKeys removeObject:groupKey];
+    }
+    [_groupKeys addObject:groupKey];
+    group[variant.memoryKey] = variant;
+    while (_groupKeys.count > SD_IMAGE_CACHE_VARIANT_GROUP_LIMIT) {
+        NSString *evictedGroupKey = _groupKeys.firstObject;
+        [_groupKeys removeObjectAtIndex:0];
+        [evictedVariants addObjectsFromArray:_groups[evictedGroupKey].allValues];
+        [_groups removeObjectForKey:evictedGroupKey];
+    }
+    SD_UNLOCK(_lock);
+    return [evictedVariants copy];
+}
+
+- (void)removeVariant:(SDImageCacheVariant *)variant {
+    if (!variant) {
+        return;
+    }
+    SD_LOCK(_lock);
+    NSMutableDictionary<NSString *, SDImageCacheVariant *> *group = _groups[variant.groupKey];
+    [group removeObjectForKey:variant.memoryKey];
+    if (group && group.count == 0) {
+        [_groups removeObjectForKey:variant.groupKey];
+        [_groupKeys removeObject:variant.groupKey];
+    }
+    SD_UNLOCK(_lock);
+}
+
+- (NSArray<SDImageCacheVariant *> *)candidateVariantsForVariant:(SDImageCacheVariant *)variant {
+    if (!variant) {
+        return @[];
+    }
+    NSMutableArray<SDImageCacheVariant *> *candidates = [NSMutableArray array];
+    SD_LOCK(_lock);
+    NSMutableDictionary<NSString *, SDImageCacheVariant *> *group = _groups[variant.groupKey];
+    for (SDImageCacheVariant *candidate in group.allValues) {
+        if ([variant canBeDerivedFromVariant:candidate]) {
+            [candidates addObject:candidate];
+        }
+    }
+    SD_UNLOCK(_lock);
+    // Smallest first, downscale from the closest size is cheaper and sharper
+    [candidates sortUsingComparator:^NSComparisonResult(SDImageCacheVariant *obj1, SDImageCacheVariant *obj2) {
+        CGFloat area1 = obj1.thumbnailPixelSize.width * obj1.thumbnailPixelSize.height;
+        CGFloat area2 = obj2.thumbnailPixelSize.width * obj2.thumbnailPixelSize.height;
+        // Full size is the largest one
+        if (area1 == 0) area1 = CGFLOAT_MAX;
+        if (area2 == 0) area2 = CGFLOAT_MAX;
+        if (area1 < area2) return NSOrderedAscending;
+        if (area1 > area2) return NSOrderedDescending;
+        return NSOrderedSame;
+    }];
+    return [candidates copy];
+}
+
+- (NSArray<SDImageCacheVariant *> *)removeVariantsForGroupKey:(NSString *)groupKey {
+    if (!groupKey) {
+        return @[];
+    }
+    SD_LOCK(_lock);
+    NSArray<SDImageCacheVariant *> *variants = [_groups[groupKey] allValues];
+    [_groups removeObjectForKey:groupKey];
+    [_groupKeys removeObject:groupKey];
+    SD_UNLOCK(_lock);
+    return variants ?: @[];
+}
+
+- (void)removeAllVariants {
+    SD_LOCK(_lock);
+    [_groups removeAllObjects];
+    [_groupKeys removeAllObjects];
+    SD_UNLOCK(_lock);
+}
+
+@end
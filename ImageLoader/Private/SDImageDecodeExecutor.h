@@ -0,0 +1,37 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The shared executor for all the image decoding (download completion, progressive and disk cache decoding), instead of one queue for each download.
+/// The concurrent decodes are bounded by the active processor count, leaving one core for the main thread. The queued decodes run in the order of `queuePriority`, which can be updated before the decode started. The cancelled decodes which are still queued never run.
+@interface SDImageDecodeExecutor : NSObject
+
+@property (nonatomic, class, readonly) SDImageDecodeExecutor *sharedExecutor;
+
+/// The max concurrent decode count. Defaults to the active processor count minus 1, at least 1.
+@property (nonatomic, assign) NSInteger maxConcurrentDecodeCount;
+
+/// Create the decode operation, which can be cancelled during decoding, see `isCurrentDecodeCancelled`
+- (NSOperation *)operationWithBlock:(dispatch_block_t)block;
+
+/// Add the decode operation, use the dependency to keep the order of decodes if needed. The quality of service is inherited from `queuePriority` if not specified.
+- (void)addOperation:(NSOperation *)operation;
+
+/// Add the decode block with priority, returns the operation which can be cancelled
+- (NSOperation *)addDecodeBlock:(dispatch_block_t)block priority:(NSOperationQueuePriority)priority;
+
+/// Whether the decode operation running on current thread is cancelled, which let the coders stop early. Always NO outside the decode operation.
+@property (nonatomic, class, readonly, getter=isCurrentDecodeCancelled) BOOL currentDecodeCancelled;
+
+@end
+
+NS_ASSUME_NONNULL_END
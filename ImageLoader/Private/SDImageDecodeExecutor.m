@@ -0,0 +1,112 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDImageDecodeExecutor.h"
+
+static NSQualityOfService SDQualityOfServiceForQueuePriority(NSOperationQueuePriority queuePriority) {
+    if (queuePriority >= NSOperationQueuePriorityHigh) {
+        return NSQualityOfServiceUserInitiated;
+    } else if (queuePriority <= NSOperationQueuePriorityVeryLow) {
+        return NSQualityOfServiceBackground;
+    } else if (queuePriority <= NSOperationQueuePriorityLow) {
+        return NSQualityOfServiceUtility;
+    } else {
+        return NSQualityOfServiceDefault;
+    }
+}
+
+// The decode operation running on current thread, the queue retains it during running
+static __thread __unsafe_unretained NSOperation *SDCurrentDecodeOperation;
+
+@interface SDImageDecodeOperation : NSOperation
+
+@property (nonatomic, copy, nullable) dispatch_block_t block;
+
+@end
+
+@implementation SDImageDecodeOperation
+
+- (void)main {
+    dispatch_block_t block = self.block;
+    self.block = nil;
+    if (!block || self.isCancelled) {
+        return;
+    }
+    NSOperation *previousOperation = SDCurrentDecodeOperation;
+    SDCurrentDecodeOperation = self;
+    block();
+    SDCurrentDecodeOperation = previousOperation;
+}
+
+@end
+
+@interface SDImageDecodeExecutor ()
+
+@property (nonatomic, strong, nonnull) NSOperationQueue *decodeQueue;
+
+@end
+
+@implementation SDImageDecodeExecutor
+
++ (SDImageDecodeExecutor *)sharedExecutor {
+    static dispatch_once_t onceToken;
+    static SDImageDecodeExecutor *executor;
+    dispatch_once(&onceToken, ^{
+        executor = [[SDImageDecodeExecutor alloc] init];
+    });
+    return executor;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _decodeQueue = [[NSOperationQueue alloc] init];
+        _decodeQueue.name = @"com.hackemist.SDImageDecodeExecutor.decodeQueue";
+        // Leave one core for the main thread rendering
+        NSInteger processorCount = (NSInteger)NSProcessInfo.processInfo.activeProcessorCount;
+        _decodeQueue.maxConcurrentOperationCount = MAX(processorCount - 1, 1);
+    }
+    return self;
+}
+
+- (NSInteger)maxConcurrentDecodeCount {
+    return self.decodeQueue.maxConcurrentOperationCount;
+}
+
+- (void)setMaxConcurrentDecodeCount:(NSInteger)maxConcurrentDecodeCount {
+    self.decodeQueue.maxConcurrentOperationCount = MAX(maxConcurrentDecodeCount, 1);
+}
+
++ (BOOL)isCurrentDecodeCancelled {
+    return SDCurrentDecodeOperation.isCancelled;
+}
+
+- (NSOperation *)operationWithBlock:(dispatch_block_t)block {
+    SDImageDecodeOperation *operation = [[SDImageDecodeOperation alloc] init];
+    operation.block = block;
+    return operation;
+}
+
+- (void)addOperation:(NSOperation *)operation {
+    if (!operation) {
+        return;
+    }
+    if (operation.qualityOfService == NSQualityOfServiceDefault) {
+        operation.qualityOfService = SDQualityOfServiceForQueuePriority(operation.queuePriority);
+    }
+    [self.decodeQueue addOperation:operation];
+}
+
+- (NSOperation *)addDecodeBlock:(dispatch_block_t)block priority:(NSOperationQueuePriority)priority {
+    NSOperation *operation = [self operationWithBlock:block];
+    operation.queuePriority = priority;
+    [self addOperation:operation];
+    return operation;
+}
+
+@end
@@ -0,0 +1,35 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "LoadImageHeaderInfo.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, SDImageHeaderParseStatus) {
+    /// The header is not complete, parse again with more data
+    SDImageHeaderParseStatusNeedMoreData,
+    /// The header info is parsed
+    SDImageHeaderParseStatusSuccess,
+    /// The data is not a supported format, or corrupted
+    SDImageHeaderParseStatusFailure
+};
+
+/// The incremental image header parser. It's stateless, parse the received prefix of the data again when more data comes, which is cheap because the header is small.
+@interface SDImageHeaderParser : NSObject
+
+/// The max data length to look for the header, which is enough for common images. Beyond this the parse fails.
+@property (nonatomic, class, readonly) NSUInteger maxHeaderLength;
+
+/// Parse the prefix of image data
++ (SDImageHeaderParseStatus)parseData:(nullable NSData *)data headerInfo:(LoadImageHeaderInfo * _Nullable * _Nonnull)headerInfo;
+
+@end
+
+NS_ASSUME_NONNULL_END
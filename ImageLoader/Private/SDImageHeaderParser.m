@@ -0,0 +1,478 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDImageHeaderParser.h"
+
+// Enough for the JPEG with large EXIF and ICC segments before SOF
+#define SD_IMAGE_HEADER_MAX_LENGTH (128 * 1024)
+
+static inline uint16_t SDReadUInt16BE(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t SDReadUInt32BE(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline uint16_t SDReadUInt16LE(const uint8_t *p) {
+    return (uint16_t)(p[1] << 8 | p[0]);
+}
+
+static inline uint32_t SDReadUInt24LE(const uint8_t *p) {
+    return (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | (uint32_t)p[0];
+}
+
+static inline uint32_t SDReadUInt32LE(const uint8_t *p) {
+    return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | (uint32_t)p[0];
+}
+
+static inline BOOL SDFourCCEqual(const uint8_t *p, const char *fourCC) {
+    return memcmp(p, fourCC, 4) == 0;
+}
+
+@implementation SDImageHeaderParser
+
++ (NSUInteger)maxHeaderLength {
+    return SD_IMAGE_HEADER_MAX_LENGTH;
+}
+
++ (SDImageHeaderParseStatus)parseData:(NSData *)data headerInfo:(LoadImageHeaderInfo * _Nullable __autoreleasing *)headerInfo {
+    *headerInfo = nil;
+    if (data.length < 2) {
+        return SDImageHeaderParseStatusNeedMoreData;
+    }
+    // Only look into the prefix
+    size_t length = MIN(data.length, SD_IMAGE_HEADER_MAX_LENGTH);
+    const uint8_t *bytes = data.bytes;
+    BOOL reachLimit = data.length >= SD_IMAGE_HEADER_MAX_LENGTH;
+    SDImageHeaderParseStatus status;
+    switch (bytes[0]) {
+        case 0xFF:
+            status = [self parseJPEGBytes:bytes length:length headerInfo:headerInfo];
+            break;
+        case 0x89:
+            status = [self parsePNGBytes:bytes length:length headerInfo:headerInfo];
+            break;
+        case 0x47:
+            status = [self parseGIFBytes:bytes length:length reachLimit:reachLimit headerInfo:headerInfo];
+            break;
+        case 0x52:
+            status = [self parseWebPBytes:bytes length:length headerInfo:headerInfo];
+            break;
+        case 0x00:
+            status = [self parseHEIFBytes:bytes length:length headerInfo:headerInfo];
+            break;
+        default:
+            status = SDImageHeaderParseStatusFailure;
+            break;
+    }
+    if (status == SDImageHeaderParseStatusNeedMoreData && reachLimit) {
+        status = SDImageHeaderParseStatusFailure;
+    }
+    return status;
+}
+
+#pragma mark - JPEG
+
+// Walk the segments until the SOF marker, which contains the height and width
++ (SDImageHeaderParseStatus)parseJPEGBytes:(const uint8_t *)bytes length:(size_t)length headerInfo:(LoadImageHeaderInfo **)headerInfo {
+    if (bytes[1] != 0xD8) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    size_t offset = 2;
+    while (YES) {
+        if (offset + 2 > length) {
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        if (bytes[offset] != 0xFF) {
+            return SDImageHeaderParseStatusFailure;
+        }
+        uint8_t marker = bytes[offset + 1];
+        if (marker == 0xFF) {
+            // Fill byte
+            offset++;
+            continue;
+        }
+        offset += 2;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+            // Standalone marker without length
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {
+            // EOI or SOS before SOF
+            return SDImageHeaderParseStatusFailure;
+        }
+        if (offset + 2 > length) {
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        uint16_t segmentLength = SDReadUInt16BE(bytes + offset);
+        if (segmentLength < 2) {
+            return SDImageHeaderParseStatusFailure;
+        }
+        BOOL isSOF = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isSOF) {
+            // length(2), precision(1), height(2), width(2)
+            if (offset + 7 > length) {
+                return SDImageHeaderParseStatusNeedMoreData;
+            }
+            uint16_t height = SDReadUInt16BE(bytes + offset + 3);
+            uint16_t width = SDReadUInt16BE(bytes + offset + 5);
+            if (width == 0 || height == 0) {
+                return SDImageHeaderParseStatusFailure;
+            }
+            *headerInfo = [[LoadImageHeaderInfo alloc] initWithFormat:LoadImageFormatJPEG pixelSize:CGSizeMake(width, height) frameCount:1 animated:NO];
+            return SDImageHeaderParseStatusSuccess;
+        }
+        offset += segmentLength;
+    }
+}
+
+#pragma mark - PNG
+
+// IHDR is always the first chunk. The acTL chunk (APNG) must appear before the first IDAT
++ (SDImageHeaderParseStatus)parsePNGBytes:(const uint8_t *)bytes length:(size_t)length headerInfo:(LoadImageHeaderInfo **)headerInfo {
+    static const uint8_t signature[8] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+    if (memcmp(bytes, signature, MIN(length, 8)) != 0) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    if (length < 24) {
+        return SDImageHeaderParseStatusNeedMoreData;
+    }
+    if (SDReadUInt32BE(bytes + 8) != 13 || !SDFourCCEqual(bytes + 12, "IHDR")) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    uint32_t width = SDReadUInt32BE(bytes + 16);
+    uint32_t height = SDReadUInt32BE(bytes + 20);
+    if (width == 0 || height == 0) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    // The chunk length, type, data, CRC
+    size_t offset = 8 + 8 + 13 + 4;
+    while (YES) {
+        if (offset + 8 > length) {
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        uint32_t chunkLength = SDReadUInt32BE(bytes + offset);
+        const uint8_t *chunkType = bytes + offset + 4;
+        if (SDFourCCEqual(chunkType, "acTL")) {
+            if (offset + 12 > length) {
+                return SDImageHeaderParseStatusNeedMoreData;
+            }
+            uint32_t frameCount = SDReadUInt32BE(bytes + offset + 8);
+            *headerInfo = [[LoadImageHeaderInfo alloc] initWithFormat:LoadImageFormatPNG pixelSize:CGSizeMake(width, height) frameCount:frameCount animated:frameCount > 1];
+            return SDImageHeaderParseStatusSuccess;
+        }
+        if (SDFourCCEqual(chunkType, "IDAT") || SDFourCCEqual(chunkType, "IEND")) {
+            *headerInfo = [[LoadImageHeaderInfo alloc] initWithFormat:LoadImageFormatPNG pixelSize:CGSizeMake(width, height) frameCount:1 animated:NO];
+            return SDImageHeaderParseStatusSuccess;
+        }
+        if (chunkLength > SD_IMAGE_HEADER_MAX_LENGTH) {
+            return SDImageHeaderParseStatusFailure;
+        }
+        offset += 8 + chunkLength + 4;
+    }
+}
+
+#pragma mark - GIF
+
+// The logical screen descriptor contains the canvas size. The looping application extension (NETSCAPE2.0) before the first image means animated
++ (SDImageHeaderParseStatus)parseGIFBytes:(const uint8_t *)bytes length:(size_t)length reachLimit:(BOOL)reachLimit headerInfo:(LoadImageHeaderInfo **)headerInfo {
+    if (memcmp(bytes, "GIF8", MIN(length, 4)) != 0) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    if (length < 13) {
+        return SDImageHeaderParseStatusNeedMoreData;
+    }
+    if ((bytes[4] != '7' && bytes[4] != '9') || bytes[5] != 'a') {
+        return SDImageHeaderParseStatusFailure;
+    }
+    uint16_t width = SDReadUInt16LE(bytes + 6);
+    uint16_t height = SDReadUInt16LE(bytes + 8);
+    if (width == 0 || height == 0) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    CGSize pixelSize = CGSizeMake(width, height);
+    uint8_t packedFields = bytes[10];
+    size_t offset = 13;
+    if (packedFields & 0x80) {
+        // Global color table
+        offset += 3 * (1 << ((packedFields & 0x07) + 1));
+    }
+    BOOL animated = NO;
+    while (!animated) {
+        if (offset + 2 > length) {
+            if (reachLimit) {
+                // The size is known, that's enough
+                break;
+            }
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        if (bytes[offset] != 0x21) {
+            // Image descriptor or trailer, no more extension before the first frame
+            break;
+        }
+        uint8_t label = bytes[offset + 1];
+        if (label == 0xFF) {
+            if (offset + 3 + 11 > length) {
+                if (reachLimit) {
+                    break;
+                }
+                return SDImageHeaderParseStatusNeedMoreData;
+            }
+            if (bytes[offset + 2] == 11 && (memcmp(bytes + offset + 3, "NETSCAPE2.0", 11) == 0 || memcmp(bytes + offset + 3, "ANIMEXTS1.0", 11) == 0)) {
+                animated = YES;
+                break;
+            }
+        }
+        // Skip the sub-blocks
+        size_t position = offset + 2;
+        while (position < length && bytes[position] != 0) {
+            position += bytes[position] + 1;
+        }
+        if (position >= length) {
+            if (reachLimit) {
+                break;
+            }
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        offset = position + 1;
+    }
+    *headerInfo = [[LoadImageHeaderInfo alloc] initWithFormat:LoadImageFormatGIF pixelSize:pixelSize frameCount:animated ? 0 : 1 animated:animated];
+    return SDImageHeaderParseStatusSuccess;
+}
+
+#pragma mark - WebP
+
+// The first chunk is VP8 (lossy), VP8L (lossless) or VP8X (extended, with the canvas size and animation flag)
++ (SDImageHeaderParseStatus)parseWebPBytes:(const uint8_t *)bytes length:(size_t)length headerInfo:(LoadImageHeaderInfo **)headerInfo {
+    if (memcmp(bytes, "RIFF", MIN(length, 4)) != 0) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    if (length < 20) {
+        return SDImageHeaderParseStatusNeedMoreData;
+    }
+    if (!SDFourCCEqual(bytes + 8, "WEBP")) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    const uint8_t *chunkType = bytes + 12;
+    const uint8_t *chunkData = bytes + 20;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    BOOL animated = NO;
+    if (SDFourCCEqual(chunkType, "VP8 ")) {
+        // frame tag(3), start code(3), width(14 bits), height(14 bits)
+        if (length < 30) {
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        if (chunkData[3] != 0x9D || chunkData[4] != 0x01 || chunkData[5] != 0x2A) {
+            return SDImageHeaderParseStatusFailure;
+        }
+        width = SDReadUInt16LE(chunkData + 6) & 0x3FFF;
+        height = SDReadUInt16LE(chunkData + 8) & 0x3FFF;
+    } else if (SDFourCCEqual(chunkType, "VP8L")) {
+        // signature(1), width - 1 (14 bits), height - 1 (14 bits)
+        if (length < 25) {
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        if (chunkData[0] != 0x2F) {
+            return SDImageHeaderParseStatusFailure;
+        }
+        uint32_t bits = SDReadUInt32LE(chunkData + 1);
+        width = (bits & 0x3FFF) + 1;
+        height = ((bits >> 14) & 0x3FFF) + 1;
+    } else if (SDFourCCEqual(chunkType, "VP8X")) {
+        // flags(1), reserved(3), canvas width - 1 (24 bits), canvas height - 1 (24 bits)
+        if (length < 30) {
+            return SDImageHeaderParseStatusNeedMoreData;
+        }
+        animated = (chunkData[0] & 0x02) != 0;
+        width = SDReadUInt24LE(chunkData + 4) + 1;
+        height = SDReadUInt24LE(chunkData + 7) + 1;
+    } else {
+        return SDImageHeaderParseStatusFailure;
+    }
+    if (width == 0 || height == 0) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    *headerInfo = [[LoadImageHeaderInfo alloc] initWithFormat:LoadImageFormatWebP pixelSize:CGSizeMake(width, height) frameCount:animated ? 0 : 1 animated:animated];
+    return SDImageHeaderParseStatusSuccess;
+}
+
+#pragma mark - HEIF
+
+// Iterate the ISOBMFF boxes in range, stop when block return NO, or the box header is truncated or invalid. The box end may be beyond the range, unless `contained`
+// The child boxes of a parent box are `contained`, the iteration stops when a child overruns its parent, so the payload is always readable
+static void SDEnumerateBoxes(const uint8_t *bytes, size_t start, size_t end, BOOL contained, BOOL (^block)(const uint8_t *type, size_t payloadStart, size_t boxEnd)) {
+    size_t offset = start;
+    while (offset + 8 <= end) {
+        uint64_t boxSize = SDReadUInt32BE(bytes + offset);
+        const uint8_t *type = bytes + offset + 4;
+        size_t headerSize = 8;
+        if (boxSize == 1) {
+            if (offset + 16 > end) {
+                return;
+            }
+            boxSize = (uint64_t)SDReadUInt32BE(bytes + offset + 8) << 32 | SDReadUInt32BE(bytes + offset + 12);
+            headerSize = 16;
+        } else if (boxSize == 0) {
+            // Extend to the end of file
+            boxSize = contained ? end - offset : SIZE_MAX - offset;
+        }
+        if (boxSize < headerSize) {
+            return;
+        }
+        size_t boxEnd = boxSize > SIZE_MAX - offset ? SIZE_MAX : offset + (size_t)boxSize;
+        if (contained && boxEnd > end) {
+            // Malformed, the child overruns its parent
+            return;
+        }
+        if (!block(type, offset + headerSize, boxEnd) || boxEnd >= end) {
+            return;
+        }
+        offset = boxEnd;
+    }
+}
+
+// The `ispe` property of primary item (by `pitm` and `ipma`), or the largest `ispe` if the association is not found
++ (CGSize)pixelSizeOfMetaBytes:(const uint8_t *)bytes start:(size_t)start end:(size_t)end {
+    __block uint32_t primaryItemID = 0;
+    __block size_t ipcoStart = 0;
+    __block size_t ipcoEnd = 0;
+    __block size_t ipmaStart = 0;
+    __block size_t ipmaEnd = 0;
+    SDEnumerateBoxes(bytes, start, end, YES, ^BOOL(const uint8_t *type, size_t payloadStart, size_t boxEnd) {
+        if (SDFourCCEqual(type, "pitm") && payloadStart + 4 <= boxEnd) {
+            uint8_t version = bytes[payloadStart];
+            if (version == 0 && payloadStart + 6 <= boxEnd) {
+                primaryItemID = SDReadUInt16BE(bytes + payloadStart + 4);
+            } else if (version > 0 && payloadStart + 8 <= boxEnd) {
+                primaryItemID = SDReadUInt32BE(bytes + payloadStart + 4);
+            }
+        } else if (SDFourCCEqual(type, "iprp")) {
+            SDEnumerateBoxes(bytes, payloadStart, boxEnd, YES, ^BOOL(const uint8_t *childType, size_t childStart, size_t childEnd) {
+                if (SDFourCCEqual(childType, "ipco")) {
+                    ipcoStart = childStart;
+                    ipcoEnd = childEnd;
+                } else if (SDFourCCEqual(childType, "ipma")) {
+                    ipmaStart = childStart;
+                    ipmaEnd = childEnd;
+                }
+                return YES;
+            });
+        }
+        return YES;
+    });
+    if (ipcoEnd == 0) {
+        return CGSizeZero;
+    }
+    // The property index is 1-based, the size is zero for the property other than `ispe`
+    NSMutableData *propertySizes = [NSMutableData data];
+    __block CGSize largestSize = CGSizeZero;
+    SDEnumerateBoxes(bytes, ipcoStart, ipcoEnd, YES, ^BOOL(const uint8_t *type, size_t payloadStart, size_t boxEnd) {
+        CGSize size = CGSizeZero;
+        if (SDFourCCEqual(type, "ispe") && payloadStart + 12 <= boxEnd) {
+            size = CGSizeMake(SDReadUInt32BE(bytes + payloadStart + 4), SDReadUInt32BE(bytes + payloadStart + 8));
+            if (size.width * size.height > largestSize.width * largestSize.height) {
+                largestSize = size;
+            }
+        }
+        [propertySizes appendBytes:&size length:sizeof(CGSize)];
+        return YES;
+    });
+    if (ipmaEnd == 0 || primaryItemID == 0 || ipmaStart + 8 > ipmaEnd) {
+        return largestSize;
+    }
+    const CGSize *sizes = propertySizes.bytes;
+    NSUInteger propertyCount = propertySizes.length / sizeof(CGSize);
+    uint8_t version = bytes[ipmaStart];
+    BOOL largeIndex = (bytes[ipmaStart + 3] & 0x01) != 0;
+    uint32_t entryCount = SDReadUInt32BE(bytes + ipmaStart + 4);
+    size_t offset = ipmaStart + 8;
+    for (uint32_t i = 0; i < entryCount; i++) {
+        size_t itemIDSize = version < 1 ? 2 : 4;
+        if (offset + itemIDSize + 1 > ipmaEnd) {
+            break;
+        }
+        uint32_t itemID = version < 1 ? SDReadUInt16BE(bytes + offset) : SDReadUInt32BE(bytes + offset);
+        offset += itemIDSize;
+        uint8_t associationCount = bytes[offset];
+        offset++;
+        for (uint8_t j = 0; j < associationCount; j++) {
+            uint32_t index;
+            if (largeIndex) {
+                if (offset + 2 > ipmaEnd) {
+                    return largestSize;
+                }
+                index = SDReadUInt16BE(bytes + offset) & 0x7FFF;
+                offset += 2;
+            } else {
+                if (offset + 1 > ipmaEnd) {
+                    return largestSize;
+                }
+                index = bytes[offset] & 0x7F;
+                offset++;
+            }
+            if (itemID == primaryItemID && index > 0 && index <= propertyCount) {
+                CGSize size = sizes[index - 1];
+                if (size.width > 0 && size.height > 0) {
+                    return size;
+                }
+            }
+        }
+    }
+    return largestSize;
+}
+
+// The `ftyp` brand tells the format, the `meta` box contains the item properties
++ (SDImageHeaderParseStatus)parseHEIFBytes:(const uint8_t *)bytes length:(size_t)length headerInfo:(LoadImageHeaderInfo **)headerInfo {
+    if (length < 12) {
+        return SDImageHeaderParseStatusNeedMoreData;
+    }
+    if (!SDFourCCEqual(bytes + 4, "ftyp")) {
+        return SDImageHeaderParseStatusFailure;
+    }
+    const uint8_t *brand = bytes + 8;
+    LoadImageFormat format;
+    __block BOOL sequence = NO;
+    if (SDFourCCEqual(brand, "heic") || SDFourCCEqual(brand, "heix") || SDFourCCEqual(brand, "heim") || SDFourCCEqual(brand, "heis")) {
+        format = LoadImageFormatHEIC;
+    } else if (SDFourCCEqual(brand, "hevc") || SDFourCCEqual(brand, "hevx")) {
+        format = LoadImageFormatHEIC;
+        sequence = YES;
+    } else if (SDFourCCEqual(brand, "mif1")) {
+        format = LoadImageFormatHEIF;
+    } else if (SDFourCCEqual(brand, "msf1")) {
+        format = LoadImageFormatHEIF;
+        sequence = YES;
+    } else {
+        return SDImageHeaderParseStatusFailure;
+    }
+    __block SDImageHeaderParseStatus status = SDImageHeaderParseStatusNeedMoreData;
+    __block CGSize pixelSize = CGSizeZero;
+    SDEnumerateBoxes(bytes, 0, length, NO, ^BOOL(const uint8_t *type, size_t payloadStart, size_t boxEnd) {
+        if (SDFourCCEqual(type, "moov")) {
+            sequence = YES;
+        } else if (SDFourCCEqual(type, "meta")) {
+            if (boxEnd > length) {
+                // Wait for the whole meta box
+                return NO;
+            }
+            // Full box, skip version and flags
+            pixelSize = [self pixelSizeOfMetaBytes:bytes start:payloadStart + 4 end:boxEnd];
+            status = pixelSize.width > 0 && pixelSize.height > 0 ? SDImageHeaderParseStatusSuccess : SDImageHeaderParseStatusFailure;
+            return NO;
+        }
+        return YES;
+    });
+    if (status == SDImageHeaderParseStatusSuccess) {
+        *headerInfo = [[LoadImageHeaderInfo alloc] initWithFormat:format pixelSize:pixelSize frameCount:sequence ? 0 : 1 animated:sequence];
+    }
+    return status;
+}
+
+@end
@@ -0,0 +1,34 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "ImageLoaderOperation.h"
+#import "LoadImageHeaderInfo.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef void(^SDImageProbeCompletionBlock)(LoadImageHeaderInfo * _Nullable headerInfo, NSError * _Nullable error);
+
+/// The prober which fetch the image header with a bounded range request, parse it incrementally, and cancel the request as soon as the header is known.
+/// It use the download session (so the connections are shared with downloads), but the probe tasks does not go through the download scheduler. The session delegate (downloader) should forward the data delegate methods of probe tasks, see `isProbeTask:`.
+@interface SDImageProber : NSObject <NSURLSessionDataDelegate>
+
+/// The session is weak referenced, which is owned by downloader
+- (instancetype)initWithSession:(NSURLSession *)session NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Start a probe task. The completion block is called exactly once, on the URLSession delegate queue (or the caller thread when cancelled).
+- (id<ImageLoaderOperation>)probeWithRequest:(NSURLRequest *)request completion:(SDImageProbeCompletionBlock)completion;
+
+/// Whether the task is a probe task, which should not be treated as download
+- (BOOL)isProbeTask:(NSURLSessionTask *)task;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,178 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDImageProber.h"
+#import "SDImageHeaderParser.h"
+#import "ImageLoaderError.h"
+#import "SDInternalMacros.h"
+
+@interface SDImageProbeTask : NSObject <ImageLoaderOperation>
+
+@property (nonatomic, strong, nullable) NSURLSessionDataTask *dataTask;
+@property (nonatomic, strong, nonnull) NSMutableData *data;
+@property (nonatomic, copy, nullable) SDImageProbeCompletionBlock completion;
+@property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
+
+@end
+
+@implementation SDImageProbeTask
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _data = [NSMutableData data];
+    }
+    return self;
+}
+
+// Returns NO if already finished
+- (BOOL)finishWithHeaderInfo:(nullable LoadImageHeaderInfo *)headerInfo error:(nullable NSError *)error {
+    SDImageProbeCompletionBlock completion;
+    @synchronized (self) {
+        completion = self.completion;
+        self.completion = nil;
+    }
+    if (!completion) {
+        return NO;
+    }
+    completion(headerInfo, error);
+    return YES;
+}
+
+- (void)cancel {
+    @synchronized (self) {
+        if (self.cancelled) {
+            return;
+        }
+        self.cancelled = YES;
+    }
+    [self.dataTask cancel];
+    [self finishWithHeaderInfo:nil error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user before probing"}]];
+}
+
+@end
+
+@interface SDImageProber () {
+    SD_LOCK_DECLARE(_tasksLock);
+}
+
+@property (nonatomic, weak, nullable) NSURLSession *session;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSNumber *, SDImageProbeTask *> *tasks;
+
+@end
+
+@implementation SDImageProber
+
+- (instancetype)initWithSession:(NSURLSession *)session {
+    self = [super init];
+    if (self) {
+        _tasks = [NSMutableDictionary dictionary];
+        SD_LOCK_INIT(_tasksLock);
+        _session = session;
+    }
+    return self;
+}
+
+- (id<ImageLoaderOperation>)probeWithRequest:(NSURLRequest *)request completion:(SDImageProbeCompletionBlock)completion {
+    SDImageProbeTask *probeTask = [SDImageProbeTask new];
+    probeTask.completion = completion;
+    NSURLSessionDataTask *dataTask = [self.session dataTaskWithRequest:request];
+    if (!dataTask) {
+        [probeTask finishWithHeaderInfo:nil error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorInvalidDownloadOperation userInfo:@{NSLocalizedDescriptionKey : @"Task can't be initialized for probe request"}]];
+        return probeTask;
+    }
+    probeTask.dataTask = dataTask;
+    SD_LOCK(_tasksLock);
+    self.tasks[@(dataTask.taskIdentifier)] = probeTask;
+    SD_UNLOCK(_tasksLock);
+    [dataTask resume];
+    return probeTask;
+}
+
+- (BOOL)isProbeTask:(NSURLSessionTask *)task {
+    if (!task) {
+        return NO;
+    }
+    return [self probeTaskForTask:task remove:NO] != nil;
+}
+
+- (nullable SDImageProbeTask *)probeTaskForTask:(NSURLSessionTask *)task remove:(BOOL)remove {
+    SD_LOCK(_tasksLock);
+    SDImageProbeTask *probeTask = self.tasks[@(task.taskIdentifier)];
+    if (remove) {
+        [self.tasks removeObjectForKey:@(task.taskIdentifier)];
+    }
+    SD_UNLOCK(_tasksLock);
+    return probeTask;
+}
+
+#pragma mark NSURLSessionDataDelegate
+
+- (void)URLSession:(NSURLSession *)session
+          dataTask:(NSURLSessionDataTask *)dataTask
+didReceiveResponse:(NSURLResponse *)response
+ completionHandler:(void (^)(NSURLSessionResponseDisposition disposition))completionHandler {
+    SDImageProbeTask *probeTask = [self probeTaskForTask:dataTask remove:NO];
+    NSInteger statusCode = [response isKindOfClass:NSHTTPURLResponse.class] ? ((NSHTTPURLResponse *)response).statusCode : 200;
+    // 206 for the range response, 200 if the server ignore the range
+    if (statusCode < 200 || statusCode >= 300) {
+        completionHandler(NSURLSessionResponseCancel);
+        [probeTask finishWithHeaderInfo:nil error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorInvalidDownloadStatusCode userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Probe marked as failed because of invalid response status code %ld", (long)statusCode], ImageLoaderErrorDownloadStatusCodeKey : @(statusCode), ImageLoaderErrorDownloadResponseKey : response}]];
+        return;
+    }
+    completionHandler(NSURLSessionResponseAllow);
+}
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
+    SDImageProbeTask *probeTask = [self probeTaskForTask:dataTask remove:NO];
+    if (!probeTask) {
+        return;
+    }
+    [probeTask.data appendData:data];
+    LoadImageHeaderInfo *headerInfo;
+    SDImageHeaderParseStatus status = [SDImageHeaderParser parseData:probeTask.data headerInfo:&headerInfo];
+    if (status == SDImageHeaderParseStatusNeedMoreData) {
+        return;
+    }
+    // Header known (or never will be), stop the transfer
+    [dataTask cancel];
+    if (status == SDImageHeaderParseStatusSuccess) {
+        [probeTask finishWithHeaderInfo:headerInfo error:nil];
+    } else {
+        [probeTask finishWithHeaderInfo:nil error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : @"Image header can not be parsed"}]];
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session
+          dataTask:(NSURLSessionDataTask *)dataTask
+ willCacheResponse:(NSCachedURLResponse *)proposedResponse
+ completionHandler:(void (^)(NSCachedURLResponse *cachedResponse))completionHandler {
+    // Partial response, do not cache
+    completionHandler(nil);
+}
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
+    SDImageProbeTask *probeTask = [self probeTaskForTask:task remove:YES];
+    if (!probeTask) {
+        return;
+    }
+    if (error) {
+        [probeTask finishWithHeaderInfo:nil error:error];
+        return;
+    }
+    // The whole range received, the image may be smaller than the range, or the header is beyond it
+    LoadImageHeaderInfo *headerInfo;
+    SDImageHeaderParseStatus status = [SDImageHeaderParser parseData:probeTask.data headerInfo:&headerInfo];
+    if (status == SDImageHeaderParseStatusSuccess) {
+        [probeTask finishWithHeaderInfo:headerInfo error:nil];
+    } else {
+        [probeTask finishWithHeaderInfo:nil error:[NSError errorWithDomain:ImageLoaderErrorDomain code:ImageLoaderErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : probeTask.data.length > 0 ? @"Image header can not be parsed" : @"Image data is nil"}]];
+    }
+}
+
+@end
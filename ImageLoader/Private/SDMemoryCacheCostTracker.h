@@ -0,0 +1,34 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+#import "SDMemoryCache.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Track the memory caches and keys which hold an image, so the cost in the cache follow the later change of `_memoryCost` (such as `SDAnimatedImage` preload or unload frames).
+/// The tracker is associated to the image, the caches are hold weakly. This class is thread-safe.
+@interface SDMemoryCacheCostTracker : NSObject
+
+/// Record the cache and key which store the image
++ (void)trackImage:(UIImage *)image inCache:(SDMemoryCache *)cache forKey:(id)key;
+
+/// Update the cost in the caches which still hold the image, called when `_memoryCost` changed
++ (void)imageMemoryCostDidChange:(UIImage *)image;
+
+@end
+
+@interface SDMemoryCache (CostTracker)
+
+/// Re-set the object with the new cost if it is still stored for the key
+- (void)sd_updateCost:(NSUInteger)cost ofObject:(id)object forKey:(id)key;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDMemoryCacheCostTracker.h"
+#import "UIImage+MemoryCacheCost.h"
+#import "objc/runtime.h"
+
+@interface SDMemoryCacheCostTracker ()
+
+@property (nonatomic, strong, nonnull) NSMapTable<SDMemoryCache *, NSMutableSet *> *cacheKeys; // weak cache to the stored keys
+
+@end
+
+@implementation SDMemoryCacheCostTracker
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _cacheKeys = [NSMapTable weakToStrongObjectsMapTable];
+    }
+    return self;
+}
+
++ (void)trackImage:(UIImage *)image inCache:(SDMemoryCache *)cache forKey:(id)key {
+    if (!image || !cache || !key) {
+        return;
+    }
+    SDMemoryCacheCostTracker *tracker;
+    @synchronized (image) {
+        tracker = objc_getAssociatedObject(image, @selector(trackImage:inCache:forKey:));
+        if (!tracker) {
+            tracker = [[SDMemoryCacheCostTracker alloc] init];
+            objc_setAssociatedObject(image, @selector(trackImage:inCache:forKey:), tracker, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        }
+    }
+    @synchronized (tracker) {
+        NSMutableSet *keys = [tracker.cacheKeys objectForKey:cache];
+        if (!keys) {
+            keys = [NSMutableSet set];
+            [tracker.cacheKeys setObject:keys forKey:cache];
+        }
+        [keys addObject:key];
+    }
+}
+
++ (void)imageMemoryCostDidChange:(UIImage *)image {
+    // The image is never stored in memory cache, which is the most case during decoding
+    SDMemoryCacheCostTracker *tracker = objc_getAssociatedObject(image, @selector(trackImage:inCache:forKey:));
+    if (!tracker) {
+        return;
+    }
+    NSMutableArray<SDMemoryCache *> *caches = [NSMutableArray array];
+    NSMutableArray<NSSet *> *cacheKeys = [NSMutableArray array];
+    @synchronized (tracker) {
+        for (SDMemoryCache *cache in tracker.cacheKeys) {
+            [caches addObject:cache];
+            [cacheKeys addObject:[[tracker.cacheKeys objectForKey:cache] copy]];
+        }
+    }
+    // Update outside the lock, the cache re-track the image when set
+    NSUInteger cost = image._memoryCost;
+    [caches enumerateObjectsUsingBlock:^(SDMemoryCache * _Nonnull cache, NSUInteger idx, BOOL * _Nonnull stop) {
+        for (id key in cacheKeys[idx]) {
+            [cache sd_updateCost:cost ofObject:image forKey:key];
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+@class LoadImageCache;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The hidden directory in disk cache path, which keep the partial downloaded bodies
+FOUNDATION_EXPORT NSString * const SDPartialDownloadDirectoryName;
+
+/// The partial downloaded body, which can be resumed with HTTP `Range` and `If-Range` request
+@interface SDPartialDownload : NSObject
+
+/// The file path of the body, owned by the caller after claimed
+@property (nonatomic, copy) NSString *path;
+/// The validator for `If-Range`, the strong `ETag` or `Last-Modified` of the original response
+@property (nonatomic, copy) NSString *validator;
+/// The byte count of the body
+@property (nonatomic, assign) unsigned long long length;
+/// The total byte count of the resource, 0 means unknown
+@property (nonatomic, assign) unsigned long long expectedLength;
+
+@end
+
+/// The store for the partial downloaded bodies in the partial download area of the image cache's disk cache. The body file is moved between the partial area and the staging file, never copied.
+@interface SDPartialDownloadStore : NSObject
+
+- (instancetype)initWithImageCache:(LoadImageCache *)imageCache;
+
+/// Returns the validator in response which can be used for `If-Range`, nil if the response can not be resumed
++ (nullable NSString *)validatorForResponse:(NSURLResponse *)response;
+
+/// Move the persisted partial body for the key into a new staging file owned by the caller. Returns nil if there is no valid partial body.
+- (nullable SDPartialDownload *)claimPartialDownloadForKey:(NSString *)key;
+/// Move the staging file into the partial area for the key, replace the existing one. The staging file is removed if the body can not be resumed.
+- (void)savePartialDownload:(SDPartialDownload *)partialDownload forKey:(NSString *)key;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,125 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDPartialDownloadStore.h"
+#import "LoadImageCache.h"
+#import "SDFileAttributeHelper.h"
+
+NSString * const SDPartialDownloadDirectoryName = @".partial";
+static NSString * const SDPartialDownloadExtendedAttributeName = @"com.hackemist.SDPartialDownload";
+static NSString * const SDPartialDownloadValidatorKey = @"validator";
+static NSString * const SDPartialDownloadExpectedLengthKey = @"expectedLength";
+
+@implementation SDPartialDownload
+
+@end
+
+@interface SDPartialDownloadStore ()
+
+@property (nonatomic, weak) LoadImageCache *imageCache;
+@property (nonatomic, strong) NSFileManager *fileManager;
+
+@end
+
+@implementation SDPartialDownloadStore
+
+- (instancetype)initWithImageCache:(LoadImageCache *)imageCache {
+    self = [super init];
+    if (self) {
+        _imageCache = imageCache;
+        _fileManager = [NSFileManager new];
+    }
+    return self;
+}
+
++ (NSString *)validatorForResponse:(NSURLResponse *)response {
+    if (![response isKindOfClass:NSHTTPURLResponse.class]) {
+        return nil;
+    }
+    NSDictionary *headers = ((NSHTTPURLResponse *)response).allHeaderFields;
+    NSString *eTag;
+    NSString *lastModified;
+    for (NSString *field in headers) {
+        if ([field caseInsensitiveCompare:@"ETag"] == NSOrderedSame) {
+            eTag = headers[field];
+        } else if ([field caseInsensitiveCompare:@"Last-Modified"] == NSOrderedSame) {
+            lastModified = headers[field];
+        }
+    }
+    // `If-Range` requires strong validator, weak ETag can not be used
+    if (eTag.length > 0 && ![eTag hasPrefix:@"W/"]) {
+        return eTag;
+    }
+    if (lastModified.length > 0) {
+        return lastModified;
+    }
+    return nil;
+}
+
+- (nullable NSString *)partialPathForKey:(NSString *)key {
+    LoadImageCache *imageCache = self.imageCache;
+    NSString *fileName = [imageCache cachePathForKey:key].lastPathComponent;
+    if (!fileName) {
+        return nil;
+    }
+    return [[imageCache.diskCachePath stringByAppendingPathComponent:SDPartialDownloadDirectoryName] stringByAppendingPathComponent:fileName];
+}
+
+- (SDPartialDownload *)claimPartialDownloadForKey:(NSString *)key {
+    NSString *partialPath = [self partialPathForKey:key];
+    if (!partialPath || ![self.fileManager fileExistsAtPath:partialPath]) {
+        return nil;
+    }
+    NSString *stagingPath = [self.imageCache createStagingFileForKey:key];
+    if (!stagingPath) {
+        return nil;
+    }
+    // Atomic move, only one operation can claim it
+    if (rename(partialPath.fileSystemRepresentation, stagingPath.fileSystemRepresentation) != 0) {
+        [self.imageCache removeStagingFile:stagingPath];
+        return nil;
+    }
+    NSData *metadata = [SDFileAttributeHelper extendedAttribute:SDPartialDownloadExtendedAttributeName atPath:stagingPath traverseLink:NO error:nil];
+    NSDictionary *info = metadata ? [NSJSONSerialization JSONObjectWithData:metadata options:0 error:nil] : nil;
+    NSString *validator = [info isKindOfClass:NSDictionary.class] ? info[SDPartialDownloadValidatorKey] : nil;
+    unsigned long long length = [[self.fileManager attributesOfItemAtPath:stagingPath error:nil] fileSize];
+    if (![validator isKindOfClass:NSString.class] || length == 0) {
+        [self.imageCache removeStagingFile:stagingPath];
+        return nil;
+    }
+    SDPartialDownload *partialDownload = [SDPartialDownload new];
+    partialDownload.path = stagingPath;
+    partialDownload.validator = validator;
+    partialDownload.length = length;
+    partialDownload.expectedLength = [info[SDPartialDownloadExpectedLengthKey] unsignedLongLongValue];
+    // Should not happen, the completed body is not a partial one
+    if (partialDownload.expectedLength > 0 && length >= partialDownload.expectedLength) {
+        [self.imageCache removeStagingFile:stagingPath];
+        return nil;
+    }
+    return partialDownload;
+}
+
+- (void)savePartialDownload:(SDPartialDownload *)partialDownload forKey:(NSString *)key {
+    NSString *partialPath = [self partialPathForKey:key];
+    if (!partialPath || partialDownload.validator.length == 0) {
+        [self.imageCache removeStagingFile:partialDownload.path];
+        return;
+    }
+    NSDictionary *info = @{SDPartialDownloadValidatorKey : partialDownload.validator,
+                           SDPartialDownloadExpectedLengthKey : @(partialDownload.expectedLength)};
+    NSData *metadata = [NSJSONSerialization dataWithJSONObject:info options:0 error:nil];
+    [self.fileManager createDirectoryAtPath:partialPath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+    if (!metadata ||
+        ![SDFileAttributeHelper setExtendedAttribute:SDPartialDownloadExtendedAttributeName value:metadata atPath:partialDownload.path traverseLink:NO overwrite:YES error:nil] ||
+        rename(partialDownload.path.fileSystemRepresentation, partialPath.fileSystemRepresentation) != 0) {
+        [self.imageCache removeStagingFile:partialDownload.path];
+    }
+}
+
+@end
@@ -0,0 +1,38 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The target which publish the progress into atomic counters, and deliver it when the coalescer fires
+@protocol SDProgressCoalescing <NSObject>
+
+/// Deliver the pending progress if any, called on the coalescer queue
+- (void)deliverCoalescedProgress;
+
+@end
+
+/// The single coalescing timer for the progress delivery of all download operations. The timer only runs when there are registered targets, at the smallest interval of them.
+@interface SDProgressCoalescer : NSObject
+
+@property (nonatomic, class, readonly) SDProgressCoalescer *sharedCoalescer;
+
+/// Register the target, which is weakly referenced
+- (void)addTarget:(id<SDProgressCoalescing>)target interval:(NSTimeInterval)interval;
+
+/// Unregister the target, without delivering the pending progress
+- (void)removeTarget:(id<SDProgressCoalescing>)target;
+
+/// Unregister the target, and deliver the pending progress synchronously, serialized with the timer delivery
+- (void)flushTarget:(id<SDProgressCoalescing>)target;
+
+@end
+
+NS_ASSUME_NONNULL_END
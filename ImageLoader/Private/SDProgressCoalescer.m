@@ -0,0 +1,126 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDProgressCoalescer.h"
+#import "SDInternalMacros.h"
+
+@implementation SDProgressCoalescer {
+    SD_LOCK_DECLARE(_lock);
+    NSHashTable<id<SDProgressCoalescing>> *_targets;
+    NSMapTable<id<SDProgressCoalescing>, NSNumber *> *_intervals;
+    dispatch_queue_t _queue;
+    dispatch_source_t _timer;
+    NSTimeInterval _interval; // the current timer interval, 0 if not running
+}
+
++ (SDProgressCoalescer *)sharedCoalescer {
+    static dispatch_once_t onceToken;
+    static SDProgressCoalescer *coalescer;
+    dispatch_once(&onceToken, ^{
+        coalescer = [[SDProgressCoalescer alloc] init];
+    });
+    return coalescer;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        SD_LOCK_INIT(_lock);
+        _targets = [NSHashTable weakObjectsHashTable];
+        _intervals = [NSMapTable weakToStrongObjectsMapTable];
+        _queue = dispatch_queue_create("com.hackemist.SDProgressCoalescer", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)addTarget:(id<SDProgressCoalescing>)target interval:(NSTimeInterval)interval {
+    if (!target || interval <= 0) {
+        return;
+    }
+    SD_LOCK(_lock);
+    [_targets addObject:target];
+    [_intervals setObject:@(interval) forKey:target];
+    if (_interval == 0 || interval < _interval) {
+        [self startTimerWithInterval:interval];
+    }
+    SD_UNLOCK(_lock);
+}
+
+- (void)removeTarget:(id<SDProgressCoalescing>)target {
+    if (!target) {
+        return;
+    }
+    SD_LOCK(_lock);
+    [_targets removeObject:target];
+    [_intervals removeObjectForKey:target];
+    [self updateTimer];
+    SD_UNLOCK(_lock);
+}
+
+- (void)flushTarget:(id<SDProgressCoalescing>)target {
+    if (!target) {
+        return;
+    }
+    [self removeTarget:target];
+    // The timer delivery may be running on the queue, keep the progress in order
+    dispatch_sync(_queue, ^{
+        [target deliverCoalescedProgress];
+    });
+}
+
+#pragma mark - Timer
+
+// Must be called in lock
+- (void)updateTimer {
+    NSTimeInterval interval = 0;
+    for (NSNumber *value in _intervals.objectEnumerator) {
+        NSTimeInterval targetInterval = value.doubleValue;
+        if (interval == 0 || targetInterval < interval) {
+            interval = targetInterval;
+        }
+    }
+    if (interval == 0) {
+        // No target, do not wake up
+        if (_timer) {
+            dispatch_source_cancel(_timer);
+            _timer = nil;
+        }
+        _interval = 0;
+    } else if (interval != _interval) {
+        [self startTimerWithInterval:interval];
+    }
+}
+
+// Must be called in lock
+- (void)startTimerWithInterval:(NSTimeInterval)interval {
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+    _interval = interval;
+    _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+    uint64_t intervalInNanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+    // Allow 10% leeway to let the system coalesce the wake up
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)intervalInNanoseconds), intervalInNanoseconds, intervalInNanoseconds / 10);
+    @weakify(self);
+    dispatch_source_set_event_handler(_timer, ^{
+        @strongify(self);
+        [self fire];
+    });
+    dispatch_resume(_timer);
+}
+
+- (void)fire {
+    SD_LOCK(_lock);
+    NSArray<id<SDProgressCoalescing>> *targets = _targets.allObjects;
+    SD_UNLOCK(_lock);
+    for (id<SDProgressCoalescing> target in targets) {
+        [target deliverCoalescedProgress];
+    }
+}
+
+@end
@@ -0,0 +1,42 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The adaptive throttle for progressive decoding of one download. It measures each partial decode, and decides to decode again only when enough new data arrived to visibly improve the image:
+/// 1. For progressive JPEG, a new scan is completed (the next SOS marker arrived)
+/// 2. For other data, the received bytes grow by a step (10% of expected size, at least 16KB)
+/// And the decoding takes at most half of the wall time (the next decode waits for the last decode duration), within the CPU time budget of the download.
+/// This class is thread-safe.
+@interface SDProgressiveDecodeThrottle : NSObject
+
+/// The total decode duration limit, 0 means no limit
+- (instancetype)initWithBudget:(NSTimeInterval)budget NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Feed each received chunk, in order
+- (void)appendData:(NSData *)data;
+
+/// Whether to start a partial decode with the data received so far. This does not change the state, if the caller does schedule the decode, call `markDecodeScheduled` then record it.
+- (BOOL)shouldDecodeWithExpectedSize:(NSUInteger)expectedSize;
+
+/// Mark a partial decode of the data received so far is scheduled
+- (void)markDecodeScheduled;
+
+/// Record the partial decode duration
+- (void)recordDecodeDuration:(NSTimeInterval)duration;
+
+/// The total duration of partial decodes so far
+@property (nonatomic, assign, readonly) NSTimeInterval totalDecodeDuration;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,133 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDProgressiveDecodeThrottle.h"
+#import "SDInternalMacros.h"
+
+// The minimum bytes step for non-progressive data
+static const NSUInteger SDProgressiveDecodeMinimumStep = 16 * 1024;
+
+@implementation SDProgressiveDecodeThrottle {
+    SD_LOCK_DECLARE(_lock);
+    NSTimeInterval _budget;
+    // Received data
+    NSUInteger _receivedLength;
+    uint8_t _firstByte;
+    uint8_t _lastByte;
+    BOOL _JPEG;
+    BOOL _progressive;
+    NSUInteger _scanCount;
+    // Decode
+    NSUInteger _decodeCount;
+    NSUInteger _decodedLength;
+    NSUInteger _decodedScanCount;
+    CFAbsoluteTime _lastDecodeStartTime;
+    NSTimeInterval _lastDecodeDuration;
+    NSTimeInterval _totalDecodeDuration;
+}
+
+- (instancetype)initWithBudget:(NSTimeInterval)budget {
+    self = [super init];
+    if (self) {
+        SD_LOCK_INIT(_lock);
+        _budget = MAX(budget, 0);
+    }
+    return self;
+}
+
+- (void)appendData:(NSData *)data {
+    SD_LOCK(_lock);
+    // Enumerate the ranges, do not flatten the dispatch data
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        const uint8_t *buffer = bytes;
+        for (NSUInteger i = 0; i < byteRange.length; i++) {
+            if (self->_receivedLength >= 2 && !self->_JPEG) {
+                // Only count the bytes for non-JPEG
+                self->_receivedLength += byteRange.length - i;
+                break;
+            }
+            uint8_t byte = buffer[i];
+            if (self->_receivedLength == 0) {
+                self->_firstByte = byte;
+            } else if (self->_receivedLength == 1) {
+                self->_JPEG = (self->_firstByte == 0xFF && byte == 0xD8);
+            } else if (self->_JPEG && self->_lastByte == 0xFF) {
+                // The 0xFF in entropy-coded data is always stuffed with 0x00, so these are real markers
+                // The embedded EXIF thumbnail may be counted as well, which only cause one more early decode
+                if (byte == 0xDA) {
+                    // SOS, the previous scan is completed
+                    self->_scanCount++;
+                } else if (byte == 0xC2) {
+                    // SOF2, progressive DCT
+                    self->_progressive = YES;
+                }
+            }
+            self->_lastByte = byte;
+            self->_receivedLength++;
+        }
+    }];
+    SD_UNLOCK(_lock);
+}
+
+- (BOOL)shouldDecodeWithExpectedSize:(NSUInteger)expectedSize {
+    SD_LOCK(_lock);
+    BOOL shouldDecode = [self _shouldDecodeWithExpectedSize:expectedSize];
+    SD_UNLOCK(_lock);
+    return shouldDecode;
+}
+
+// Must be called in lock
+- (BOOL)_shouldDecodeWithExpectedSize:(NSUInteger)expectedSize {
+    if (_budget > 0 && _totalDecodeDuration >= _budget) {
+        // Out of budget, the final image is still decoded when download finished
+        return NO;
+    }
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    if (_decodeCount > 0 && now - _lastDecodeStartTime < _lastDecodeDuration * 2) {
+        // Keep the decoding at most half of the wall time, the slower decode the fewer partial images
+        return NO;
+    }
+    if (_JPEG && _scanCount == 0) {
+        // No pixel data yet
+        return NO;
+    }
+    BOOL enough;
+    if (_progressive) {
+        // The incoming scan does not refine the image until completed
+        enough = _scanCount - 1 > _decodedScanCount;
+    } else {
+        NSUInteger step = MAX(SDProgressiveDecodeMinimumStep, expectedSize / 10);
+        enough = _decodeCount == 0 || _receivedLength >= _decodedLength + step;
+    }
+    return enough;
+}
+
+- (void)markDecodeScheduled {
+    SD_LOCK(_lock);
+    _decodeCount++;
+    _decodedLength = _receivedLength;
+    _decodedScanCount = _progressive && _scanCount > 0 ? _scanCount - 1 : 0;
+    _lastDecodeStartTime = CFAbsoluteTimeGetCurrent();
+    SD_UNLOCK(_lock);
+}
+
+- (void)recordDecodeDuration:(NSTimeInterval)duration {
+    SD_LOCK(_lock);
+    _lastDecodeDuration = duration;
+    _totalDecodeDuration += duration;
+    SD_UNLOCK(_lock);
+}
+
+- (NSTimeInterval)totalDecodeDuration {
+    SD_LOCK(_lock);
+    NSTimeInterval totalDecodeDuration = _totalDecodeDuration;
+    SD_UNLOCK(_lock);
+    return totalDecodeDuration;
+}
+
+@end
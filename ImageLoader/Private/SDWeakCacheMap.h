@@ -0,0 +1,33 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ImageLoaderCompat.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A concurrent hash map which hold the key strongly and the object weakly, used for the weak memory cache (the resurrection tier of `SDMemoryCache`).
+/// The read is lock-free (readers never wait for writers), the write is serialized. Stale entries are removed lazily when the object deallocates or when the bucket is written.
+/// The old chains replaced by writers are released when no reader exists, by the next write or by the last leaving reader.
+@interface SDWeakCacheMap<KeyType, ObjectType> : NSObject
+
+/// Returns the object for key, and the cost stored with it. Return nil if no entry exists or the object is already deallocated.
+- (nullable ObjectType)objectForKey:(nullable KeyType)key cost:(nullable NSUInteger *)cost;
+/// Store the object weakly for key, with the cost to use when the object is resurrected.
+- (void)setObject:(nullable ObjectType)object forKey:(nullable KeyType)key cost:(NSUInteger)cost;
+- (void)removeObjectForKey:(nullable KeyType)key;
+- (void)removeAllObjects;
+
+/// The count of `objectForKey:cost:` which find an alive object
+@property (nonatomic, readonly) NSUInteger hitCount;
+/// The count of `objectForKey:cost:` which return nil
+@property (nonatomic, readonly) NSUInteger missCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
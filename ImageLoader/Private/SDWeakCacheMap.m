@@ -0,0 +1,311 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWeakCacheMap.h"
+#import "SDInternalMacros.h"
+#import "objc/runtime.h"
+#import <stdatomic.h>
+
+// Power of 2, the bucket index is `hash & (count - 1)`
+#define SD_WEAK_CACHE_BUCKET_COUNT 512
+
+/// Immutable node of the bucket chain. Writer always publish a new chain instead of mutating the old one, so readers can traverse without lock.
+@interface SDWeakCacheNode : NSObject {
+    @public
+    id _key;
+    __weak id _object;
+    NSUInteger _cost;
+    NSUInteger _hash;
+    SDWeakCacheNode *_next;
+}
+
+@end
+
+@implementation SDWeakCacheNode
+@end
+
+/// Associated to the cached object, remove the stale entries from the map when the object deallocates
+@interface SDWeakCacheSentinel : NSObject
+
+@property (nonatomic, weak) SDWeakCacheMap *map;
+@property (nonatomic, strong, nonnull) NSMutableSet *keys;
+
+@end
+
+@interface SDWeakCacheMap ()
+
+- (void)removeStaleObjectsForKeys:(nonnull NSSet *)keys;
+
+@end
+
+@implementation SDWeakCacheSentinel
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _keys = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    NSSet *keys;
+    @synchronized (self) {
+        keys = [self.keys copy];
+    }
+    // The object is deallocating, weak reference to it already return nil
+    [self.map removeStaleObjectsForKeys:keys];
+}
+
+@end
+
+@implementation SDWeakCacheMap {
+    _Atomic(void *) _buckets[SD_WEAK_CACHE_BUCKET_COUNT]; // +1 retained `SDWeakCacheNode` chain head
+    atomic_ulong _readerCount;
+    atomic_ulong _retiredCount; // the count of `_retiredNodes`, which readers can check without lock
+    atomic_bool _drainScheduled;
+    atomic_ulong _hitCount;
+    atomic_ulong _missCount;
+    SD_LOCK_DECLARE(_writeLock); // a lock to serialize the writers, readers never take it
+    NSMutableArray<SDWeakCacheNode *> *_retiredNodes; // old chains which may still be traversed by readers, guarded by `_writeLock`
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        for (NSUInteger i = 0; i < SD_WEAK_CACHE_BUCKET_COUNT; i++) {
+            atomic_init(&_buckets[i], NULL);
+        }
+        atomic_init(&_readerCount, 0);
+        atomic_init(&_retiredCount, 0);
+        atomic_init(&_drainScheduled, false);
+        atomic_init(&_hitCount, 0);
+        atomic_init(&_missCount, 0);
+        SD_LOCK_INIT(_writeLock);
+        _retiredNodes = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < SD_WEAK_CACHE_BUCKET_COUNT; i++) {
+        void *head = atomic_exchange_explicit(&_buckets[i], NULL, memory_order_relaxed);
+        if (head) {
+            CFRelease(head);
+        }
+    }
+}
+
+#pragma mark - Read
+
+- (id)objectForKey:(id)key cost:(NSUInteger *)cost {
+    if (!key) {
+        return nil;
+    }
+    NSUInteger hash = [key hash];
+    id object;
+    // Announce the reader, so writers keep the old chains alive until we leave
+    atomic_fetch_add_explicit(&_readerCount, 1, memory_order_seq_cst);
+    __unsafe_unretained SDWeakCacheNode *node = (__bridge SDWeakCacheNode *)atomic_load_explicit(&_buckets[hash & (SD_WEAK_CACHE_BUCKET_COUNT - 1)], memory_order_seq_cst);
+    for (; node; node = node->_next) {
+        if (node->_hash == hash && (node->_key == key || [node->_key isEqual:key])) {
+            object = node->_object;
+            if (object && cost) {
+                *cost = node->_cost;
+            }
+            break;
+        }
+    }
+    if (atomic_fetch_sub_explicit(&_readerCount, 1, memory_order_acq_rel) == 1 && atomic_load_explicit(&_retiredCount, memory_order_acquire) > 0) {
+        // The last reader leaving, the old chains can be released now, do not wait for the next write
+        [self scheduleDrainRetiredNodes];
+    }
+
+    if (object) {
+        atomic_fetch_add_explicit(&_hitCount, 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&_missCount, 1, memory_order_relaxed);
+    }
+    return object;
+}
+
+- (NSUInteger)hitCount {
+    return atomic_load_explicit(&_hitCount, memory_order_relaxed);
+}
+
+- (NSUInteger)missCount {
+    return atomic_load_explicit(&_missCount, memory_order_relaxed);
+}
+
+#pragma mark - Write
+
+- (void)setObject:(id)object forKey:(id)key cost:(NSUInteger)cost {
+    if (!key) {
+        return;
+    }
+    if (!object) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    NSUInteger hash = [key hash];
+    SDWeakCacheNode *newNode = [[SDWeakCacheNode alloc] init];
+    newNode->_key = key;
+    newNode->_object = object;
+    newNode->_cost = cost;
+    newNode->_hash = hash;
+
+    NSMutableArray *aliveObjects = [NSMutableArray array];
+    SD_LOCK(_writeLock);
+    newNode->_next = [self chainByRemovingKey:key hash:hash aliveObjects:aliveObjects];
+    [self publishChain:newNode atIndex:hash & (SD_WEAK_CACHE_BUCKET_COUNT - 1)];
+    [self drainRetiredNodes];
+    // Attach under the same lock as the sentinel removal, so the key is never missed by the removal of a concurrent store or deallocation
+    id replacedSentinel = [self attachSentinelToObject:object forKey:key];
+    SD_UNLOCK(_writeLock);
+    // The replaced sentinel may remove stale entries when released, which take the lock
+    replacedSentinel = nil;
+}
+
+- (void)removeObjectForKey:(id)key {
+    if (!key) {
+        return;
+    }
+    NSUInteger hash = [key hash];
+    NSMutableArray *aliveObjects = [NSMutableArray array];
+    SD_LOCK(_writeLock);
+    SDWeakCacheNode *chain = [self chainByRemovingKey:key hash:hash aliveObjects:aliveObjects];
+    [self publishChain:chain atIndex:hash & (SD_WEAK_CACHE_BUCKET_COUNT - 1)];
+    [self drainRetiredNodes];
+    SD_UNLOCK(_writeLock);
+}
+
+- (void)removeAllObjects {
+    SD_LOCK(_writeLock);
+    for (NSUInteger i = 0; i < SD_WEAK_CACHE_BUCKET_COUNT; i++) {
+        [self publishChain:nil atIndex:i];
+    }
+    [self drainRetiredNodes];
+    SD_UNLOCK(_writeLock);
+}
+
+- (void)removeStaleObjectsForKeys:(NSSet *)keys {
+    if (keys.count == 0) {
+        return;
+    }
+    NSMutableArray *aliveObjects = [NSMutableArray array];
+    SD_LOCK(_writeLock);
+    for (id key in keys) {
+        NSUInteger hash = [key hash];
+        NSUInteger index = hash & (SD_WEAK_CACHE_BUCKET_COUNT - 1);
+        SDWeakCacheNode *head = (__bridge SDWeakCacheNode *)atomic_load_explicit(&_buckets[index], memory_order_relaxed);
+        // Chain rebuild always drop the nil object, only the key of the current object (if re-stored) will survive
+        [self publishChain:[self chainByRemovingKey:nil hash:0 fromChain:head aliveObjects:aliveObjects] atIndex:index];
+    }
+    [self drainRetiredNodes];
+    SD_UNLOCK(_writeLock);
+}
+
+#pragma mark - Helper
+
+// Make sure to call with `_writeLock` by caller
+- (SDWeakCacheNode *)chainByRemovingKey:(id)key hash:(NSUInteger)hash aliveObjects:(NSMutableArray *)aliveObjects {
+    SDWeakCacheNode *head = (__bridge SDWeakCacheNode *)atomic_load_explicit(&_buckets[hash & (SD_WEAK_CACHE_BUCKET_COUNT - 1)], memory_order_relaxed);
+    return [self chainByRemovingKey:key hash:hash fromChain:head aliveObjects:aliveObjects];
+}
+
+// Copy the chain without the entry for key and the stale entries (object deallocated). Pass nil key to remove stale entries only.
+// The alive objects are retained by `aliveObjects`, which caller should release after unlock. Because the last release may dealloc the object, which trigger the sentinel and re-enter the lock.
+- (SDWeakCacheNode *)chainByRemovingKey:(id)key hash:(NSUInteger)hash fromChain:(SDWeakCacheNode *)head aliveObjects:(NSMutableArray *)aliveObjects {
+    SDWeakCacheNode *newHead;
+    SDWeakCacheNode *tail;
+    for (SDWeakCacheNode *node = head; node; node = node->_next) {
+        if (key && node->_hash == hash && (node->_key == key || [node->_key isEqual:key])) {
+            continue;
+        }
+        id object = node->_object;
+        if (!object) {
+            continue;
+        }
+        [aliveObjects addObject:object];
+        SDWeakCacheNode *copiedNode = [[SDWeakCacheNode alloc] init];
+        copiedNode->_key = node->_key;
+        copiedNode->_object = object;
+        copiedNode->_cost = node->_cost;
+        copiedNode->_hash = node->_hash;
+        if (tail) {
+            tail->_next = copiedNode;
+        } else {
+            newHead = copiedNode;
+        }
+        tail = copiedNode;
+    }
+    return newHead;
+}
+
+// Make sure to call with `_writeLock` by caller
+- (void)publishChain:(SDWeakCacheNode *)chain atIndex:(NSUInteger)index {
+    void *newHead = chain ? (__bridge_retained void *)chain : NULL;
+    void *oldHead = atomic_exchange_explicit(&_buckets[index], newHead, memory_order_seq_cst);
+    if (oldHead) {
+        // Readers may still traverse the old chain, retire it instead of release
+        [_retiredNodes addObject:(__bridge_transfer SDWeakCacheNode *)oldHead];
+        atomic_store_explicit(&_retiredCount, _retiredNodes.count, memory_order_release);
+    }
+}
+
+// Make sure to call with `_writeLock` by caller
+- (void)drainRetiredNodes {
+    if (_retiredNodes.count == 0) {
+        return;
+    }
+    // Any reader which come after the publish will load the new chain, so the old ones can be released when no reader exist
+    // Node dealloc only release the key, never re-enter the map, it's safe to release with lock
+    if (atomic_load_explicit(&_readerCount, memory_order_seq_cst) == 0) {
+        [_retiredNodes removeAllObjects];
+        atomic_store_explicit(&_retiredCount, 0, memory_order_release);
+    }
+}
+
+// Called by the last leaving reader, readers never take the lock, so drain on a background queue. If readers come again before the drain, the next last reader schedule again
+- (void)scheduleDrainRetiredNodes {
+    if (atomic_exchange_explicit(&_drainScheduled, true, memory_order_acq_rel)) {
+        return;
+    }
+    __weak typeof(self) wself = self;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        __strong typeof(wself) sself = wself;
+        if (!sself) {
+            return;
+        }
+        // Clear before drain, so a reader leaving after the check will schedule again
+        atomic_store_explicit(&sself->_drainScheduled, false, memory_order_release);
+        SD_LOCK(sself->_writeLock);
+        [sself drainRetiredNodes];
+        SD_UNLOCK(sself->_writeLock);
+    });
+}
+
+// Make sure to call with `_writeLock` by caller. Returns the replaced sentinel (of a deallocated map at the same address), which caller should release after unlock
+- (SDWeakCacheSentinel *)attachSentinelToObject:(id)object forKey:(id)key {
+    // Use the map address as the associated key, one object can be stored in different maps
+    const void *associatedKey = (__bridge const void *)self;
+    SDWeakCacheSentinel *sentinel = objc_getAssociatedObject(object, associatedKey);
+    SDWeakCacheSentinel *replacedSentinel;
+    if (!sentinel || sentinel.map != self) {
+        replacedSentinel = sentinel;
+        sentinel = [[SDWeakCacheSentinel alloc] init];
+        sentinel.map = self;
+        objc_setAssociatedObject(object, associatedKey, sentinel, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    @synchronized (sentinel) {
+        [sentinel.keys addObject:key];
+    }
+    return replacedSentinel;
+}
+
+@end
@@ -1 +1 @@
-../../../WebImage/SDWebImage.h
\ No newline at end of file
+../../../WebImage/ImageLoader.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageCacheKeyFilter.h
\ No newline at end of file
+../../Core/ImageLoaderCacheKeyFilter.h
\ No newline at end of file
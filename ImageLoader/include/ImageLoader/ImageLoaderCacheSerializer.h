@@ -1 +1 @@
-../../Core/SDWebImageCacheSerializer.h
\ No newline at end of file
+../../Core/ImageLoaderCacheSerializer.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageCompat.h
\ No newline at end of file
+../../Core/ImageLoaderCompat.h
\ No newline at end of file
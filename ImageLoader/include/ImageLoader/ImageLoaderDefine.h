@@ -1 +1 @@
-../../Core/SDWebImageDefine.h
\ No newline at end of file
+../../Core/ImageLoaderDefine.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageDownloader.h
\ No newline at end of file
+../../Core/ImageLoaderDownloader.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../Core/ImageLoaderDownloaderConcurrencyDecision.h
\ No newline at end of file
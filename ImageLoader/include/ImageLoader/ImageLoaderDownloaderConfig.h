@@ -1 +1 @@
-../../Core/SDWebImageDownloaderConfig.h
\ No newline at end of file
+../../Core/ImageLoaderDownloaderConfig.h
\ No newline at end of file
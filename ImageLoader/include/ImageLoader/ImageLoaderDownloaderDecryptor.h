@@ -1 +1 @@
-../../Core/SDWebImageDownloaderDecryptor.h
\ No newline at end of file
+../../Core/ImageLoaderDownloaderDecryptor.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../Core/ImageLoaderDownloaderHeaderPolicy.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../Core/ImageLoaderDownloaderMetricsAggregator.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageDownloaderOperation.h
\ No newline at end of file
+../../Core/ImageLoaderDownloaderOperation.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageDownloaderRequestModifier.h
\ No newline at end of file
+../../Core/ImageLoaderDownloaderRequestModifier.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageDownloaderResponseModifier.h
\ No newline at end of file
+../../Core/ImageLoaderDownloaderResponseModifier.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../Core/ImageLoaderDownloaderRetryPolicy.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageError.h
\ No newline at end of file
+../../Core/ImageLoaderError.h
\ No newline at end of file
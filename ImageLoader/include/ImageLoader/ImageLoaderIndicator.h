@@ -1 +1 @@
-../../Core/SDWebImageIndicator.h
\ No newline at end of file
+../../Core/ImageLoaderIndicator.h
\ No newline at end of file
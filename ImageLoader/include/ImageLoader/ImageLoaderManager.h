@@ -1 +1 @@
-../../Core/SDWebImageManager.h
\ No newline at end of file
+../../Core/ImageLoaderManager.h
\ No newline at end of file
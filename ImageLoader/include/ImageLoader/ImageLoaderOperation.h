@@ -1 +1 @@
-../../Core/SDWebImageOperation.h
\ No newline at end of file
+../../Core/ImageLoaderOperation.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageOptionsProcessor.h
\ No newline at end of file
+../../Core/ImageLoaderOptionsProcessor.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImagePrefetcher.h
\ No newline at end of file
+../../Core/ImageLoaderPrefetcher.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDWebImageTransition.h
\ No newline at end of file
+../../Core/ImageLoaderTransition.h
\ No newline at end of file
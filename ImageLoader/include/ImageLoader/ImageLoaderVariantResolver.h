@@ -0,0 +1 @@
+../../Core/ImageLoaderVariantResolver.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageAPNGCoder.h
\ No newline at end of file
+../../Core/LoadImageAPNGCoder.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageAWebPCoder.h
\ No newline at end of file
+../../Core/LoadImageAWebPCoder.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageCache.h
\ No newline at end of file
+../../Core/LoadImageCache.h
\ No newline at end of file
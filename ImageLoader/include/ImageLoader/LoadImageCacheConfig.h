@@ -1 +1 @@
-../../Core/SDImageCacheConfig.h
\ No newline at end of file
+../../Core/LoadImageCacheConfig.h
\ No newline at end of file
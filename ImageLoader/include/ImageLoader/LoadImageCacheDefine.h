@@ -1 +1 @@
-../../Core/SDImageCacheDefine.h
\ No newline at end of file
+../../Core/LoadImageCacheDefine.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../Core/LoadImageCacheStatistics.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageCachesManager.h
\ No newline at end of file
+../../Core/LoadImageCachesManager.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageCoder.h
\ No newline at end of file
+../../Core/LoadImageCoder.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageCoderHelper.h
\ No newline at end of file
+../../Core/LoadImageCoderHelper.h
\ No newline at end of file
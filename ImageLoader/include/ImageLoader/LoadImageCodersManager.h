@@ -1 +1 @@
-../../Core/SDImageCodersManager.h
\ No newline at end of file
+../../Core/LoadImageCodersManager.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageFrame.h
\ No newline at end of file
+../../Core/LoadImageFrame.h
\ No newline at end of file
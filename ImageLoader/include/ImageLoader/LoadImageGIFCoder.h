@@ -1 +1 @@
-../../Core/SDImageGIFCoder.h
\ No newline at end of file
+../../Core/LoadImageGIFCoder.h
\ No newline at end of file
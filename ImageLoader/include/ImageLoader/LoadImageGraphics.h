@@ -1 +1 @@
-../../Core/SDImageGraphics.h
\ No newline at end of file
+../../Core/LoadImageGraphics.h
\ No newline at end of file
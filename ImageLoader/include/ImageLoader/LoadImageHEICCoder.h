@@ -1 +1 @@
-../../Core/SDImageHEICCoder.h
\ No newline at end of file
+../../Core/LoadImageHEICCoder.h
\ No newline at end of file
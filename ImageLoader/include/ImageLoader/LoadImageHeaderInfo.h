@@ -0,0 +1 @@
+../../Core/LoadImageHeaderInfo.h
\ No newline at end of file
@@ -1 +1 @@
-../../Core/SDImageIOAnimatedCoder.h
\ No newline at end of file
+../../Core/LoadImageIOAnimatedCoder.h
\ No newline at end of file
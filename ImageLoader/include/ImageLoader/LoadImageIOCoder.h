@@ -1 +1 @@
-../../Core/SDImageIOCoder.h
\ No newline at end of file
+../../Core/LoadImageIOCoder.h
\ No newline at end of file
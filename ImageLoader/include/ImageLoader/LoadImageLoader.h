@@ -1 +1 @@
-../../Core/SDImageLoader.h
\ No newline at end of file
+../../Core/LoadImageLoader.h
\ No newline at end of file
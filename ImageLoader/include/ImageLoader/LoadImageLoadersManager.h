@@ -1 +1 @@
-../../Core/SDImageLoadersManager.h
\ No newline at end of file
+../../Core/LoadImageLoadersManager.h
\ No newline at end of file
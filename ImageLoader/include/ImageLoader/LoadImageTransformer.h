@@ -1 +1 @@
-../../Core/SDImageTransformer.h
\ No newline at end of file
+../../Core/LoadImageTransformer.h
\ No newline at end of file
@@ -16,6 +16,10 @@ let package = Package(
         .library(
             name: "ImageLoader",
             targets: ["ImageLoader"]
+        ),
+        .executable(
+            name: "ImageLoaderBenchmark",
+            targets: ["ImageLoaderBenchmark"]
         )
     ],
     dependencies: [
@@ -34,6 +38,19 @@ let package = Package(
                 .headerSearchPath("Core"),
                 .headerSearchPath("Private")
             ]
+        ),
+        // The downloader benchmark for macOS, see Example/Benchmark/README.md
+        .target(
+            name: "ImageLoaderBenchmark",
+            dependencies: ["ImageLoader"],
+            path: "Example/Benchmark",
+            exclude: ["README.md"]
+        ),
+        // The downloader tests for macOS, served by the stand-in server of the benchmark
+        .testTarget(
+            name: "ImageLoaderTests",
+            dependencies: ["ImageLoader"],
+            path: "Tests"
         )
     ]
 )
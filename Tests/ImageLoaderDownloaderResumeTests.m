@@ -0,0 +1,178 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDTestCase.h"
+
+/// The tests of `ImageLoaderDownloaderResumeDownload`, the partial body is persisted into the staging cache and resumed with `Range` and `If-Range`
+@interface ImageLoaderDownloaderResumeTests : SDTestCase
+
+@property (nonatomic, strong) LoadImageCache *cache;
+
+@end
+
+@implementation ImageLoaderDownloaderResumeTests
+
+- (void)setUp {
+    [super setUp];
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"ImageLoaderDownloaderResumeTests"];
+    self.cache = [[LoadImageCache alloc] initWithNamespace:[NSUUID UUID].UUIDString diskCacheDirectory:directory];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.cache.diskCachePath error:nil];
+    self.cache = nil;
+    [super tearDown];
+}
+
+- (void)test01ThatCancelledDownloadResumesWithRange {
+    NSUInteger index = [self largestItemIndex];
+    NSData *fullData = self.corpus.items[index].data;
+    NSURL *url = [self imageURLAtIndex:index host:nil];
+    ImageLoaderDownloader *downloader = [self stubDownloaderWithConfig:nil];
+    unsigned long long partialLength = [self downloadPartialBodyOfURL:url minimumLength:fullData.length / 4 downloader:downloader];
+    XCTAssertGreaterThan(partialLength, 0);
+    XCTAssertLessThan(partialLength, fullData.length);
+
+    [SDBenchmarkURLProtocol resetStatistics];
+    NSData *data = [self downloadDataOfURL:url downloader:downloader];
+    XCTAssertEqualObjects(data, fullData);
+    NSArray<NSURLRequest *> *requests = [self startedRequestsForHost:kTestHost];
+    XCTAssertEqual(requests.count, 1);
+    NSString *expectedRange = [NSString stringWithFormat:@"bytes=%llu-", partialLength];
+    XCTAssertEqualObjects([requests.firstObject valueForHTTPHeaderField:@"Range"], expectedRange);
+    XCTAssertNotNil([requests.firstObject valueForHTTPHeaderField:@"If-Range"]);
+    // Only the rest is transferred
+    XCTAssertEqual(SDBenchmarkURLProtocol.sentBytes, fullData.length - partialLength);
+    // The partial body is consumed
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self partialPathForURL:url]]);
+}
+
+- (void)test02ThatResumeFallbackToFullBodyWhenServerIgnoresRange {
+    NSUInteger index = [self largestItemIndex];
+    NSData *fullData = self.corpus.items[index].data;
+    NSURL *url = [self imageURLAtIndex:index host:nil];
+    ImageLoaderDownloader *downloader = [self stubDownloaderWithConfig:nil];
+    unsigned long long partialLength = [self downloadPartialBodyOfURL:url minimumLength:fullData.length / 4 downloader:downloader];
+    XCTAssertGreaterThan(partialLength, 0);
+
+    // The server respond 200 with the full body to the range request
+    SDBenchmarkServerConfig *serverConfig = [SDBenchmarkURLProtocol.serverConfig copy];
+    serverConfig.supportsRange = NO;
+    SDBenchmarkURLProtocol.serverConfig = serverConfig;
+    [SDBenchmarkURLProtocol resetStatistics];
+    NSData *data = [self downloadDataOfURL:url downloader:downloader];
+    XCTAssertEqualObjects(data, fullData);
+    NSArray<NSURLRequest *> *requests = [self startedRequestsForHost:kTestHost];
+    XCTAssertEqual(requests.count, 1);
+    XCTAssertNotNil([requests.firstObject valueForHTTPHeaderField:@"Range"]);
+    XCTAssertEqual(SDBenchmarkURLProtocol.sentBytes, fullData.length);
+}
+
+- (void)test03ThatUnsatisfiableRangeRetriesOnceWithoutRange {
+    NSUInteger index = [self largestItemIndex];
+    NSURL *url = [self imageURLAtIndex:index host:nil];
+    // The resource is replaced by a smaller one at the same URL, the server does not check `If-Range`
+    SDBenchmarkCorpus *smallCorpus = [[SDBenchmarkCorpus alloc] initWithCount:1 seed:1];
+    NSData *smallData = smallCorpus.items.firstObject.data;
+    XCTAssertGreaterThan(self.corpus.items[index].data.length, smallData.length * 2);
+    ImageLoaderDownloader *downloader = [self stubDownloaderWithConfig:nil];
+    unsigned long long partialLength = [self downloadPartialBodyOfURL:url minimumLength:smallData.length + 1 downloader:downloader];
+    XCTAssertGreaterThan(partialLength, smallData.length);
+
+    SDBenchmarkServerConfig *serverConfig = [SDBenchmarkURLProtocol.serverConfig copy];
+    serverConfig.corpus = smallCorpus;
+    SDBenchmarkURLProtocol.serverConfig = serverConfig;
+    [SDBenchmarkURLProtocol resetStatistics];
+    NSData *data = [self downloadDataOfURL:url downloader:downloader];
+    XCTAssertEqualObjects(data, smallData);
+    // The 416 response discards the partial body, and the retry request has no range
+    NSArray<NSURLRequest *> *requests = [self startedRequestsForHost:kTestHost];
+    XCTAssertEqual(requests.count, 2);
+    XCTAssertNotNil([requests.firstObject valueForHTTPHeaderField:@"Range"]);
+    XCTAssertNil([requests.lastObject valueForHTTPHeaderField:@"Range"]);
+    XCTAssertNil([requests.lastObject valueForHTTPHeaderField:@"If-Range"]);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self partialPathForURL:url]]);
+}
+
+#pragma mark - Helper
+
+- (NSUInteger)largestItemIndex {
+    NSArray<SDBenchmarkCorpusItem *> *items = self.corpus.items;
+    NSUInteger largestIndex = 0;
+    for (NSUInteger i = 1; i < items.count; i++) {
+        if (items[i].data.length > items[largestIndex].data.length) {
+            largestIndex = i;
+        }
+    }
+    return largestIndex;
+}
+
+// See `SDPartialDownloadStore`, the partial body is kept in the hidden directory of disk cache path
+- (NSString *)partialPathForURL:(NSURL *)url {
+    NSString *fileName = [self.cache cachePathForKey:url.absoluteString].lastPathComponent;
+    return [[self.cache.diskCachePath stringByAppendingPathComponent:@".partial"] stringByAppendingPathComponent:fileName];
+}
+
+// Download with slow server, cancel after received the minimum length, returns the persisted partial length
+- (unsigned long long)downloadPartialBodyOfURL:(NSURL *)url minimumLength:(NSUInteger)minimumLength downloader:(ImageLoaderDownloader *)downloader {
+    SDBenchmarkServerConfig *serverConfig = SDBenchmarkURLProtocol.serverConfig;
+    SDBenchmarkServerConfig *slowServerConfig = [serverConfig copy];
+    slowServerConfig.chunkSize = 4 * 1024;
+    slowServerConfig.bandwidth = 64 * 1024;
+    SDBenchmarkURLProtocol.serverConfig = slowServerConfig;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Cancel the download after the partial body received"];
+    __block ImageLoaderDownloadToken *token;
+    __block BOOL cancelled = NO;
+    NSObject *lock = [NSObject new];
+    ImageLoaderDownloadToken *downloadToken = [downloader downloadImageWithURL:url options:ImageLoaderDownloaderResumeDownload context:@{ImageLoaderContextImageCache : self.cache} progress:^(NSInteger receivedSize, NSInteger expectedSize, NSURL * _Nullable targetURL) {
+        if (receivedSize < (NSInteger)minimumLength) {
+            return;
+        }
+        @synchronized (lock) {
+            if (cancelled || !token) {
+                return;
+            }
+            cancelled = YES;
+            [token cancel];
+        }
+    } completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+        XCTAssertNil(image);
+        XCTAssertNotNil(error);
+        [expectation fulfill];
+    }];
+    XCTAssertNotNil(downloadToken);
+    @synchronized (lock) {
+        // The progress may pass the minimum length before the token returned, cancel at the next progress
+        token = downloadToken;
+    }
+    [self waitForExpectationsWithTimeout:kAsyncTestTimeout handler:nil];
+    SDBenchmarkURLProtocol.serverConfig = serverConfig;
+
+    // The partial body is saved on the session delegate queue after the cancel
+    NSString *partialPath = [self partialPathForURL:url];
+    XCTAssertTrue([self waitForCondition:^BOOL{
+        return [[NSFileManager defaultManager] fileExistsAtPath:partialPath];
+    } timeout:kAsyncTestTimeout]);
+    return [[[NSFileManager defaultManager] attributesOfItemAtPath:partialPath error:nil] fileSize];
+}
+
+- (NSData *)downloadDataOfURL:(NSURL *)url downloader:(ImageLoaderDownloader *)downloader {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Download the full body"];
+    __block NSData *downloadedData;
+    [downloader downloadImageWithURL:url options:ImageLoaderDownloaderResumeDownload context:@{ImageLoaderContextImageCache : self.cache} progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+        XCTAssertNotNil(image);
+        XCTAssertNil(error);
+        downloadedData = data;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kAsyncTestTimeout handler:nil];
+    return downloadedData;
+}
+
+@end
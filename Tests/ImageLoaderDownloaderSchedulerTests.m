@@ -0,0 +1,132 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDTestCase.h"
+
+static NSString * const kFastHost = @"fast.imageloader.invalid";
+static NSString * const kSlowHost = @"slow.imageloader.invalid";
+
+/// The tests of the download scheduler, the global and per-host limits, the weighted round-robin across hosts, the suspending and the priority
+@interface ImageLoaderDownloaderSchedulerTests : SDTestCase
+
+@end
+
+@implementation ImageLoaderDownloaderSchedulerTests
+
+- (void)setUp {
+    [super setUp];
+    SDBenchmarkServerConfig *serverConfig = [SDBenchmarkURLProtocol.serverConfig copy];
+    serverConfig.latenciesForHosts = @{kFastHost : @(0.05), kSlowHost : @(3)};
+    SDBenchmarkURLProtocol.serverConfig = serverConfig;
+}
+
+- (void)test01ThatSaturatedSlowHostDoesNotDelayFastHost {
+    ImageLoaderDownloaderConfig *config = [ImageLoaderDownloaderConfig.defaultDownloaderConfig copy];
+    config.maxConcurrentDownloads = 4;
+    config.maxConcurrentDownloadsPerHost = 2;
+    ImageLoaderDownloader *downloader = [self stubDownloaderWithConfig:config];
+    // The burst to slow host is queued first, without the host limit it takes all the slots for 3 seconds
+    for (NSUInteger i = 0; i < 10; i++) {
+        [downloader downloadImageWithURL:[self imageURLAtIndex:i host:kSlowHost] completed:nil];
+    }
+    NSMutableArray<XCTestExpectation *> *expectations = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 4; i++) {
+        XCTestExpectation *expectation = [self expectationWithDescription:@"Fast host download finished"];
+        [expectations addObject:expectation];
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        [downloader downloadImageWithURL:[self imageURLAtIndex:i host:kFastHost] completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            XCTAssertNotNil(image);
+            // Two rounds of the fast host latency, far less than the slow host latency
+            XCTAssertLessThan(CFAbsoluteTimeGetCurrent() - startTime, 1.5);
+            [expectation fulfill];
+        }];
+    }
+    [self waitForExpectations:expectations timeout:kAsyncTestTimeout];
+    // The slow host keeps its own limit
+    XCTAssertEqual([self startedRequestsForHost:kSlowHost].count, 2);
+    XCTAssertEqual([self startedRequestsForHost:kFastHost].count, 4);
+}
+
+- (void)test02ThatHostsShareSlotsByWeight {
+    SDBenchmarkServerConfig *serverConfig = [SDBenchmarkURLProtocol.serverConfig copy];
+    serverConfig.latenciesForHosts = @{kFastHost : @(0), kSlowHost : @(0)};
+    SDBenchmarkURLProtocol.serverConfig = serverConfig;
+    ImageLoaderDownloaderConfig *config = [ImageLoaderDownloaderConfig.defaultDownloaderConfig copy];
+    config.maxConcurrentDownloads = 1;
+    config.downloadWeightsForHosts = @{kFastHost : @(2)};
+    ImageLoaderDownloader *downloader = [self stubDownloaderWithConfig:config];
+    downloader.suspended = YES;
+    NSMutableArray<XCTestExpectation *> *expectations = [NSMutableArray array];
+    for (NSString *host in @[kSlowHost, kFastHost]) {
+        for (NSUInteger i = 0; i < 6; i++) {
+            XCTestExpectation *expectation = [self expectationWithDescription:@"Download finished"];
+            [expectations addObject:expectation];
+            [downloader downloadImageWithURL:[self imageURLAtIndex:i host:host] completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+                [expectation fulfill];
+            }];
+        }
+    }
+    downloader.suspended = NO;
+    [self waitForExpectations:expectations timeout:kAsyncTestTimeout];
+    // The host with weight 2 starts 2 downloads for each download of the host with weight 1, even it's queued later
+    NSArray<NSURLRequest *> *requests = SDBenchmarkURLProtocol.startedRequests;
+    XCTAssertEqual(requests.count, 12);
+    NSUInteger fastCount = 0;
+    for (NSURLRequest *request in [requests subarrayWithRange:NSMakeRange(0, 6)]) {
+        if ([request.URL.host isEqualToString:kFastHost]) {
+            fastCount++;
+        }
+    }
+    XCTAssertEqual(fastCount, 4);
+}
+
+- (void)test03ThatSuspendedDownloaderDoesNotStartDownloads {
+    ImageLoaderDownloader *downloader = [self stubDownloaderWithConfig:nil];
+    downloader.suspended = YES;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Download finished after resumed"];
+    [downloader downloadImageWithURL:[self imageURLAtIndex:0 host:nil] completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }];
+    XCTAssertFalse([self waitForCondition:^BOOL{
+        return SDBenchmarkURLProtocol.requestCount > 0;
+    } timeout:0.5]);
+    downloader.suspended = NO;
+    [self waitForExpectationsWithTimeout:kAsyncTestTimeout handler:nil];
+    XCTAssertEqual(SDBenchmarkURLProtocol.requestCount, 1);
+}
+
+- (void)test04ThatHigherPriorityDownloadStartsFirst {
+    ImageLoaderDownloaderConfig *config = [ImageLoaderDownloaderConfig.defaultDownloaderConfig copy];
+    config.maxConcurrentDownloads = 1;
+    ImageLoaderDownloader *downloader = [self stubDownloaderWithConfig:config];
+    downloader.suspended = YES;
+    NSArray<NSNumber *> *options = @[@(ImageLoaderDownloaderLowPriority), @(0), @(ImageLoaderDownloaderHighPriority), @(ImageLoaderDownloaderLowPriority)];
+    NSMutableArray<XCTestExpectation *> *expectations = [NSMutableArray array];
+    NSMutableArray<ImageLoaderDownloadToken *> *tokens = [NSMutableArray array];
+    for (NSUInteger i = 0; i < options.count; i++) {
+        XCTestExpectation *expectation = [self expectationWithDescription:@"Download finished"];
+        [expectations addObject:expectation];
+        ImageLoaderDownloadToken *token = [downloader downloadImageWithURL:[self imageURLAtIndex:i host:nil] options:options[i].unsignedIntegerValue progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            [expectation fulfill];
+        }];
+        [tokens addObject:token];
+    }
+    // The pending download is reordered by the new priority
+    tokens.lastObject.priority = ImageLoaderDownloadPriorityVisible;
+    downloader.suspended = NO;
+    [self waitForExpectations:expectations timeout:kAsyncTestTimeout];
+    NSMutableArray<NSString *> *paths = [NSMutableArray array];
+    for (NSURLRequest *request in [self startedRequestsForHost:kTestHost]) {
+        [paths addObject:request.URL.path];
+    }
+    NSArray<NSString *> *expectedPaths = @[@"/image/2", @"/image/3", @"/image/1", @"/image/0"];
+    XCTAssertEqualObjects(paths, expectedPaths);
+}
+
+@end
@@ -0,0 +1 @@
+../Example/Benchmark/SDBenchmarkCorpus.h
\ No newline at end of file
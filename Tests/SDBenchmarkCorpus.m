@@ -0,0 +1 @@
+../Example/Benchmark/SDBenchmarkCorpus.m
\ No newline at end of file
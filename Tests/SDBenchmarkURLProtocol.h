@@ -0,0 +1 @@
+../Example/Benchmark/SDBenchmarkURLProtocol.h
\ No newline at end of file
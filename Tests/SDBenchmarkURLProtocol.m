@@ -0,0 +1 @@
+../Example/Benchmark/SDBenchmarkURLProtocol.m
\ No newline at end of file
@@ -0,0 +1,36 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <XCTest/XCTest.h>
+#import <ImageLoader/ImageLoader.h>
+#import "SDBenchmarkURLProtocol.h"
+#import "SDBenchmarkCorpus.h"
+
+FOUNDATION_EXPORT const NSTimeInterval kAsyncTestTimeout;
+/// The host of the stand-in server
+FOUNDATION_EXPORT NSString * _Nonnull const kTestHost;
+
+/**
+ The base test case for the downloader tests. The requests are served by the in process stand-in server `SDBenchmarkURLProtocol`, so the tests run offline.
+ The server config is reset to `kTestHost` with a small corpus, and the started requests are recorded, for each test.
+ */
+@interface SDTestCase : XCTestCase
+
+/// The served corpus
+@property (nonatomic, strong, readonly, nonnull) SDBenchmarkCorpus *corpus;
+
+/// Create a downloader whose session only loads from the stand-in server, it's invalidated in `tearDown`
+- (nonnull ImageLoaderDownloader *)stubDownloaderWithConfig:(nullable ImageLoaderDownloaderConfig *)config;
+/// The URL of the corpus item on host, nil host means `kTestHost`
+- (nonnull NSURL *)imageURLAtIndex:(NSUInteger)index host:(nullable NSString *)host;
+/// The started GET requests for host, in order
+- (nonnull NSArray<NSURLRequest *> *)startedRequestsForHost:(nonnull NSString *)host;
+/// Run the main run loop until the condition is YES or timeout, returns the condition
+- (BOOL)waitForCondition:(nonnull BOOL (^)(void))condition timeout:(NSTimeInterval)timeout;
+
+@end
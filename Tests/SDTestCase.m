@@ -0,0 +1,81 @@
+/*
+ * This file is part of the ImageLoader package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDTestCase.h"
+
+const NSTimeInterval kAsyncTestTimeout = 10;
+NSString * const kTestHost = @"test.imageloader.invalid";
+
+@interface SDTestCase ()
+
+@property (nonatomic, strong, readwrite) SDBenchmarkCorpus *corpus;
+@property (nonatomic, strong) NSMutableArray<ImageLoaderDownloader *> *downloaders;
+
+@end
+
+@implementation SDTestCase
+
+- (void)setUp {
+    [super setUp];
+    self.corpus = [[SDBenchmarkCorpus alloc] initWithCount:6 seed:1];
+    self.downloaders = [NSMutableArray array];
+    SDBenchmarkServerConfig *serverConfig = [SDBenchmarkServerConfig new];
+    serverConfig.host = kTestHost;
+    serverConfig.corpus = self.corpus;
+    SDBenchmarkURLProtocol.serverConfig = serverConfig;
+    SDBenchmarkURLProtocol.recordsRequests = YES;
+    [SDBenchmarkURLProtocol resetStatistics];
+}
+
+- (void)tearDown {
+    for (ImageLoaderDownloader *downloader in self.downloaders) {
+        [downloader invalidateSessionAndCancel:YES];
+    }
+    self.downloaders = nil;
+    SDBenchmarkURLProtocol.recordsRequests = NO;
+    [SDBenchmarkURLProtocol resetStatistics];
+    [super tearDown];
+}
+
+- (ImageLoaderDownloader *)stubDownloaderWithConfig:(ImageLoaderDownloaderConfig *)config {
+    ImageLoaderDownloaderConfig *downloaderConfig = config ? [config copy] : [ImageLoaderDownloaderConfig.defaultDownloaderConfig copy];
+    NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    sessionConfiguration.protocolClasses = @[SDBenchmarkURLProtocol.class];
+    sessionConfiguration.URLCache = nil;
+    downloaderConfig.sessionConfiguration = sessionConfiguration;
+    ImageLoaderDownloader *downloader = [[ImageLoaderDownloader alloc] initWithConfig:downloaderConfig];
+    [self.downloaders addObject:downloader];
+    return downloader;
+}
+
+- (NSURL *)imageURLAtIndex:(NSUInteger)index host:(NSString *)host {
+    return [NSURL URLWithString:[NSString stringWithFormat:@"http://%@/image/%lu", host ?: kTestHost, (unsigned long)index]];
+}
+
+- (NSArray<NSURLRequest *> *)startedRequestsForHost:(NSString *)host {
+    NSMutableArray<NSURLRequest *> *requests = [NSMutableArray array];
+    for (NSURLRequest *request in SDBenchmarkURLProtocol.startedRequests) {
+        if ([request.URL.host caseInsensitiveCompare:host] == NSOrderedSame && [request.HTTPMethod isEqualToString:@"GET"]) {
+            [requests addObject:request];
+        }
+    }
+    return [requests copy];
+}
+
+- (BOOL)waitForCondition:(BOOL (^)(void))condition timeout:(NSTimeInterval)timeout {
+    NSDate *timeoutDate = [NSDate dateWithTimeIntervalSinceNow:timeout];
+    while (!condition()) {
+        if ([timeoutDate timeIntervalSinceNow] <= 0) {
+            return NO;
+        }
+        [[NSRunLoop mainRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return YES;
+}
+
+@end
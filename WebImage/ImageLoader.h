@@ -20,6 +20,7 @@ FOUNDATION_EXPORT const unsigned char ImageLoaderVersionString[];
 #import <ImageLoader/ImageLoaderManager.h>
 #import <ImageLoader/SDCallbackQueue.h>
 #import <ImageLoader/ImageLoaderCacheKeyFilter.h>
+#import <ImageLoader/ImageLoaderVariantResolver.h>
 #import <ImageLoader/ImageLoaderCacheSerializer.h>
 #import <ImageLoader/LoadImageCacheConfig.h>
 #import <ImageLoader/LoadImageCache.h>
@@ -27,13 +28,19 @@ FOUNDATION_EXPORT const unsigned char ImageLoaderVersionString[];
 #import <ImageLoader/SDDiskCache.h>
 #import <ImageLoader/LoadImageCacheDefine.h>
 #import <ImageLoader/LoadImageCachesManager.h>
+#import <ImageLoader/LoadImageCacheStatistics.h>
 #import <ImageLoader/UIView+WebCache.h>
 #import <ImageLoader/UIImageView+WebCache.h>
 #import <ImageLoader/UIImageView+HighlightedWebCache.h>
 #import <ImageLoader/ImageLoaderDownloaderConfig.h>
+#import <ImageLoader/ImageLoaderDownloaderConcurrencyDecision.h>
+#import <ImageLoader/ImageLoaderDownloaderRetryPolicy.h>
+#import <ImageLoader/ImageLoaderDownloaderMetricsAggregator.h>
 #import <ImageLoader/ImageLoaderDownloaderOperation.h>
 #import <ImageLoader/ImageLoaderDownloaderRequestModifier.h>
 #import <ImageLoader/ImageLoaderDownloaderResponseModifier.h>
+#import <ImageLoader/ImageLoaderDownloaderHeaderPolicy.h>
+#import <ImageLoader/LoadImageHeaderInfo.h>
 #import <ImageLoader/ImageLoaderDownloaderDecryptor.h>
 #import <ImageLoader/LoadImageLoader.h>
 #import <ImageLoader/LoadImageLoadersManager.h>